@@ -54,6 +54,8 @@ typedef unsigned @VMIME_64BIT_TYPE@ vmime_uint64;
 #cmakedefine01 VMIME_HAVE_FILESYSTEM_FEATURES
 // -- SASL support
 #cmakedefine01 VMIME_HAVE_SASL_SUPPORT
+// -- Compression support
+#cmakedefine01 VMIME_HAVE_ZLIB_SUPPORT
 // -- TLS/SSL support
 #cmakedefine01 VMIME_HAVE_TLS_SUPPORT
 #cmakedefine01 VMIME_TLS_SUPPORT_LIB_IS_GNUTLS
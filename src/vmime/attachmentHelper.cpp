@@ -45,7 +45,7 @@ bool attachmentHelper::isBodyPartAnAttachment(
 	// First, try with "Content-Disposition" field.
 	// If not present, we will try with "Content-Type" field.
 	shared_ptr <const contentDispositionField> cdf =
-		part->getHeader()->findField <contentDispositionField>(fields::CONTENT_DISPOSITION);
+		part->getHeader()->findField <contentDispositionField>(fields::ID_CONTENT_DISPOSITION);
 
 	if (cdf) {
 
@@ -79,7 +79,7 @@ bool attachmentHelper::isBodyPartAnAttachment(
 	bool hasContentTypeName = false;
 
 	shared_ptr <const contentTypeField> ctf =
-		part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -143,7 +143,7 @@ shared_ptr <const attachment> attachmentHelper::getBodyPartAttachment(
 	mediaType type;
 
 	shared_ptr <const contentTypeField> ctf =
-		part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -235,14 +235,14 @@ void attachmentHelper::addAttachment(const shared_ptr <message>& msg, const shar
 			// the root part of the message
 			shared_ptr <bodyPart> container = make_shared <bodyPart>();
 
-			if (msg->getHeader()->hasField(fields::CONTENT_TYPE)) {
+			if (msg->getHeader()->hasField(fields::ID_CONTENT_TYPE)) {
 
 				container->getHeader()->ContentType()->setValue(
 					msg->getHeader()->ContentType()->getValue()
 				);
 			}
 
-			if (msg->getHeader()->hasField(fields::CONTENT_TRANSFER_ENCODING)) {
+			if (msg->getHeader()->hasField(fields::ID_CONTENT_TRANSFER_ENCODING)) {
 
 				container->getHeader()->ContentTransferEncoding()->setValue(
 					msg->getHeader()->ContentTransferEncoding()->getValue()
@@ -268,14 +268,14 @@ void attachmentHelper::addAttachment(const shared_ptr <message>& msg, const shar
 			// root to a new child part.
 			shared_ptr <bodyPart> child = make_shared <bodyPart>();
 
-			if (msg->getHeader()->hasField(fields::CONTENT_TYPE)) {
+			if (msg->getHeader()->hasField(fields::ID_CONTENT_TYPE)) {
 
 				child->getHeader()->ContentType()->setValue(
 					msg->getHeader()->ContentType()->getValue()
 				);
 			}
 
-			if (msg->getHeader()->hasField(fields::CONTENT_TRANSFER_ENCODING)) {
+			if (msg->getHeader()->hasField(fields::ID_CONTENT_TRANSFER_ENCODING)) {
 
 				child->getHeader()->ContentTransferEncoding()->setValue(
 					msg->getHeader()->ContentTransferEncoding()->getValue()
@@ -31,6 +31,8 @@
 
 #include "vmime/utility/seekableInputStreamRegionAdapter.hpp"
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/nullOutputStream.hpp"
+#include "vmime/utility/stringUtils.hpp"
 
 #include "vmime/parserHelpers.hpp"
 
@@ -43,7 +45,11 @@ namespace vmime {
 
 
 body::body()
-	: m_contents(make_shared <emptyContentHandler>()) {
+	: m_contents(make_shared <emptyContentHandler>()),
+	  m_memoContentsRevision(0),
+	  m_memoContentsLength(0),
+	  m_memoMaxLineLength(0),
+	  m_memoSize(0) {
 
 }
 
@@ -53,71 +59,151 @@ body::~body() {
 }
 
 
-/*
- * boundaryStart: will become the index for "\r\n--marker"
- * boundaryEnd:   will become the index after "marker", i.e. index for potential trailing "--", "\r\n", etc.
- * return value:  index for "marker"
- */
 // static
-size_t body::findNextBoundaryPosition(
+void body::findBoundaryPositions(
 	const shared_ptr <utility::parserInputStreamAdapter>& parser,
 	const string& boundary,
 	const size_t position,
 	const size_t end,
-	size_t* boundaryStart,
-	size_t* boundaryEnd
+	std::vector <boundaryPosition>& positions
 ) {
 
-	size_t pos = position;
+	static const size_t BLOCK_SIZE = 65536;
 
-	for (; pos != npos && pos < end; ++pos) {
+	// We are looking for "[LF]--boundary", followed by a new line or a dash
+	const string delimiter = "\n--" + boundary;
+	const size_t delimiterLength = delimiter.length();
 
-		pos = parser->findNext(boundary, pos);
+	if (position >= end || boundary.empty()) {
+		return;
+	}
 
-		if (pos == npos) {
-			break;  // not found
-		}
+	// Start a few bytes before the start position, as the "[CR][LF]--" may
+	// precede it (eg. first boundary right after the header)
+	const size_t scanStart = (position >= 4 ? position - 4 : 0);
 
-		if (pos == 0) {
-			// Boundary is a prefix of another, continue the search (same for the other "continue"s)
-			continue;
-		}
+	// Do not read past the byte following the last possible boundary
+	const size_t scanEnd = end + boundary.length();
 
-		// Ensure the bytes before boundary are "[LF]--": boundary should be
-		// at the beginning of a line, and should start with "--"
-		if (pos < 3) {
-			continue;
-		}
-		parser->seek(pos - 3);
-		if (!parser->matchBytes("\n--", 3)) {
-			continue;
-		}
+	std::vector <byte_t> buffer(std::max(BLOCK_SIZE, 2 * (delimiterLength + 1)));
 
-		parser->seek(pos + boundary.length());
+	size_t bufferStart = scanStart;   // stream position of buffer[0]
+	size_t bufferLength = 0;
+	size_t searchFrom = 0;            // index in buffer where to search the next [LF]
 
-		const byte_t next = parser->peekByte();
+	bool isEOF = false;
 
-		// Boundary should be followed by a new line or a dash
-		if (!isspace(next) && next != '-') {
-			continue;
-		}
+	const size_t initialPos = parser->getPosition();
+
+	try {
+
+		parser->seek(scanStart);
+
+		while (true) {
+
+			// Fill in the buffer
+			if (!isEOF && bufferLength < buffer.size() && bufferStart + bufferLength < scanEnd) {
+
+				const size_t bytesToRead =
+					std::min(buffer.size() - bufferLength, scanEnd - (bufferStart + bufferLength));
+
+				const size_t bytesRead = parser->read(&buffer[bufferLength], bytesToRead);
+
+				if (bytesRead == 0) {
+					isEOF = true;
+				}
+
+				bufferLength += bytesRead;
+			}
+
+			if (bufferStart + bufferLength >= scanEnd) {
+				isEOF = true;
+			}
+
+			bool needMore = false;
+
+			while (searchFrom < bufferLength) {
+
+				const byte_t* const bufferEnd = &buffer[0] + bufferLength;
+				const byte_t* lf = utility::stringUtils::findFirstOf
+					(&buffer[searchFrom], bufferEnd, '\n', '\n');
+
+				if (lf == bufferEnd) {
+					searchFrom = bufferLength;
+					break;
+				}
+
+				const size_t i = lf - &buffer[0];
+				const size_t pos = bufferStart + i + 3;  // position of boundary
+
+				if (pos >= end) {
+					parser->seek(initialPos);
+					return;
+				}
+
+				// Not enough bytes in buffer for checking the delimiter and the
+				// byte which follows: read more data
+				if (i + delimiterLength >= bufferLength && !isEOF) {
+					searchFrom = i;
+					needMore = true;
+					break;
+				}
+
+				if (pos >= position &&
+				    i + delimiterLength <= bufferLength &&
+				    ::memcmp(&buffer[i], delimiter.data(), delimiterLength) == 0) {
+
+					const byte_t next =
+						(i + delimiterLength < bufferLength
+							? buffer[i + delimiterLength]
+							: static_cast <byte_t>(0));
+
+					// Boundary should be followed by a new line or a dash
+					if (isspace(next) || next == '-') {
+
+						boundaryPosition bp;
+
+						// Get rid of the "[CR]" just before "[LF]--", if any
+						bp.start = (i >= 1 && buffer[i - 1] == '\r' && pos >= 4 ? pos - 4 : pos - 3);
+						bp.boundary = pos;
+						bp.end = pos + boundary.length();
+
+						positions.push_back(bp);
+					}
+				}
+
+				searchFrom = i + 1;
+			}
+
+			if (isEOF && !needMore) {
+				break;
+			}
 
-		// Get rid of the "[CR]" just before "[LF]--", if any
-		size_t backwards = 0;
-		if (pos >= 4) {
-			parser->seek(pos - 4);
-			if (parser->peekByte() == '\r') {
-				++backwards;
+			// Discard bytes which have already been scanned, but keep the
+			// byte preceding the next [LF] (which may be a [CR])
+			const size_t discard = (searchFrom >= 1 ? searchFrom - 1 : 0);
+
+			if (discard != 0) {
+
+				::memmove(&buffer[0], &buffer[discard], bufferLength - discard);
+
+				bufferStart += discard;
+				bufferLength -= discard;
+				searchFrom -= discard;
+
+			} else if (bufferLength == buffer.size() || isEOF) {
+
+				break;  // should not happen
 			}
 		}
 
-		*boundaryStart = pos - backwards - 3;
-		*boundaryEnd = pos + boundary.length();
+		parser->seek(initialPos);
 
-		return pos;
-	}
+	} catch (...) {
 
-	return pos;
+		parser->seek(initialPos);
+		throw;
+	}
 }
 
 
@@ -151,7 +237,7 @@ void body::parseImpl(
 	string boundary;
 
 	shared_ptr <const contentTypeField> ctf =
-		m_part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		m_part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -243,17 +329,21 @@ void body::parseImpl(
 	if (isMultipart && !boundary.empty()) {
 
 		size_t partStart = position;
-		size_t pos = position;
 
 		bool lastPart = false;
 
-		// Find the first boundary
-		size_t boundaryStart, boundaryEnd;
-		pos = findNextBoundaryPosition(parser, boundary, pos, end, &boundaryStart, &boundaryEnd);
+		// Find all boundaries at once
+		std::vector <boundaryPosition> boundaries;
+		findBoundaryPositions(parser, boundary, position, end, boundaries);
+
+		std::vector <boundaryPosition>::const_iterator it = boundaries.begin();
+
+		for (int index = 0 ; !lastPart && it != boundaries.end() ; ++index) {
 
-		for (int index = 0 ; !lastPart && (pos != npos) && (pos < end) ; ++index) {
+			size_t partEnd = it->start;
+			size_t boundaryEnd = it->end;
 
-			size_t partEnd = boundaryStart;
+			++it;
 
 			// Check whether it is the last part (boundary terminated by "--")
 			parser->seek(boundaryEnd);
@@ -286,7 +376,11 @@ void body::parseImpl(
 				 * facilitate broken mails.
 				 */
 				boundaryEnd += parser->skipIf([](char_t c) { return c != '\n'; }, end);
-				pos = findNextBoundaryPosition(parser, boundary, boundaryEnd, end, &boundaryStart, &boundaryEnd);
+
+				while (it != boundaries.end() && it->boundary < boundaryEnd) {
+					++it;
+				}
+
 				--index;
 				continue;
 			}
@@ -322,16 +416,16 @@ void body::parseImpl(
 
 			partStart = boundaryEnd;
 
-			// Find the next boundary
-			pos = findNextBoundaryPosition(
-				parser, boundary, boundaryEnd, end, &boundaryStart, &boundaryEnd
-			);
+			// Skip to the next boundary
+			while (it != boundaries.end() && it->boundary < boundaryEnd) {
+				++it;
+			}
 		}
 
 		m_contents = make_shared <emptyContentHandler>();
 
 		// Last part was not found: recover from missing boundary
-		if (!lastPart && pos == npos) {
+		if (!lastPart) {
 
 			shared_ptr <bodyPart> part = m_part->createChildPart();
 
@@ -358,7 +452,7 @@ void body::parseImpl(
 		encoding enc;
 
 		shared_ptr <const headerField> cef =
-			m_part->getHeader()->findField(fields::CONTENT_TRANSFER_ENCODING);
+			m_part->getHeader()->findField(fields::ID_CONTENT_TRANSFER_ENCODING);
 
 		if (cef) {
 
@@ -446,7 +540,7 @@ void body::generateImpl(
 			// Use current boundary string, if specified. If no "Content-Type" field is
 			// present, or the boundary is not specified, generate a random one
 			shared_ptr <contentTypeField> ctf =
-				m_part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+				m_part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 			if (ctf) {
 
@@ -510,6 +604,17 @@ void body::generateImpl(
 	// Simple body
 	} else {
 
+		// When only counting bytes, there is no need to encode the
+		// contents again if we already know the size of encoded data
+		utility::nullOutputStream* nos = dynamic_cast <utility::nullOutputStream*>(&os);
+		size_t size = 0;
+
+		if (nos && getMemoizedContentsSize(ctx, &size)) {
+
+			nos->advance(size);
+			return;
+		}
+
 		// Generate the contents
 		shared_ptr <contentHandler> contents = m_contents->clone();
 		contents->setContentTypeHint(getContentType());
@@ -519,6 +624,53 @@ void body::generateImpl(
 }
 
 
+void body::memoizeGeneratedSize(const generationContext& ctx) {
+
+	component::memoizeGeneratedSize(ctx);
+
+	if (getPartCount() != 0 || getMemoizedContentsSize(ctx, NULL)) {
+		return;
+	}
+
+	shared_ptr <contentHandler> contents = m_contents->clone();
+	contents->setContentTypeHint(getContentType());
+
+	utility::nullOutputStream nos;
+	contents->generate(nos, getEncoding(), ctx.getMaxLineLength());
+
+	m_memoContents = m_contents;
+	m_memoContentsRevision = m_contents->getRevision();
+	m_memoContentsLength = m_contents->getLength();
+	m_memoMaxLineLength = ctx.getMaxLineLength();
+	m_memoEncoding = getEncoding().getName();
+	m_memoContentType = getContentType();
+	m_memoSize = nos.getByteCount();
+}
+
+
+bool body::getMemoizedContentsSize(const generationContext& ctx, size_t* size) const {
+
+	// Memoized size is only valid if neither the contents nor any of
+	// the parameters used to encode them have changed since
+	if (m_memoContents.owner_before(m_contents) || m_contents.owner_before(m_memoContents) ||
+	    m_memoContents.expired() ||
+	    m_memoContentsRevision != m_contents->getRevision() ||
+	    m_memoContentsLength != m_contents->getLength() ||
+	    m_memoMaxLineLength != ctx.getMaxLineLength() ||
+	    m_memoEncoding != getEncoding().getName() ||
+	    !(m_memoContentType == getContentType())) {
+
+		return false;
+	}
+
+	if (size) {
+		*size = m_memoSize;
+	}
+
+	return true;
+}
+
+
 size_t body::getGeneratedSize(const generationContext& ctx) {
 
 	// MIME-Multipart
@@ -568,7 +720,14 @@ size_t body::getGeneratedSize(const generationContext& ctx) {
 	// Simple body
 	} else {
 
-		if (getEncoding() == m_contents->getEncoding()) {
+		size_t size = 0;
+
+		if (getMemoizedContentsSize(ctx, &size)) {
+
+			// Exact size is known from a previous call to getExactGeneratedSize()
+			return size;
+
+		} else if (getEncoding() == m_contents->getEncoding()) {
 
 			// No re-encoding has to be performed
 			return m_contents->getLength();
@@ -691,7 +850,7 @@ void body::setContentType(const mediaType& type) {
 const mediaType body::getContentType() const {
 
 	shared_ptr <const contentTypeField> ctf =
-		m_part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		m_part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -708,7 +867,7 @@ const mediaType body::getContentType() const {
 void body::setCharset(const charset& chset) {
 
 	shared_ptr <contentTypeField> ctf =
-		m_part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		m_part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	// If a Content-Type field exists, set charset
 	if (ctf) {
@@ -727,7 +886,7 @@ void body::setCharset(const charset& chset) {
 const charset body::getCharset() const {
 
 	const shared_ptr <const contentTypeField> ctf =
-		m_part->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		m_part->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -758,7 +917,7 @@ void body::setEncoding(const encoding& enc) {
 const encoding body::getEncoding() const {
 
 	shared_ptr <const headerField> cef =
-		m_part->getHeader()->findField(fields::CONTENT_TRANSFER_ENCODING);
+		m_part->getHeader()->findField(fields::ID_CONTENT_TRANSFER_ENCODING);
 
 	if (cef) {
 
@@ -864,6 +1023,25 @@ const shared_ptr <const contentHandler> body::getContents() const {
 }
 
 
+bool body::isBuffered() const {
+
+	// MIME-Multipart: contents are not generated
+	if (getPartCount() != 0) {
+
+		for (size_t i = 0 ; i < m_parts.size() ; ++i) {
+
+			if (!m_parts[i]->getBody()->isBuffered()) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	return m_contents->isBuffered();
+}
+
+
 void body::setContents(const shared_ptr <const contentHandler>& contents) {
 
 	m_contents = contents;
@@ -924,7 +1102,7 @@ void body::initNewPart(const shared_ptr <bodyPart>& part) {
 
 		// Check whether we have a boundary string
 		shared_ptr <contentTypeField> ctf =
-			hdr->findField <contentTypeField>(fields::CONTENT_TYPE);
+			hdr->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 		if (ctf) {
 
@@ -952,7 +1130,7 @@ void body::initNewPart(const shared_ptr <bodyPart>& part) {
 
 			// No "Content-Type" field: create a new one and generate
 			// a random boundary string.
-			ctf = hdr->getField <contentTypeField>(fields::CONTENT_TYPE);
+			ctf = hdr->getField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 			ctf->setValue(mediaType(mediaTypes::MULTIPART, mediaTypes::MULTIPART_MIXED));
 			ctf->setBoundary(generateRandomBoundaryString());
@@ -182,6 +182,15 @@ public:
 	  */
 	const shared_ptr <const contentHandler> getContents() const;
 
+	/** Indicates whether this body can be generated multiple times,
+	  * that is whether the contents of this body and of all its sub-parts
+	  * can be read multiple times (see contentHandler::isBuffered()).
+	  *
+	  * @return true if this body can be generated multiple times, or false
+	  * if some contents are read from a stream which cannot be reset
+	  */
+	bool isBuffered() const;
+
 	/** Set the body contents.
 	  *
 	  * @param contents new body contents
@@ -304,6 +313,8 @@ private:
 
 	void setParentPart(bodyPart* parent);
 
+	bool getMemoizedContentsSize(const generationContext& ctx, size_t* size) const;
+
 
 	string m_prologText;
 	string m_epilogText;
@@ -314,31 +325,50 @@ private:
 
 	std::vector <shared_ptr <bodyPart> > m_parts;
 
+	// Size of the encoded contents, memoized by memoizeGeneratedSize(),
+	// and the parameters it depends on
+	weak_ptr <const contentHandler> m_memoContents;
+	size_t m_memoContentsRevision;
+	size_t m_memoContentsLength;
+	string m_memoEncoding;
+	mediaType m_memoContentType;
+	size_t m_memoMaxLineLength;
+	size_t m_memoSize;
+
 	bool isRootPart() const;
 
 	void initNewPart(const shared_ptr <bodyPart>& part);
 
 protected:
 
-	/** Finds the next boundary position in the parsing buffer.
+	void memoizeGeneratedSize(const generationContext& ctx);
+
+	/** Position of a boundary delimiter line in the parsing buffer.
+	  */
+	struct boundaryPosition {
+
+		size_t start;     /**< start of the delimiter (including any CR/LF and "--" before the boundary) */
+		size_t boundary;  /**< position of the boundary string */
+		size_t end;       /**< position just after the boundary string (before the CRLF or "--" which follows) */
+	};
+
+	/** Finds all boundary positions in the parsing buffer, in a single
+	  * forward pass. The input is read in large blocks and line feeds are
+	  * located with memchr(), so that only the bytes at the start of a
+	  * line are compared against the boundary.
 	  *
 	  * @param parser parser object
 	  * @param boundary boundary string (without "--" nor CR/LF)
 	  * @param position start position
 	  * @param end end position
-	  * @param boundaryStart will hold the start position of the boundary (including any
-	  * CR/LF and "--" before the boundary)
-	  * @param boundaryEnd will hold the end position of the boundary (position just
-	  * before the CRLF or "--" which follows)
-	  * @return the position of the boundary string, or npos if not found
+	  * @param positions will receive the boundary positions, in order
 	  */
-	size_t findNextBoundaryPosition(
+	static void findBoundaryPositions(
 		const shared_ptr <utility::parserInputStreamAdapter>& parser,
 		const string& boundary,
 		const size_t position,
 		const size_t end,
-		size_t* boundaryStart,
-		size_t* boundaryEnd
+		std::vector <boundaryPosition>& positions
 	);
 
 	// Component parsing & assembling
@@ -87,7 +87,7 @@ const text bodyPartAttachment::getDescription() const {
 	text description;
 
 	shared_ptr <const headerField> cd =
-		getHeader()->findField(fields::CONTENT_DESCRIPTION);
+		getHeader()->findField(fields::ID_CONTENT_DESCRIPTION);
 
 	if (cd) {
 
@@ -128,13 +128,13 @@ shared_ptr <const header> bodyPartAttachment::getHeader() const {
 
 shared_ptr <const contentDispositionField> bodyPartAttachment::getContentDisposition() const {
 
-	return getHeader()->findField <contentDispositionField>(fields::CONTENT_DISPOSITION);
+	return getHeader()->findField <contentDispositionField>(fields::ID_CONTENT_DISPOSITION);
 }
 
 
 shared_ptr <const contentTypeField> bodyPartAttachment::getContentType() const {
 
-	return getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+	return getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 }
 
 
@@ -27,6 +27,8 @@
 #include "vmime/utility/streamUtils.hpp"
 #include "vmime/utility/inputStreamStringAdapter.hpp"
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
+#include "vmime/utility/nullOutputStream.hpp"
 
 #include <sstream>
 
@@ -80,12 +82,15 @@ void component::parse(
 	if (!seekableStream || end == 0) {
 
 		// Read the whole stream into a buffer
-		std::ostringstream oss;
-		utility::outputStreamAdapter ossAdapter(oss);
+		string buffer;
+		utility::outputStreamStringAdapter bufferAdapter(buffer);
 
-		utility::bufferedStreamCopyRange(*inputStream, ossAdapter, position, end - position);
+		if (end > position) {
+			buffer.reserve(end - position);
+		}
+
+		utility::bufferedStreamCopyRange(*inputStream, bufferAdapter, position, end - position);
 
-		const string buffer = oss.str();
 		parseImpl(ctx, buffer, 0, buffer.length(), NULL);
 
 	} else {
@@ -272,4 +277,27 @@ size_t component::getGeneratedSize(const generationContext& ctx) {
 }
 
 
+size_t component::getExactGeneratedSize(const generationContext& ctx) {
+
+	memoizeGeneratedSize(ctx);
+
+	utility::nullOutputStream nos;
+	generate(ctx, nos);
+
+	return nos.getByteCount();
+}
+
+
+void component::memoizeGeneratedSize(const generationContext& ctx) {
+
+	std::vector <shared_ptr <component> > children = getChildComponents();
+
+	for (std::vector <shared_ptr <component> >::iterator it = children.begin() ;
+	     it != children.end() ; ++it) {
+
+		(*it)->memoizeGeneratedSize(ctx);
+	}
+}
+
+
 } // vmime
@@ -222,6 +222,20 @@ public:
 	  */
 	virtual size_t getGeneratedSize(const generationContext& ctx);
 
+	/** Get the exact number of bytes that will be used by this component
+	  * when it is generated. The component is generated into a stream
+	  * which only counts bytes, so memory usage does not depend on the
+	  * size of the component. The size of encoded body contents is
+	  * memoized, so the contents are not encoded again on later calls
+	  * unless they have been modified since. Contents are read by this
+	  * function: if they cannot be read twice (see body::isBuffered()),
+	  * generate the component into a buffer instead.
+	  *
+	  * @param ctx generation context
+	  * @return exact component size when generated
+	  */
+	size_t getExactGeneratedSize(const generationContext& ctx);
+
 protected:
 
 	void setParsedBounds(const size_t start, const size_t end);
@@ -250,9 +264,21 @@ protected:
 		size_t* newLinePos = NULL
 	) const = 0;
 
+	/** Compute and store any data which can make generating this
+	  * component into a utility::nullOutputStream faster. This is
+	  * called by getExactGeneratedSize(), so that generate() never
+	  * modifies the component. The default implementation calls
+	  * this function on each child component.
+	  *
+	  * @param ctx generation context
+	  */
+	virtual void memoizeGeneratedSize(const generationContext& ctx);
+
 private:
 
-	void offsetParsedBounds(const size_t offset);
+	friend class headerField;
+
+	virtual void offsetParsedBounds(const size_t offset);
 
 	size_t m_parsedOffset;
 	size_t m_parsedLength;
@@ -211,6 +211,54 @@ namespace vmime {
 		extern VMIME_EXPORT const char* const FINAL_RECIPIENT;
 		extern VMIME_EXPORT const char* const REPORTING_UA;
 		extern VMIME_EXPORT const char* const MDN_GATEWAY;
+
+		/** Identifiers of the field names above. They can be used to
+		  * look up fields in a header without comparing field names
+		  * (see header::findField(const fields::Id)).
+		  */
+		enum Id {
+			ID_UNKNOWN = 0,  /**< Field name is not one of the above. */
+			ID_RECEIVED,
+			ID_FROM,
+			ID_SENDER,
+			ID_REPLY_TO,
+			ID_TO,
+			ID_CC,
+			ID_BCC,
+			ID_DATE,
+			ID_SUBJECT,
+			ID_ORGANIZATION,
+			ID_USER_AGENT,
+			ID_DELIVERED_TO,
+			ID_RETURN_PATH,
+			ID_MIME_VERSION,
+			ID_MESSAGE_ID,
+			ID_CONTENT_TYPE,
+			ID_CONTENT_TRANSFER_ENCODING,
+			ID_CONTENT_DESCRIPTION,
+			ID_CONTENT_DISPOSITION,
+			ID_CONTENT_ID,
+			ID_CONTENT_LOCATION,
+			ID_IN_REPLY_TO,
+			ID_REFERENCES,
+
+			ID_X_MAILER,
+			ID_X_PRIORITY,
+
+			ID_ORIGINAL_MESSAGE_ID,
+			ID_DISPOSITION_NOTIFICATION_TO,
+			ID_DISPOSITION_NOTIFICATION_OPTIONS,
+			ID_DISPOSITION,
+			ID_FAILURE,
+			ID_ERROR,
+			ID_WARNING,
+			ID_ORIGINAL_RECIPIENT,
+			ID_FINAL_RECIPIENT,
+			ID_REPORTING_UA,
+			ID_MDN_GATEWAY,
+
+			ID_COUNT  /**< Number of identifiers. */
+		};
 	}
 
 	/** Constants for disposition action modes (RFC-3978). */
@@ -31,9 +31,27 @@ namespace vmime {
 const encoding contentHandler::NO_ENCODING(encodingTypes::BINARY);
 
 
+contentHandler::contentHandler()
+	: m_revision(0) {
+
+}
+
+
 contentHandler::~contentHandler() {
 
 }
 
 
+size_t contentHandler::getRevision() const {
+
+	return m_revision;
+}
+
+
+void contentHandler::incrementRevision() {
+
+	++m_revision;
+}
+
+
 } // vmime
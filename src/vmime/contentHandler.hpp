@@ -138,6 +138,27 @@ public:
 	  * @return type content media type
 	  */
 	virtual const mediaType getContentTypeHint() const = 0;
+
+	/** Returns a number which changes each time the data managed by
+	  * this object is modified. This can be used to know whether a
+	  * result computed from the data is still valid.
+	  *
+	  * @return revision of data
+	  */
+	size_t getRevision() const;
+
+protected:
+
+	contentHandler();
+
+	/** Must be called by derived classes each time the data
+	  * managed by this object is modified.
+	  */
+	void incrementRevision();
+
+private:
+
+	size_t m_revision;
 };
 
 
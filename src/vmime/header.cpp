@@ -24,7 +24,10 @@
 #include "vmime/header.hpp"
 #include "vmime/parserHelpers.hpp"
 
+#include "vmime/utility/parserInputStreamAdapter.hpp"
+
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 
 
@@ -36,6 +39,13 @@ header::header() {
 }
 
 
+header::header(const header& other)
+	: component() {
+
+	copyFrom(other);
+}
+
+
 header::~header() {
 
 	removeAllFields();
@@ -61,6 +71,85 @@ field-body-contents =
 		 specials tokens, or else consisting of texts>
 */
 
+/** Finds the end of the header block, ie. the position just after the
+  * empty line which separates the header from the body.
+  *
+  * @param parser parser object
+  * @param position start position of the header
+  * @param end end position
+  * @return position just after the empty line, or end if not found
+  */
+static size_t findEndOfHeader(
+	const shared_ptr <utility::parserInputStreamAdapter>& parser,
+	const size_t position,
+	const size_t end
+) {
+
+	byte_t buffer[4096];
+
+	// Header starts at the beginning of a line
+	buffer[0] = '\n';
+
+	size_t length = 1;
+	size_t streamPos = position;  // stream position of buffer[length]
+
+	parser->seek(position);
+
+	while (streamPos < end) {
+
+		const size_t bytesRead =
+			parser->read(buffer + length, std::min(sizeof(buffer) - length, end - streamPos));
+
+		if (bytesRead == 0) {
+			break;
+		}
+
+		length += bytesRead;
+		streamPos += bytesRead;
+
+		// Look for "[LF][LF]" or "[LF][CR][LF]"
+		for (size_t i = 0 ; i < length ; ++i) {
+
+			const byte_t* lf = static_cast <const byte_t*>(::memchr(buffer + i, '\n', length - i));
+
+			if (!lf) {
+				break;
+			}
+
+			i = lf - buffer;
+
+			if (i + 1 < length && buffer[i + 1] == '\n') {
+				return streamPos - length + i + 2;
+			} else if (i + 2 < length && buffer[i + 1] == '\r' && buffer[i + 2] == '\n') {
+				return streamPos - length + i + 3;
+			}
+		}
+
+		// Keep the last bytes, which may be the beginning of an empty line
+		const size_t keep = std::min(length, static_cast <size_t>(2));
+
+		::memmove(buffer, buffer + length - keep, keep);
+		length = keep;
+	}
+
+	return end;
+}
+
+
+void header::parseImpl(
+	parsingContext& ctx,
+	const shared_ptr <utility::parserInputStreamAdapter>& parser,
+	const size_t position,
+	const size_t end,
+	size_t* newPosition
+) {
+
+	// Only extract the header block, not the whole message: parsing
+	// stops at the first empty line anyway
+	component::parseImpl(ctx, parser, position, findEndOfHeader(parser, position, end), newPosition);
+}
+
+
 void header::parseImpl(
 	parsingContext& ctx,
 	const string& buffer,
@@ -73,14 +162,24 @@ void header::parseImpl(
 
 	removeAllFields();
 
+	// Field values are parsed lazily from a single copy of the header
+	// block, which is shared by all the fields along with the context
+	shared_ptr <headerField::rawValueSource> source =
+		make_shared <headerField::rawValueSource>(ctx, position);
+
 	while (pos < end) {
 
-		shared_ptr <headerField> field = headerField::parseNext(ctx, buffer, pos, end, &pos);
+		shared_ptr <headerField> field = headerField::parseNext(source, ctx, buffer, pos, end, &pos);
 		if (!field) break;
 
 		m_fields.push_back(field);
 	}
 
+	source->buffer.assign(buffer, position, pos - position);
+
+	attachFields();
+	reindexFields();
+
 	setParsedBounds(position, pos);
 
 	if (newPosition) {
@@ -128,6 +227,10 @@ shared_ptr <component> header::clone() const {
 		hdr->m_fields.push_back(vmime::clone(*it));
 	}
 
+	if (m_index) {
+		hdr->setFieldIndexEnabled(true);
+	}
+
 	return hdr;
 }
 
@@ -146,10 +249,16 @@ void header::copyFrom(const component& other) {
 		fields.push_back(vmime::clone(*it));
 	}
 
-	m_fields.clear();
+	const bool indexed = (h.m_index != NULL);
+
+	removeAllFields();
+	setFieldIndexEnabled(false);
+
 	m_fields.resize(fields.size());
 
 	std::copy(fields.begin(), fields.end(), m_fields.begin());
+
+	setFieldIndexEnabled(indexed);
 }
 
 
@@ -160,84 +269,214 @@ header& header::operator=(const header& other) {
 }
 
 
+size_t header::findFieldIndex(
+	const char* name,
+	const size_t length,
+	const size_t hash,
+	const size_t start
+) const {
+
+	const size_t count = m_fields.size();
+	size_t i = start;
+
+	while (i < count && !m_fields[i]->hasName(name, length, hash)) {
+		++i;
+	}
+
+	return i;
+}
+
+
+/** Check that a field name identifier can be looked up.
+  *
+  * @param id field name identifier
+  * @throw exceptions::invalid_argument if the identifier is
+  * fields::ID_UNKNOWN or out of range
+  */
+static void checkFieldId(const fields::Id id) {
+
+	// Fields with an unknown name can only be looked up by name
+	if (id == fields::ID_UNKNOWN || id >= fields::ID_COUNT) {
+		throw exceptions::invalid_argument();
+	}
+}
+
+
 bool header::hasField(const string& fieldName) const {
 
-	std::vector <shared_ptr <headerField> >::const_iterator pos =
-		std::find_if(
-			m_fields.begin(), m_fields.end(),
-			fieldHasName(utility::stringUtils::toLower(fieldName))
-		);
+	const size_t hash = headerField::computeNameHash(fieldName.data(), fieldName.length());
+	const fields::Id id = headerField::findNameId(fieldName.data(), fieldName.length(), hash);
+
+	if (id != fields::ID_UNKNOWN) {
+		return hasField(id);
+	}
+
+	return findFieldIndex(fieldName.data(), fieldName.length(), hash) != m_fields.size();
+}
+
+
+bool header::hasField(const fields::Id fieldId) const {
+
+	return findField(fieldId) != NULL;
+}
+
+
+void header::setFieldIndexEnabled(const bool enable) {
+
+	if (enable == (m_index != NULL)) {
+		return;
+	}
+
+	if (enable) {
+
+		m_index.reset(new fieldIndex);
 
-	return pos != m_fields.end();
+		attachFields();
+		reindexFields();
+
+	} else {
+
+		// Fields do not need to notify this header anymore
+		detachFields();
+
+		m_index.reset();
+	}
+}
+
+
+bool header::isFieldIndexEnabled() const {
+
+	return m_index != NULL;
 }
 
 
 shared_ptr <headerField> header::findField(const string& fieldName) const {
 
-	// Find the first field that matches the specified name
-	std::vector <shared_ptr <headerField> >::const_iterator pos =
-		std::find_if(
-			m_fields.begin(), m_fields.end(),
-			fieldHasName(utility::stringUtils::toLower(fieldName))
-		);
+	const size_t hash = headerField::computeNameHash(fieldName.data(), fieldName.length());
+	const fields::Id id = headerField::findNameId(fieldName.data(), fieldName.length(), hash);
+
+	if (id != fields::ID_UNKNOWN) {
+		return findField(id);
+	}
+
+	const size_t index = findFieldIndex(fieldName.data(), fieldName.length(), hash);
 
 	// No field with this name can be found
-	if (pos == m_fields.end()) {
+	if (index == m_fields.size()) {
 		return null;
 	}
 
 	// Else, return a reference to the existing field
-	return *pos;
+	return m_fields[index];
+}
+
+
+shared_ptr <headerField> header::findField(const fields::Id fieldId) const {
+
+	checkFieldId(fieldId);
+
+	if (m_index) {
+		return m_index->first[fieldId];
+	}
+
+	for (std::vector <shared_ptr <headerField> >::const_iterator it = m_fields.begin() ;
+	     it != m_fields.end() ; ++it) {
+
+		if ((*it)->m_nameId == fieldId) {
+			return *it;
+		}
+	}
+
+	return null;
 }
 
 
 std::vector <shared_ptr <headerField> > header::findAllFields(const string& fieldName) {
 
+	const size_t hash = headerField::computeNameHash(fieldName.data(), fieldName.length());
+	const fields::Id id = headerField::findNameId(fieldName.data(), fieldName.length(), hash);
+
+	if (id != fields::ID_UNKNOWN) {
+		return findAllFields(id);
+	}
+
+	const size_t count = m_fields.size();
+
 	std::vector <shared_ptr <headerField> > result;
-	std::back_insert_iterator <std::vector <shared_ptr <headerField> > > back(result);
 
-	std::remove_copy_if(
-		m_fields.begin(), m_fields.end(), back,
-		fieldHasNotName(utility::stringUtils::toLower(fieldName))
-	);
+	for (size_t i = findFieldIndex(fieldName.data(), fieldName.length(), hash) ; i < count ;
+	     i = findFieldIndex(fieldName.data(), fieldName.length(), hash, i + 1)) {
+
+		result.push_back(m_fields[i]);
+	}
 
 	return result;
 }
 
 
-shared_ptr <headerField> header::getField(const string& fieldName) {
+std::vector <shared_ptr <headerField> > header::findAllFields(const fields::Id fieldId) {
 
-	const string name = utility::stringUtils::toLower(fieldName);
+	checkFieldId(fieldId);
 
-	// Find the first field that matches the specified name
-	std::vector <shared_ptr <headerField> >::const_iterator pos = m_fields.begin();
-	const std::vector <shared_ptr <headerField> >::const_iterator end = m_fields.end();
+	std::vector <shared_ptr <headerField> > result;
+
+	// With the index, stop after the last field with this identifier
+	const size_t count = m_index ? m_index->count[fieldId] : m_fields.size();
+
+	if (m_index) {
+		result.reserve(count);
+	}
+
+	for (size_t i = 0, n = m_fields.size() ; result.size() < count && i < n ; ++i) {
 
-	while (pos != end && utility::stringUtils::toLower((*pos)->getName()) != name) {
-		++pos;
+		if (m_fields[i]->m_nameId == fieldId) {
+			result.push_back(m_fields[i]);
+		}
 	}
 
+	return result;
+}
+
+
+shared_ptr <headerField> header::getField(const string& fieldName) {
+
+	// Find the first field that matches the specified name
+	shared_ptr <headerField> field = findField(fieldName);
+
 	// If no field with this name can be found, create a new one
-	if (pos == end) {
+	if (!field) {
 
-		shared_ptr <headerField> field = headerFieldFactory::getInstance()->create(fieldName);
+		field = headerFieldFactory::getInstance()->create(fieldName);
 
 		appendField(field);
+	}
 
-		// Return a reference to the new field
-		return (field);
+	return field;
+}
 
-	// Else, return a reference to the existing field
-	} else {
 
-		return *pos;
+shared_ptr <headerField> header::getField(const fields::Id fieldId) {
+
+	// Find the first field that matches the specified name
+	shared_ptr <headerField> field = findField(fieldId);
+
+	// If no field with this name can be found, create a new one
+	if (!field) {
+
+		field = headerFieldFactory::getInstance()->create(headerField::getNameById(fieldId));
+
+		appendField(field);
 	}
+
+	return field;
 }
 
 
 void header::appendField(const shared_ptr <headerField>& field) {
 
 	m_fields.push_back(field);
+
+	indexField(m_fields.size() - 1);
 }
 
 
@@ -253,13 +492,19 @@ void header::insertFieldBefore(
 		throw exceptions::no_such_field();
 	}
 
+	const size_t pos = it - m_fields.begin();
+
 	m_fields.insert(it, field);
+
+	indexField(pos);
 }
 
 
 void header::insertFieldBefore(const size_t pos, const shared_ptr <headerField>& field) {
 
 	m_fields.insert(m_fields.begin() + pos, field);
+
+	indexField(pos);
 }
 
 
@@ -275,13 +520,19 @@ void header::insertFieldAfter(
 		throw exceptions::no_such_field();
 	}
 
+	const size_t pos = it - m_fields.begin() + 1;
+
 	m_fields.insert(it + 1, field);
+
+	indexField(pos);
 }
 
 
 void header::insertFieldAfter(const size_t pos, const shared_ptr <headerField>& field) {
 
 	m_fields.insert(m_fields.begin() + pos + 1, field);
+
+	indexField(pos + 1);
 }
 
 
@@ -294,12 +545,16 @@ void header::removeField(const shared_ptr <headerField>& field) {
 		throw exceptions::no_such_field();
 	}
 
+	unindexField(it - m_fields.begin());
+
 	m_fields.erase(it);
 }
 
 
 void header::removeField(const size_t pos) {
 
+	unindexField(pos);
+
 	const std::vector <shared_ptr <headerField> >::iterator it = m_fields.begin() + pos;
 
 	m_fields.erase(it);
@@ -318,16 +573,169 @@ void header::replaceField(
 
 void header::removeAllFields() {
 
+	detachFields();
+
 	m_fields.clear();
+
+	reindexFields();
 }
 
 
 void header::removeAllFields(const string& fieldName) {
 
-	std::vector <shared_ptr <headerField> > fields = findAllFields(fieldName);
+	const size_t hash = headerField::computeNameHash(fieldName.data(), fieldName.length());
+
+	std::vector <shared_ptr <headerField> >::iterator dest = m_fields.begin();
+
+	for (std::vector <shared_ptr <headerField> >::iterator it = m_fields.begin() ;
+	     it != m_fields.end() ; ++it) {
+
+		if (!(*it)->hasName(fieldName.data(), fieldName.length(), hash)) {
+
+			*dest++ = *it;
+
+		} else if (m_index) {
 
-	for (unsigned int i = 0 ; i < fields.size() ; ++i) {
-		removeField(fields[i]);
+			detachField(**it);
+		}
+	}
+
+	m_fields.erase(dest, m_fields.end());
+
+	reindexFields();
+}
+
+
+void header::indexField(const size_t pos) {
+
+	if (!m_index) {
+		return;
+	}
+
+	const shared_ptr <headerField>& field = m_fields[pos];
+
+	field->m_headers.push_back(this);
+
+	const fields::Id id = field->m_nameId;
+
+	if (id == fields::ID_UNKNOWN) {
+		return;
+	}
+
+	if (m_index->count[id]++ != 0) {
+
+		// Another field has this identifier: the new field is only
+		// the first one if it has been inserted before the others
+		if (pos + 1 == m_fields.size()) {
+			return;
+		}
+
+		for (size_t i = 0 ; i < pos ; ++i) {
+
+			if (m_fields[i]->m_nameId == id) {
+				return;
+			}
+		}
+	}
+
+	m_index->first[id] = field;
+}
+
+
+void header::unindexField(const size_t pos) {
+
+	if (!m_index) {
+		return;
+	}
+
+	const shared_ptr <headerField>& field = m_fields[pos];
+
+	detachField(*field);
+
+	const fields::Id id = field->m_nameId;
+
+	if (id == fields::ID_UNKNOWN) {
+		return;
+	}
+
+	--m_index->count[id];
+
+	if (m_index->first[id] == field) {
+
+		m_index->first[id].reset();
+
+		// Look for the next field with this identifier
+		for (size_t i = pos + 1, n = m_fields.size() ; m_index->count[id] != 0 && i < n ; ++i) {
+
+			if (m_fields[i]->m_nameId == id) {
+
+				m_index->first[id] = m_fields[i];
+				break;
+			}
+		}
+	}
+}
+
+
+void header::reindexFields() {
+
+	if (!m_index) {
+		return;
+	}
+
+	for (size_t i = 0 ; i < fields::ID_COUNT ; ++i) {
+
+		m_index->count[i] = 0;
+		m_index->first[i].reset();
+	}
+
+	for (std::vector <shared_ptr <headerField> >::iterator it = m_fields.begin() ;
+	     it != m_fields.end() ; ++it) {
+
+		const headerField& field = **it;
+
+		if (field.m_nameId != fields::ID_UNKNOWN && m_index->count[field.m_nameId]++ == 0) {
+			m_index->first[field.m_nameId] = *it;
+		}
+	}
+}
+
+
+void header::attachFields() {
+
+	if (!m_index) {
+		return;
+	}
+
+	for (std::vector <shared_ptr <headerField> >::iterator it = m_fields.begin() ;
+	     it != m_fields.end() ; ++it) {
+
+		(*it)->m_headers.push_back(this);
+	}
+}
+
+
+void header::detachFields() {
+
+	if (!m_index) {
+		return;
+	}
+
+	for (std::vector <shared_ptr <headerField> >::iterator it = m_fields.begin() ;
+	     it != m_fields.end() ; ++it) {
+
+		detachField(**it);
+	}
+}
+
+
+void header::detachField(headerField& field) {
+
+	const std::vector <header*>::iterator it =
+		std::find(field.m_headers.begin(), field.m_headers.end(), this);
+
+	if (it != field.m_headers.end()) {
+		field.m_headers.erase(it);
 	}
 }
 
@@ -388,30 +796,4 @@ const std::vector <shared_ptr <component> > header::getChildComponents() {
 }
 
 
-
-// Field search
-
-
-header::fieldHasName::fieldHasName(const string& name)
-	: m_name(name) {
-
-}
-
-bool header::fieldHasName::operator() (const shared_ptr <const headerField>& field) {
-
-	return utility::stringUtils::toLower(field->getName()) == m_name;
-}
-
-
-header::fieldHasNotName::fieldHasNotName(const string& name)
-	: m_name(name) {
-
-}
-
-bool header::fieldHasNotName::operator() (const shared_ptr <const headerField>& field) {
-
-	return utility::stringUtils::toLower(field->getName()) != m_name;
-}
-
-
 } // vmime
@@ -50,11 +50,12 @@ class VMIME_EXPORT header : public component {
 public:
 
 	header();
+	header(const header& other);
 	~header();
 
 #define FIELD_ACCESS(methodName, fieldName) \
-	shared_ptr <headerField> methodName() { return getField(fields::fieldName); } \
-	shared_ptr <const headerField> methodName() const { return findField(fields::fieldName); }
+	shared_ptr <headerField> methodName() { return getField(fields::ID_##fieldName); } \
+	shared_ptr <const headerField> methodName() const { return findField(fields::ID_##fieldName); }
 
 	FIELD_ACCESS(From,                         FROM)
 	FIELD_ACCESS(Sender,                       SENDER)
@@ -95,6 +96,36 @@ public:
 	  */
 	bool hasField(const string& fieldName) const;
 
+	/** Checks whether (at least) one field with this name exists.
+	  * This does not compare field names.
+	  *
+	  * @param fieldId identifier of a field name from the vmime::fields
+	  * namespace (eg: fields::ID_FROM)
+	  * @return true if at least one field with the specified name
+	  * exists, or false otherwise
+	  * @throw exceptions::invalid_argument if fieldId is fields::ID_UNKNOWN
+	  */
+	bool hasField(const fields::Id fieldId) const;
+
+	/** Enable or disable the index of the fields whose name has an
+	  * identifier (see fields::Id). With the index, looking up such
+	  * fields takes constant time, which is useful for headers with
+	  * many fields (eg. Received or DKIM-Signature); without it, the
+	  * fields are scanned but their names are not compared.
+	  *
+	  * The index is disabled by default.
+	  *
+	  * @param enable true to enable the index, false to disable it
+	  */
+	void setFieldIndexEnabled(const bool enable);
+
+	/** Return whether the index of the fields is enabled.
+	  *
+	  * @return true if the index is enabled, false otherwise
+	  * @see setFieldIndexEnabled()
+	  */
+	bool isFieldIndexEnabled() const;
+
 	/** Find the first field that matches the specified name.
 	  * Field name is case-insensitive.
 	  * If no field is found, NULL is returned.
@@ -106,6 +137,18 @@ public:
 	  */
 	shared_ptr <headerField> findField(const string& fieldName) const;
 
+	/** Find the first field that matches the specified name.
+	  * This does not compare field names.
+	  * If no field is found, NULL is returned.
+	  *
+	  * @param fieldId identifier of a field name from the vmime::fields
+	  * namespace (eg: fields::ID_FROM)
+	  * @return first field with the specified name, or NULL if no field
+	  * with this name was found
+	  * @throw exceptions::invalid_argument if fieldId is fields::ID_UNKNOWN
+	  */
+	shared_ptr <headerField> findField(const fields::Id fieldId) const;
+
 	/** Find the first field that matches the specified name,
 	  * casted to the specified field type. Field name is case-insensitive.
 	  * If no field is found, or the field is not of the specified type,
@@ -123,6 +166,22 @@ public:
 		return dynamicCast <T>(findField(fieldName));
 	}
 
+	/** Find the first field that matches the specified name,
+	  * casted to the specified field type. This does not compare
+	  * field names. If no field is found, or the field is not of
+	  * the specified type, NULL is returned.
+	  *
+	  * @param fieldId identifier of a field name from the vmime::fields
+	  * namespace (eg: fields::ID_FROM)
+	  * @return first field with the specified name, or NULL if no field
+	  * with this name was found
+	  */
+	template <typename T>
+	shared_ptr <T> findField(const fields::Id fieldId) const {
+
+		return dynamicCast <T>(findField(fieldId));
+	}
+
 	/** Find the value of the first field that matches the specified name,
 	  * casted to the specified value type. Field name is case-insensitive.
 	  * If no field is found, or the field value is not of the specified
@@ -155,6 +214,17 @@ public:
 	  */
 	std::vector <shared_ptr <headerField> > findAllFields(const string& fieldName);
 
+	/** Find all fields that match the specified name.
+	  * This does not compare field names.
+	  * If no field is found, an empty vector is returned.
+	  *
+	  * @param fieldId identifier of a field name from the vmime::fields
+	  * namespace (eg: fields::ID_RECEIVED)
+	  * @return list of fields with the specified name
+	  * @throw exceptions::invalid_argument if fieldId is fields::ID_UNKNOWN
+	  */
+	std::vector <shared_ptr <headerField> > findAllFields(const fields::Id fieldId);
+
 	/** Find the first field that matches the specified name.
 	  * If no field is found, one will be created and inserted into
 	  * the header.
@@ -180,6 +250,35 @@ public:
 		return dynamicCast <T>(getField(fieldName));
 	}
 
+	/** Find the first field that matches the specified name.
+	  * This does not compare field names.
+	  * If no field is found, one will be created and inserted into
+	  * the header.
+	  *
+	  * @param fieldId identifier of a field name from the vmime::fields
+	  * namespace (eg: fields::ID_FROM)
+	  * @return first field with the specified name or a new field
+	  * if no field is found
+	  * @throw exceptions::invalid_argument if fieldId is fields::ID_UNKNOWN
+	  */
+	shared_ptr <headerField> getField(const fields::Id fieldId);
+
+	/** Find the first field that matches the specified name,
+	  * casted to the specified type.
+	  * If no field is found, one will be created and inserted into
+	  * the header.
+	  *
+	  * @param fieldId identifier of a field name from the vmime::fields
+	  * namespace (eg: fields::ID_FROM)
+	  * @return first field with the specified name or a new field
+	  * if no field is found
+	  */
+	template <typename T>
+	shared_ptr <T> getField(const fields::Id fieldId) {
+
+		return dynamicCast <T>(getField(fieldId));
+	}
+
 	/** Add a field at the end of the list.
 	  *
 	  * @param field field to append
@@ -309,36 +408,83 @@ public:
 
 private:
 
+	friend class headerField;
+
 	std::vector <shared_ptr <headerField> > m_fields;
 
+	/** Index of the fields whose name has an identifier (see fields::Id):
+	  * number of fields with each identifier, and the first of them.
+	  */
+	struct fieldIndex {
 
-	class fieldHasName {
+		size_t count[fields::ID_COUNT];
+		shared_ptr <headerField> first[fields::ID_COUNT];
+	};
 
-	public:
+	// Index of the fields (NULL if disabled)
+	scoped_ptr <fieldIndex> m_index;
 
-		fieldHasName(const string& name);
-		bool operator() (const shared_ptr <const headerField>& field);
+	/** Update the index after a field has been inserted into the list.
+	  *
+	  * @param pos position of the new field
+	  */
+	void indexField(const size_t pos);
 
-	private:
+	/** Update the index before a field is removed from the list.
+	  *
+	  * @param pos position of the field to remove
+	  */
+	void unindexField(const size_t pos);
 
-		string m_name;
-	};
+	/** Rebuild the index from the list of fields, if it is enabled.
+	  */
+	void reindexFields();
 
-	class fieldHasNotName {
+	/** Register this header with all its fields, if the index is
+	  * enabled, so that a field notifies it when its name changes.
+	  */
+	void attachFields();
 
-	public:
+	/** Unregister this header from all its fields, if the index
+	  * is enabled.
+	  */
+	void detachFields();
 
-		fieldHasNotName(const string& name);
-		bool operator() (const shared_ptr <const headerField>& field);
+	/** Unregister this header from a field (one occurrence).
+	  *
+	  * @param field field from which to unregister
+	  */
+	void detachField(headerField& field);
 
-	private:
 
-		string m_name;
-	};
+	/** Find the first field that matches the specified name, starting
+	  * at the specified position. Field names are compared using their
+	  * case-insensitive hash first, so that no string is built.
+	  *
+	  * @param name field name
+	  * @param length length of the field name
+	  * @param hash hash of the field name (see headerField::computeNameHash())
+	  * @param start index of the first field to look at
+	  * @return index of the field, or m_fields.size() if not found
+	  */
+	size_t findFieldIndex(
+		const char* name,
+		const size_t length,
+		const size_t hash,
+		const size_t start = 0
+	) const;
 
 protected:
 
 	// Component parsing & assembling
+	void parseImpl(
+		parsingContext& ctx,
+		const shared_ptr <utility::parserInputStreamAdapter>& parser,
+		const size_t position,
+		const size_t end,
+		size_t* newPosition = NULL
+	);
+
 	void parseImpl(
 		parsingContext& ctx,
 		const string& buffer,
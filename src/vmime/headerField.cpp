@@ -23,23 +23,56 @@
 
 #include "vmime/headerField.hpp"
 #include "vmime/headerFieldFactory.hpp"
+#include "vmime/header.hpp"
 
 #include "vmime/parserHelpers.hpp"
 
 #include "vmime/exception.hpp"
 
+#include <cstring>
+#include <mutex>
+
 
 namespace vmime {
 
 
+/** Return the lock which protects the lazy parsing of the value
+  * of a field. Fields share a fixed set of locks, so that each of
+  * them does not need its own.
+  *
+  * @param field header field
+  * @return lock for this field
+  */
+static std::mutex& getRawValueLock(const headerField* field) {
+
+	static std::mutex locks[31];
+
+	return locks[(reinterpret_cast <size_t>(field) >> 4) % (sizeof(locks) / sizeof(locks[0]))];
+}
+
+
 headerField::headerField()
-	: m_name("X-Undefined") {
+	: m_name("X-Undefined"),
+	  m_nameHash(computeNameHash(m_name.data(), m_name.length())),
+	  m_nameId(findNameId(m_name.data(), m_name.length(), m_nameHash)),
+	  m_rawValueStart(0),
+	  m_rawValueLength(0),
+	  m_rawValueOffset(0),
+	  m_rawValueGeneratable(false),
+	  m_rawValuePending(false) {
 
 }
 
 
 headerField::headerField(const string& fieldName)
-	: m_name(fieldName) {
+	: m_name(fieldName),
+	  m_nameHash(computeNameHash(m_name.data(), m_name.length())),
+	  m_nameId(findNameId(m_name.data(), m_name.length(), m_nameHash)),
+	  m_rawValueStart(0),
+	  m_rawValueLength(0),
+	  m_rawValueOffset(0),
+	  m_rawValueGeneratable(false),
+	  m_rawValuePending(false) {
 
 }
 
@@ -63,7 +96,20 @@ void headerField::copyFrom(const component& other) {
 
 	const headerField& hf = dynamic_cast <const headerField&>(other);
 
+	// The value of the other field may be parsed concurrently
+	// from a const accessor
+	std::lock_guard <std::mutex> lock(getRawValueLock(&hf));
+
 	m_value->copyFrom(*hf.m_value);
+
+	// Value data is not modified after parsing, so the source
+	// can be shared with the other field
+	m_rawSource = hf.m_rawSource;
+	m_rawValueStart = hf.m_rawValueStart;
+	m_rawValueLength = hf.m_rawValueLength;
+	m_rawValueOffset = hf.m_rawValueOffset;
+	m_rawValueGeneratable = hf.m_rawValueGeneratable;
+	m_rawValuePending = hf.m_rawValuePending.load();
 }
 
 
@@ -74,6 +120,13 @@ headerField& headerField::operator=(const headerField& other) {
 }
 
 
+headerField::rawValueSource::rawValueSource(const parsingContext& ctx, const size_t position)
+	: ctx(ctx),
+	  position(position) {
+
+}
+
+
 shared_ptr <headerField> headerField::parseNext(
 	parsingContext& ctx,
 	const string& buffer,
@@ -82,6 +135,32 @@ shared_ptr <headerField> headerField::parseNext(
 	size_t* newPosition
 ) {
 
+	shared_ptr <rawValueSource> source = make_shared <rawValueSource>(ctx, position);
+
+	size_t pos = position;
+
+	shared_ptr <headerField> field = parseNext(source, ctx, buffer, position, end, &pos);
+
+	source->buffer.assign(buffer, position, pos - position);
+
+	if (newPosition) {
+		*newPosition = pos;
+	}
+
+	return field;
+}
+
+
+// static
+shared_ptr <headerField> headerField::parseNext(
+	const shared_ptr <rawValueSource>& source,
+	parsingContext& ctx,
+	const string& buffer,
+	const size_t position,
+	const size_t end,
+	size_t* newPosition
+) {
+
 	size_t pos = position;
 
 	while (pos < end) {
@@ -208,7 +287,12 @@ shared_ptr <headerField> headerField::parseNext(
 				// Return a new field
 				shared_ptr <headerField> field = headerFieldFactory::getInstance()->create(name);
 
-				field->parse(ctx, buffer, contentsStart, contentsEnd, NULL);
+				if (field->supportsLazyValueParsing()) {
+					field->setRawValue(source, buffer, contentsStart, contentsEnd, nameStart);
+				} else {
+					field->parse(ctx, buffer, contentsStart, contentsEnd, NULL);
+				}
+
 				field->setParsedBounds(nameStart, pos);
 
 				if (newPosition) {
@@ -270,10 +354,108 @@ void headerField::parseImpl(
 	size_t* newPosition
 ) {
 
+	discardRawValue();
+
 	m_value->parse(ctx, buffer, position, end, newPosition);
 }
 
 
+void headerField::setRawValue(
+	const shared_ptr <const rawValueSource>& source,
+	const string& buffer,
+	const size_t position,
+	const size_t end,
+	const size_t fieldStart
+) {
+
+	m_rawSource = source;
+	m_rawValueStart = position - source->position;
+	m_rawValueLength = end - position;
+	m_rawValueOffset = position - fieldStart;
+	m_rawValuePending = true;
+
+	// Do not output bare LFs found in folded lines
+	m_rawValueGeneratable = true;
+
+	for (size_t pos = buffer.find('\n', position) ; pos < end ;
+	     pos = buffer.find('\n', pos + 1)) {
+
+		if (pos == position || buffer[pos - 1] != '\r') {
+			m_rawValueGeneratable = false;
+			break;
+		}
+	}
+}
+
+
+void headerField::parseRawValue() const {
+
+	// Value has already been parsed: this pairs with the release
+	// below, so that the parsed value is visible to this thread
+	if (!m_rawValuePending.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	std::lock_guard <std::mutex> lock(getRawValueLock(this));
+
+	// Value may have been parsed by another thread in the meantime
+	if (!m_rawValuePending.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	parsingContext ctx(m_rawSource->ctx);
+
+	m_value->parse(ctx, m_rawSource->buffer, m_rawValueStart, m_rawValueStart + m_rawValueLength, NULL);
+
+	// Value has been parsed from the source buffer: move its bounds
+	// to the position of the field
+	if (getParsedLength() != 0) {
+		m_value->offsetParsedBounds(getParsedOffset() + m_rawValueOffset - m_rawValueStart);
+	}
+
+	// Source data is still read without locking by generation
+	if (!m_rawValueGeneratable) {
+		m_rawSource.reset();
+	}
+
+	m_rawValuePending.store(false, std::memory_order_release);
+}
+
+
+void headerField::discardRawValue() {
+
+	m_rawSource.reset();
+	m_rawValuePending = false;
+	m_rawValueGeneratable = false;
+}
+
+
+bool headerField::supportsLazyValueParsing() const {
+
+	return true;
+}
+
+
+void headerField::offsetParsedBounds(const size_t offset) {
+
+	// Bounds of the value will be set when it is parsed
+	if (m_rawValuePending) {
+
+		if (getParsedLength() != 0) {
+
+			setParsedBounds(
+				getParsedOffset() + offset,
+				getParsedOffset() + offset + getParsedLength()
+			);
+		}
+
+	} else {
+
+		component::offsetParsedBounds(offset);
+	}
+}
+
+
 void headerField::generateImpl(
 	const generationContext& ctx,
 	utility::outputStream& os,
@@ -283,12 +465,43 @@ void headerField::generateImpl(
 
 	os << m_name + ": ";
 
+	if (m_rawValueGeneratable) {
+
+		// Value has not been modified since parsing: output it as-is
+		const string& buffer = m_rawSource->buffer;
+
+		os.write(buffer.data() + m_rawValueStart, m_rawValueLength);
+
+		if (newLinePos) {
+
+			const size_t valueEnd = m_rawValueStart + m_rawValueLength;
+			const size_t lastEOL = (m_rawValueLength != 0)
+				? buffer.rfind('\n', valueEnd - 1) : string::npos;
+
+			if (lastEOL == string::npos || lastEOL < m_rawValueStart) {
+				*newLinePos = curLinePos + m_name.length() + 2 + m_rawValueLength;
+			} else {
+				*newLinePos = valueEnd - lastEOL - 1;
+			}
+		}
+
+		return;
+	}
+
+	parseRawValue();
+
 	m_value->generate(ctx, os, curLinePos + m_name.length() + 2, newLinePos);
 }
 
 
 size_t headerField::getGeneratedSize(const generationContext& ctx) {
 
+	if (m_rawValueGeneratable) {
+		return m_name.length() + 2 /* ": " */ + m_rawValueLength;
+	}
+
+	parseRawValue();
+
 	return m_name.length() + 2 /* ": " */ + m_value->getGeneratedSize(ctx);
 }
 
@@ -299,9 +512,191 @@ const string headerField::getName() const {
 }
 
 
+fields::Id headerField::getNameId() const {
+
+	return m_nameId;
+}
+
+
 void headerField::setName(const string& name) {
 
+	const fields::Id oldId = m_nameId;
+
 	m_name = name;
+	m_nameHash = computeNameHash(m_name.data(), m_name.length());
+	m_nameId = findNameId(m_name.data(), m_name.length(), m_nameHash);
+
+	// Header index is based on the name identifier
+	if (m_nameId != oldId) {
+
+		for (std::vector <header*>::const_iterator it = m_headers.begin() ;
+		     it != m_headers.end() ; ++it) {
+
+			(*it)->reindexFields();
+		}
+	}
+}
+
+
+// Compute a case-insensitive hash of a field name
+static size_t fieldNameHash(const char* name, const size_t length) {
+
+	// FNV-1a on ASCII lowercase characters
+	size_t hash = 2166136261u;
+
+	for (size_t i = 0 ; i < length ; ++i) {
+
+		unsigned char c = static_cast <unsigned char>(name[i]);
+
+		if (c >= 'A' && c <= 'Z') {
+			c = static_cast <unsigned char>(c - 'A' + 'a');
+		}
+
+		hash = (hash ^ c) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+// static
+size_t headerField::computeNameHash(const char* name, const size_t length) {
+
+	return fieldNameHash(name, length);
+}
+
+
+// Compare two field names of the same length (ASCII case-insensitive)
+static bool fieldNamesEqual(const char* name1, const char* name2, const size_t length) {
+
+	for (size_t i = 0 ; i < length ; ++i) {
+
+		unsigned char c1 = static_cast <unsigned char>(name1[i]);
+		unsigned char c2 = static_cast <unsigned char>(name2[i]);
+
+		if (c1 >= 'A' && c1 <= 'Z') {
+			c1 = static_cast <unsigned char>(c1 - 'A' + 'a');
+		}
+
+		if (c2 >= 'A' && c2 <= 'Z') {
+			c2 = static_cast <unsigned char>(c2 - 'A' + 'a');
+		}
+
+		if (c1 != c2) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool headerField::hasName(const char* name, const size_t length, const size_t hash) const {
+
+	if (hash != m_nameHash || length != m_name.length()) {
+		return false;
+	}
+
+	return fieldNamesEqual(m_name.data(), name, length);
+}
+
+
+namespace {
+
+
+// Names from the vmime::fields namespace, indexed by identifier
+class wellKnownFieldNames {
+
+public:
+
+	wellKnownFieldNames() {
+
+		const char* const names[fields::ID_COUNT] = {
+			NULL,
+			fields::RECEIVED,
+			fields::FROM,
+			fields::SENDER,
+			fields::REPLY_TO,
+			fields::TO,
+			fields::CC,
+			fields::BCC,
+			fields::DATE,
+			fields::SUBJECT,
+			fields::ORGANIZATION,
+			fields::USER_AGENT,
+			fields::DELIVERED_TO,
+			fields::RETURN_PATH,
+			fields::MIME_VERSION,
+			fields::MESSAGE_ID,
+			fields::CONTENT_TYPE,
+			fields::CONTENT_TRANSFER_ENCODING,
+			fields::CONTENT_DESCRIPTION,
+			fields::CONTENT_DISPOSITION,
+			fields::CONTENT_ID,
+			fields::CONTENT_LOCATION,
+			fields::IN_REPLY_TO,
+			fields::REFERENCES,
+			fields::X_MAILER,
+			fields::X_PRIORITY,
+			fields::ORIGINAL_MESSAGE_ID,
+			fields::DISPOSITION_NOTIFICATION_TO,
+			fields::DISPOSITION_NOTIFICATION_OPTIONS,
+			fields::DISPOSITION,
+			fields::FAILURE,
+			fields::ERROR,
+			fields::WARNING,
+			fields::ORIGINAL_RECIPIENT,
+			fields::FINAL_RECIPIENT,
+			fields::REPORTING_UA,
+			fields::MDN_GATEWAY
+		};
+
+		for (size_t i = 0 ; i < fields::ID_COUNT ; ++i) {
+
+			m_names[i] = names[i];
+			m_lengths[i] = names[i] ? ::strlen(names[i]) : 0;
+			m_hashes[i] = names[i] ? fieldNameHash(names[i], m_lengths[i]) : 0;
+		}
+	}
+
+	const char* m_names[fields::ID_COUNT];
+	size_t m_lengths[fields::ID_COUNT];
+	size_t m_hashes[fields::ID_COUNT];
+};
+
+
+const wellKnownFieldNames& getWellKnownFieldNames() {
+
+	static const wellKnownFieldNames names;
+	return names;
+}
+
+
+} // namespace
+
+
+// static
+fields::Id headerField::findNameId(const char* name, const size_t length, const size_t hash) {
+
+	const wellKnownFieldNames& names = getWellKnownFieldNames();
+
+	for (size_t i = 1 ; i < fields::ID_COUNT ; ++i) {
+
+		if (names.m_hashes[i] == hash && names.m_lengths[i] == length &&
+		    fieldNamesEqual(names.m_names[i], name, length)) {
+
+			return static_cast <fields::Id>(i);
+		}
+	}
+
+	return fields::ID_UNKNOWN;
+}
+
+
+// static
+const char* headerField::getNameById(const fields::Id id) {
+
+	return getWellKnownFieldNames().m_names[id];
 }
 
 
@@ -313,6 +708,10 @@ bool headerField::isCustom() const {
 
 const std::vector <shared_ptr <component> > headerField::getChildComponents() {
 
+	// Child components may be modified by the caller
+	parseRawValue();
+	discardRawValue();
+
 	std::vector <shared_ptr <component> > list;
 
 	if (m_value) {
@@ -325,12 +724,17 @@ const std::vector <shared_ptr <component> > headerField::getChildComponents() {
 
 shared_ptr <const headerFieldValue> headerField::getValue() const {
 
+	parseRawValue();
+
 	return m_value;
 }
 
 
 shared_ptr <headerFieldValue> headerField::getValue() {
 
+	parseRawValue();
+	discardRawValue();
+
 	return m_value;
 }
 
@@ -342,6 +746,7 @@ void headerField::setValue(const shared_ptr <headerFieldValue>& value) {
 	}
 
 	if (value != NULL) {
+		discardRawValue();
 		m_value = value;
 	}
 }
@@ -353,6 +758,7 @@ void headerField::setValueConst(const shared_ptr <const headerFieldValue>& value
 		throw exceptions::bad_field_value_type(getName());
 	}
 
+	discardRawValue();
 	m_value = vmime::clone(value);
 }
 
@@ -363,6 +769,7 @@ void headerField::setValue(const headerFieldValue& value) {
 		throw exceptions::bad_field_value_type(getName());
 	}
 
+	discardRawValue();
 	m_value = vmime::clone(value);
 }
 
@@ -28,12 +28,22 @@
 #include "vmime/base.hpp"
 #include "vmime/component.hpp"
 #include "vmime/headerFieldValue.hpp"
+#include "vmime/constants.hpp"
+
+#include <atomic>
 
 
 namespace vmime {
 
 
+class header;
+
+
 /** Base class for header fields.
+  *
+  * When a field is parsed from a header, its value is only parsed when
+  * it is first accessed. This is done under a lock, so that const
+  * methods can still be called concurrently from several threads.
   */
 class VMIME_EXPORT headerField : public component {
 
@@ -69,6 +79,13 @@ public:
 	  */
 	const string getName() const;
 
+	/** Return the identifier of the name of this field, if it is
+	  * one of the names from the vmime::fields namespace.
+	  *
+	  * @return field name identifier, or fields::ID_UNKNOWN
+	  */
+	fields::Id getNameId() const;
+
 	/** Check whether this field is a custom (non-standard) field.
 	  * Custom fields have a name beginning with "X-".
 	  *
@@ -77,6 +94,9 @@ public:
 	bool isCustom() const;
 
 	/** Return the read-only value object attached to this field.
+	  *
+	  * When the field has been parsed from a message, its value is
+	  * only parsed the first time it is requested.
 	  *
 	  * @return read-only value object
 	  */
@@ -90,10 +110,13 @@ public:
 	template <typename T>
 	shared_ptr <const T> getValue() const {
 
-		return dynamicCast <const T>(m_value);
+		return dynamicCast <const T>(getValue());
 	}
 
 	/** Return the value object attached to this field.
+	  *
+	  * As the returned object may be modified, the field will be
+	  * generated from it, instead of from the original parsed data.
 	  *
 	  * @return value object
 	  */
@@ -107,7 +130,7 @@ public:
 	template <typename T>
 	shared_ptr <T> getValue() {
 
-		return dynamicCast <T>(m_value);
+		return dynamicCast <T>(getValue());
 	}
 
 	/** Set the value of this field.
@@ -164,6 +187,14 @@ public:
 
 protected:
 
+	/** Return whether the value of this field can be parsed on demand,
+	  * instead of when the field is parsed from a header. Fields which
+	  * access their value directly should return false.
+	  *
+	  * @return true if the value can be parsed lazily, false otherwise
+	  */
+	virtual bool supportsLazyValueParsing() const;
+
 	void parseImpl(
 		parsingContext& ctx,
 		const string& buffer,
@@ -182,6 +213,101 @@ protected:
 
 	string m_name;
 	shared_ptr <headerFieldValue> m_value;
+
+private:
+
+	/** Data from which the values of lazily parsed fields are parsed,
+	  * shared by all the fields of a header.
+	  */
+	struct rawValueSource {
+
+		rawValueSource(const parsingContext& ctx, const size_t position);
+
+		// Context for parsing the values
+		parsingContext ctx;
+		// Position of the data in the parsed buffer
+		size_t position;
+		// Copy of the parsed data, set once all the fields have been parsed
+		string buffer;
+	};
+
+	static shared_ptr <headerField> parseNext(
+		const shared_ptr <rawValueSource>& source,
+		parsingContext& ctx,
+		const string& buffer,
+		const size_t position,
+		const size_t end,
+		size_t* newPosition
+	);
+
+	void setRawValue(
+		const shared_ptr <const rawValueSource>& source,
+		const string& buffer,
+		const size_t position,
+		const size_t end,
+		const size_t fieldStart
+	);
+
+	void parseRawValue() const;
+	void discardRawValue();
+
+	void offsetParsedBounds(const size_t offset);
+
+	/** Compute a case-insensitive hash of a field name.
+	  *
+	  * @param name field name
+	  * @param length length of the field name
+	  * @return hash value
+	  */
+	static size_t computeNameHash(const char* name, const size_t length);
+
+	/** Check whether this field has the specified name (case-insensitive).
+	  *
+	  * @param name field name
+	  * @param length length of the field name
+	  * @param hash hash of the field name, as returned by computeNameHash()
+	  * @return true if the name matches, false otherwise
+	  */
+	bool hasName(const char* name, const size_t length, const size_t hash) const;
+
+	/** Return the identifier of a field name (case-insensitive).
+	  *
+	  * @param name field name
+	  * @param length length of the field name
+	  * @param hash hash of the field name, as returned by computeNameHash()
+	  * @return field name identifier, or fields::ID_UNKNOWN
+	  */
+	static fields::Id findNameId(const char* name, const size_t length, const size_t hash);
+
+	/** Return the field name for the specified identifier.
+	  *
+	  * @param id field name identifier (not fields::ID_UNKNOWN)
+	  * @return field name
+	  */
+	static const char* getNameById(const fields::Id id);
+
+
+	// Case-insensitive hash of the field name
+	size_t m_nameHash;
+	// Identifier of the field name
+	fields::Id m_nameId;
+	// Headers which index this field by its name identifier (a header
+	// appears once per occurrence of the field in its list)
+	std::vector <header*> m_headers;
+
+	// Data which contains the value data (NULL if none)
+	mutable shared_ptr <const rawValueSource> m_rawSource;
+	// Position and length of value data in the source buffer
+	size_t m_rawValueStart;
+	size_t m_rawValueLength;
+	// Offset of value data, relative to the start of the field
+	size_t m_rawValueOffset;
+	// Whether the value data can be generated as-is
+	bool m_rawValueGeneratable;
+	// Whether the value data has not been parsed yet (once set, only
+	// cleared by parseRawValue() under the lock of the field, or by
+	// non-const methods)
+	mutable std::atomic <bool> m_rawValuePending;
 };
 
 
@@ -155,11 +155,11 @@ void htmlTextPart::findEmbeddedParts(
 
 		// For a part to be an embedded object, it must have either a
 		// Content-Id field or a Content-Location field.
-		if (p->getHeader()->hasField(fields::CONTENT_ID)) {
+		if (p->getHeader()->hasField(fields::ID_CONTENT_ID)) {
 			cidParts.push_back(p);
 		}
 
-		if (p->getHeader()->hasField(fields::CONTENT_LOCATION)) {
+		if (p->getHeader()->hasField(fields::ID_CONTENT_LOCATION)) {
 			locParts.push_back(p);
 		}
 
@@ -182,7 +182,7 @@ void htmlTextPart::addEmbeddedObject(
 	mediaType type;
 
 	shared_ptr <const headerField> ctf =
-		part.getHeader()->findField(fields::CONTENT_TYPE);
+		part.getHeader()->findField(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -229,7 +229,7 @@ void htmlTextPart::parse(
 
 	// Find charset
 	shared_ptr <const contentTypeField> ctf =
-		textPart->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		textPart->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf && ctf->hasCharset()) {
 		m_charset = ctf->getCharset();
@@ -243,7 +243,7 @@ void htmlTextPart::parse(
 	     p != cidParts.end() ; ++p) {
 
 		const shared_ptr <const headerField> midField =
-			(*p)->getHeader()->findField(fields::CONTENT_ID);
+			(*p)->getHeader()->findField(fields::ID_CONTENT_ID);
 
 		const messageId mid = *midField->getValue <messageId>();
 
@@ -260,7 +260,7 @@ void htmlTextPart::parse(
 	     p != locParts.end() ; ++p) {
 
 		const shared_ptr <const headerField> locField =
-			(*p)->getHeader()->findField(fields::CONTENT_LOCATION);
+			(*p)->getHeader()->findField(fields::ID_CONTENT_LOCATION);
 
 		const text loc = *locField->getValue <text>();
 		const string locStr = loc.getWholeBuffer();
@@ -289,7 +289,7 @@ bool htmlTextPart::findPlainTextPart(
 
 	// We search for the nearest "multipart/alternative" part.
 	const shared_ptr <const headerField> ctf =
-		part.getHeader()->findField(fields::CONTENT_TYPE);
+		part.getHeader()->findField(fields::ID_CONTENT_TYPE);
 
 	if (ctf) {
 
@@ -321,7 +321,7 @@ bool htmlTextPart::findPlainTextPart(
 					const shared_ptr <const bodyPart> p = part.getBody()->getPartAt(i);
 
 					const shared_ptr <const headerField> ctf =
-						p->getHeader()->findField(fields::CONTENT_TYPE);
+						p->getHeader()->findField(fields::ID_CONTENT_TYPE);
 
 					if (ctf) {
 
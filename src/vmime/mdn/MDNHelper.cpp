@@ -61,7 +61,7 @@ const std::vector <sendableMDNInfos> MDNHelper::getPossibleMDNs(const shared_ptr
 
 	const shared_ptr <const header> hdr = msg->getHeader();
 
-	if (hdr->hasField(fields::DISPOSITION_NOTIFICATION_TO)) {
+	if (hdr->hasField(fields::ID_DISPOSITION_NOTIFICATION_TO)) {
 
 		const mailboxList& dnto =
 			*hdr->DispositionNotificationTo()->getValue <mailboxList>();
@@ -83,7 +83,7 @@ bool MDNHelper::isMDN(const shared_ptr <const message>& msg)
 	//   - a Content-Type field is present and its value is "multipart/report"
 	//   - a "report-type" parameter is present in the Content-Type field,
 	//     and its value is "disposition-notification"
-	if (hdr->hasField(fields::CONTENT_TYPE)) {
+	if (hdr->hasField(fields::ID_CONTENT_TYPE)) {
 
 		const contentTypeField& ctf = *dynamicCast <const contentTypeField>(hdr->ContentType());
 
@@ -119,12 +119,12 @@ bool MDNHelper::needConfirmation(const shared_ptr <const message>& msg)
 	shared_ptr <const header> hdr = msg->getHeader();
 
 	// No "Return-Path" field
-	if (!hdr->hasField(fields::RETURN_PATH)) {
+	if (!hdr->hasField(fields::ID_RETURN_PATH)) {
 		return true;
 	}
 
 	// More than one address in Disposition-Notification-To
-	if (hdr->hasField(fields::DISPOSITION_NOTIFICATION_TO)) {
+	if (hdr->hasField(fields::ID_DISPOSITION_NOTIFICATION_TO)) {
 
 		const mailboxList& dnto = *hdr->DispositionNotificationTo()->getValue <mailboxList>();
 
@@ -92,7 +92,7 @@ void receivedMDNInfos::extract() {
 
 		const shared_ptr <const bodyPart> part = bdy->getPartAt(i);
 
-		if (!part->getHeader()->hasField(fields::CONTENT_TYPE)) {
+		if (!part->getHeader()->hasField(fields::ID_CONTENT_TYPE)) {
 			continue;
 		}
 
@@ -81,7 +81,7 @@ void messageParser::parse(const shared_ptr <const message>& msg) {
 #endif // VMIME_BUILDING_DOC
 
 	// Date
-	shared_ptr <const headerField> recv = msg->getHeader()->findField(fields::RECEIVED);
+	shared_ptr <const headerField> recv = msg->getHeader()->findField(fields::ID_RECEIVED);
 	static const datetime unsetDate;
 
 	m_date = unsetDate;
@@ -95,7 +95,7 @@ void messageParser::parse(const shared_ptr <const message>& msg) {
 	// RECEIVED may in some cases contain no date at all
 	if (unsetDate == m_date) {
 
-		shared_ptr <const headerField> date = msg->getHeader()->findField(fields::DATE);
+		shared_ptr <const headerField> date = msg->getHeader()->findField(fields::ID_DATE);
 
 		if (date) {
 			m_date = *date->getValue <datetime>();
@@ -131,7 +131,7 @@ void messageParser::findTextParts(
 		bool accept = false;
 
 		shared_ptr <const contentTypeField> ctf =
-			msg->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+			msg->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 		if (ctf) {
 
@@ -182,7 +182,7 @@ bool messageParser::findSubTextParts(
 		const shared_ptr <const bodyPart> p = part->getBody()->getPartAt(i);
 
 		shared_ptr <const contentTypeField> ctf =
-			p->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+			p->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 		if (ctf) {
 
@@ -192,7 +192,7 @@ bool messageParser::findSubTextParts(
 			if (type.getType() == mediaTypes::TEXT) {
 
 				shared_ptr <const contentDispositionField> cdf = p->getHeader()->
-					findField <contentDispositionField>(fields::CONTENT_DISPOSITION);
+					findField <contentDispositionField>(fields::ID_CONTENT_DISPOSITION);
 
 				if (cdf) {
 
@@ -230,7 +230,7 @@ bool messageParser::findSubTextParts(
 		     p != textParts.end() ; ++p) {
 
 			const contentTypeField& ctf =
-				*(*p)->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+				*(*p)->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 			const mediaType type = *ctf.getValue <mediaType>();
 
@@ -0,0 +1,129 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include "vmime/net/capabilitySet.hpp"
+
+#include "vmime/utility/stringUtils.hpp"
+
+#include <algorithm>
+
+
+namespace vmime {
+namespace net {
+
+
+const size_t capabilitySet::MAX_KNOWN_CAPABILITIES;
+
+
+capabilitySet::capabilitySet(const char* const* knownNames, const size_t knownCount)
+	: m_knownNames(knownNames),
+	  m_knownCount(std::min(knownCount, MAX_KNOWN_CAPABILITIES)) {
+
+}
+
+
+void capabilitySet::clear() {
+
+	m_known.reset();
+	m_names.clear();
+	m_params.clear();
+}
+
+
+void capabilitySet::add(const string& name, const std::vector <string>& params) {
+
+	const string normName = utility::stringUtils::toUpper(name);
+
+	for (size_t i = 0 ; i < m_knownCount ; ++i) {
+
+		if (normName == m_knownNames[i]) {
+			m_known.set(i);
+			break;
+		}
+	}
+
+	std::pair <std::unordered_map <string, std::vector <string> >::iterator, bool> res =
+		m_params.insert(std::make_pair(normName, params));
+
+	if (res.second) {
+		m_names.push_back(normName);
+	} else {
+		res.first->second = params;
+	}
+}
+
+
+bool capabilitySet::has(const string& name) const {
+
+	return m_params.find(utility::stringUtils::toUpper(name)) != m_params.end();
+}
+
+
+bool capabilitySet::getParameters(const size_t known, std::vector <string>& params) const {
+
+	if (!has(known)) {
+		return false;
+	}
+
+	return getParameters(string(m_knownNames[known]), params);
+}
+
+
+bool capabilitySet::getParameters(const string& name, std::vector <string>& params) const {
+
+	std::unordered_map <string, std::vector <string> >::const_iterator
+		it = m_params.find(utility::stringUtils::toUpper(name));
+
+	if (it == m_params.end()) {
+		return false;
+	}
+
+	params = it->second;
+
+	return true;
+}
+
+
+const std::vector <string>& capabilitySet::getNames() const {
+
+	return m_names;
+}
+
+
+bool capabilitySet::isEmpty() const {
+
+	return m_names.empty();
+}
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
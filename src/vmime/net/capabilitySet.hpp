@@ -0,0 +1,148 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_CAPABILITYSET_HPP_INCLUDED
+#define VMIME_NET_CAPABILITYSET_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES
+
+
+#include "vmime/types.hpp"
+
+#include <bitset>
+#include <unordered_map>
+#include <vector>
+
+
+namespace vmime {
+namespace net {
+
+
+/** A set of capabilities (or extensions) advertised by a server.
+  *
+  * Capabilities are parsed once, when they are received from the
+  * server. Each protocol has its own table of known capabilities:
+  * they are identified by their index in this table, and they can
+  * be tested with a single bit test. Other capabilities are looked
+  * up by name, in a hashed set. Capability names are case-insensitive.
+  */
+class VMIME_EXPORT capabilitySet {
+
+public:
+
+	/** Maximum number of known capabilities in a table. */
+	static const size_t MAX_KNOWN_CAPABILITIES = 64;
+
+	/** Construct an empty set of capabilities.
+	  *
+	  * @param knownNames names of the known capabilities, in upper-case;
+	  * the table must not be freed while this object is used (usually,
+	  * it is a static array)
+	  * @param knownCount number of names in the table (at most
+	  * MAX_KNOWN_CAPABILITIES)
+	  */
+	capabilitySet(const char* const* knownNames, const size_t knownCount);
+
+	/** Remove all capabilities from this set.
+	  */
+	void clear();
+
+	/** Add a capability to this set. If the capability is already
+	  * in the set, its parameters are replaced.
+	  *
+	  * @param name capability name
+	  * @param params capability parameters, if any (eg. the list of
+	  * mechanisms for SASL)
+	  */
+	void add(const string& name, const std::vector <string>& params = std::vector <string>());
+
+	/** Test whether a known capability is in this set.
+	  *
+	  * @param known index of the capability in the table of known names
+	  * @return true if the capability is in this set, false otherwise
+	  */
+	bool has(const size_t known) const {
+
+		return known < MAX_KNOWN_CAPABILITIES && m_known.test(known);
+	}
+
+	/** Test whether a capability is in this set.
+	  *
+	  * @param name capability name (case-insensitive)
+	  * @return true if the capability is in this set, false otherwise
+	  */
+	bool has(const string& name) const;
+
+	/** Return the parameters of a known capability.
+	  *
+	  * @param known index of the capability in the table of known names
+	  * @param params receives the parameters of the capability
+	  * @return true if the capability is in this set, false otherwise
+	  */
+	bool getParameters(const size_t known, std::vector <string>& params) const;
+
+	/** Return the parameters of a capability.
+	  *
+	  * @param name capability name (case-insensitive)
+	  * @param params receives the parameters of the capability
+	  * @return true if the capability is in this set, false otherwise
+	  */
+	bool getParameters(const string& name, std::vector <string>& params) const;
+
+	/** Return the names of all the capabilities in this set, in
+	  * upper-case and in the order they were added.
+	  *
+	  * @return list of capability names
+	  */
+	const std::vector <string>& getNames() const;
+
+	/** Test whether this set is empty.
+	  *
+	  * @return true if this set contains no capability, false otherwise
+	  */
+	bool isEmpty() const;
+
+private:
+
+	const char* const* m_knownNames;
+	size_t m_knownCount;
+
+	std::bitset <MAX_KNOWN_CAPABILITIES> m_known;
+
+	std::vector <string> m_names;
+	std::unordered_map <string, std::vector <string> > m_params;
+};
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES
+
+
+#endif // VMIME_NET_CAPABILITYSET_HPP_INCLUDED
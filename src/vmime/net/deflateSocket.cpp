@@ -0,0 +1,338 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_ZLIB_SUPPORT
+
+
+#include "vmime/net/deflateSocket.hpp"
+
+#include "vmime/utility/stringUtils.hpp"
+
+#include "vmime/exception.hpp"
+
+#include <cstring>
+
+#include <zlib.h>
+
+
+namespace vmime {
+namespace net {
+
+
+deflateSocket::deflateSocket(const shared_ptr <socket>& wrapped, const string& receivedData)
+	: m_wrapped(wrapped),
+	  m_deflate(new z_stream),
+	  m_inflate(new z_stream),
+	  m_inflatePending(false),
+	  m_uncompressedSent(0),
+	  m_compressedSent(0),
+	  m_uncompressedReceived(0),
+	  m_compressedReceived(0) {
+
+	std::memset(m_deflate, 0, sizeof(z_stream));
+	std::memset(m_inflate, 0, sizeof(z_stream));
+
+	// Negative window bits: raw DEFLATE stream, without zlib header
+	if (deflateInit2(m_deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+
+		delete m_deflate;
+		delete m_inflate;
+
+		throw exceptions::socket_exception("deflateInit2() failed");
+	}
+
+	if (inflateInit2(m_inflate, -15) != Z_OK) {
+
+		deflateEnd(m_deflate);
+
+		delete m_deflate;
+		delete m_inflate;
+
+		throw exceptions::socket_exception("inflateInit2() failed");
+	}
+
+	// Inflate data already received before reading from the socket
+	if (!receivedData.empty()) {
+
+		m_receivedData.assign(receivedData.begin(), receivedData.end());
+
+		m_inflate->next_in = &m_receivedData[0];
+		m_inflate->avail_in = static_cast <uInt>(m_receivedData.size());
+
+		m_compressedReceived += m_receivedData.size();
+	}
+}
+
+
+deflateSocket::~deflateSocket() {
+
+	deflateEnd(m_deflate);
+	inflateEnd(m_inflate);
+
+	delete m_deflate;
+	delete m_inflate;
+}
+
+
+void deflateSocket::connect(const string& address, const port_t port) {
+
+	m_wrapped->connect(address, port);
+}
+
+
+void deflateSocket::disconnect() {
+
+	m_wrapped->disconnect();
+}
+
+
+bool deflateSocket::isConnected() const {
+
+	return m_wrapped->isConnected();
+}
+
+
+size_t deflateSocket::getBlockSize() const {
+
+	return m_wrapped->getBlockSize();
+}
+
+
+const string deflateSocket::getPeerName() const {
+
+	return m_wrapped->getPeerName();
+}
+
+
+const string deflateSocket::getPeerAddress() const {
+
+	return m_wrapped->getPeerAddress();
+}
+
+
+shared_ptr <timeoutHandler> deflateSocket::getTimeoutHandler() {
+
+	return m_wrapped->getTimeoutHandler();
+}
+
+
+void deflateSocket::setTracer(const shared_ptr <tracer>& tracer) {
+
+	m_wrapped->setTracer(tracer);
+}
+
+
+shared_ptr <tracer> deflateSocket::getTracer() {
+
+	return m_wrapped->getTracer();
+}
+
+
+int deflateSocket::getDescriptor() const {
+
+	return m_wrapped->getDescriptor();
+}
+
+
+bool deflateSocket::waitForRead(const int msecs) {
+
+	// Compressed data may already have been received
+	if (m_inflate->avail_in != 0 || m_inflatePending) {
+		return true;
+	}
+
+	return m_wrapped->waitForRead(msecs);
+}
+
+
+bool deflateSocket::waitForWrite(const int msecs) {
+
+	return m_wrapped->waitForWrite(msecs);
+}
+
+
+void deflateSocket::receive(string& buffer) {
+
+	const size_t n = receiveRaw(m_recvBuffer, sizeof(m_recvBuffer));
+
+	buffer = utility::stringUtils::makeStringFromBytes(m_recvBuffer, n);
+}
+
+
+size_t deflateSocket::receiveRaw(byte_t* buffer, const size_t count) {
+
+	if (count == 0) {
+		return 0;
+	}
+
+	m_inflate->next_out = buffer;
+	m_inflate->avail_out = static_cast <uInt>(count);
+
+	while (m_inflate->avail_out == count) {
+
+		// Receive more compressed data, unless some is left from
+		// the previous call, or inflate() has more output for it
+		if (m_inflate->avail_in == 0 && !m_inflatePending) {
+
+			const size_t n = m_wrapped->receiveRaw(m_inBuffer, sizeof(m_inBuffer));
+
+			if (n == 0) {
+				break;  // no data available
+			}
+
+			m_compressedReceived += n;
+
+			m_inflate->next_in = m_inBuffer;
+			m_inflate->avail_in = static_cast <uInt>(n);
+		}
+
+		const int ret = inflate(m_inflate, Z_SYNC_FLUSH);
+
+		if (ret == Z_STREAM_END) {
+			throw exceptions::socket_exception("Compressed stream ended unexpectedly");
+		} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			throw exceptions::socket_exception("inflate() failed");
+		}
+
+		// If the output buffer is full, inflate() may have more
+		// output even if all the input has been consumed
+		m_inflatePending = (m_inflate->avail_out == 0);
+	}
+
+	const size_t n = count - m_inflate->avail_out;
+
+	m_uncompressedReceived += n;
+
+	return n;
+}
+
+
+void deflateSocket::send(const string& buffer) {
+
+	sendRaw(reinterpret_cast <const byte_t*>(buffer.data()), buffer.length());
+}
+
+
+void deflateSocket::send(const char* str) {
+
+	sendRaw(reinterpret_cast <const byte_t*>(str), strlen(str));
+}
+
+
+void deflateSocket::sendRaw(const byte_t* buffer, const size_t count) {
+
+	compressAndSend(buffer, count);
+}
+
+
+size_t deflateSocket::sendRawNonBlocking(const byte_t* buffer, const size_t count) {
+
+	// The compressed stream cannot be interrupted: either all the
+	// data is sent, or none of it
+	if (!m_wrapped->waitForWrite(0)) {
+		return 0;
+	}
+
+	compressAndSend(buffer, count);
+
+	return count;
+}
+
+
+void deflateSocket::compressAndSend(const byte_t* buffer, const size_t count) {
+
+	if (count == 0) {
+		return;
+	}
+
+	m_deflate->next_in = const_cast <byte_t*>(buffer);
+	m_deflate->avail_in = static_cast <uInt>(count);
+
+	m_outBuffer.resize(deflateBound(m_deflate, static_cast <uLong>(count)) + 16);
+
+	size_t outLen = 0;
+
+	do {
+
+		if (outLen == m_outBuffer.size()) {
+			m_outBuffer.resize(m_outBuffer.size() * 2);
+		}
+
+		m_deflate->next_out = &m_outBuffer[outLen];
+		m_deflate->avail_out = static_cast <uInt>(m_outBuffer.size() - outLen);
+
+		const int ret = deflate(m_deflate, Z_SYNC_FLUSH);
+
+		if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			throw exceptions::socket_exception("deflate() failed");
+		}
+
+		outLen = m_outBuffer.size() - m_deflate->avail_out;
+
+	} while (m_deflate->avail_out == 0);
+
+	m_wrapped->sendRaw(&m_outBuffer[0], outLen);
+
+	m_uncompressedSent += count;
+	m_compressedSent += outLen;
+}
+
+
+unsigned int deflateSocket::getStatus() const {
+
+	return m_wrapped->getStatus();
+}
+
+
+vmime_uint64 deflateSocket::getUncompressedBytesSent() const {
+
+	return m_uncompressedSent;
+}
+
+
+vmime_uint64 deflateSocket::getCompressedBytesSent() const {
+
+	return m_compressedSent;
+}
+
+
+vmime_uint64 deflateSocket::getUncompressedBytesReceived() const {
+
+	return m_uncompressedReceived;
+}
+
+
+vmime_uint64 deflateSocket::getCompressedBytesReceived() const {
+
+	return m_compressedReceived;
+}
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_ZLIB_SUPPORT
@@ -0,0 +1,165 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_DEFLATESOCKET_HPP_INCLUDED
+#define VMIME_NET_DEFLATESOCKET_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_ZLIB_SUPPORT
+
+
+#include "vmime/types.hpp"
+
+#include "vmime/net/socket.hpp"
+
+
+struct z_stream_s;
+
+
+namespace vmime {
+namespace net {
+
+
+/** Add a compression layer to an existing socket: data is deflated
+  * when sent and inflated when received, as a continuous raw DEFLATE
+  * stream in each direction (RFC 1951). This is the format used by
+  * the COMPRESS=DEFLATE extension of IMAP (RFC 4978).
+  *
+  * Any socket can be wrapped, including a TLS socket.
+  */
+class VMIME_EXPORT deflateSocket : public socket {
+
+public:
+
+	/** Create a new socket object that compresses the data
+	  * exchanged on an existing socket.
+	  *
+	  * @param wrapped socket to wrap; it must be connected, and
+	  * compression must have been negotiated with the peer
+	  * @param receivedData compressed data which has already been read
+	  * from the wrapped socket (eg. buffered by a parser); it is inflated
+	  * before any data is received from the wrapped socket
+	  */
+	deflateSocket(const shared_ptr <socket>& wrapped, const string& receivedData = "");
+
+	~deflateSocket();
+
+	void connect(const string& address, const port_t port);
+	void disconnect();
+
+	bool isConnected() const;
+
+	bool waitForRead(const int msecs = 30000);
+	bool waitForWrite(const int msecs = 30000);
+
+	void receive(string& buffer);
+	size_t receiveRaw(byte_t* buffer, const size_t count);
+
+	void send(const string& buffer);
+	void send(const char* str);
+	void sendRaw(const byte_t* buffer, const size_t count);
+	size_t sendRawNonBlocking(const byte_t* buffer, const size_t count);
+
+	size_t getBlockSize() const;
+
+	unsigned int getStatus() const;
+
+	const string getPeerName() const;
+	const string getPeerAddress() const;
+
+	shared_ptr <timeoutHandler> getTimeoutHandler();
+
+	void setTracer(const shared_ptr <tracer>& tracer);
+	shared_ptr <tracer> getTracer();
+
+	int getDescriptor() const;
+
+	/** Return the number of bytes passed to send functions, before
+	  * compression.
+	  *
+	  * @return number of uncompressed bytes sent
+	  */
+	vmime_uint64 getUncompressedBytesSent() const;
+
+	/** Return the number of bytes sent on the wrapped socket, after
+	  * compression.
+	  *
+	  * @return number of compressed bytes sent
+	  */
+	vmime_uint64 getCompressedBytesSent() const;
+
+	/** Return the number of bytes returned by receive functions,
+	  * after decompression.
+	  *
+	  * @return number of uncompressed bytes received
+	  */
+	vmime_uint64 getUncompressedBytesReceived() const;
+
+	/** Return the number of bytes received on the wrapped socket,
+	  * before decompression.
+	  *
+	  * @return number of compressed bytes received
+	  */
+	vmime_uint64 getCompressedBytesReceived() const;
+
+private:
+
+	/** Compress data and send it on the wrapped socket. Output is
+	  * flushed, so that the peer can decompress everything which has
+	  * been sent so far.
+	  */
+	void compressAndSend(const byte_t* buffer, const size_t count);
+
+
+	shared_ptr <socket> m_wrapped;
+
+	z_stream_s* m_deflate;
+	z_stream_s* m_inflate;
+
+	std::vector <byte_t> m_outBuffer;
+
+	byte_t m_inBuffer[16384];
+	bool m_inflatePending;
+
+	// Compressed data given to the constructor
+	std::vector <byte_t> m_receivedData;
+
+	byte_t m_recvBuffer[65536];
+
+	vmime_uint64 m_uncompressedSent;
+	vmime_uint64 m_compressedSent;
+	vmime_uint64 m_uncompressedReceived;
+	vmime_uint64 m_compressedReceived;
+};
+
+
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_ZLIB_SUPPORT
+
+#endif // VMIME_NET_DEFLATESOCKET_HPP_INCLUDED
@@ -58,6 +58,7 @@ public:
 		UID = (1 << 6),            /**< Unique identifier (protocol specific). */
 		IMPORTANCE = (1 << 7),     /**< Header fields suitable for use with misc::importanceHelper. */
 		PEEK = (1 << 8),           /**< Use IMAP PEEK method when accessing HEADER fields. */
+		PART_HEADERS = (1 << 9),   /**< MIME header of each body part (implies STRUCTURE). */
 
 		CUSTOM = (1 << 16)         /**< Reserved for future use. */
 	};
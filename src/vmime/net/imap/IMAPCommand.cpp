@@ -212,6 +212,17 @@ shared_ptr <IMAPCommand> IMAPCommand::FETCH(
 	const std::vector <string>& params
 ) {
 
+	return FETCH(msgs, params, std::vector <string>());
+}
+
+
+// static
+shared_ptr <IMAPCommand> IMAPCommand::FETCH(
+	const messageSet& msgs,
+	const std::vector <string>& params,
+	const std::vector <string>& modifiers
+) {
+
 	std::ostringstream cmd;
 	cmd.imbue(std::locale::classic());
 
@@ -237,6 +248,19 @@ shared_ptr <IMAPCommand> IMAPCommand::FETCH(
 		cmd << ")";
 	}
 
+	// Fetch modifiers (RFC-4466), eg. CHANGEDSINCE
+	if (!modifiers.empty()) {
+
+		cmd << " (";
+
+		for (size_t i = 0, n = modifiers.size() ; i < n ; ++i) {
+			if (i != 0) cmd << " ";
+			cmd << modifiers[i];
+		}
+
+		cmd << ")";
+	}
+
 	return createCommand(cmd.str());
 }
 
@@ -286,27 +310,23 @@ shared_ptr <IMAPCommand> IMAPCommand::APPEND(
 	const size_t size
 ) {
 
-	std::ostringstream cmd;
-	cmd.imbue(std::locale::classic());
-	cmd << "APPEND " << IMAPUtils::quoteString(mailboxName);
-
-	if (!flags.empty()) {
-
-		cmd << " (";
+	return APPEND(mailboxName, flags, date, size, false);
+}
 
-		for (size_t i = 0, n = flags.size() ; i < n ; ++i) {
-			if (i != 0) cmd << " ";
-			cmd << flags[i];
-		}
 
-		cmd << ")";
-	}
-
-	if (date != NULL) {
-		cmd << " " << IMAPUtils::dateTime(*date);
-	}
+// static
+shared_ptr <IMAPCommand> IMAPCommand::APPEND(
+	const string& mailboxName,
+	const std::vector <string>& flags,
+	vmime::datetime* date,
+	const size_t size,
+	const bool nonSynchronizing
+) {
 
-	cmd << " {" << size << "}";
+	std::ostringstream cmd;
+	cmd.imbue(std::locale::classic());
+	cmd << "APPEND " << IMAPUtils::quoteString(mailboxName)
+	    << " " << IMAPUtils::appendArguments(flags, date, size, nonSynchronizing);
 
 	return createCommand(cmd.str());
 }
@@ -388,6 +408,32 @@ shared_ptr <IMAPCommand> IMAPCommand::CAPABILITY() {
 }
 
 
+// static
+shared_ptr <IMAPCommand> IMAPCommand::ENABLE(const std::vector <string>& capabilities) {
+
+	std::ostringstream cmd;
+	cmd.imbue(std::locale::classic());
+	cmd << "ENABLE";
+
+	for (size_t i = 0, n = capabilities.size() ; i < n ; ++i) {
+		cmd << " " << capabilities[i];
+	}
+
+	return createCommand(cmd.str());
+}
+
+
+// static
+shared_ptr <IMAPCommand> IMAPCommand::COMPRESS(const string& mechanism) {
+
+	std::ostringstream cmd;
+	cmd.imbue(std::locale::classic());
+	cmd << "COMPRESS " << mechanism;
+
+	return createCommand(cmd.str());
+}
+
+
 // static
 shared_ptr <IMAPCommand> IMAPCommand::NOOP() {
 
@@ -395,6 +441,13 @@ shared_ptr <IMAPCommand> IMAPCommand::NOOP() {
 }
 
 
+// static
+shared_ptr <IMAPCommand> IMAPCommand::IDLE() {
+
+	return createCommand("IDLE");
+}
+
+
 // static
 shared_ptr <IMAPCommand> IMAPCommand::EXPUNGE() {
 
@@ -409,6 +462,13 @@ shared_ptr <IMAPCommand> IMAPCommand::CLOSE() {
 }
 
 
+// static
+shared_ptr <IMAPCommand> IMAPCommand::UNSELECT() {
+
+	return createCommand("UNSELECT");
+}
+
+
 // static
 shared_ptr <IMAPCommand> IMAPCommand::LOGOUT() {
 
@@ -62,16 +62,22 @@ public:
 	static shared_ptr <IMAPCommand> DELETE(const string& mailboxName);
 	static shared_ptr <IMAPCommand> RENAME(const string& mailboxName, const string& newMailboxName);
 	static shared_ptr <IMAPCommand> FETCH(const messageSet& msgs, const std::vector <string>& params);
+	static shared_ptr <IMAPCommand> FETCH(const messageSet& msgs, const std::vector <string>& params, const std::vector <string>& modifiers);
 	static shared_ptr <IMAPCommand> STORE(const messageSet& msgs, const int mode, const std::vector <string>& flags);
 	static shared_ptr <IMAPCommand> APPEND(const string& mailboxName, const std::vector <string>& flags, vmime::datetime* date, const size_t size);
+	static shared_ptr <IMAPCommand> APPEND(const string& mailboxName, const std::vector <string>& flags, vmime::datetime* date, const size_t size, const bool nonSynchronizing);
 	static shared_ptr <IMAPCommand> COPY(const messageSet& msgs, const string& mailboxName);
 	static shared_ptr <IMAPCommand> SEARCH(const std::vector <string>& keys, const vmime::charset* charset);
 	static shared_ptr <IMAPCommand> UIDSEARCH(const std::vector <string>& keys, const vmime::charset* charset);
 	static shared_ptr <IMAPCommand> STARTTLS();
 	static shared_ptr <IMAPCommand> CAPABILITY();
+	static shared_ptr <IMAPCommand> ENABLE(const std::vector <string>& capabilities);
+	static shared_ptr <IMAPCommand> COMPRESS(const string& mechanism);
 	static shared_ptr <IMAPCommand> NOOP();
+	static shared_ptr <IMAPCommand> IDLE();
 	static shared_ptr <IMAPCommand> EXPUNGE();
 	static shared_ptr <IMAPCommand> CLOSE();
+	static shared_ptr <IMAPCommand> UNSELECT();
 	static shared_ptr <IMAPCommand> LOGOUT();
 
 	/** Creates a new IMAP command with the specified text.
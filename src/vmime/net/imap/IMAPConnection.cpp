@@ -49,6 +49,10 @@
 	#include "vmime/net/tls/TLSSecuredConnectionInfos.hpp"
 #endif // VMIME_HAVE_TLS_SUPPORT
 
+#if VMIME_HAVE_ZLIB_SUPPORT
+	#include "vmime/net/deflateSocket.hpp"
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
 #include <sstream>
 
 // Helpers for service properties
@@ -65,6 +69,34 @@ namespace net {
 namespace imap {
 
 
+// Names of the capabilities in IMAPConnection::Capabilities
+static const char* const KNOWN_CAPABILITIES[] = {
+	"IMAP4REV1",
+	"STARTTLS",
+	"LOGINDISABLED",
+	"SASL-IR",
+	"ENABLE",
+	"IDLE",
+	"CHILDREN",
+	"UNSELECT",
+	"LITERAL+",
+	"LITERAL-",
+	"MULTIAPPEND",
+	"CONDSTORE",
+	"QRESYNC",
+	"CREATE-SPECIAL-USE",
+	"COMPRESS=DEFLATE",
+	"BINARY"
+};
+
+static const size_t KNOWN_CAPABILITY_COUNT = sizeof(KNOWN_CAPABILITIES) / sizeof(KNOWN_CAPABILITIES[0]);
+
+static_assert(
+	KNOWN_CAPABILITY_COUNT == IMAPConnection::CAPABILITY_COUNT,
+	"KNOWN_CAPABILITIES must have an entry for each value of IMAPConnection::Capabilities"
+);
+
+
 IMAPConnection::IMAPConnection(
 	const shared_ptr <IMAPStore>& store,
 	const shared_ptr <security::authenticator>& auth
@@ -76,9 +108,13 @@ IMAPConnection::IMAPConnection(
 	  m_tag(null),
 	  m_hierarchySeparator('\0'),
 	  m_state(STATE_NONE),
+	  m_idle(false),
+	  m_streaming(false),
 	  m_timeoutHandler(null),
 	  m_secured(false),
+	  m_compressed(false),
 	  m_firstTag(true),
+	  m_capabilities(KNOWN_CAPABILITIES, KNOWN_CAPABILITY_COUNT),
 	  m_capabilitiesFetched(false),
 	  m_noModSeq(false) {
 
@@ -119,6 +155,7 @@ void IMAPConnection::connect() {
 	}
 
 	m_state = STATE_NONE;
+	m_idle = false;
 	m_hierarchySeparator = '\0';
 
 	const string address = GET_PROPERTY(string, PROPERTY_SERVER_ADDRESS);
@@ -240,6 +277,28 @@ void IMAPConnection::connect() {
 		}
 	}
 
+#if VMIME_HAVE_ZLIB_SUPPORT
+	// Enable compression, if supported by the server. This is done after
+	// authentication, so that credentials are not compressed (RFC-4978)
+	if (GET_PROPERTY(bool, PROPERTY_OPTIONS_COMPRESS)
+	    && hasCapability(CAPABILITY_COMPRESS_DEFLATE)) {
+
+		try {
+
+			startCompression();
+
+		} catch (exceptions::command_error&) {
+
+			// Non-fatal error: continue without compression
+
+		} catch (...) {
+
+			m_state = STATE_NONE;
+			throw;
+		}
+	}
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
 	// Get the hierarchy separator character
 	initHierarchySeparator();
 
@@ -595,7 +654,7 @@ const std::vector <string> IMAPConnection::getCapabilities() {
 		fetchCapabilities();
 	}
 
-	return m_capabilities;
+	return m_capabilities.getNames();
 }
 
 
@@ -605,30 +664,29 @@ bool IMAPConnection::hasCapability(const string& capa) {
 		fetchCapabilities();
 	}
 
-	const string normCapa = utility::stringUtils::toUpper(capa);
+	return m_capabilities.has(capa);
+}
 
-	for (size_t i = 0, n = m_capabilities.size() ; i < n ; ++i) {
 
-		if (m_capabilities[i] == normCapa) {
-			return true;
-		}
-	}
+bool IMAPConnection::hasCapability(const string& capa) const {
 
-	return false;
+	return m_capabilities.has(capa);
 }
 
 
-bool IMAPConnection::hasCapability(const string& capa) const {
+bool IMAPConnection::hasCapability(const Capabilities capa) {
 
-	const string normCapa = utility::stringUtils::toUpper(capa);
+	if (!m_capabilitiesFetched) {
+		fetchCapabilities();
+	}
 
-	for (size_t i = 0, n = m_capabilities.size() ; i < n ; ++i) {
+	return m_capabilities.has(capa);
+}
 
-		if (m_capabilities[i] == normCapa)
-			return true;
-	}
 
-	return false;
+bool IMAPConnection::hasCapability(const Capabilities capa) const {
+
+	return m_capabilities.has(capa);
 }
 
 
@@ -677,22 +735,109 @@ bool IMAPConnection::processCapabilityResponseData(const IMAPParser::response* r
 
 void IMAPConnection::processCapabilityResponseData(const IMAPParser::capability_data* capaData) {
 
-	std::vector <string> res;
+	m_capabilities.clear();
 
 	for (auto &cap : capaData->capabilities) {
 
 		if (cap->auth_type) {
-			res.push_back("AUTH=" + cap->auth_type->name);
+			m_capabilities.add("AUTH=" + cap->auth_type->name);
 		} else {
-			res.push_back(utility::stringUtils::toUpper(cap->atom->value));
+			m_capabilities.add(cap->atom->value);
 		}
 	}
 
-	m_capabilities = res;
 	m_capabilitiesFetched = true;
 }
 
 
+#if VMIME_HAVE_ZLIB_SUPPORT
+
+void IMAPConnection::startCompression() {
+
+	// Example:  C: t1 COMPRESS DEFLATE
+	//           S: t1 OK DEFLATE active
+	//
+	// Compression starts immediately after the CRLF of the tagged
+	// response, in both directions (RFC-4978).
+
+	IMAPCommand::COMPRESS("DEFLATE")->send(dynamicCast <IMAPConnection>(shared_from_this()));
+
+	scoped_ptr <IMAPParser::response> resp(m_parser->readResponse(*m_tag));
+
+	if (resp->isBad() || resp->response_done->response_tagged->
+			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+		throw exceptions::command_error("COMPRESS", resp->getErrorLog(), "bad response");
+	}
+
+	// Data received after the tagged response is already compressed
+	m_socket = make_shared <deflateSocket>(m_socket, m_parser->extractBufferedData());
+	m_parser->setSocket(m_socket);
+
+	m_compressed = true;
+}
+
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
+
+void IMAPConnection::enable(const std::vector <string>& capabilities) {
+
+	// Emit the "ENABLE" command (RFC-5161). This is only valid before
+	// a mailbox is selected on the connection.
+	//
+	// Example:  C: t2 ENABLE QRESYNC
+	//           S: * ENABLED QRESYNC
+	//           S: t2 OK Enabled
+
+	IMAPCommand::ENABLE(capabilities)->send(dynamicCast <IMAPConnection>(shared_from_this()));
+
+	scoped_ptr <IMAPParser::response> resp(m_parser->readResponse(*m_tag));
+
+	if (resp->isBad() || resp->response_done->response_tagged->
+			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+		throw exceptions::command_error("ENABLE", resp->getErrorLog(), "bad response");
+	}
+
+	for (auto &respData : resp->continue_req_or_response_data) {
+
+		if (!respData->response_data || !respData->response_data->enable_data) {
+			continue;
+		}
+
+		for (auto &cap : respData->response_data->enable_data->capabilities) {
+
+			if (cap->atom) {
+				m_enabledCapabilities.push_back(utility::stringUtils::toUpper(cap->atom->value));
+			}
+		}
+	}
+}
+
+
+bool IMAPConnection::isEnabled(const string& capa) const {
+
+	const string normCapa = utility::stringUtils::toUpper(capa);
+
+	for (size_t i = 0, n = m_enabledCapabilities.size() ; i < n ; ++i) {
+
+		if (m_enabledCapabilities[i] == normCapa) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool IMAPConnection::canSendNonSynchronizingLiteral(const size_t size) {
+
+	// LITERAL- only allows non-synchronizing literals up to 4096 bytes
+	return hasCapability(CAPABILITY_LITERAL_PLUS)
+		|| (size <= 4096 && hasCapability(CAPABILITY_LITERAL_MINUS));
+}
+
+
 shared_ptr <security::authenticator> IMAPConnection::getAuthenticator() {
 
 	return m_auth;
@@ -713,6 +858,12 @@ bool IMAPConnection::isSecuredConnection() const {
 }
 
 
+bool IMAPConnection::isCompressedConnection() const {
+
+	return m_compressed;
+}
+
+
 shared_ptr <connectionInfos> IMAPConnection::getConnectionInfos() const {
 
 	return m_cntInfos;
@@ -731,7 +882,8 @@ void IMAPConnection::disconnect() {
 
 void IMAPConnection::internalDisconnect() {
 
-	if (isConnected()) {
+	// No command is allowed in IDLE state: just close the socket
+	if (isConnected() && !m_idle) {
 
 		IMAPCommand::LOGOUT()->send(dynamicCast <IMAPConnection>(shared_from_this()));
 	}
@@ -744,9 +896,13 @@ void IMAPConnection::internalDisconnect() {
 	m_timeoutHandler = null;
 
 	m_state = STATE_LOGOUT;
+	m_idle = false;
 
 	m_secured = false;
+	m_compressed = false;
 	m_cntInfos = null;
+
+	m_enabledCapabilities.clear();
 }
 
 
@@ -793,24 +949,32 @@ void IMAPConnection::initHierarchySeparator() {
 
 void IMAPConnection::sendCommand(const shared_ptr <IMAPCommand>& cmd) {
 
+	if (m_idle) {
+		throw exceptions::illegal_state("Connection idle");
+	} else if (m_streaming) {
+		throw exceptions::illegal_state("Response being read");
+	}
+
+	// Send the whole line at once
+	m_socket->send(prepareCommand(cmd));
+}
+
+
+const string IMAPConnection::prepareCommand(const shared_ptr <IMAPCommand>& cmd) {
+
 	if (!m_firstTag) {
 		++(*m_tag);
 	}
 
-	m_socket->send(*m_tag);
-	m_socket->send(" ");
-	m_socket->send(cmd->getText());
-	m_socket->send("\r\n");
-
 	m_firstTag = false;
 
-	if (m_tracer) {
+	const string line = string(*m_tag) + " " + cmd->getText();
 
-		std::ostringstream oss;
-		oss << string(*m_tag) << " " << cmd->getText();
-
-		m_tracer->traceSend(oss.str());
+	if (m_tracer) {
+		m_tracer->traceSend(line);
 	}
+
+	return line + "\r\n";
 }
 
 
@@ -826,6 +990,63 @@ IMAPParser::response* IMAPConnection::readResponse(IMAPParser::literalHandler* l
 }
 
 
+IMAPParser::response* IMAPConnection::readResponse(
+	const IMAPTag& tag,
+	IMAPParser::literalHandler* lh
+) {
+
+	return m_parser->readResponse(tag, lh);
+}
+
+
+IMAPParser::response* IMAPConnection::readStreamedResponse(
+	IMAPParser::responseHandler* handler,
+	IMAPParser::literalHandler* lh
+) {
+
+	// The handler is called while the response is being read: it
+	// must not send commands on this connection
+	m_streaming = true;
+
+	IMAPParser::response* resp = NULL;
+
+	try {
+
+		resp = m_parser->readStreamedResponse(*m_tag, handler, lh);
+
+	} catch (...) {
+
+		m_streaming = false;
+		throw;
+	}
+
+	m_streaming = false;
+
+	return resp;
+}
+
+
+IMAPParser::response* IMAPConnection::readUntaggedResponse() {
+
+	return m_parser->readUntaggedResponse();
+}
+
+
+bool IMAPConnection::isResponseAvailable(const bool receive) {
+
+	return m_parser->isLineAvailable(receive);
+}
+
+
+bool IMAPConnection::readResponsePart(
+	IMAPParser::responseHandler* handler,
+	scoped_ptr <IMAPParser::response>& resp
+) {
+
+	return m_parser->readResponsePart(*m_tag, handler, resp);
+}
+
+
 IMAPConnection::ProtocolStates IMAPConnection::state() const {
 
 	return m_state;
@@ -838,6 +1059,18 @@ void IMAPConnection::setState(const ProtocolStates state) {
 }
 
 
+void IMAPConnection::setIdle(const bool idle) {
+
+	m_idle = idle;
+}
+
+
+bool IMAPConnection::isIdle() const {
+
+	return m_idle;
+}
+
+
 char IMAPConnection::hierarchySeparator() const {
 
 	return m_hierarchySeparator;
@@ -874,6 +1107,12 @@ shared_ptr <const socket> IMAPConnection::getSocket() const {
 }
 
 
+shared_ptr <socket> IMAPConnection::getSocket() {
+
+	return m_socket;
+}
+
+
 void IMAPConnection::setSocket(const shared_ptr <socket>& sok) {
 
 	m_socket = sok;
@@ -36,6 +36,7 @@
 #include "vmime/net/tracer.hpp"
 #include "vmime/net/session.hpp"
 #include "vmime/net/connectionInfos.hpp"
+#include "vmime/net/capabilitySet.hpp"
 
 #include "vmime/net/imap/IMAPParser.hpp"
 
@@ -76,6 +77,20 @@ public:
 	ProtocolStates state() const;
 	void setState(const ProtocolStates state);
 
+	/** Set whether the connection is in IDLE state (RFC 2177). While it
+	  * is, no command can be sent on the connection.
+	  *
+	  * @param idle true if the IDLE command has been accepted by the
+	  * server, false once it has been terminated
+	  */
+	void setIdle(const bool idle);
+
+	/** Test whether the connection is in IDLE state.
+	  *
+	  * @return true if the connection is idle, false otherwise
+	  */
+	bool isIdle() const;
+
 
 	char hierarchySeparator() const;
 
@@ -83,7 +98,30 @@ public:
 	void sendCommand(const shared_ptr <IMAPCommand>& cmd);
 	void sendRaw(const byte_t* buffer, const size_t count);
 
+	/** Assign the next tag to the specified command, and return the
+	  * command line (terminated by CRLF) without sending it. This lets
+	  * the caller send the command together with the data following it.
+	  *
+	  * @param cmd command to prepare
+	  * @return command line to send
+	  */
+	const string prepareCommand(const shared_ptr <IMAPCommand>& cmd);
+
 	IMAPParser::response* readResponse(IMAPParser::literalHandler* lh = NULL);
+	IMAPParser::response* readResponse(const IMAPTag& tag, IMAPParser::literalHandler* lh = NULL);
+
+	IMAPParser::response* readStreamedResponse(
+		IMAPParser::responseHandler* handler,
+		IMAPParser::literalHandler* lh = NULL
+	);
+
+	IMAPParser::response* readUntaggedResponse();
+	bool isResponseAvailable(const bool receive = true);
+
+	bool readResponsePart(
+		IMAPParser::responseHandler* handler,
+		scoped_ptr <IMAPParser::response>& resp
+	);
 
 
 	shared_ptr <const IMAPStore> getStore() const;
@@ -91,18 +129,58 @@ public:
 
 	shared_ptr <session> getSession();
 
+	/** Capabilities known by this implementation, which can be tested
+	  * without looking up their name (see hasCapability()).
+	  */
+	enum Capabilities {
+		CAPABILITY_IMAP4REV1,
+		CAPABILITY_STARTTLS,
+		CAPABILITY_LOGINDISABLED,
+		CAPABILITY_SASL_IR,
+		CAPABILITY_ENABLE,
+		CAPABILITY_IDLE,
+		CAPABILITY_CHILDREN,
+		CAPABILITY_UNSELECT,
+		CAPABILITY_LITERAL_PLUS,
+		CAPABILITY_LITERAL_MINUS,
+		CAPABILITY_MULTIAPPEND,
+		CAPABILITY_CONDSTORE,
+		CAPABILITY_QRESYNC,
+		CAPABILITY_CREATE_SPECIAL_USE,
+		CAPABILITY_COMPRESS_DEFLATE,
+		CAPABILITY_BINARY,
+
+		CAPABILITY_COUNT
+	};
+
 	void fetchCapabilities();
 	void invalidateCapabilities();
 	const std::vector <string> getCapabilities();
 	bool hasCapability(const string& capa);
 	bool hasCapability(const string& capa) const;
+	bool hasCapability(const Capabilities capa);
+	bool hasCapability(const Capabilities capa) const;
+
+	void enable(const std::vector <string>& capabilities);
+	bool isEnabled(const string& capa) const;
+
+	/** Test whether a literal of the specified size can be sent as a
+	  * non-synchronizing literal, ie. without waiting for a continuation
+	  * request from the server (LITERAL+ or LITERAL-, RFC-7888).
+	  *
+	  * @param size size of the literal, in bytes
+	  * @return true if a non-synchronizing literal can be used
+	  */
+	bool canSendNonSynchronizingLiteral(const size_t size);
 
 	shared_ptr <security::authenticator> getAuthenticator();
 
 	bool isSecuredConnection() const;
+	bool isCompressedConnection() const;
 	shared_ptr <connectionInfos> getConnectionInfos() const;
 
 	shared_ptr <const socket> getSocket() const;
+	shared_ptr <socket> getSocket();
 	void setSocket(const shared_ptr <socket>& sok);
 
 	shared_ptr <tracer> getTracer();
@@ -125,6 +203,10 @@ private:
 	void startTLS();
 #endif // VMIME_HAVE_TLS_SUPPORT
 
+#if VMIME_HAVE_ZLIB_SUPPORT
+	void startCompression();
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
 	bool processCapabilityResponseData(const IMAPParser::response* resp);
 	void processCapabilityResponseData(const IMAPParser::capability_data* capaData);
 
@@ -142,17 +224,22 @@ private:
 	char m_hierarchySeparator;
 
 	ProtocolStates m_state;
+	bool m_idle;
+	bool m_streaming;
 
 	shared_ptr <timeoutHandler> m_timeoutHandler;
 
 	bool m_secured;
+	bool m_compressed;
 	shared_ptr <connectionInfos> m_cntInfos;
 
 	bool m_firstTag;
 
-	std::vector <string> m_capabilities;
+	capabilitySet m_capabilities;
 	bool m_capabilitiesFetched;
 
+	std::vector <string> m_enabledCapabilities;
+
 	bool m_noModSeq;
 
 	shared_ptr <tracer> m_tracer;
@@ -32,18 +32,23 @@
 #include "vmime/net/imap/IMAPStore.hpp"
 #include "vmime/net/imap/IMAPParser.hpp"
 #include "vmime/net/imap/IMAPMessage.hpp"
+#include "vmime/net/imap/IMAPMessagePart.hpp"
 #include "vmime/net/imap/IMAPUtils.hpp"
 #include "vmime/net/imap/IMAPConnection.hpp"
 #include "vmime/net/imap/IMAPFolderStatus.hpp"
 #include "vmime/net/imap/IMAPCommand.hpp"
+#include "vmime/net/imap/IMAPPipelinedBatch.hpp"
 
 #include "vmime/message.hpp"
 
 #include "vmime/exception.hpp"
 
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
+#include "vmime/utility/streamUtils.hpp"
 
 #include <algorithm>
+#include <exception>
 #include <sstream>
 
 
@@ -52,6 +57,502 @@ namespace net {
 namespace imap {
 
 
+// Minimum number of messages fetched on each connection, when a set
+// of messages is fetched in parallel (see IMAPFolder::fetchMessages())
+static const size_t PARALLEL_FETCH_MIN_MESSAGES = 250;
+
+// Maximum time to wait for data on the connections before checking
+// the time-out, when fetching in parallel (in milliseconds)
+static const int PARALLEL_FETCH_WAIT_TIME = 250;
+
+
+// Converts a numeric message UID; returns false for '*' or an invalid UID
+static bool parseUID(const message::uid& uid, vmime_uint32& value) {
+
+	std::istringstream iss(static_cast <string>(uid));
+	iss.imbue(std::locale::classic());
+
+	return (iss >> value) && iss.eof();
+}
+
+
+//
+// IMAPFolder::resyncResult
+//
+
+IMAPFolder::resyncResult::resyncResult()
+	: uidValidityChanged(false),
+	  uidValidity(0),
+	  highestModSeq(0),
+	  vanishedUIDs(messageSet::empty()) {
+
+}
+
+
+//
+// IMAPFolder::fetchMessagesHandler
+//
+
+/** Processes the FETCH data of existing messages as soon as it has
+  * been received (see IMAPFolder::fetchMessages()).
+  */
+class IMAPFolder::fetchMessagesHandler : public IMAPParser::responseHandler {
+
+public:
+
+	fetchMessagesHandler(
+		const std::map <size_t, shared_ptr <IMAPMessage> >& numberToMsg,
+		const fetchAttributes& options,
+		utility::progressListener* progress
+	)
+		: m_numberToMsg(numberToMsg),
+		  m_options(options),
+		  m_progress(progress),
+		  m_current(0) {
+
+	}
+
+	bool handleResponseData(const IMAPParser::response_data& data) {
+
+		const IMAPParser::message_data* messageData = data.message_data.get();
+
+		// We are only interested in responses of type "FETCH"; other
+		// data (eg. status updates) is kept in the response
+		if (!messageData || messageData->type != IMAPParser::message_data::FETCH) {
+			return false;
+		}
+
+		// Process fetch response for this message
+		std::map <size_t, shared_ptr <IMAPMessage> >::const_iterator it =
+			m_numberToMsg.find(messageData->number);
+
+		if (it != m_numberToMsg.end()) {
+
+			(*it).second->processFetchResponse(m_options, *messageData);
+
+			if (m_progress) {
+				m_progress->progress(++m_current, m_numberToMsg.size());
+			}
+		}
+
+		return true;
+	}
+
+private:
+
+	const std::map <size_t, shared_ptr <IMAPMessage> >& m_numberToMsg;
+	const fetchAttributes& m_options;
+
+	utility::progressListener* m_progress;
+	size_t m_current;
+};
+
+
+
+//
+// IMAPFolder::parallelFetchHandler
+//
+
+/** Processes the FETCH data of the messages fetched on one of the
+  * connections used by IMAPFolder::fetchMessagesParallel(). Messages
+  * are identified by their UID, and the progress listener is shared
+  * between all the connections.
+  */
+class IMAPFolder::parallelFetchHandler : public IMAPParser::responseHandler {
+
+public:
+
+	parallelFetchHandler(
+		const std::map <string, shared_ptr <IMAPMessage> >& uidToMsg,
+		const fetchAttributes& options,
+		utility::progressListener* progress,
+		size_t& current,
+		const size_t total
+	)
+		: m_uidToMsg(uidToMsg),
+		  m_options(options),
+		  m_progress(progress),
+		  m_current(current),
+		  m_total(total) {
+
+	}
+
+	bool handleResponseData(const IMAPParser::response_data& data) {
+
+		const IMAPParser::message_data* messageData = data.message_data.get();
+
+		// We are only interested in responses of type "FETCH"; other
+		// data (eg. status updates) is kept in the response
+		if (!messageData || messageData->type != IMAPParser::message_data::FETCH) {
+			return false;
+		}
+
+		// Get message UID
+		message::uid msgUID;
+
+		for (auto &att : messageData->msg_att->items) {
+
+			if (att->type == IMAPParser::msg_att_item::UID) {
+				msgUID = att->uniqueid->value;
+				break;
+			}
+		}
+
+		// Process fetch response for this message
+		std::map <string, shared_ptr <IMAPMessage> >::const_iterator it =
+			m_uidToMsg.find(static_cast <string>(msgUID));
+
+		if (it != m_uidToMsg.end()) {
+
+			(*it).second->processFetchResponse(m_options, *messageData);
+
+			if (m_progress) {
+				m_progress->progress(++m_current, m_total);
+			}
+		}
+
+		return true;
+	}
+
+private:
+
+	const std::map <string, shared_ptr <IMAPMessage> >& m_uidToMsg;
+	const fetchAttributes& m_options;
+
+	utility::progressListener* m_progress;
+	size_t& m_current;
+	const size_t m_total;
+};
+
+
+namespace {
+
+/** Checks the connections used by IMAPFolder::fetchMessagesParallel()
+  * for IMAPUtils::waitForData().
+  */
+class connectionDataAvailabilityChecker : public IMAPUtils::dataAvailabilityChecker {
+
+public:
+
+	connectionDataAvailabilityChecker(const std::vector <shared_ptr <IMAPConnection> >& connections)
+		: m_connections(connections) {
+
+	}
+
+	bool isDataAvailable(const size_t index, int* descriptor) {
+
+		shared_ptr <socket> sok = m_connections[index]->getSocket();
+
+		if (descriptor) {
+			*descriptor = sok->getDescriptor();
+		}
+
+		return sok->waitForRead(0);
+	}
+
+private:
+
+	const std::vector <shared_ptr <IMAPConnection> >& m_connections;
+};
+
+} // namespace
+
+
+
+//
+// IMAPFolder::getAndFetchMessagesHandler
+//
+
+/** Creates messages from FETCH data as soon as it has been received,
+  * and hands them to a fetchHandler (see IMAPFolder::getAndFetchMessages()).
+  */
+class IMAPFolder::getAndFetchMessagesHandler : public IMAPParser::responseHandler {
+
+public:
+
+	getAndFetchMessagesHandler(
+		const shared_ptr <IMAPFolder>& folder,
+		const fetchAttributes& options,
+		fetchHandler& handler
+	)
+		: m_folder(folder),
+		  m_options(options),
+		  m_handler(handler) {
+
+	}
+
+	bool handleResponseData(const IMAPParser::response_data& data) {
+
+		const IMAPParser::message_data* messageData = data.message_data.get();
+
+		// We are only interested in responses of type "FETCH"; other
+		// data (eg. status updates) is kept in the response
+		if (!messageData || messageData->type != IMAPParser::message_data::FETCH) {
+			return false;
+		}
+
+		// Get message UID
+		message::uid msgUID;
+
+		for (auto &att : messageData->msg_att->items) {
+
+			if (att->type == IMAPParser::msg_att_item::UID) {
+				msgUID = att->uniqueid->value;
+				break;
+			}
+		}
+
+		// Create a new message reference
+		shared_ptr <IMAPMessage> msg =
+			make_shared <IMAPMessage>(m_folder, messageData->number, msgUID);
+
+		// Process fetch response for this message
+		msg->processFetchResponse(m_options, *messageData);
+
+		// Part headers can only be fetched once the response is complete
+		if (m_options.has(fetchAttributes::PART_HEADERS)) {
+			m_pending.push_back(msg);
+		} else {
+			m_handler.handleMessage(msg);
+		}
+
+		return true;
+	}
+
+	/** Return the messages which have not been handed to the handler
+	  * yet, because their part headers must be fetched first.
+	  */
+	const std::vector <shared_ptr <IMAPMessage> >& getPendingMessages() const {
+
+		return m_pending;
+	}
+
+private:
+
+	shared_ptr <IMAPFolder> m_folder;
+	const fetchAttributes& m_options;
+
+	fetchHandler& m_handler;
+
+	std::vector <shared_ptr <IMAPMessage> > m_pending;
+};
+
+
+
+//
+// IMAPFolder::appendSource
+//
+
+/** Provides the data of a message to upload with APPEND.
+  */
+class IMAPFolder::appendSource {
+
+public:
+
+	virtual ~appendSource() { }
+
+	/** Return the exact size of the message data, in bytes.
+	  */
+	virtual size_t getSize() = 0;
+
+	/** Write the message data to the specified stream.
+	  */
+	virtual void write(utility::outputStream& os) = 0;
+};
+
+
+/** Generates a message: once to count its size, then a second time
+  * while it is sent. This avoids keeping the whole message in memory.
+  * If some contents cannot be read twice (eg. a stream which cannot be
+  * reset), the message is generated only once, into memory.
+  */
+class IMAPFolder::messageAppendSource : public IMAPFolder::appendSource {
+
+public:
+
+	messageAppendSource(const shared_ptr <vmime::message>& msg)
+		: m_msg(msg),
+		  m_buffered(false) {
+
+	}
+
+	size_t getSize() {
+
+		const generationContext& ctx = generationContext::getDefaultContext();
+
+		if (m_msg->getBody()->isBuffered()) {
+			return m_msg->getExactGeneratedSize(ctx);
+		}
+
+		m_data.clear();
+
+		utility::outputStreamStringAdapter dataAdapter(m_data);
+		m_msg->generate(ctx, dataAdapter);
+
+		m_buffered = true;
+
+		return m_data.length();
+	}
+
+	void write(utility::outputStream& os) {
+
+		if (m_buffered) {
+			os.write(m_data.data(), m_data.length());
+		} else {
+			m_msg->generate(os);
+		}
+	}
+
+private:
+
+	shared_ptr <vmime::message> m_msg;
+
+	string m_data;
+	bool m_buffered;
+};
+
+
+/** Reads the message data from an input stream of known size.
+  */
+class IMAPFolder::streamAppendSource : public IMAPFolder::appendSource {
+
+public:
+
+	streamAppendSource(utility::inputStream& is, const size_t size)
+		: m_is(is),
+		  m_size(size) {
+
+	}
+
+	size_t getSize() {
+
+		return m_size;
+	}
+
+	void write(utility::outputStream& os) {
+
+		// Never write more than announced, even if the stream is longer
+		utility::bufferedStreamCopyRange(m_is, os, 0, m_size);
+	}
+
+private:
+
+	utility::inputStream& m_is;
+	const size_t m_size;
+};
+
+
+//
+// IMAPFolder::appendOutputStream
+//
+
+/** Sends an APPEND command and message data on a connection, by
+  * blocks of the socket block size, and notifies progress. Command
+  * lines are buffered with the data, so that a command using
+  * non-synchronizing literals goes out in as few writes as possible.
+  */
+class IMAPFolder::appendOutputStream : public utility::outputStream {
+
+public:
+
+	appendOutputStream(
+		const shared_ptr <IMAPConnection>& cnt,
+		utility::progressListener* progress,
+		const size_t total
+	)
+		: m_connection(cnt),
+		  m_progress(progress),
+		  m_current(0),
+		  m_total(total),
+		  m_pendingData(0),
+		  m_blockSize(cnt->getSocket()->getBlockSize()) {
+
+		m_buffer.reserve(m_blockSize);
+	}
+
+	/** Write protocol data (not counted as message data).
+	  */
+	void writeCommand(const string& line) {
+
+		writeBytes(reinterpret_cast <const byte_t*>(line.data()), line.length(), false);
+	}
+
+	void flush() {
+
+		if (!m_buffer.empty()) {
+
+			sendData(&m_buffer[0], m_buffer.size());
+			m_buffer.clear();
+		}
+	}
+
+	size_t getCurrent() const {
+
+		return m_current + m_pendingData;
+	}
+
+protected:
+
+	void writeImpl(const byte_t* const data, const size_t count) {
+
+		writeBytes(data, count, true);
+	}
+
+private:
+
+	void writeBytes(const byte_t* const data, const size_t count, const bool isMessageData) {
+
+		if (m_buffer.size() + count > m_blockSize) {
+
+			flush();
+
+			if (count >= m_blockSize) {
+
+				if (isMessageData) {
+					m_pendingData += count;
+				}
+
+				sendData(data, count);
+				return;
+			}
+		}
+
+		m_buffer.insert(m_buffer.end(), data, data + count);
+
+		if (isMessageData) {
+			m_pendingData += count;
+		}
+	}
+
+	void sendData(const byte_t* const data, const size_t count) {
+
+		m_connection->sendRaw(data, count);
+
+		if (m_pendingData != 0) {
+
+			m_current += m_pendingData;
+			m_pendingData = 0;
+
+			if (m_progress) {
+				m_progress->progress(m_current, m_total);
+			}
+		}
+	}
+
+
+	shared_ptr <IMAPConnection> m_connection;
+
+	utility::progressListener* m_progress;
+	size_t m_current;
+	const size_t m_total;
+
+	size_t m_pendingData;  // message data in buffer, not sent yet
+
+	const size_t m_blockSize;
+	std::vector <byte_t> m_buffer;
+};
+
+
 IMAPFolder::IMAPFolder(
 	const folder::path& path,
 	const shared_ptr <IMAPStore>& store,
@@ -63,7 +564,8 @@ IMAPFolder::IMAPFolder(
 	  m_name(path.isEmpty() ? folder::path::component("") : path.getLastComponent()),
 	  m_mode(-1),
 	  m_open(false),
-	  m_attribs(attribs) {
+	  m_attribs(attribs),
+	  m_partCache(make_shared <IMAPMessagePartCache>()) {
 
 	store->registerFolder(this);
 
@@ -163,14 +665,11 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable) {
 		}
 	}
 
-	// Open a connection for this folder
-	shared_ptr <IMAPConnection> connection =
-		make_shared <IMAPConnection>(store, store->getAuthenticator());
+	// Get a connection for this folder
+	shared_ptr <IMAPConnection> connection = store->acquireConnection();
 
 	try {
 
-		connection->connect();
-
 		// Emit the "SELECT" command
 		//
 		// Example:  C: A142 SELECT INBOX
@@ -184,7 +683,7 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable) {
 
 		std::vector <string> selectParams;
 
-		if (m_connection->hasCapability("CONDSTORE")) {
+		if (m_connection->hasCapability(IMAPConnection::CAPABILITY_CONDSTORE)) {
 			selectParams.push_back("CONDSTORE");
 		}
 
@@ -278,12 +777,24 @@ void IMAPFolder::open(const int mode, bool failIfModeIsNotAvailable) {
 			}
 		}
 
+		connection->setState(IMAPConnection::STATE_SELECTED);
+
 		m_connection = connection;
 		m_open = true;
 		m_mode = mode;
 
+	} catch (exceptions::command_error&) {
+
+		// The connection is still usable
+		store->releaseConnection(connection);
+		throw;
+
 	} catch (std::exception&) {
 
+		if (connection->isConnected()) {
+			connection->disconnect();
+		}
+
 		throw;
 	}
 }
@@ -309,43 +820,81 @@ void IMAPFolder::close(const bool expunge) {
 		throw exceptions::illegal_state("Folder not open");
 	}
 
-	shared_ptr <IMAPConnection> oldConnection = m_connection;
-
-	// Emit the "CLOSE" command to expunge messages marked
-	// as deleted (this is fastest than "EXPUNGE")
-	if (expunge) {
+	if (m_connection->isIdle()) {
+		stopIdle();
+	}
 
-		if (m_mode == MODE_READ_ONLY) {
-			throw exceptions::operation_not_supported();
-		}
+	shared_ptr <IMAPConnection> oldConnection = m_connection;
 
-		IMAPCommand::CLOSE()->send(oldConnection);
+	if (expunge && m_mode == MODE_READ_ONLY) {
+		throw exceptions::operation_not_supported();
 	}
 
-	// Close this folder connection
-	oldConnection->disconnect();
+	if (store->getConnectionPoolSize() != 0) {
 
-	// Now use default store connection
-	m_connection = store->connection();
+		// Return to the authenticated state, so that the connection
+		// can be reused. "CLOSE" expunges messages marked as deleted,
+		// except if the folder is read-only; "UNSELECT" never does.
+		shared_ptr <IMAPCommand> cmd;
 
-	m_open = false;
-	m_mode = -1;
+		if (expunge || m_mode == MODE_READ_ONLY) {
+			cmd = IMAPCommand::CLOSE();
+		} else if (oldConnection->hasCapability(IMAPConnection::CAPABILITY_UNSELECT)) {
+			cmd = IMAPCommand::UNSELECT();
+		}
 
-	m_status = make_shared <IMAPFolderStatus>();
+		if (cmd) {
 
-	onClose();
-}
+			cmd->send(oldConnection);
 
+			scoped_ptr <IMAPParser::response> resp(oldConnection->readResponse());
 
-void IMAPFolder::onClose() {
+			if (!resp->isBad() && resp->response_done->response_tagged->
+					resp_cond_state->status == IMAPParser::resp_cond_state::OK) {
 
-	for (std::vector <IMAPMessage*>::iterator it = m_messages.begin() ;
+				oldConnection->setState(IMAPConnection::STATE_AUTHENTICATED);
+			}
+		}
+
+		// Keep the connection in the pool, or close it if it is
+		// still in the selected state
+		store->releaseConnection(oldConnection);
+
+	} else {
+
+		// Emit the "CLOSE" command to expunge messages marked
+		// as deleted (this is fastest than "EXPUNGE")
+		if (expunge) {
+			IMAPCommand::CLOSE()->send(oldConnection);
+		}
+
+		// Close this folder connection
+		oldConnection->disconnect();
+	}
+
+	// Now use default store connection
+	m_connection = store->connection();
+
+	m_open = false;
+	m_mode = -1;
+
+	m_status = make_shared <IMAPFolderStatus>();
+
+	onClose();
+}
+
+
+void IMAPFolder::onClose() {
+
+	for (std::vector <IMAPMessage*>::iterator it = m_messages.begin() ;
 	     it != m_messages.end() ; ++it) {
 
 		(*it)->onFolderClosed();
 	}
 
 	m_messages.clear();
+
+	m_partCache->clear();
 }
 
 
@@ -381,7 +930,7 @@ void IMAPFolder::create(const folderAttributes& attribs) {
 
 	if (attribs.getSpecialUse() != folderAttributes::SPECIALUSE_NONE) {
 
-		if (!m_connection->hasCapability("CREATE-SPECIAL-USE")) {
+		if (!m_connection->hasCapability(IMAPConnection::CAPABILITY_CREATE_SPECIAL_USE)) {
 			throw exceptions::operation_not_supported();
 		}
 
@@ -680,6 +1229,358 @@ vmime_uint64 IMAPFolder::getHighestModSequence() const {
 }
 
 
+IMAPFolder::resyncResult IMAPFolder::resync(
+	const vmime_uint32 uidValidity,
+	const vmime_uint64 highestModSeq,
+	const messageSet& knownUIDs
+) {
+
+	shared_ptr <IMAPStore> store = m_store.lock();
+
+	if (!store) {
+		throw exceptions::illegal_state("Store disconnected");
+	} else if (highestModSeq == 0) {
+		throw std::invalid_argument("highestModSeq");
+	} else if (!knownUIDs.isEmpty() && !knownUIDs.isUIDSet()) {
+		throw std::invalid_argument("knownUIDs");
+	}
+
+	shared_ptr <IMAPConnection> connection = store->getConnection();
+
+	const bool qresync = connection->hasCapability(IMAPConnection::CAPABILITY_QRESYNC);
+
+	if (!qresync && !connection->hasCapability(IMAPConnection::CAPABILITY_CONDSTORE)) {
+		throw exceptions::operation_not_supported();
+	}
+
+	// QRESYNC must be enabled before a mailbox is selected
+	if (qresync && !connection->isEnabled("QRESYNC")) {
+		connection->enable(std::vector <string>(1, "QRESYNC"));
+	}
+
+	// Emit the "EXAMINE" command: the folder is opened read-only, so that
+	// the state of the messages is not modified (eg. Recent flag)
+	//
+	// Example:  C: A02 EXAMINE INBOX (QRESYNC (67890007 20050715194045000 41,43:211))
+	//           S: * OK [CLOSED]
+	//           S: * 314 EXISTS
+	//           S: * OK [UIDVALIDITY 67890007] UIDVALIDITY
+	//           S: * OK [HIGHESTMODSEQ 20050715194045000] Highest
+	//           S: * VANISHED (EARLIER) 41,43:116,118,120:211
+	//           S: * 49 FETCH (UID 117 FLAGS (\Seen \Answered) MODSEQ (90060115194045001))
+	//           S: A02 OK [READ-ONLY] EXAMINE completed
+
+	std::vector <string> selectParams;
+
+	if (qresync) {
+
+		std::ostringstream qresyncParam;
+		qresyncParam.imbue(std::locale::classic());
+		qresyncParam << "QRESYNC (" << uidValidity << " " << highestModSeq;
+
+		if (!knownUIDs.isEmpty()) {
+			qresyncParam << " " << IMAPUtils::messageSetToSequenceSet(knownUIDs);
+		}
+
+		qresyncParam << ")";
+
+		selectParams.push_back(qresyncParam.str());
+
+	} else {
+
+		selectParams.push_back("CONDSTORE");
+	}
+
+	IMAPCommand::SELECT(
+		/* readOnly */ true,
+		IMAPUtils::pathToString(connection->hierarchySeparator(), getFullPath()),
+		selectParams
+	)->send(connection);
+
+	resyncResult result;
+	size_t messageCount = 0;
+	bool haveModSeq = true;
+	bool selected = false;
+
+	// Return to the authenticated state (no message is expunged, as
+	// the folder has been opened read-only)
+	auto closeFolder = [&connection]() {
+
+		IMAPCommand::CLOSE()->send(connection);
+
+		scoped_ptr <IMAPParser::response> resp(connection->readResponse());
+
+		if (resp->isBad() || resp->response_done->response_tagged->
+				resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+			throw exceptions::command_error("CLOSE", resp->getErrorLog(), "bad response");
+		}
+	};
+
+	try {
+
+		{
+			scoped_ptr <IMAPParser::response> resp(connection->readResponse());
+
+			if (resp->isBad() || resp->response_done->response_tagged->
+					resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+				throw exceptions::command_error("EXAMINE", resp->getErrorLog(), "bad response");
+			}
+
+			selected = true;
+
+			haveModSeq = processResyncResponse(*resp, result, messageCount);
+		}
+
+		if (result.uidValidity != uidValidity) {
+
+			// Saved state is obsolete; the server did not report changes
+			result.uidValidityChanged = true;
+			result.changedMessages.clear();
+			result.vanishedUIDs = messageSet::empty();
+
+		} else if (haveModSeq && !qresync) {
+
+			// Fetch the flags which changed since the saved state
+			//
+			// Example:  C: A03 UID FETCH 1:* (UID FLAGS) (CHANGEDSINCE 12345)
+			//           S: * 1 FETCH (UID 4 MODSEQ (12121231000) FLAGS (\Seen))
+			//           S: A03 OK Fetch completed
+
+			std::vector <string> fetchParams;
+			fetchParams.push_back("UID");
+			fetchParams.push_back("FLAGS");
+
+			std::ostringstream changedSince;
+			changedSince.imbue(std::locale::classic());
+			changedSince << "CHANGEDSINCE " << highestModSeq;
+
+			IMAPCommand::FETCH(
+				messageSet::byUID(1, "*"),
+				fetchParams,
+				std::vector <string>(1, changedSince.str())
+			)->send(connection);
+
+			scoped_ptr <IMAPParser::response> resp(connection->readResponse());
+
+			if (resp->isBad() || resp->response_done->response_tagged->
+					resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+				throw exceptions::command_error("UID FETCH", resp->getErrorLog(), "bad response");
+			}
+
+			processResyncResponse(*resp, result, messageCount);
+
+			// Expunged messages are not reported without QRESYNC. As new
+			// messages have been fetched above, the message count tells
+			// whether some known messages have been expunged.
+			bool countable = true;
+			size_t knownCount = 0;
+			vmime_uint32 maxKnownUID = 0;
+
+			for (size_t i = 0, n = knownUIDs.getRangeCount() ; countable && i < n ; ++i) {
+
+				const UIDMessageRange& range = dynamic_cast <const UIDMessageRange&>(knownUIDs.getRangeAt(i));
+
+				vmime_uint32 first = 0, last = 0;
+
+				if (parseUID(range.getFirst(), first) && parseUID(range.getLast(), last) && first <= last) {
+
+					knownCount += last - first + 1;
+					maxKnownUID = std::max(maxKnownUID, last);
+
+				} else {
+
+					countable = false;
+				}
+			}
+
+			size_t newCount = 0;
+
+			for (size_t i = 0, n = result.changedMessages.size() ; i < n ; ++i) {
+
+				vmime_uint32 uid = 0;
+
+				if (parseUID(result.changedMessages[i]->getUID(), uid) && uid > maxKnownUID) {
+					++newCount;
+				}
+			}
+
+			if (!countable || messageCount != knownCount + newCount) {
+
+				// Search which known messages still exist
+				std::vector <string> searchKeys;
+				searchKeys.push_back("UID " + IMAPUtils::messageSetToSequenceSet(knownUIDs));
+
+				IMAPCommand::UIDSEARCH(searchKeys, /* charset */ NULL)->send(connection);
+
+				scoped_ptr <IMAPParser::response> resp(connection->readResponse());
+
+				if (resp->isBad() || resp->response_done->response_tagged->
+						resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+					throw exceptions::command_error("UIDSEARCH", resp->getErrorLog(), "bad response");
+				}
+
+				std::vector <vmime_uint32> existingUIDs;
+
+				for (auto &respData : resp->continue_req_or_response_data) {
+
+					auto *mailboxData = respData->response_data ? respData->response_data->mailbox_data.get() : NULL;
+
+					if (!mailboxData || mailboxData->type != IMAPParser::mailbox_data::SEARCH) {
+						continue;
+					}
+
+					for (auto &nzn : mailboxData->search_nz_number_list) {
+						existingUIDs.push_back(static_cast <vmime_uint32>(nzn->value));
+					}
+				}
+
+				std::sort(existingUIDs.begin(), existingUIDs.end());
+
+				// Vanished UIDs are the gaps between existing UIDs
+				for (size_t i = 0, n = knownUIDs.getRangeCount() ; i < n ; ++i) {
+
+					const UIDMessageRange& range = dynamic_cast <const UIDMessageRange&>(knownUIDs.getRangeAt(i));
+
+					vmime_uint32 first = 0, last = 0;
+
+					if (!parseUID(range.getFirst(), first) || !parseUID(range.getLast(), last)) {
+						continue;
+					}
+
+					std::vector <vmime_uint32>::const_iterator it =
+						std::lower_bound(existingUIDs.begin(), existingUIDs.end(), first);
+
+					for (vmime_uint32 uid = first ; uid <= last ; ) {
+
+						if (it != existingUIDs.end() && *it <= last) {
+
+							if (*it > uid) {
+								result.vanishedUIDs.addRange(UIDMessageRange(uid, *it - 1));
+							}
+
+							// Do not wrap around when the range ends at the highest UID
+							if (*it == last) {
+								break;
+							}
+
+							uid = *it + 1;
+							++it;
+
+						} else {
+
+							result.vanishedUIDs.addRange(UIDMessageRange(uid, last));
+							break;
+						}
+					}
+				}
+			}
+		}
+
+	} catch (...) {
+
+		// Do not leave the folder selected on the store connection
+		if (selected) {
+
+			try {
+				closeFolder();
+			} catch (...) {
+				// Ignore
+			}
+		}
+
+		throw;
+	}
+
+	closeFolder();
+
+	if (!haveModSeq) {
+		throw exceptions::operation_not_supported();
+	}
+
+	return result;
+}
+
+
+bool IMAPFolder::processResyncResponse(
+	const IMAPParser::response& resp,
+	resyncResult& result,
+	size_t& messageCount
+) {
+
+	bool haveModSeq = true;
+
+	for (auto &respData : resp.continue_req_or_response_data) {
+
+		const IMAPParser::response_data* data = respData->response_data.get();
+
+		if (!data) {
+			continue;
+		}
+
+		if (data->resp_cond_state && data->resp_cond_state->resp_text->resp_text_code) {
+
+			const IMAPParser::resp_text_code* code = data->resp_cond_state->resp_text->resp_text_code.get();
+
+			switch (code->type) {
+
+				case IMAPParser::resp_text_code::UIDVALIDITY:
+
+					result.uidValidity = static_cast <vmime_uint32>(code->nz_number->value);
+					break;
+
+				case IMAPParser::resp_text_code::HIGHESTMODSEQ:
+
+					result.highestModSeq = code->mod_sequence_value->value;
+					break;
+
+				case IMAPParser::resp_text_code::NOMODSEQ:
+
+					haveModSeq = false;
+					break;
+
+				default:
+
+					break;
+			}
+
+		} else if (data->mailbox_data) {
+
+			if (data->mailbox_data->type == IMAPParser::mailbox_data::EXISTS) {
+				messageCount = data->mailbox_data->number->value;
+			}
+
+		} else if (data->message_data) {
+
+			if (data->message_data->type != IMAPParser::message_data::FETCH) {
+				continue;
+			}
+
+			shared_ptr <IMAPMessage> msg = make_shared <IMAPMessage>(
+				dynamicCast <IMAPFolder>(shared_from_this()), data->message_data->number
+			);
+
+			msg->processFetchResponse(fetchAttributes::FLAGS | fetchAttributes::UID, *data->message_data);
+
+			result.changedMessages.push_back(msg);
+
+		} else if (data->expunged_resp) {
+
+			const messageSet vanished = IMAPUtils::buildMessageSet(*data->expunged_resp->uid_set);
+
+			for (size_t i = 0, n = vanished.getRangeCount() ; i < n ; ++i) {
+				result.vanishedUIDs.addRange(vanished.getRangeAt(i));
+			}
+		}
+	}
+
+	return haveModSeq;
+}
+
+
 shared_ptr <folder> IMAPFolder::getFolder(const folder::path::component& name) {
 
 	shared_ptr <IMAPStore> store = m_store.lock();
@@ -799,13 +1700,44 @@ void IMAPFolder::fetchMessages(
 		return;
 	}
 
+	// Split large sets of messages across the connections of the pool
+	const size_t partCount =
+		std::min(store->getConnectionPoolSize() + 1, msg.size() / PARALLEL_FETCH_MIN_MESSAGES);
+
+	if (partCount >= 2) {
+		fetchMessagesParallel(msg, options, progress, partCount);
+	} else {
+		fetchMessagesImpl(msg, options, progress);
+	}
+
+	// Fetch part headers, once the structure is known
+	if (options.has(fetchAttributes::PART_HEADERS)) {
+
+		std::vector <shared_ptr <IMAPMessage> > imapMsgs;
+		imapMsgs.reserve(msg.size());
+
+		for (std::vector <shared_ptr <message> >::iterator it = msg.begin() ; it != msg.end() ; ++it) {
+			imapMsgs.push_back(dynamicCast <IMAPMessage>(*it));
+		}
+
+		fetchPartHeaders(imapMsgs);
+	}
+}
+
+
+void IMAPFolder::fetchMessagesImpl(
+	const std::vector <shared_ptr <message> >& msg,
+	const fetchAttributes& options,
+	utility::progressListener* progress
+) {
+
 	// Build message numbers list
 	std::vector <size_t> list;
 	list.reserve(msg.size());
 
 	std::map <size_t, shared_ptr <IMAPMessage> > numberToMsg;
 
-	for (std::vector <shared_ptr <message> >::iterator it = msg.begin() ; it != msg.end() ; ++it) {
+	for (std::vector <shared_ptr <message> >::const_iterator it = msg.begin() ; it != msg.end() ; ++it) {
 
 		list.push_back((*it)->getNumber());
 		numberToMsg[(*it)->getNumber()] = dynamicCast <IMAPMessage>(*it);
@@ -816,8 +1748,33 @@ void IMAPFolder::fetchMessages(
 		m_connection, messageSet::byNumber(list), options
 	)->send(m_connection);
 
-	// Get the response
-	scoped_ptr <IMAPParser::response> resp(m_connection->readResponse());
+	const size_t total = numberToMsg.size();
+
+	if (progress) {
+		progress->start(total);
+	}
+
+	// Get the response: messages are processed as their data is
+	// received, and the data is freed immediately
+	fetchMessagesHandler handler(numberToMsg, options, progress);
+	scoped_ptr <IMAPParser::response> resp;
+
+	try {
+
+		resp.reset(m_connection->readStreamedResponse(&handler));
+
+	} catch (...) {
+
+		if (progress) {
+			progress->stop(total);
+		}
+
+		throw;
+	}
+
+	if (progress) {
+		progress->stop(total);
+	}
 
 	if (resp->isBad() || resp->response_done->response_tagged->
 		resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
@@ -825,59 +1782,412 @@ void IMAPFolder::fetchMessages(
 		throw exceptions::command_error("FETCH", resp->getErrorLog(), "bad response");
 	}
 
-	auto &respDataList = resp->continue_req_or_response_data;
+	for (auto &respData : resp->continue_req_or_response_data) {
+
+		if (!respData->response_data) {
+			throw exceptions::command_error("FETCH", resp->getErrorLog(), "invalid response");
+		}
+	}
+
+	processStatusUpdate(resp.get());
+}
+
+
+void IMAPFolder::fetchMessagesParallel(
+	const std::vector <shared_ptr <message> >& msg,
+	const fetchAttributes& options,
+	utility::progressListener* progress,
+	const size_t partCount
+) {
+
+	shared_ptr <IMAPStore> store = m_store.lock();
+
+	// Messages are identified by their UID on the other connections, as
+	// sequence numbers may differ from those known on this connection
+	std::vector <shared_ptr <message> > withoutUID;
+
+	for (std::vector <shared_ptr <message> >::const_iterator it = msg.begin() ; it != msg.end() ; ++it) {
+
+		if ((*it)->getUID().empty()) {
+			withoutUID.push_back(*it);
+		}
+	}
+
+	if (!withoutUID.empty()) {
+		fetchMessagesImpl(withoutUID, fetchAttributes(fetchAttributes::UID), NULL);
+	}
+
+	// Split messages into parts of consecutive messages
+	std::vector <std::map <string, shared_ptr <IMAPMessage> > > parts(partCount);
+
+	for (size_t i = 0 ; i < msg.size() ; ++i) {
+		parts[i * partCount / msg.size()][static_cast <string>(msg[i]->getUID())] = dynamicCast <IMAPMessage>(msg[i]);
+	}
+
+	// Open this folder in read-only mode on the other connections
+	std::vector <shared_ptr <IMAPConnection> > connections(partCount);
+	connections[0] = m_connection;
+
+	try {
+
+		for (size_t i = 1 ; i < partCount ; ++i) {
+
+			connections[i] = store->acquireConnection();
+
+			IMAPCommand::SELECT(
+				/* readOnly */ true,
+				IMAPUtils::pathToString(connections[i]->hierarchySeparator(), getFullPath()),
+				std::vector <string>()
+			)->send(connections[i]);
+
+			scoped_ptr <IMAPParser::response> resp(connections[i]->readResponse());
+
+			if (resp->isBad() || resp->response_done->response_tagged->
+					resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+				throw exceptions::command_error("EXAMINE", resp->getErrorLog(), "bad response");
+			}
+
+			connections[i]->setState(IMAPConnection::STATE_SELECTED);
+		}
+
+	} catch (...) {
+
+		for (size_t i = 1 ; i < partCount ; ++i) {
+
+			if (connections[i]) {
+
+				try {
+					connections[i]->disconnect();
+				} catch (exception&) {
+					// Ignore
+				}
+			}
+		}
+
+		throw;
+	}
 
 	const size_t total = msg.size();
 	size_t current = 0;
 
+	std::vector <scoped_ptr <parallelFetchHandler> > handlers(partCount);
+	std::vector <scoped_ptr <IMAPParser::response> > responses(partCount);
+	std::vector <bool> complete(partCount, false);
+
+	// Whether sending the request on the connection of this folder has
+	// started, and whether it has completed
+	bool requestStarted = false;
+	bool requestSent = false;
+
 	if (progress) {
 		progress->start(total);
 	}
 
-	try {
+	try {
+
+		// Send the request on every connection first, so that the server
+		// processes them at the same time
+		for (size_t i = 0 ; i < partCount ; ++i) {
+
+			std::vector <message::uid> uids;
+			uids.reserve(parts[i].size());
+
+			for (auto it = parts[i].begin() ; it != parts[i].end() ; ++it) {
+				uids.push_back(message::uid(it->first));
+			}
+
+			handlers[i].reset(new parallelFetchHandler(parts[i], options, progress, current, total));
+
+			shared_ptr <IMAPCommand> cmd =
+				IMAPUtils::buildFetchCommand(connections[i], messageSet::byUID(uids), options);
+
+			requestStarted = requestStarted || (i == 0);
+
+			cmd->send(connections[i]);
+
+			requestSent = requestSent || (i == 0);
+		}
+
+		// Then, read the responses in this thread, taking turns on the
+		// connections on which data has been received. Messages are
+		// processed one at a time, as when fetching on one connection.
+		shared_ptr <timeoutHandler> toh = m_connection->getSocket()->getTimeoutHandler();
+
+		if (toh) {
+			toh->resetTimeOut();
+		}
+
+		size_t remaining = partCount;
+
+		while (remaining != 0) {
+
+			bool received = false;
+
+			for (size_t i = 0 ; i < partCount ; ++i) {
+
+				while (!complete[i] && connections[i]->isResponseAvailable()) {
+
+					if (connections[i]->readResponsePart(handlers[i].get(), responses[i])) {
+
+						complete[i] = true;
+						--remaining;
+					}
+
+					received = true;
+				}
+			}
+
+			if (received) {
+
+				if (toh) {
+					toh->resetTimeOut();
+				}
+
+				continue;
+			}
+
+			// Check whether the time-out delay is elapsed
+			if (toh && toh->isTimeOut()) {
+
+				if (!toh->handleTimeOut()) {
+					throw exceptions::operation_timed_out();
+				}
+
+				toh->resetTimeOut();
+			}
+
+			// Wait for data on all the incomplete connections at once
+			std::vector <shared_ptr <IMAPConnection> > waiting;
+
+			for (size_t i = 0 ; i < partCount ; ++i) {
+
+				if (!complete[i]) {
+					waiting.push_back(connections[i]);
+				}
+			}
+
+			connectionDataAvailabilityChecker checker(waiting);
+			std::vector <bool> ready;
+
+			IMAPUtils::waitForData(checker, waiting.size(), PARALLEL_FETCH_WAIT_TIME, ready);
+		}
+
+	} catch (...) {
+
+		if (progress) {
+			progress->stop(total);
+		}
+
+		// The other connections are not synchronized anymore
+		for (size_t i = 1 ; i < partCount ; ++i) {
+
+			try {
+				connections[i]->disconnect();
+			} catch (...) {
+				// Ignore
+			}
+		}
+
+		// Read the rest of the response on the connection of this folder,
+		// so that the next commands are not confused by it
+		bool synchronized = complete[0] || !requestStarted;
+
+		if (!synchronized && requestSent) {
+
+			try {
+
+				while (!connections[0]->readResponsePart(handlers[0].get(), responses[0])) {
+					// Read next part
+				}
+
+				synchronized = true;
+
+			} catch (...) {
+
+				// Ignore
+			}
+		}
+
+		// Otherwise, the folder is closed
+		if (!synchronized) {
+
+			try {
+				m_connection->disconnect();
+			} catch (...) {
+				// Ignore
+			}
+
+			m_connection = store->connection();
+
+			m_open = false;
+			m_mode = -1;
+
+			m_status = make_shared <IMAPFolderStatus>();
+
+			onClose();
+		}
+
+		throw;
+	}
+
+	if (progress) {
+		progress->stop(total);
+	}
+
+	// Close the folder on the other connections, and give them back to
+	// the pool; connections on which an error occurred are closed
+	for (size_t i = 1 ; i < partCount ; ++i) {
+
+		try {
+
+			IMAPCommand::CLOSE()->send(connections[i]);
+
+			scoped_ptr <IMAPParser::response> resp(connections[i]->readResponse());
+
+			if (!resp->isBad() && resp->response_done->response_tagged->
+					resp_cond_state->status == IMAPParser::resp_cond_state::OK) {
+
+				connections[i]->setState(IMAPConnection::STATE_AUTHENTICATED);
+			}
+
+			store->releaseConnection(connections[i]);
+
+		} catch (...) {
+
+			// The connection will not be reused
+			try {
+				connections[i]->disconnect();
+			} catch (...) {
+				// Ignore
+			}
+		}
+	}
+
+	for (size_t i = 0 ; i < partCount ; ++i) {
+
+		const IMAPParser::response* resp = responses[i].get();
+
+		if (resp->isBad() || resp->response_done->response_tagged->
+			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+			throw exceptions::command_error("FETCH", resp->getErrorLog(), "bad response");
+		}
+	}
+
+	// Status updates are only relevant on the connection of this folder
+	processStatusUpdate(responses[0].get());
+}
+
+
+void IMAPFolder::fetchPartHeaders(const std::vector <shared_ptr <IMAPMessage> >& msgs) {
+
+	// Group messages by list of part sections: messages with the
+	// same structure can be fetched with a single command
+	std::map <std::vector <string>, std::vector <size_t> > sectionsToNumbers;
+	std::map <size_t, std::map <string, shared_ptr <IMAPMessagePart> > > numberToParts;
+
+	for (std::vector <shared_ptr <IMAPMessage> >::const_iterator it = msgs.begin() ; it != msgs.end() ; ++it) {
+
+		const size_t num = (*it)->getNumber();
+
+		std::vector <string> sections;
+		IMAPMessage::collectPartHeaderSections((*it)->getStructure(), numberToParts[num], sections);
+
+		sectionsToNumbers[sections].push_back(num);
+	}
+
+	// Send all the requests at once
+	IMAPPipelinedBatch batch(m_connection);
+
+	for (std::map <std::vector <string>, std::vector <size_t> >::const_iterator
+	     it = sectionsToNumbers.begin() ; it != sectionsToNumbers.end() ; ++it) {
+
+		if (!it->first.empty()) {
+
+			batch.send(IMAPUtils::buildFetchPartHeadersCommand(
+				messageSet::byNumber(it->second), it->first
+			));
+		}
+	}
+
+	for (size_t i = 0 ; i < batch.getCommandCount() ; ++i) {
+
+		// Get the response
+		scoped_ptr <IMAPParser::response> resp(batch.readResponse(i));
+
+		if (resp->isBad() || resp->response_done->response_tagged->
+			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
 
-		for (auto it = respDataList.begin() ; it != respDataList.end() ; ++it) {
+			throw exceptions::command_error("FETCH", resp->getErrorLog(), "bad response");
+		}
+
+		for (auto &respData : resp->continue_req_or_response_data) {
 
-			if (!(*it)->response_data) {
+			if (!respData->response_data) {
 				throw exceptions::command_error("FETCH", resp->getErrorLog(), "invalid response");
 			}
 
-			auto *messageData = (*it)->response_data->message_data.get();
+			auto *messageData = respData->response_data->message_data.get();
 
 			// We are only interested in responses of type "FETCH"
 			if (!messageData || messageData->type != IMAPParser::message_data::FETCH) {
 				continue;
 			}
 
-			// Process fetch response for this message
-			const size_t num = messageData->number;
+			std::map <size_t, std::map <string, shared_ptr <IMAPMessagePart> > >::iterator
+				parts = numberToParts.find(messageData->number);
+
+			if (parts == numberToParts.end()) {
+				continue;
+			}
+
+			// Dispatch each section to the corresponding part
+			for (auto &att : messageData->msg_att->items) {
+
+				if (att->type != IMAPParser::msg_att_item::BODY_SECTION) {
+					continue;
+				}
+
+				const IMAPParser::section* sect = att->section.get();
+				std::ostringstream section;
+				section.imbue(std::locale::classic());
+
+				if (sect->nz_numbers.empty()) {
+
+					// Header of the root part: "BODY[HEADER]"
+					if (!sect->section_text1 ||
+					    sect->section_text1->type != IMAPParser::section_text::HEADER) {
+
+						continue;
+					}
 
-			std::map <size_t, shared_ptr <IMAPMessage> >::iterator msg = numberToMsg.find(num);
+				} else {
 
-			if (msg != numberToMsg.end()) {
+					// Part header: "BODY[n.n.MIME]"
+					if (!sect->section_text2 ||
+					    sect->section_text2->type != IMAPParser::section_text::MIME) {
 
-				(*msg).second->processFetchResponse(options, *messageData);
+						continue;
+					}
 
-				if (progress) {
-					progress->progress(++current, total);
+					for (size_t j = 0 ; j < sect->nz_numbers.size() ; ++j) {
+						if (j != 0) section << ".";
+						section << sect->nz_numbers[j];
+					}
 				}
-			}
-		}
 
-	} catch (...) {
+				std::map <string, shared_ptr <IMAPMessagePart> >::iterator
+					part = parts->second.find(section.str());
 
-		if (progress) {
-			progress->stop(total);
+				if (part != parts->second.end()) {
+					part->second->getOrCreateHeader().parse(att->nstring->value);
+				}
+			}
 		}
 
-		throw;
-	}
-
-	if (progress) {
-		progress->stop(total);
+		processStatusUpdate(resp.get());
 	}
-
-	processStatusUpdate(resp.get());
 }
 
 
@@ -895,6 +2205,32 @@ std::vector <shared_ptr <message> > IMAPFolder::getAndFetchMessages(
 	const fetchAttributes& attribs
 ) {
 
+	// Collect the messages as they are fetched
+	class collector : public fetchHandler {
+
+	public:
+
+		void handleMessage(const shared_ptr <message>& msg) {
+
+			messages.push_back(msg);
+		}
+
+		std::vector <shared_ptr <message> > messages;
+	};
+
+	collector coll;
+	getAndFetchMessages(msgs, attribs, coll);
+
+	return coll.messages;
+}
+
+
+void IMAPFolder::getAndFetchMessages(
+	const messageSet& msgs,
+	const fetchAttributes& attribs,
+	fetchHandler& handler
+) {
+
 	shared_ptr <IMAPStore> store = m_store.lock();
 
 	if (!store) {
@@ -904,7 +2240,7 @@ std::vector <shared_ptr <message> > IMAPFolder::getAndFetchMessages(
 	}
 
 	if (msgs.isEmpty()) {
-		return std::vector <shared_ptr <message> >();
+		return;
 	}
 
 	// Ensure we also get the UID for each message
@@ -914,8 +2250,12 @@ std::vector <shared_ptr <message> > IMAPFolder::getAndFetchMessages(
 	// Send the request
 	IMAPUtils::buildFetchCommand(m_connection, msgs, attribsWithUID)->send(m_connection);
 
-	// Get the response
-	scoped_ptr <IMAPParser::response> resp(m_connection->readResponse());
+	// Get the response: messages are created and handed to the handler
+	// as their data is received, and the data is freed immediately
+	getAndFetchMessagesHandler respHandler
+		(dynamicCast <IMAPFolder>(shared_from_this()), attribsWithUID, handler);
+
+	scoped_ptr <IMAPParser::response> resp(m_connection->readStreamedResponse(&respHandler));
 
 	if (resp->isBad() || resp->response_done->response_tagged->
 		resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
@@ -923,50 +2263,26 @@ std::vector <shared_ptr <message> > IMAPFolder::getAndFetchMessages(
 		throw exceptions::command_error("FETCH", resp->getErrorLog(), "bad response");
 	}
 
-	auto &respDataList = resp->continue_req_or_response_data;
-
-	std::vector <shared_ptr <message> > messages;
-
-	for (auto it = respDataList.begin() ; it != respDataList.end() ; ++it) {
+	for (auto &respData : resp->continue_req_or_response_data) {
 
-		if (!(*it)->response_data) {
+		if (!respData->response_data) {
 			throw exceptions::command_error("FETCH", resp->getErrorLog(), "invalid response");
 		}
+	}
 
-		auto *messageData = (*it)->response_data->message_data.get();
-
-		// We are only interested in responses of type "FETCH"
-		if (!messageData || messageData->type != IMAPParser::message_data::FETCH) {
-			continue;
-		}
+	processStatusUpdate(resp.get());
 
-		// Get message number
-		const size_t msgNum = messageData->number;
+	// Fetch part headers, once the structure is known
+	const std::vector <shared_ptr <IMAPMessage> >& pending = respHandler.getPendingMessages();
 
-		// Get message UID
-		message::uid msgUID;
+	if (!pending.empty()) {
 
-		for (auto &att : messageData->msg_att->items) {
+		fetchPartHeaders(pending);
 
-			if (att->type == IMAPParser::msg_att_item::UID) {
-				msgUID = att->uniqueid->value;
-				break;
-			}
+		for (std::vector <shared_ptr <IMAPMessage> >::const_iterator it = pending.begin() ; it != pending.end() ; ++it) {
+			handler.handleMessage(*it);
 		}
-
-		// Create a new message reference
-		shared_ptr <IMAPFolder> thisFolder = dynamicCast <IMAPFolder>(shared_from_this());
-		shared_ptr <IMAPMessage> msg = make_shared <IMAPMessage>(thisFolder, msgNum, msgUID);
-
-		messages.push_back(msg);
-
-		// Process fetch response for this message
-		msg->processFetchResponse(attribsWithUID, *messageData);
 	}
-
-	processStatusUpdate(resp.get());
-
-	return messages;
 }
 
 
@@ -976,7 +2292,7 @@ int IMAPFolder::getFetchCapabilities() const {
 	       fetchAttributes::STRUCTURE | fetchAttributes::FLAGS |
 	       fetchAttributes::SIZE | fetchAttributes::FULL_HEADER |
 	       fetchAttributes::UID | fetchAttributes::IMPORTANCE |
-	       fetchAttributes::PEEK;
+	       fetchAttributes::PEEK | fetchAttributes::PART_HEADERS;
 }
 
 
@@ -1021,6 +2337,14 @@ void IMAPFolder::unregisterMessage(IMAPMessage* msg) {
 	if (it != m_messages.end()) {
 		m_messages.erase(it);
 	}
+
+	m_partCache->removeMessage(msg);
+}
+
+
+void IMAPFolder::setPartCacheLimits(const size_t blockSize, const size_t maxSize) {
+
+	m_partCache->setLimits(blockSize, maxSize);
 }
 
 
@@ -1099,15 +2423,12 @@ messageSet IMAPFolder::addMessage(
 	utility::progressListener* progress
 ) {
 
-	std::ostringstream oss;
-	utility::outputStreamAdapter ossAdapter(oss);
+	messageAppendSource source(msg);
 
-	msg->generate(ossAdapter);
+	std::vector <appendSource*> sources;
+	sources.push_back(&source);
 
-	const string& str = oss.str();
-	utility::inputStreamStringAdapter strAdapter(str);
-
-	return addMessage(strAdapter, str.length(), flags, date, progress);
+	return appendMessagesImpl(sources, flags, date, progress);
 }
 
 
@@ -1119,6 +2440,68 @@ messageSet IMAPFolder::addMessage(
 	utility::progressListener* progress
 ) {
 
+	streamAppendSource source(is, size);
+
+	std::vector <appendSource*> sources;
+	sources.push_back(&source);
+
+	return appendMessagesImpl(sources, flags, date, progress);
+}
+
+
+messageSet IMAPFolder::addMessages(
+	const std::vector <shared_ptr <vmime::message> >& msgs,
+	const int flags,
+	vmime::datetime* date,
+	utility::progressListener* progress
+) {
+
+	std::vector <messageAppendSource> sources;
+	sources.reserve(msgs.size());
+
+	for (size_t i = 0, n = msgs.size() ; i < n ; ++i) {
+		sources.push_back(messageAppendSource(msgs[i]));
+	}
+
+	std::vector <appendSource*> sourcePtrs;
+
+	for (size_t i = 0, n = sources.size() ; i < n ; ++i) {
+		sourcePtrs.push_back(&sources[i]);
+	}
+
+	if (sourcePtrs.empty()) {
+		return messageSet::empty();
+	}
+
+	if (m_connection && m_connection->hasCapability(IMAPConnection::CAPABILITY_MULTIAPPEND)) {
+		return appendMessagesImpl(sourcePtrs, flags, date, progress);
+	}
+
+	// MULTIAPPEND not supported: add messages one by one
+	messageSet result = messageSet::empty();
+
+	for (size_t i = 0, n = sourcePtrs.size() ; i < n ; ++i) {
+
+		const messageSet uids = appendMessagesImpl(
+			std::vector <appendSource*>(1, sourcePtrs[i]), flags, date, progress
+		);
+
+		for (size_t j = 0, m = uids.getRangeCount() ; j < m ; ++j) {
+			result.addRange(uids.getRangeAt(j));
+		}
+	}
+
+	return result;
+}
+
+
+messageSet IMAPFolder::appendMessagesImpl(
+	const std::vector <appendSource*>& sources,
+	const int flags,
+	vmime::datetime* date,
+	utility::progressListener* progress
+) {
+
 	shared_ptr <IMAPStore> store = m_store.lock();
 
 	if (!store) {
@@ -1129,68 +2512,106 @@ messageSet IMAPFolder::addMessage(
 		throw exceptions::illegal_state("Folder is read-only");
 	}
 
-	// Send the request
-	IMAPCommand::APPEND(
-		IMAPUtils::pathToString(m_connection->hierarchySeparator(), getFullPath()),
-		IMAPUtils::messageFlagList(flags), date, size
-	)->send(m_connection);
+	// Compute the size of each message first, as it must be sent
+	// before the message data
+	std::vector <size_t> sizes(sources.size());
+	size_t total = 0;
 
-	// Get the response
-	scoped_ptr <IMAPParser::response> resp(m_connection->readResponse());
+	for (size_t i = 0, n = sources.size() ; i < n ; ++i) {
 
-	bool ok = false;
-	auto &respList = resp->continue_req_or_response_data;
+		sizes[i] = sources[i]->getSize();
+		total += sizes[i];
+	}
 
-	for (auto it = respList.begin() ; !ok && (it != respList.end()) ; ++it) {
+	const std::vector <string> flagList = IMAPUtils::messageFlagList(flags);
 
-		if ((*it)->continue_req) {
-			ok = true;
-		}
+	if (progress) {
+		progress->start(total);
 	}
 
-	if (!ok) {
-		throw exceptions::command_error("APPEND", resp->getErrorLog(), "bad response");
-	}
+	// Send the request. With MULTIAPPEND (RFC-3502), the arguments are
+	// repeated for each message:
+	//
+	//   C: a001 APPEND INBOX (\Seen) {1234+}
+	//   C: <1234 bytes>
+	//   C:  (\Seen) {5678+}
+	//   C: <5678 bytes>
+	//   C:
+	//   S: a001 OK [APPENDUID 38505 3955:3956] APPEND completed
+	//
+	// With non-synchronizing literals (LITERAL+/LITERAL-), the data is
+	// sent without waiting for a continuation request from the server.
+	appendOutputStream os(m_connection, progress, total);
 
-	processStatusUpdate(resp.get());
+	for (size_t i = 0, n = sources.size() ; i < n ; ++i) {
 
-	// Send message data
-	const size_t total = size;
-	size_t current = 0;
+		const bool nonSync = m_connection->canSendNonSynchronizingLiteral(sizes[i]);
 
-	if (progress) {
-		progress->start(total);
-	}
+		if (i == 0) {
 
-	const size_t blockSize = std::min(
-		is.getBlockSize(),
-		static_cast <size_t>(m_connection->getSocket()->getBlockSize())
-	);
+			os.writeCommand(m_connection->prepareCommand(IMAPCommand::APPEND(
+				IMAPUtils::pathToString(m_connection->hierarchySeparator(), getFullPath()),
+				flagList, date, sizes[i], nonSync
+			)));
+
+		} else {
 
-	std::vector <byte_t> vbuffer(blockSize);
-	byte_t* buffer = &vbuffer.front();
+			const string args = IMAPUtils::appendArguments(flagList, date, sizes[i], nonSync);
 
-	while (!is.eof()) {
+			os.writeCommand(" " + args + "\r\n");
 
-		// Read some data from the input stream
-		const size_t read = is.read(buffer, blockSize);
-		current += read;
+			if (m_connection->getTracer()) {
+				m_connection->getTracer()->traceSend(args);
+			}
+		}
 
-		// Put read data into socket output stream
-		m_connection->sendRaw(buffer, read);
+		if (!nonSync) {
 
-		// Notify progress
-		if (progress) {
-			progress->progress(current, total);
+			os.flush();
+
+			// Wait for the continuation request
+			scoped_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+			bool ok = false;
+			auto &respList = resp->continue_req_or_response_data;
+
+			for (auto it = respList.begin() ; !ok && (it != respList.end()) ; ++it) {
+
+				if ((*it)->continue_req) {
+					ok = true;
+				}
+			}
+
+			if (!ok) {
+				throw exceptions::command_error("APPEND", resp->getErrorLog(), "bad response");
+			}
+
+			processStatusUpdate(resp.get());
 		}
-	}
 
-	m_connection->sendRaw(utility::stringUtils::bytesFromString("\r\n"), 2);
+		// Send message data
+		const size_t start = os.getCurrent();
 
-	if (m_connection->getTracer()) {
-		m_connection->getTracer()->traceSendBytes(current);
+		sources[i]->write(os);
+
+		const size_t written = os.getCurrent() - start;
+
+		if (m_connection->getTracer()) {
+			m_connection->getTracer()->traceSendBytes(written);
+		}
+
+		// The server reads exactly the announced number of bytes as message
+		// data: if it differs, the rest would be parsed as commands
+		if (written != sizes[i]) {
+
+			m_connection->disconnect();
+			throw exceptions::invalid_argument();
+		}
 	}
 
+	os.writeCommand("\r\n");
+	os.flush();
+
 	if (progress) {
 		progress->stop(total);
 	}
@@ -1201,7 +2622,7 @@ messageSet IMAPFolder::addMessage(
 	if (finalResp->isBad() || finalResp->response_done->response_tagged->
 			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
 
-		throw exceptions::command_error("APPEND", resp->getErrorLog(), "bad response");
+		throw exceptions::command_error("APPEND", finalResp->getErrorLog(), "bad response");
 	}
 
 	processStatusUpdate(finalResp.get());
@@ -1381,7 +2802,7 @@ shared_ptr <folderStatus> IMAPFolder::getStatus() {
 	attribs.push_back("UIDNEXT");
 	attribs.push_back("UIDVALIDITY");
 
-	if (m_connection->hasCapability("CONDSTORE")) {
+	if (m_connection->hasCapability(IMAPConnection::CAPABILITY_CONDSTORE)) {
 		attribs.push_back("HIGHESTMODSEQ");
 	}
 
@@ -1451,6 +2872,160 @@ void IMAPFolder::noop() {
 }
 
 
+void IMAPFolder::startIdle() {
+
+	shared_ptr <IMAPStore> store = m_store.lock();
+
+	if (!store) {
+		throw exceptions::illegal_state("Store disconnected");
+	} else if (!isOpen()) {
+		throw exceptions::illegal_state("Folder not open");
+	} else if (m_connection->isIdle()) {
+		throw exceptions::illegal_state("Folder already idle");
+	}
+
+	if (!m_connection->hasCapability(IMAPConnection::CAPABILITY_IDLE)) {
+		throw exceptions::operation_not_supported();
+	}
+
+	// Emit the "IDLE" command
+	//
+	// Example:  C: A002 IDLE
+	//           S: + idling
+	//           ...time passes; new mail arrives...
+	//           S: * 4 EXISTS
+	//           C: DONE
+	//           S: A002 OK IDLE terminated
+
+	IMAPCommand::IDLE()->send(m_connection);
+
+	scoped_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	// The server answers with a continuation request, or completes
+	// the command immediately if it refuses it
+	if (resp->response_done) {
+		throw exceptions::command_error("IDLE", resp->getErrorLog(), "bad response");
+	}
+
+	m_connection->setIdle(true);
+
+	processStatusUpdate(resp.get());
+}
+
+
+void IMAPFolder::stopIdle() {
+
+	if (!isIdle()) {
+		throw exceptions::illegal_state("Folder not idle");
+	}
+
+	m_connection->setIdle(false);
+
+	if (m_connection->getTracer()) {
+		m_connection->getTracer()->traceSend("DONE");
+	}
+
+	const char done[] = "DONE\r\n";
+	m_connection->sendRaw(reinterpret_cast <const byte_t*>(done), sizeof(done) - 1);
+
+	scoped_ptr <IMAPParser::response> resp(m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done->response_tagged->
+			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+		throw exceptions::command_error("IDLE", resp->getErrorLog());
+	}
+
+	processStatusUpdate(resp.get());
+}
+
+
+bool IMAPFolder::isIdle() const {
+
+	return m_connection && m_connection->isIdle();
+}
+
+
+bool IMAPFolder::processIdleNotifications() {
+
+	return processIdleNotifications(/* receive */ true);
+}
+
+
+bool IMAPFolder::processIdleNotifications(const bool receive) {
+
+	if (!isIdle()) {
+		throw exceptions::illegal_state("Folder not idle");
+	}
+
+	bool processed = false;
+
+	// A listener may have stopped IDLE while events were dispatched
+	while (isIdle() && m_connection->isResponseAvailable(receive)) {
+
+		scoped_ptr <IMAPParser::response> resp(m_connection->readUntaggedResponse());
+
+		processStatusUpdate(resp.get());
+		processed = true;
+	}
+
+	return processed;
+}
+
+
+bool IMAPFolder::idle(const int msecs) {
+
+	startIdle();
+
+	shared_ptr <socket> sok = m_connection->getSocket();
+	shared_ptr <timeoutHandler> toh = sok->getTimeoutHandler();
+
+	bool processed = false;
+
+	try {
+
+		processed = processIdleNotifications();
+
+		// Wait by steps, as no data is expected on the connection
+		// for a long time, which must not be seen as a time-out
+		const int step = 1000;
+
+		for (int remaining = msecs ; !processed && remaining > 0 ; remaining -= step) {
+
+			if (toh) {
+				toh->resetTimeOut();
+			}
+
+			if (sok->waitForRead(std::min(remaining, step))) {
+				processed = processIdleNotifications();
+			}
+		}
+
+	} catch (...) {
+
+		// Leave IDLE state, so that the folder remains usable if the
+		// connection is; stopIdle() resets the state before any I/O
+		if (isIdle()) {
+
+			try {
+				stopIdle();
+			} catch (...) {
+				// Report the original error
+			}
+		}
+
+		throw;
+	}
+
+	// A listener may already have stopped IDLE
+	if (isIdle()) {
+		stopIdle();
+	}
+
+	return processed;
+}
+
+
 std::vector <size_t> IMAPFolder::getMessageNumbersStartingOnUID(const message::uid& uid) {
 
 	// Send the request
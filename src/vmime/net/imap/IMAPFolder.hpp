@@ -40,6 +40,7 @@
 
 #include "vmime/net/imap/IMAPParser.hpp"
 #include "vmime/net/imap/IMAPSearchAttributes.hpp"
+#include "vmime/net/imap/IMAPMessagePartCache.hpp"
 
 
 namespace vmime {
@@ -66,6 +67,58 @@ private:
 
 public:
 
+	/** Receives the messages fetched by getAndFetchMessages(),
+	  * as soon as their data has been received.
+	  */
+	class fetchHandler {
+
+	public:
+
+		virtual ~fetchHandler() { }
+
+		/** Called for each message, in the order in which the
+		  * server sent them.
+		  *
+		  * This is called while the response is being read: no
+		  * operation may be performed on the folder from here.
+		  * Commands sent on its connection meanwhile throw
+		  * exceptions::illegal_state.
+		  *
+		  * @param msg fetched message
+		  */
+		virtual void handleMessage(const shared_ptr <message>& msg) = 0;
+	};
+
+	/** Changes in a folder since a previous session, as returned
+	  * by resync().
+	  */
+	struct resyncResult {
+
+		resyncResult();
+
+		/** True if the UID validity of the folder has changed: the
+		  * state saved by the client is obsolete and the folder must
+		  * be fully synchronized again. Other members are not set.
+		  */
+		bool uidValidityChanged;
+
+		/** UID validity of the folder, to be saved for the next resync(). */
+		vmime_uint32 uidValidity;
+
+		/** Highest modification sequence of the folder, to be saved
+		  * for the next resync(). */
+		vmime_uint64 highestModSeq;
+
+		/** Messages added, or whose flags changed, since the previous
+		  * session. Their UID, flags and modification sequence are
+		  * available. */
+		std::vector <shared_ptr <message> > changedMessages;
+
+		/** UIDs of the known messages which have been expunged. */
+		messageSet vanishedUIDs;
+	};
+
+
 	IMAPFolder(
 		const folder::path& path,
 		const shared_ptr <IMAPStore>& store,
@@ -156,6 +209,32 @@ public:
 		utility::progressListener* progress = NULL
 	);
 
+	/** Add a set of messages to this folder. If the server supports
+	  * MULTIAPPEND (RFC-3502), all the messages are uploaded with a
+	  * single command; this is atomic: either all the messages are
+	  * added, or none of them. Otherwise, the messages are added one
+	  * by one.
+	  *
+	  * Messages are generated on the fly: each one is generated once
+	  * to compute its size, then a second time while it is sent.
+	  *
+	  * @param msgs messages to add
+	  * @param flags flags for the new messages (if -1, default
+	  * flags are used)
+	  * @param date date/time for the new messages (if NULL, the
+	  * current time is used)
+	  * @param progress progress listener, or NULL if not used
+	  * @return a message set containing the UIDs of the new messages,
+	  * or an empty set if the server did not report them
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	messageSet addMessages(
+		const std::vector <shared_ptr <vmime::message> >& msgs,
+		const int flags = -1,
+		vmime::datetime* date = NULL,
+		utility::progressListener* progress = NULL
+	);
+
 	messageSet copyMessages(const folder::path& dest, const messageSet& msgs);
 
 	void status(size_t& count, size_t& unseen);
@@ -170,7 +249,21 @@ public:
 	shared_ptr <const store> getStore() const;
 	shared_ptr <store> getStore();
 
-
+	/** Fetch objects for the specified messages.
+	  *
+	  * If the store keeps a pool of connections (see the property
+	  * "options.connection-pool-size"), large sets of messages are
+	  * split and fetched in parallel over several connections. The
+	  * responses are still read and processed by the calling thread,
+	  * so the progress listener is only notified from this thread.
+	  * If an error occurs and the response cannot be read to the end
+	  * on the connection of this folder, the folder is closed.
+	  *
+	  * @param msg list of message sequence numbers
+	  * @param options set of attributes to fetch
+	  * @param progress progress listener, or NULL if not used
+	  * @throw exceptions::net_exception if an error occurs
+	  */
 	void fetchMessages(
 		std::vector <shared_ptr <message> >& msg,
 		const fetchAttributes& options,
@@ -184,6 +277,28 @@ public:
 		const fetchAttributes& attribs
 	);
 
+	/** Get messages by their sequence number or UID, and fetch objects
+	  * for them at the same time. Each message is handed to the handler
+	  * as soon as its data has been received, and the folder does not
+	  * keep it: memory use does not depend on the number of messages,
+	  * unless the handler keeps them.
+	  *
+	  * If part headers (fetchAttributes::PART_HEADERS) are requested,
+	  * they are fetched once all the other data has been received, and
+	  * the messages are only handed to the handler then: all of them
+	  * are kept in memory meanwhile.
+	  *
+	  * @param msgs index set of messages to retrieve
+	  * @param attribs set of attributes to fetch
+	  * @param handler receives the messages as they are fetched
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	void getAndFetchMessages(
+		const messageSet& msgs,
+		const fetchAttributes& attribs,
+		fetchHandler& handler
+	);
+
 	int getFetchCapabilities() const;
 
 	/** Returns the UID validity of the folder for the current session.
@@ -206,8 +321,119 @@ public:
 	  */
 	vmime_uint64 getHighestModSequence() const;
 
+	/** Resynchronize the client's copy of this folder, using the state
+	  * saved at the end of a previous session (RFC 7162). Only the
+	  * changes are transferred: the messages whose flags changed, and
+	  * the UIDs of the messages which have been expunged.
+	  *
+	  * If the server supports QRESYNC, everything is obtained with a
+	  * single EXAMINE command. With CONDSTORE only, changed flags are
+	  * fetched with CHANGEDSINCE, and the UIDs which still exist are
+	  * searched only if the message count shows that some known
+	  * messages have been expunged.
+	  *
+	  * The folder is examined on the connection of the store, so it
+	  * does not need to be open.
+	  *
+	  * @param uidValidity UID validity saved by the client
+	  * @param highestModSeq highest modification sequence saved by
+	  * the client (must not be zero)
+	  * @param knownUIDs UIDs of all the messages of the folder known
+	  * by the client
+	  * @return changes in the folder since the saved state
+	  * @throw exceptions::operation_not_supported if the server does
+	  * not support CONDSTORE, or modification sequences are not
+	  * available for this folder
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	resyncResult resync(
+		const vmime_uint32 uidValidity,
+		const vmime_uint64 highestModSeq,
+		const messageSet& knownUIDs
+	);
+
+	/** Enter IDLE state (RFC 2177). While the folder is idle, the
+	  * server notifies changes in the folder as they happen. These
+	  * notifications are processed by processIdleNotifications().
+	  * No other operation can be performed on the folder until
+	  * stopIdle() is called: commands sent meanwhile throw
+	  * exceptions::illegal_state (except close(), which leaves
+	  * IDLE state first).
+	  *
+	  * @throw exceptions::operation_not_supported if the server
+	  * does not support IDLE
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	void startIdle();
+
+	/** Leave IDLE state. Notifications received meanwhile are
+	  * processed.
+	  *
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	void stopIdle();
+
+	/** Test whether the folder is in IDLE state.
+	  *
+	  * @return true if the folder is idle, false otherwise
+	  */
+	bool isIdle() const;
+
+	/** Process the notifications received while the folder is idle,
+	  * and dispatch the corresponding events (messageCountEvent,
+	  * messageChangedEvent) to the listeners of the folder. This
+	  * function does not wait for notifications.
+	  *
+	  * @return true if notifications have been processed, or false
+	  * if none was available
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	bool processIdleNotifications();
+
+	/** Wait for changes in the folder using IDLE, for at most the
+	  * specified time. Events are dispatched to the listeners of the
+	  * folder as notifications arrive. To watch many folders, use
+	  * IMAPIdleWatcher instead.
+	  *
+	  * @param msecs maximum time to wait, in milliseconds
+	  * @return true if notifications have been processed, or false
+	  * if the delay has elapsed
+	  * @throw exceptions::net_exception if an error occurs; the
+	  * folder has left IDLE state then
+	  */
+	bool idle(const int msecs);
+
+	/** Set the limits of the cache in which the contents of the parts
+	  * of the messages of this folder are kept, once fetched. Extracting
+	  * the body of a part again (with IMAPMessage::extractPart() or the
+	  * content handler of the part, whether decoded by the server or not)
+	  * or reading it with IMAPMessagePartInputStream does not download
+	  * the cached data again. The cache is shared by all the messages of
+	  * the folder; the least recently used data is evicted when it is
+	  * full, and the data of a message is dropped when the message object
+	  * is destroyed. Parts bigger than the cache are not cached. The cache
+	  * is emptied.
+	  *
+	  * @param blockSize size of the blocks in which contents are fetched
+	  * and cached, in bytes (default is 4096)
+	  * @param maxSize maximum size of the cached data, in bytes (default
+	  * is 1 MiB); 0 disables the cache
+	  */
+	void setPartCacheLimits(const size_t blockSize, const size_t maxSize);
+
 private:
 
+	friend class IMAPIdleWatcher;
+
+	class fetchMessagesHandler;
+	class getAndFetchMessagesHandler;
+	class parallelFetchHandler;
+
+	class appendSource;
+	class messageAppendSource;
+	class streamAppendSource;
+	class appendOutputStream;
+
 	void registerMessage(IMAPMessage* msg);
 	void unregisterMessage(IMAPMessage* msg);
 
@@ -221,6 +447,84 @@ private:
 
 	void copyMessagesImpl(const string& set, const folder::path& dest);
 
+	/** Upload messages with a single APPEND command. Non-synchronizing
+	  * literals (RFC-7888) are used when the server allows them, so
+	  * that message data is sent without waiting for a continuation
+	  * request from the server. If there is more than one message,
+	  * the server must support MULTIAPPEND.
+	  *
+	  * @param sources messages to upload
+	  * @param flags flags for the new messages
+	  * @param date date/time for the new messages, or NULL
+	  * @param progress progress listener, or NULL if not used
+	  * @return UIDs of the new messages, if reported by the server
+	  */
+	messageSet appendMessagesImpl(
+		const std::vector <appendSource*>& sources,
+		const int flags,
+		vmime::datetime* date,
+		utility::progressListener* progress
+	);
+
+	/** Fetch objects for the specified messages with a single
+	  * FETCH command on the connection of this folder.
+	  *
+	  * @param msg messages to fetch
+	  * @param options set of attributes to fetch
+	  * @param progress progress listener, or NULL if not used
+	  */
+	void fetchMessagesImpl(
+		const std::vector <shared_ptr <message> >& msg,
+		const fetchAttributes& options,
+		utility::progressListener* progress
+	);
+
+	/** Fetch objects for the specified messages in parallel: messages
+	  * are split into the specified number of parts, the first one is
+	  * fetched on the connection of this folder, and the other ones on
+	  * connections from the store pool, on which the folder has been
+	  * opened in read-only mode. Messages are identified by their UID.
+	  * Requests are sent on all the connections at once, and responses
+	  * are read in the calling thread, taking turns on the connections
+	  * on which data has been received.
+	  *
+	  * @param msg messages to fetch
+	  * @param options set of attributes to fetch
+	  * @param progress progress listener, or NULL if not used
+	  * @param partCount number of parts (and connections) to use
+	  */
+	void fetchMessagesParallel(
+		const std::vector <shared_ptr <message> >& msg,
+		const fetchAttributes& options,
+		utility::progressListener* progress,
+		const size_t partCount
+	);
+
+	/** Collect the data of a response which is relevant for resync().
+	  *
+	  * @param resp response received during resynchronization
+	  * @param result changes are added to this object
+	  * @param messageCount receives the number of messages, if the
+	  * response contains it
+	  * @return false if modification sequences are not available for
+	  * this folder, true otherwise
+	  */
+	bool processResyncResponse(
+		const IMAPParser::response& resp,
+		resyncResult& result,
+		size_t& messageCount
+	);
+
+	/** Fetch the header of every body part of the specified messages.
+	  * Messages sharing the same structure are fetched with a single
+	  * command, which contains all the part sections. Commands for
+	  * different structures are pipelined.
+	  *
+	  * @param msgs messages for which to fetch part headers; the
+	  * structure of each message must have been fetched
+	  */
+	void fetchPartHeaders(const std::vector <shared_ptr <IMAPMessage> >& msgs);
+
 
 	/** Process status updates ("unsolicited responses") contained in the
 	  * specified response. Example:
@@ -233,6 +537,15 @@ private:
 	  */
 	void processStatusUpdate(const IMAPParser::response* resp);
 
+	/** Process the notifications received while the folder is idle.
+	  *
+	  * @param receive if true, data available on the socket is received
+	  * first; if false, only data which has already been received is
+	  * processed
+	  * @return true if notifications have been processed
+	  */
+	bool processIdleNotifications(const bool receive);
+
 
 	weak_ptr <IMAPStore> m_store;
 	shared_ptr <IMAPConnection> m_connection;
@@ -248,6 +561,8 @@ private:
 	shared_ptr <IMAPFolderStatus> m_status;
 
 	std::vector <IMAPMessage*> m_messages;
+
+	shared_ptr <IMAPMessagePartCache> m_partCache;
 };
 
 
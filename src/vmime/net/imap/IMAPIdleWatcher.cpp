@@ -0,0 +1,432 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPIdleWatcher.hpp"
+#include "vmime/net/imap/IMAPFolder.hpp"
+#include "vmime/net/imap/IMAPConnection.hpp"
+#include "vmime/net/imap/IMAPUtils.hpp"
+
+#include "vmime/platform.hpp"
+#include "vmime/exception.hpp"
+
+#include "vmime/utility/sync/autoLock.hpp"
+
+#include <algorithm>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+thread_local IMAPIdleWatcher::watchedFolder* IMAPIdleWatcher::sm_currentFolder = NULL;
+
+
+IMAPIdleWatcher::IMAPIdleWatcher()
+	: m_lock(platform::getHandler()->createCriticalSection()),
+	  m_refreshInterval(25 * 60),
+	  m_stop(false) {
+
+}
+
+
+IMAPIdleWatcher::~IMAPIdleWatcher() {
+
+	try {
+
+		stop();
+
+	} catch (...) {
+
+		// Don't throw in destructor
+	}
+
+	// Folders still watched leave IDLE state
+	for (watchedFolderList::iterator it = m_folders.begin() ; it != m_folders.end() ; ++it) {
+
+		try {
+
+			if ((*it)->folder->isIdle()) {
+				(*it)->folder->stopIdle();
+			}
+
+		} catch (...) {
+
+			// Don't throw in destructor
+		}
+	}
+}
+
+
+void IMAPIdleWatcher::addFolder(const shared_ptr <IMAPFolder>& folder) {
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+		for (watchedFolderList::const_iterator it = m_folders.begin() ; it != m_folders.end() ; ++it) {
+
+			if ((*it)->folder == folder) {
+				return;  // already watched
+			}
+		}
+	}
+
+	// Wait for the server reply without holding the lock
+	folder->startIdle();
+
+	shared_ptr <watchedFolder> wf = make_shared <watchedFolder>();
+	wf->folder = folder;
+	wf->idleStartTime = platform::getHandler()->getUnixTime();
+	wf->active = true;
+	wf->ioLock = platform::getHandler()->createCriticalSection();
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_folders.push_back(wf);
+}
+
+
+void IMAPIdleWatcher::removeFolder(const shared_ptr <IMAPFolder>& folder) {
+
+	shared_ptr <watchedFolder> wf;
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+		for (watchedFolderList::iterator it = m_folders.begin() ; it != m_folders.end() ; ++it) {
+
+			if ((*it)->folder == folder) {
+
+				wf = *it;
+
+				m_folders.erase(it);
+				break;
+			}
+		}
+	}
+
+	if (!wf) {
+		return;
+	}
+
+	// Wait for the watcher to finish using the connection, unless this
+	// is called by a listener while notifications are dispatched for
+	// this folder: the current thread already holds the lock then
+	scoped_ptr <utility::sync::autoLock <utility::sync::criticalSection> > ioLock;
+
+	if (sm_currentFolder != wf.get()) {
+		ioLock.reset(new utility::sync::autoLock <utility::sync::criticalSection>(wf->ioLock));
+	}
+
+	wf->active = false;
+
+	if (folder->isIdle()) {
+		folder->stopIdle();
+	}
+}
+
+
+const std::vector <shared_ptr <IMAPFolder> > IMAPIdleWatcher::getFolders() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	std::vector <shared_ptr <IMAPFolder> > folders;
+	folders.reserve(m_folders.size());
+
+	for (watchedFolderList::const_iterator it = m_folders.begin() ; it != m_folders.end() ; ++it) {
+		folders.push_back((*it)->folder);
+	}
+
+	return folders;
+}
+
+
+void IMAPIdleWatcher::setRefreshInterval(const unsigned int secs) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_refreshInterval = secs;
+}
+
+
+unsigned int IMAPIdleWatcher::getRefreshInterval() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	return m_refreshInterval;
+}
+
+
+size_t IMAPIdleWatcher::poll(const int msecs) {
+
+	watchedFolderList folders;
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+		folders = m_folders;
+	}
+
+	// Process notifications which have already been received
+	size_t count = processFolders(folders, std::vector <bool>(folders.size(), true), /* receive */ false);
+
+	if (count != 0) {
+		return count;
+	}
+
+	// Wait for new notifications
+	std::vector <bool> ready;
+
+	if (waitForData(folders, msecs, ready)) {
+		count = processFolders(folders, ready, /* receive */ true);
+	}
+
+	return count;
+}
+
+
+bool IMAPIdleWatcher::isDataAvailable(watchedFolder& wf, int* descriptor) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(wf.ioLock);
+
+	if (descriptor) {
+		*descriptor = -1;
+	}
+
+	// The folder may have been removed, and its connection closed
+	if (!wf.active || !wf.folder->m_connection) {
+		return false;
+	}
+
+	shared_ptr <socket> sok = wf.folder->m_connection->getSocket();
+
+	if (!sok) {
+		return false;
+	}
+
+	if (descriptor) {
+		*descriptor = sok->getDescriptor();
+	}
+
+	// Data may already be buffered inside the socket (eg. decrypted TLS
+	// records, or inflated data), which poll() would not notice
+	return sok->waitForRead(0);
+}
+
+
+// Checks the connections of the watched folders for IMAPUtils::waitForData()
+class IMAPIdleWatcher::folderDataAvailabilityChecker : public IMAPUtils::dataAvailabilityChecker {
+
+public:
+
+	folderDataAvailabilityChecker(IMAPIdleWatcher& watcher, const watchedFolderList& folders)
+		: m_watcher(watcher),
+		  m_folders(folders) {
+
+	}
+
+	bool isDataAvailable(const size_t index, int* descriptor) {
+
+		return m_watcher.isDataAvailable(*m_folders[index], descriptor);
+	}
+
+private:
+
+	IMAPIdleWatcher& m_watcher;
+	const watchedFolderList& m_folders;
+};
+
+
+bool IMAPIdleWatcher::waitForData(
+	const watchedFolderList& folders,
+	const int msecs,
+	std::vector <bool>& ready
+) {
+
+	folderDataAvailabilityChecker checker(*this, folders);
+
+	return IMAPUtils::waitForData(checker, folders.size(), msecs, ready);
+}
+
+
+size_t IMAPIdleWatcher::processFolders(
+	const watchedFolderList& folders,
+	const std::vector <bool>& ready,
+	const bool receive
+) {
+
+	unsigned int refreshInterval;
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+		refreshInterval = m_refreshInterval;
+	}
+
+	const unsigned long now = platform::getHandler()->getUnixTime();
+	size_t count = 0;
+
+	for (size_t i = 0 ; i < folders.size() ; ++i) {
+
+		watchedFolder& wf = *folders[i];
+		bool failed = false;
+
+		{
+			utility::sync::autoLock <utility::sync::criticalSection> ioLock(wf.ioLock);
+
+			// Folder may have been removed meanwhile
+			if (!wf.active) {
+				continue;
+			}
+
+			sm_currentFolder = &wf;
+
+			try {
+
+				if (ready[i] && wf.folder->processIdleNotifications(receive)) {
+					++count;
+				}
+
+				// Restart IDLE periodically, unless a listener removed the folder
+				if (wf.active && now - wf.idleStartTime >= refreshInterval) {
+
+					wf.folder->stopIdle();
+					wf.folder->startIdle();
+
+					wf.idleStartTime = now;
+				}
+
+			} catch (exception&) {
+
+				// The folder cannot be watched anymore
+				wf.active = false;
+				failed = true;
+
+			} catch (...) {
+
+				sm_currentFolder = NULL;
+				throw;
+			}
+
+			sm_currentFolder = NULL;
+		}
+
+		if (failed) {
+			discardFolder(folders[i]);
+		}
+	}
+
+	return count;
+}
+
+
+void IMAPIdleWatcher::discardFolder(const shared_ptr <watchedFolder>& wf) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	watchedFolderList::iterator it = std::find(m_folders.begin(), m_folders.end(), wf);
+
+	if (it != m_folders.end()) {
+		m_folders.erase(it);
+	}
+}
+
+
+void IMAPIdleWatcher::start() {
+
+	if (m_thread.joinable()) {
+		return;  // already running
+	}
+
+	m_stop = false;
+	m_error = std::exception_ptr();
+
+	m_thread = std::thread(&IMAPIdleWatcher::run, this);
+}
+
+
+void IMAPIdleWatcher::stop() {
+
+	if (!m_thread.joinable()) {
+		return;
+	}
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+		m_stop = true;
+	}
+
+	m_thread.join();
+
+	if (m_error) {
+
+		std::exception_ptr error = m_error;
+		m_error = std::exception_ptr();
+
+		std::rethrow_exception(error);
+	}
+}
+
+
+bool IMAPIdleWatcher::isRunning() const {
+
+	return m_thread.joinable();
+}
+
+
+void IMAPIdleWatcher::run() {
+
+	try {
+
+		// Wait by short steps, to react quickly to stop()
+		while (true) {
+
+			{
+				utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+				if (m_stop) {
+					break;
+				}
+			}
+
+			poll(250);
+		}
+
+	} catch (...) {
+
+		// An exception must not escape the thread; it is thrown by stop()
+		m_error = std::current_exception();
+	}
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
@@ -0,0 +1,225 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_IMAP_IMAPIDLEWATCHER_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPIDLEWATCHER_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/object.hpp"
+#include "vmime/base.hpp"
+
+#include "vmime/utility/sync/criticalSection.hpp"
+
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+class IMAPFolder;
+
+
+/** Watches several IMAP folders for changes, using IDLE (RFC 2177).
+  *
+  * The connections of all the folders are waited on at once, either by
+  * the thread which calls poll(), or by a background thread started with
+  * start(). Notifications sent by the server are turned into events,
+  * which are dispatched to the listeners of each folder from that thread.
+  *
+  * While a folder is watched, it must not be used by other threads.
+  * Listeners may call removeFolder() for the folder whose events they
+  * receive, but must not call addFolder().
+  * If an error occurs on the connection of a folder, the folder is no
+  * longer watched (see getFolders()). Any other error terminates the
+  * background thread, and is thrown by stop().
+  */
+class VMIME_EXPORT IMAPIdleWatcher : public object {
+
+public:
+
+	IMAPIdleWatcher();
+	~IMAPIdleWatcher();
+
+	/** Start watching the specified folder. The folder enters
+	  * IDLE state.
+	  *
+	  * @param folder open folder to watch
+	  * @throw exceptions::operation_not_supported if the server
+	  * does not support IDLE
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	void addFolder(const shared_ptr <IMAPFolder>& folder);
+
+	/** Stop watching the specified folder. The folder leaves
+	  * IDLE state.
+	  *
+	  * @param folder folder to stop watching
+	  * @throw exceptions::net_exception if an error occurs
+	  */
+	void removeFolder(const shared_ptr <IMAPFolder>& folder);
+
+	/** Return the folders currently watched.
+	  *
+	  * @return watched folders
+	  */
+	const std::vector <shared_ptr <IMAPFolder> > getFolders() const;
+
+	/** Set the interval after which IDLE is restarted on each folder,
+	  * as servers may consider a client inactive after 30 minutes.
+	  * The default is 25 minutes.
+	  *
+	  * @param secs refresh interval, in seconds
+	  */
+	void setRefreshInterval(const unsigned int secs);
+
+	/** Return the interval after which IDLE is restarted on each folder.
+	  *
+	  * @return refresh interval, in seconds
+	  */
+	unsigned int getRefreshInterval() const;
+
+	/** Wait for notifications on the watched folders, for at most
+	  * the specified time, and process them.
+	  *
+	  * @param msecs maximum time to wait, in milliseconds
+	  * @return number of folders for which notifications have been
+	  * processed
+	  */
+	size_t poll(const int msecs);
+
+	/** Start a background thread which processes notifications until
+	  * stop() is called.
+	  */
+	void start();
+
+	/** Stop the background thread started with start(), and wait for
+	  * it to terminate.
+	  *
+	  * @throw exception the error which terminated the background
+	  * thread, if any (eg. exceptions::socket_exception if waiting
+	  * on the connections failed, or an exception thrown by a listener)
+	  */
+	void stop();
+
+	/** Test whether the background thread is running.
+	  *
+	  * @return true if the background thread is running, false otherwise
+	  */
+	bool isRunning() const;
+
+private:
+
+	struct watchedFolder {
+
+		shared_ptr <IMAPFolder> folder;
+		unsigned long idleStartTime;
+		bool active;
+
+		// Serializes the use of the folder connection, which is not
+		// protected by the lock on the folder list; also protects the
+		// other members
+		shared_ptr <utility::sync::criticalSection> ioLock;
+	};
+
+	typedef std::vector <shared_ptr <watchedFolder> > watchedFolderList;
+
+	class folderDataAvailabilityChecker;
+
+
+	/** Wait for data on the connections of the specified folders.
+	  *
+	  * @param folders folders to wait on
+	  * @param msecs maximum time to wait, in milliseconds
+	  * @param ready receives, for each folder, whether data is available
+	  * @return true if data is available for at least one folder
+	  */
+	bool waitForData(const watchedFolderList& folders, const int msecs, std::vector <bool>& ready);
+
+	/** Check whether data can be read without waiting on the connection
+	  * of the specified folder.
+	  *
+	  * @param wf folder to check
+	  * @param descriptor if not NULL, receives the descriptor of the
+	  * socket, or -1 if it is not available
+	  * @return true if data is available, false otherwise
+	  */
+	bool isDataAvailable(watchedFolder& wf, int* descriptor);
+
+	/** Process the notifications received for the specified folders,
+	  * and restart IDLE on folders which need to be refreshed. Each
+	  * connection is only used under the lock of its folder, so that
+	  * addFolder(), removeFolder() and getFolders() do not wait for the
+	  * server replies.
+	  *
+	  * @param folders folders to process
+	  * @param ready for each folder, whether data is available
+	  * @param receive whether to receive data available on the sockets,
+	  * or only process data which has already been received
+	  * @return number of folders for which notifications have been processed
+	  */
+	size_t processFolders(const watchedFolderList& folders, const std::vector <bool>& ready, const bool receive);
+
+	/** Remove the specified folder from the list of watched folders,
+	  * after an error occurred on its connection.
+	  *
+	  * @param wf folder which cannot be watched anymore
+	  */
+	void discardFolder(const shared_ptr <watchedFolder>& wf);
+
+	void run();
+
+
+	watchedFolderList m_folders;
+	shared_ptr <utility::sync::criticalSection> m_lock;
+
+	unsigned int m_refreshInterval;
+
+	std::thread m_thread;
+	bool m_stop;
+
+	// Error which terminated the background thread, thrown by stop()
+	std::exception_ptr m_error;
+
+	// Folder whose notifications are being dispatched by this thread
+	static thread_local watchedFolder* sm_currentFolder;
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPIDLEWATCHER_HPP_INCLUDED
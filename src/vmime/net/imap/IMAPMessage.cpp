@@ -41,7 +41,9 @@
 #include "vmime/messageId.hpp"
 #include "vmime/messageIdSequence.hpp"
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
 
+#include <algorithm>
 #include <sstream>
 #include <iterator>
 #include <typeinfo>
@@ -75,6 +77,7 @@ public:
 				<const IMAPParser::msg_att_item&>(comp).type;
 
 			if (type == IMAPParser::msg_att_item::BODY_SECTION ||
+			    type == IMAPParser::msg_att_item::BINARY_SECTION ||
 			    type == IMAPParser::msg_att_item::RFC822_TEXT) {
 
 				return m_target;
@@ -113,7 +116,8 @@ IMAPMessage::IMAPMessage(
 	  m_flags(FLAG_UNDEFINED),
 	  m_expunged(false),
 	  m_modseq(0),
-	  m_structure(null) {
+	  m_structure(null),
+	  m_seenByFetch(false) {
 
 	folder->registerMessage(this);
 }
@@ -131,7 +135,8 @@ IMAPMessage::IMAPMessage(
 	  m_expunged(false),
 	  m_uid(uid),
 	  m_modseq(0),
-	  m_structure(null) {
+	  m_structure(null),
+	  m_seenByFetch(false) {
 
 	folder->registerMessage(this);
 }
@@ -294,21 +299,126 @@ void IMAPMessage::fetchPartHeader(const shared_ptr <messagePart>& p) {
 }
 
 
-void IMAPMessage::fetchPartHeaderForStructure(const shared_ptr <messageStructure>& str) {
+size_t IMAPMessage::getDecodedPartSize(const shared_ptr <const messagePart>& p) const {
+
+	shared_ptr <const IMAPFolder> folder = m_folder.lock();
+
+	if (!folder) {
+		throw exceptions::folder_not_found();
+	} else if (!folder->isOpen()) {
+		throw exceptions::illegal_state("Folder not open");
+	} else if (!isBinaryExtractSupported()) {
+		throw exceptions::operation_not_supported();
+	}
+
+	// The body of a non-multipart message is part "1"
+	string section = getPartSection(p);
+
+	if (section.empty()) {
+		section = "1";
+	}
+
+	std::vector <std::string> fetchParams;
+	fetchParams.push_back("BINARY.SIZE[" + section + "]");
+
+	// Example:  C: a001 UID FETCH 42 (BINARY.SIZE[2])
+	//           S: * 3 FETCH (UID 42 BINARY.SIZE[2] 48213)
+	//           S: a001 OK FETCH completed
+	IMAPCommand::FETCH(
+		m_uid.empty() ? messageSet::byNumber(m_num) : messageSet::byUID(m_uid),
+		fetchParams
+	)->send(folder->m_connection);
+
+	scoped_ptr <IMAPParser::response> resp(folder->m_connection->readResponse());
+
+	if (resp->isBad() || resp->response_done->response_tagged->
+		resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+		throw exceptions::command_error("FETCH", resp->getErrorLog(), "bad response");
+	}
+
+	for (auto &respData : resp->continue_req_or_response_data) {
+
+		if (!respData->response_data || !respData->response_data->message_data ||
+		    respData->response_data->message_data->type != IMAPParser::message_data::FETCH) {
+
+			continue;
+		}
+
+		for (auto &att : respData->response_data->message_data->msg_att->items) {
+
+			if (att->type == IMAPParser::msg_att_item::BINARY_SIZE) {
+				return static_cast <size_t>(att->number->value);
+			}
+		}
+	}
+
+	throw exceptions::command_error("FETCH", resp->getErrorLog(), "no BINARY.SIZE in response");
+}
+
+
+bool IMAPMessage::isBinaryExtractSupported() const {
+
+	shared_ptr <const IMAPFolder> folder = m_folder.lock();
+
+	return folder && folder->m_connection &&
+		folder->m_connection->hasCapability(IMAPConnection::CAPABILITY_BINARY);
+}
+
+
+// static
+void IMAPMessage::collectPartHeaderSections(
+	const shared_ptr <messageStructure>& str,
+	std::map <string, shared_ptr <IMAPMessagePart> >& parts,
+	std::vector <string>& sections
+) {
 
 	for (size_t i = 0, n = str->getPartCount() ; i < n ; ++i) {
 
-		shared_ptr <messagePart> part = str->getPartAt(i);
+		shared_ptr <IMAPMessagePart> part = dynamicCast <IMAPMessagePart>(str->getPartAt(i));
+		const string section = getPartSection(part);
 
-		// Fetch header of current part
-		fetchPartHeader(part);
+		parts[section] = part;
+		sections.push_back(section);
 
-		// Fetch header of sub-parts
-		fetchPartHeaderForStructure(part->getStructure());
+		// Collect sub-parts
+		collectPartHeaderSections(part->getStructure(), parts, sections);
 	}
 }
 
 
+// static
+const string IMAPMessage::getPartSection(const shared_ptr <const messagePart>& p) {
+
+	if (p == NULL) {
+		return "";
+	}
+
+	std::ostringstream section;
+	section.imbue(std::locale::classic());
+
+	shared_ptr <const IMAPMessagePart> currentPart = dynamicCast <const IMAPMessagePart>(p);
+	std::vector <size_t> numbers;
+
+	numbers.push_back(currentPart->getNumber());
+	currentPart = currentPart->getParent();
+
+	while (currentPart != NULL) {
+		numbers.push_back(currentPart->getNumber());
+		currentPart = currentPart->getParent();
+	}
+
+	numbers.erase(numbers.end() - 1);
+
+	for (std::vector <size_t>::reverse_iterator it = numbers.rbegin() ; it != numbers.rend() ; ++it) {
+		if (it != numbers.rbegin()) section << ".";
+		section << (*it + 1);
+	}
+
+	return section.str();
+}
+
+
 size_t IMAPMessage::extractImpl(
 	const shared_ptr <const messagePart>& p,
 	utility::outputStream& os,
@@ -328,35 +438,203 @@ size_t IMAPMessage::extractImpl(
 		throw exceptions::illegal_state("Folder not open");
 	}
 	
-	IMAPMessage_literalHandler literalHandler(os, progress);
-
 	if (length == 0) {
 		return 0;
 	}
 
 	// Construct section identifier
-	std::ostringstream section;
-	section.imbue(std::locale::classic());
+	const string section = getPartSection(p);
 
-	if (p != NULL) {
+	// Body of a part, as stored on the server or decoded by the
+	// server (the body of a non-multipart message is decoded as
+	// part "1"): use the part cache
+	if ((extractFlags & EXTRACT_BODY) && !(extractFlags & EXTRACT_HEADER) &&
+	    (!section.empty() || (extractFlags & EXTRACT_BINARY))) {
 
-		shared_ptr <const IMAPMessagePart> currentPart = dynamicCast <const IMAPMessagePart>(p);
-		std::vector <size_t> numbers;
+		return extractCachedBody(p, section, os, progress, start, length, extractFlags);
+	}
 
-		numbers.push_back(currentPart->getNumber());
-		currentPart = currentPart->getParent();
+	return extractFromServer(p, section, os, progress, start, length, extractFlags);
+}
+
+
+size_t IMAPMessage::extractCachedBody(
+	const shared_ptr <const messagePart>& p,
+	const string& section,
+	utility::outputStream& os,
+	utility::progressListener* progress,
+	const size_t start,
+	const size_t length,
+	const int extractFlags
+) const {
+
+	shared_ptr <const IMAPFolder> folder = m_folder.lock();
+
+	if (!folder) {
+		throw exceptions::folder_not_found();
+	}
+
+	IMAPMessagePartCache& cache = *folder->m_partCache;
+
+	const IMAPMessagePartCache::partId part(this, section, (extractFlags & EXTRACT_BINARY) != 0);
+
+	// Decoded contents are not bigger than the contents as stored
+	// on the server, so the size of the part is an upper bound
+	const size_t blockSize = cache.getBlockSize();
+	const size_t partSize = p->getSize();
+
+	const size_t end = (length == static_cast <size_t>(-1)) ? partSize : std::min(start + length, partSize);
+
+	// Nothing known to extract, or too much data to be cached
+	if (end <= start || end - start > cache.getMaxSize()) {
+		return extractFromServer(p, section, os, progress, start, length, extractFlags);
+	}
+
+	// Cached data can be used if fetching it again would not set
+	// the "\Seen" flag on the message
+	const bool useCache =
+		(extractFlags & EXTRACT_PEEK) || m_seenByFetch ||
+		(m_flags != FLAG_UNDEFINED && (m_flags & FLAG_SEEN));
+
+	const size_t lastBlock = (end - 1) / blockSize;
+
+	size_t written = 0;
+	size_t block = start / blockSize;
+
+	while (block <= lastBlock) {
 
-		while (currentPart != NULL) {
-			numbers.push_back(currentPart->getNumber());
-			currentPart = currentPart->getParent();
+		const string* data = useCache ? cache.getBlock(part, block) : NULL;
+		string fetched;
+		size_t count = 1;
+		bool endOfPart = false;
+
+		if (data) {
+
+			// A short block is the last block of the part
+			endOfPart = (data->length() < blockSize);
+
+		} else {
+
+			// Fetch the following missing blocks with the same request
+			while (block + count <= lastBlock &&
+			       !(useCache && cache.hasBlock(part, block + count))) {
+
+				++count;
+			}
+
+			// Fetch until the end of the part if this was requested, in
+			// case the part is bigger than the size given by the server
+			const bool toEnd = (length == static_cast <size_t>(-1) && block + count > lastBlock);
+
+			utility::outputStreamStringAdapter fetchedStream(fetched);
+
+			extractFromServer(
+				p, section, fetchedStream, progress, block * blockSize,
+				toEnd ? static_cast <size_t>(-1) : count * blockSize, extractFlags
+			);
+
+			endOfPart = toEnd || fetched.length() < count * blockSize;
+
+			for (size_t i = 0 ; i * blockSize < fetched.length() ; ++i) {
+				cache.addBlock(part, block + i, string(fetched, i * blockSize, blockSize));
+			}
+
+			data = &fetched;
 		}
 
-		numbers.erase(numbers.end() - 1);
+		// Write the requested bytes
+		const size_t dataStart = block * blockSize;
+		const size_t dataEnd = (length == static_cast <size_t>(-1))
+			? dataStart + data->length() : std::min(dataStart + data->length(), start + length);
+
+		if (dataEnd > start && dataEnd > dataStart) {
+
+			const size_t offset = (start > dataStart) ? start - dataStart : 0;
 
-		for (std::vector <size_t>::reverse_iterator it = numbers.rbegin() ; it != numbers.rend() ; ++it) {
-			if (it != numbers.rbegin()) section << ".";
-			section << (*it + 1);
+			os.write(data->data() + offset, dataEnd - dataStart - offset);
+			written += dataEnd - dataStart - offset;
 		}
+
+		if (endOfPart) {
+			break;
+		}
+
+		block += count;
+	}
+
+	return written;
+}
+
+
+size_t IMAPMessage::extractFromServer(
+	const shared_ptr <const messagePart>& p,
+	const string& section,
+	utility::outputStream& os,
+	utility::progressListener* progress,
+	const size_t start,
+	const size_t length,
+	const int extractFlags
+) const {
+
+	shared_ptr <const IMAPFolder> folder = m_folder.lock();
+
+	if (!folder) {
+		throw exceptions::folder_not_found();
+	}
+
+	IMAPMessage_literalHandler literalHandler(os, progress);
+
+	// Decoded body, as sent by the server (RFC-3516):
+	/*
+	   BINARY[section]      decoded body
+	   BINARY.PEEK[section] decoded body (peek)
+	*/
+	if (extractFlags & EXTRACT_BINARY) {
+
+		std::ostringstream binaryDesc;
+		binaryDesc.imbue(std::locale::classic());
+
+		binaryDesc << "BINARY";
+
+		if (extractFlags & EXTRACT_PEEK) {
+			binaryDesc << ".PEEK";
+		}
+
+		// The body of a non-multipart message is part "1"
+		binaryDesc << "[" << (section.empty() ? "1" : section) << "]";
+
+		if (start != 0 || length != static_cast <size_t>(-1)) {
+
+			if (length == static_cast <size_t>(-1)) {
+				binaryDesc << "<" << start << "." << static_cast <unsigned int>(-1) << ">";
+			} else {
+				binaryDesc << "<" << start << "." << length << ">";
+			}
+		}
+
+		std::vector <std::string> fetchParams;
+		fetchParams.push_back(binaryDesc.str());
+
+		IMAPCommand::FETCH(
+			m_uid.empty() ? messageSet::byNumber(m_num) : messageSet::byUID(m_uid),
+			fetchParams
+		)->send(folder->m_connection);
+
+		// Get the response; the server replies with "NO [UNKNOWN-CTE]"
+		// if it cannot decode the contents of the part
+		scoped_ptr <IMAPParser::response> resp(folder->m_connection->readResponse(&literalHandler));
+
+		if (resp->isBad() || resp->response_done->response_tagged->
+			resp_cond_state->status != IMAPParser::resp_cond_state::OK) {
+
+			throw exceptions::command_error("FETCH", resp->getErrorLog(), "bad response");
+		}
+
+		if (!(extractFlags & EXTRACT_PEEK)) {
+			m_seenByFetch = true;
+		}
+
+		return literalHandler.getTarget()->getBytesWritten();
 	}
 
 	// Build the body descriptor for FETCH
@@ -379,7 +657,7 @@ size_t IMAPMessage::extractImpl(
 
 	bodyDesc << "[";
 
-	if (section.str().empty()) {
+	if (section.empty()) {
 
 		// header + body
 		if ((extractFlags & EXTRACT_HEADER) && (extractFlags & EXTRACT_BODY)) {
@@ -394,7 +672,7 @@ size_t IMAPMessage::extractImpl(
 
 	} else {
 
-		bodyDesc << section.str();
+		bodyDesc << section;
 
 		// header + body
 		if ((extractFlags & EXTRACT_HEADER) && (extractFlags & EXTRACT_BODY)) {
@@ -479,6 +757,10 @@ size_t IMAPMessage::extractImpl(
 
 	if (extractFlags & EXTRACT_BODY) {
 		// TODO: update the flags (eg. flag "\Seen" may have been set)
+
+		if (!(extractFlags & EXTRACT_PEEK)) {
+			m_seenByFetch = true;
+		}
 	}
 
 	return literalHandler.getTarget()->getBytesWritten();
@@ -634,6 +916,8 @@ int IMAPMessage::processFetchResponse(
 				break;
 			}
 			case IMAPParser::msg_att_item::INTERNALDATE:
+			case IMAPParser::msg_att_item::BINARY_SECTION:
+			case IMAPParser::msg_att_item::BINARY_SIZE:
 			case IMAPParser::msg_att_item::RFC822:
 			case IMAPParser::msg_att_item::RFC822_TEXT:
 			case IMAPParser::msg_att_item::BODY: {
@@ -730,6 +1014,12 @@ void IMAPMessage::constructParsedMessage(
 
 shared_ptr <vmime::message> IMAPMessage::getParsedMessage() {
 
+	shared_ptr <IMAPFolder> folder = m_folder.lock();
+
+	if (!folder) {
+		throw exceptions::folder_not_found();
+	}
+
 	// Fetch structure
 	shared_ptr <messageStructure> structure;
 
@@ -739,12 +1029,6 @@ shared_ptr <vmime::message> IMAPMessage::getParsedMessage() {
 
 	} catch (exceptions::unfetched_object&) {
 
-		auto folder = m_folder.lock();
-
-		if (!folder) {
-			throw exceptions::folder_not_found();
-		}
-
 		std::vector <shared_ptr <message> > msgs;
 		msgs.push_back(dynamicCast <IMAPMessage>(shared_from_this()));
 
@@ -755,8 +1039,11 @@ shared_ptr <vmime::message> IMAPMessage::getParsedMessage() {
 		structure = getStructure();
 	}
 
-	// Fetch header for each part
-	fetchPartHeaderForStructure(structure);
+	// Fetch header for each part, all at once
+	std::vector <shared_ptr <IMAPMessage> > imapMsgs;
+	imapMsgs.push_back(dynamicCast <IMAPMessage>(shared_from_this()));
+
+	folder->fetchPartHeaders(imapMsgs);
 
 	// Construct message from structure
 	shared_ptr <vmime::message> msg = make_shared <vmime::message>();
@@ -36,6 +36,8 @@
 
 #include "vmime/net/imap/IMAPParser.hpp"
 
+#include <map>
+
 
 namespace vmime {
 namespace net {
@@ -43,6 +45,7 @@ namespace imap {
 
 
 class IMAPFolder;
+class IMAPMessagePart;
 
 
 /** IMAP message implementation.
@@ -53,6 +56,7 @@ private:
 
 	friend class IMAPFolder;
 	friend class IMAPMessagePartContentHandler;
+	friend class IMAPMessagePartInputStream;
 
 	IMAPMessage(const IMAPMessage&) : message() { }
 
@@ -110,6 +114,20 @@ public:
 
 	void fetchPartHeader(const shared_ptr <messagePart>& p);
 
+	/** Return the size of the contents of the specified part, once
+	  * its content transfer encoding has been decoded. The size is
+	  * requested from the server, without fetching the contents
+	  * (BINARY.SIZE, RFC-3516).
+	  *
+	  * @param p part for which to get the size
+	  * @return decoded size of the part contents, in bytes
+	  * @throw exceptions::operation_not_supported if the server does
+	  * not support the BINARY extension
+	  * @throw exceptions::command_error if the server cannot decode
+	  * the contents of the part
+	  */
+	size_t getDecodedPartSize(const shared_ptr <const messagePart>& p) const;
+
 	shared_ptr <vmime::message> getParsedMessage();
 
 private:
@@ -134,11 +152,28 @@ private:
 	  */
 	int processFetchResponse(const fetchAttributes& options, const IMAPParser::message_data& msgData);
 
-	/** Recursively fetch part header for all parts in the structure.
+	/** Recursively collect all parts in the structure, along with the
+	  * section specifier to use for fetching their header.
+	  *
+	  * @param str structure for which to collect parts
+	  * @param parts receives the parts, indexed by section specifier
+	  * (see IMAPUtils::buildFetchPartHeadersCommand())
+	  * @param sections receives the section specifiers, in the order
+	  * in which the parts appear in the structure
+	  */
+	static void collectPartHeaderSections(
+		const shared_ptr <messageStructure>& str,
+		std::map <string, shared_ptr <IMAPMessagePart> >& parts,
+		std::vector <string>& sections
+	);
+
+	/** Return the IMAP section specifier of the specified part.
 	  *
-	  * @param str structure for which to fetch parts headers
+	  * @param p message part
+	  * @return section specifier (eg. "1.2"), or an empty string
+	  * for the message itself
 	  */
-	void fetchPartHeaderForStructure(const shared_ptr <messageStructure>& str);
+	static const string getPartSection(const shared_ptr <const messagePart>& p);
 
 	/** Recursively contruct parsed message from structure.
 	  * Called by getParsedMessage().
@@ -158,9 +193,18 @@ private:
 	{
 		EXTRACT_HEADER = 0x1,
 		EXTRACT_BODY = 0x2,
-		EXTRACT_PEEK = 0x10
+		EXTRACT_PEEK = 0x10,
+		EXTRACT_BINARY = 0x20   /**< Let the server decode the body (BINARY, RFC-3516). */
 	};
 
+	/** Test whether the server can decode the contents of parts
+	  * itself (BINARY extension, RFC-3516), so that they can be
+	  * extracted with EXTRACT_BINARY.
+	  *
+	  * @return true if the BINARY extension is supported
+	  */
+	bool isBinaryExtractSupported() const;
+
 	size_t extractImpl(
 		const shared_ptr <const messagePart>& p,
 		utility::outputStream& os,
@@ -170,6 +214,44 @@ private:
 		const int extractFlags
 	) const;
 
+	/** Extract the body of a part, reading the blocks which are in the
+	  * part cache and fetching the missing ones. Consecutive missing
+	  * blocks are fetched with a single request, and added to the cache.
+	  * Called by extractImpl().
+	  *
+	  * @param p message part
+	  * @param section section specifier of the part
+	  * @param os output stream
+	  * @param progress progress listener, or NULL
+	  * @param start offset of the first byte to extract
+	  * @param length number of bytes to extract, or -1 to extract
+	  * until the end of the part
+	  * @param extractFlags EXTRACT_BODY, and optionally EXTRACT_PEEK
+	  * @return number of bytes written to the output stream
+	  */
+	size_t extractCachedBody(
+		const shared_ptr <const messagePart>& p,
+		const string& section,
+		utility::outputStream& os,
+		utility::progressListener* progress,
+		const size_t start,
+		const size_t length,
+		const int extractFlags
+	) const;
+
+	/** Send the FETCH request for the specified data, and write the
+	  * data to the output stream. Called by extractImpl().
+	  */
+	size_t extractFromServer(
+		const shared_ptr <const messagePart>& p,
+		const string& section,
+		utility::outputStream& os,
+		utility::progressListener* progress,
+		const size_t start,
+		const size_t length,
+		const int extractFlags
+	) const;
+
 
 	shared_ptr <header> getOrCreateHeader();
 
@@ -187,6 +269,8 @@ private:
 
 	shared_ptr <header> m_header;
 	shared_ptr <messageStructure> m_structure;
+
+	mutable bool m_seenByFetch;   // the body has been fetched without "PEEK"
 };
 
 
@@ -0,0 +1,187 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPMessagePartCache.hpp"
+
+#include <algorithm>
+#include <functional>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+IMAPMessagePartCache::partId::partId(
+	const IMAPMessage* message,
+	const string& section,
+	const bool binary
+)
+	: message(message),
+	  section(section),
+	  binary(binary) {
+
+}
+
+
+bool IMAPMessagePartCache::partId::operator<(const partId& other) const {
+
+	if (message != other.message) {
+		return std::less <const IMAPMessage*>()(message, other.message);
+	}
+
+	if (binary != other.binary) {
+		return other.binary;
+	}
+
+	return section < other.section;
+}
+
+
+IMAPMessagePartCache::IMAPMessagePartCache(const size_t blockSize, const size_t maxSize)
+	: m_blockSize(std::max(blockSize, static_cast <size_t>(1))),
+	  m_maxSize(maxSize),
+	  m_size(0) {
+
+}
+
+
+void IMAPMessagePartCache::setLimits(const size_t blockSize, const size_t maxSize) {
+
+	clear();
+
+	m_blockSize = std::max(blockSize, static_cast <size_t>(1));
+	m_maxSize = maxSize;
+}
+
+
+size_t IMAPMessagePartCache::getBlockSize() const {
+
+	return m_blockSize;
+}
+
+
+size_t IMAPMessagePartCache::getMaxSize() const {
+
+	return m_maxSize;
+}
+
+
+size_t IMAPMessagePartCache::getSize() const {
+
+	return m_size;
+}
+
+
+const string* IMAPMessagePartCache::getBlock(const partId& part, const size_t block) {
+
+	std::map <blockKey, cachedBlock>::iterator it = m_blocks.find(blockKey(part, block));
+
+	if (it == m_blocks.end()) {
+		return NULL;
+	}
+
+	// This is now the most recently used block
+	m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+
+	return &it->second.data;
+}
+
+
+bool IMAPMessagePartCache::hasBlock(const partId& part, const size_t block) const {
+
+	return m_blocks.find(blockKey(part, block)) != m_blocks.end();
+}
+
+
+void IMAPMessagePartCache::addBlock(const partId& part, const size_t block, const string& data) {
+
+	const blockKey key(part, block);
+
+	std::map <blockKey, cachedBlock>::iterator it = m_blocks.find(key);
+
+	if (it != m_blocks.end()) {
+		removeBlock(it);
+	}
+
+	if (data.length() > m_maxSize) {
+		return;
+	}
+
+	// Evict the least recently used blocks
+	while (m_size + data.length() > m_maxSize) {
+		removeBlock(m_blocks.find(m_lru.back()));
+	}
+
+	m_lru.push_front(key);
+
+	cachedBlock& entry = m_blocks[key];
+	entry.data = data;
+	entry.lruPos = m_lru.begin();
+
+	m_size += data.length();
+}
+
+
+void IMAPMessagePartCache::removeMessage(const IMAPMessage* message) {
+
+	// Blocks are sorted by message first
+	std::map <blockKey, cachedBlock>::iterator it =
+		m_blocks.lower_bound(blockKey(partId(message, "", false), 0));
+
+	while (it != m_blocks.end() && it->first.first.message == message) {
+		removeBlock(it++);
+	}
+}
+
+
+void IMAPMessagePartCache::removeBlock(const std::map <blockKey, cachedBlock>::iterator& it) {
+
+	m_size -= it->second.data.length();
+
+	m_lru.erase(it->second.lruPos);
+	m_blocks.erase(it);
+}
+
+
+void IMAPMessagePartCache::clear() {
+
+	m_blocks.clear();
+	m_lru.clear();
+
+	m_size = 0;
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
@@ -0,0 +1,175 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_IMAP_IMAPMESSAGEPARTCACHE_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPMESSAGEPARTCACHE_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/types.hpp"
+
+#include <list>
+#include <map>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+class IMAPMessage;
+
+
+/** A cache for the contents of the parts of the messages of a folder,
+  * as fetched from the server. Contents are stored in fixed-size blocks,
+  * identified by the part (see partId) and the index of the block; the
+  * least recently used blocks are evicted when the total size of the
+  * cached blocks would exceed the maximum size of the cache.
+  *
+  * A block shorter than the block size is the last block of the part.
+  */
+class VMIME_EXPORT IMAPMessagePartCache : public object {
+
+public:
+
+	/** Identifies the contents of a part: the message, the section
+	  * specifier of the part, and whether the contents have been
+	  * decoded by the server (BINARY, RFC-3516) or not (BODY).
+	  */
+	struct partId {
+
+		partId(const IMAPMessage* message, const string& section, const bool binary);
+
+		bool operator<(const partId& other) const;
+
+		const IMAPMessage* message;
+		string section;
+		bool binary;
+	};
+
+	/** Construct a new, empty cache.
+	  *
+	  * @param blockSize size of the blocks, in bytes
+	  * @param maxSize maximum total size of the cached blocks, in bytes
+	  */
+	IMAPMessagePartCache(const size_t blockSize = 4096, const size_t maxSize = 1024 * 1024);
+
+	/** Change the size of the blocks and the capacity of the cache.
+	  * The cache is emptied.
+	  *
+	  * @param blockSize size of the blocks, in bytes
+	  * @param maxSize maximum total size of the cached blocks, in bytes
+	  * (0 disables the cache)
+	  */
+	void setLimits(const size_t blockSize, const size_t maxSize);
+
+	/** Return the size of the blocks.
+	  *
+	  * @return size of the blocks, in bytes
+	  */
+	size_t getBlockSize() const;
+
+	/** Return the maximum total size of the cached blocks.
+	  *
+	  * @return maximum size, in bytes
+	  */
+	size_t getMaxSize() const;
+
+	/** Return the total size of the cached blocks.
+	  *
+	  * @return size of the cached data, in bytes
+	  */
+	size_t getSize() const;
+
+	/** Return a block, and mark it as the most recently used one.
+	  *
+	  * @param part part to which the block belongs
+	  * @param block index of the block
+	  * @return block data, or NULL if the block is not in the cache;
+	  * the pointer is valid until the next call to addBlock()
+	  */
+	const string* getBlock(const partId& part, const size_t block);
+
+	/** Test whether a block is in the cache.
+	  *
+	  * @param part part to which the block belongs
+	  * @param block index of the block
+	  * @return true if the block is in the cache, false otherwise
+	  */
+	bool hasBlock(const partId& part, const size_t block) const;
+
+	/** Add a block to the cache, evicting the least recently used
+	  * blocks if the cache is full. A block bigger than the maximum
+	  * size of the cache is not added.
+	  *
+	  * @param part part to which the block belongs
+	  * @param block index of the block
+	  * @param data block data
+	  */
+	void addBlock(const partId& part, const size_t block, const string& data);
+
+	/** Remove all the blocks of the parts of a message.
+	  *
+	  * @param message message whose blocks are removed
+	  */
+	void removeMessage(const IMAPMessage* message);
+
+	/** Remove all the blocks from the cache.
+	  */
+	void clear();
+
+private:
+
+	typedef std::pair <partId, size_t> blockKey;
+
+	struct cachedBlock {
+
+		string data;
+		std::list <blockKey>::iterator lruPos;
+	};
+
+	void removeBlock(const std::map <blockKey, cachedBlock>::iterator& it);
+
+
+	size_t m_blockSize;
+	size_t m_maxSize;
+	size_t m_size;
+
+	std::map <blockKey, cachedBlock> m_blocks;
+	std::list <blockKey> m_lru;  // most recently used first
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPMESSAGEPARTCACHE_HPP_INCLUDED
@@ -33,8 +33,6 @@
 #include "vmime/net/imap/IMAPFolderStatus.hpp"
 #include "vmime/net/imap/IMAPStore.hpp"
 
-#include "vmime/utility/outputStreamAdapter.hpp"
-#include "vmime/utility/inputStreamStringAdapter.hpp"
 
 namespace vmime {
 namespace net {
@@ -78,34 +76,32 @@ void IMAPMessagePartContentHandler::generate(
 
 		// The data is already encoded but the encoding specified for
 		// the generation is different from the current one. We need
-		// to re-encode data: decode from input buffer to temporary
-		// buffer, and then re-encode to output stream...
+		// to re-encode data: data is decoded as it is received, and
+		// decoded data is re-encoded to output stream...
 		if (m_encoding != enc) {
 
-			// Extract part contents to temporary buffer
-			std::ostringstream oss;
-			utility::outputStreamAdapter tmp(oss);
+			shared_ptr <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
+			shared_ptr <utility::encoder::encoder> theEncoder = enc.getEncoder();
 
-			msg->extractPart(part, tmp, NULL);
+			theEncoder->getProperties()["maxlinelength"] = maxLineLength;
+			theEncoder->getProperties()["text"] = (m_contentType.getType() == mediaTypes::TEXT);
 
-			// Decode to another temporary buffer
-			utility::inputStreamStringAdapter in(oss.str());
+			shared_ptr <utility::filteredOutputStream> encodingStream =
+				theEncoder->getEncodingFilteredOutputStream(os);
 
-			std::ostringstream oss2;
-			utility::outputStreamAdapter tmp2(oss2);
+			// Let the server decode data, if possible
+			if (extractBinary(*encodingStream, NULL)) {
 
-			shared_ptr <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
-			theDecoder->decode(in, tmp2);
+				encodingStream->flush();
+				return;
+			}
 
-			// Reencode to output stream
-			string str = oss2.str();
-			utility::inputStreamStringAdapter tempIn(str);
+			shared_ptr <utility::filteredOutputStream> decodingStream =
+				theDecoder->getDecodingFilteredOutputStream(*encodingStream);
 
-			shared_ptr <utility::encoder::encoder> theEncoder = enc.getEncoder();
-			theEncoder->getProperties()["maxlinelength"] = maxLineLength;
-			theEncoder->getProperties()["text"] = (m_contentType.getType() == mediaTypes::TEXT);
+			msg->extractPart(part, *decodingStream, NULL);
 
-			theEncoder->encode(tempIn, os);
+			decodingStream->flush();
 
 		// No encoding to perform
 		} else {
@@ -116,20 +112,17 @@ void IMAPMessagePartContentHandler::generate(
 	// Need to encode data before
 	} else {
 
-		// Extract part contents to temporary buffer
-		std::ostringstream oss;
-		utility::outputStreamAdapter tmp(oss);
-
-		msg->extractPart(part, tmp, NULL);
-
-		// Encode temporary buffer to output stream
+		// Encode part contents to output stream, as it is received
 		shared_ptr <utility::encoder::encoder> theEncoder = enc.getEncoder();
 		theEncoder->getProperties()["maxlinelength"] = maxLineLength;
 		theEncoder->getProperties()["text"] = (m_contentType.getType() == mediaTypes::TEXT);
 
-		utility::inputStreamStringAdapter is(oss.str());
+		shared_ptr <utility::filteredOutputStream> encodingStream =
+			theEncoder->getEncodingFilteredOutputStream(os);
+
+		msg->extractPart(part, *encodingStream, NULL);
 
-		theEncoder->encode(is, os);
+		encodingStream->flush();
 	}
 }
 
@@ -150,21 +143,23 @@ void IMAPMessagePartContentHandler::extract(
 
 		msg->extractImpl(part, os, progress, 0, -1, IMAPMessage::EXTRACT_BODY);
 
+	// Let the server decode data, if possible
+	} else if (extractBinary(os, progress)) {
+
+		// Nothing more to do
+
 	// Need to decode data
 	} else {
 
-		// Extract part contents to temporary buffer
-		std::ostringstream oss;
-		utility::outputStreamAdapter tmp(oss);
+		// Decode part contents to output stream, as it is received
+		shared_ptr <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
 
-		msg->extractImpl(part, tmp, NULL, 0, -1, IMAPMessage::EXTRACT_BODY);
+		shared_ptr <utility::filteredOutputStream> decodingStream =
+			theDecoder->getDecodingFilteredOutputStream(os);
 
-		// Encode temporary buffer to output stream
-		utility::inputStreamStringAdapter is(oss.str());
-		utility::progressListenerSizeAdapter plsa(progress, getLength());
+		msg->extractImpl(part, *decodingStream, progress, 0, -1, IMAPMessage::EXTRACT_BODY);
 
-		shared_ptr <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
-		theDecoder->decode(is, os, &plsa);
+		decodingStream->flush();
 	}
 }
 
@@ -184,6 +179,42 @@ void IMAPMessagePartContentHandler::extractRaw(
 }
 
 
+bool IMAPMessagePartContentHandler::extractBinary(
+	utility::outputStream& os,
+	utility::progressListener* progress
+) const {
+
+	// Only worth it for encodings which add overhead
+	if (m_encoding.getName() != encodingTypes::BASE64 &&
+	    m_encoding.getName() != encodingTypes::QUOTED_PRINTABLE) {
+
+		return false;
+	}
+
+	shared_ptr <IMAPMessage> msg = m_message.lock();
+	shared_ptr <messagePart> part = m_part.lock();
+
+	if (!msg->isBinaryExtractSupported()) {
+		return false;
+	}
+
+	try {
+
+		msg->extractImpl(
+			part, os, progress, 0, -1,
+			IMAPMessage::EXTRACT_BODY | IMAPMessage::EXTRACT_BINARY
+		);
+
+	} catch (exceptions::command_error&) {
+
+		// The server cannot decode this part ("NO [UNKNOWN-CTE]")
+		return false;
+	}
+
+	return true;
+}
+
+
 size_t IMAPMessagePartContentHandler::getLength() const {
 	shared_ptr <messagePart> part = m_part.lock();
 	if (!part)
@@ -76,6 +76,18 @@ public:
 
 private:
 
+	/** Extract the contents of the part as decoded by the server, if it
+	  * supports the BINARY extension (RFC-3516). This saves the transfer
+	  * overhead of the encoding, and decoding on the client side.
+	  *
+	  * @param os output stream
+	  * @param progress progress listener, or NULL if not used
+	  * @return true if the contents have been extracted, or false if
+	  * they must be fetched and decoded as usual
+	  */
+	bool extractBinary(utility::outputStream& os, utility::progressListener* progress) const;
+
+
 	weak_ptr <IMAPMessage> m_message;
 	weak_ptr <messagePart> m_part;
 
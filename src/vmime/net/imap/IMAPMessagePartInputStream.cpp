@@ -0,0 +1,139 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPMessagePartInputStream.hpp"
+
+#include "vmime/utility/outputStreamStringAdapter.hpp"
+
+#include "vmime/exception.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+IMAPMessagePartInputStream::IMAPMessagePartInputStream(
+	const shared_ptr <IMAPMessage>& msg,
+	const shared_ptr <const messagePart>& part
+)
+	: m_message(msg),
+	  m_part(part),
+	  m_size(part->getSize()),
+	  m_position(0) {
+
+}
+
+
+bool IMAPMessagePartInputStream::eof() const {
+
+	return m_position >= m_size;
+}
+
+
+void IMAPMessagePartInputStream::reset() {
+
+	m_position = 0;
+}
+
+
+size_t IMAPMessagePartInputStream::read(byte_t* const data, const size_t count) {
+
+	if (count == 0 || m_position >= m_size) {
+		return 0;
+	}
+
+	shared_ptr <IMAPMessage> msg = m_message.lock();
+
+	if (!msg) {
+		throw exceptions::message_not_found();
+	}
+
+	const size_t n = std::min(count, m_size - m_position);
+
+	string buffer;
+	buffer.reserve(n);
+
+	utility::outputStreamStringAdapter os(buffer);
+
+	msg->extractImpl(
+		m_part, os, /* progress */ NULL, m_position, n,
+		IMAPMessage::EXTRACT_BODY | IMAPMessage::EXTRACT_PEEK
+	);
+
+	// Less data than expected: this is the end of the part
+	if (buffer.length() < n) {
+		m_size = m_position + buffer.length();
+	}
+
+	std::memcpy(data, buffer.data(), buffer.length());
+
+	m_position += buffer.length();
+
+	return buffer.length();
+}
+
+
+size_t IMAPMessagePartInputStream::skip(const size_t count) {
+
+	const size_t n = (m_position >= m_size) ? 0 : std::min(count, m_size - m_position);
+
+	m_position += n;
+
+	return n;
+}
+
+
+size_t IMAPMessagePartInputStream::getPosition() const {
+
+	return m_position;
+}
+
+
+void IMAPMessagePartInputStream::seek(const size_t pos) {
+
+	m_position = pos;
+}
+
+
+size_t IMAPMessagePartInputStream::getSize() const {
+
+	return m_size;
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
@@ -0,0 +1,102 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_IMAP_IMAPMESSAGEPARTINPUTSTREAM_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPMESSAGEPARTINPUTSTREAM_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/utility/seekableInputStream.hpp"
+
+#include "vmime/net/imap/IMAPMessage.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+/** A seekable input stream over the contents of a message part, as
+  * stored on the server (ie. not decoded). Contents are fetched on
+  * demand, in blocks, with ranged requests ("BODY.PEEK[section]<offset.length>"),
+  * so that only the data actually read is downloaded; the "\Seen" flag
+  * is not set.
+  *
+  * Blocks are kept in the part cache of the folder (see
+  * IMAPFolder::setPartCacheLimits()), which is shared with the other
+  * streams and with extractions of the part, so that reading the same
+  * data again (eg. to sniff the content type, then to display a preview,
+  * or to resume a download) does not fetch it again. Consecutive missing
+  * blocks are fetched with a single request.
+  */
+class VMIME_EXPORT IMAPMessagePartInputStream : public utility::seekableInputStream {
+
+public:
+
+	/** Construct a new stream over the contents of a message part.
+	  *
+	  * @param msg message to which the part belongs; its folder must
+	  * be open when data is read
+	  * @param part part whose contents are read (see IMAPMessage::getStructure())
+	  */
+	IMAPMessagePartInputStream(
+		const shared_ptr <IMAPMessage>& msg,
+		const shared_ptr <const messagePart>& part
+	);
+
+	bool eof() const;
+	void reset();
+	size_t read(byte_t* const data, const size_t count);
+	size_t skip(const size_t count);
+	size_t getPosition() const;
+	void seek(const size_t pos);
+
+	/** Return the size of the part contents.
+	  *
+	  * @return size of the part contents, in bytes
+	  */
+	size_t getSize() const;
+
+private:
+
+	weak_ptr <IMAPMessage> m_message;
+	shared_ptr <const messagePart> m_part;
+
+	size_t m_size;
+	size_t m_position;
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPMESSAGEPARTINPUTSTREAM_HPP_INCLUDED
@@ -56,6 +56,8 @@
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <algorithm>
+#include <cstring>
 
 
 //#define DEBUG_RESPONSE 1
@@ -70,7 +72,7 @@
   */
 #define VIMAP_PARSER_FAIL() \
 	{  \
-		parser.m_errorResponseLine = makeResponseLine(getComponentName(), line, pos);  \
+		parser.setErrorPosition(getComponentName(), line, pos);  \
 		return false;  \
 	}
 
@@ -267,7 +269,12 @@ public:
 	IMAPParser()
 		: m_progress(NULL),
 		  m_strict(false),
-		  m_literalHandler(NULL) {
+		  m_literalHandler(NULL),
+		  m_responseHandler(NULL),
+		  m_bufferLength(0),
+		  m_bufferPos(0),
+		  m_scanPos(0),
+		  m_errorPos(0) {
 
 	}
 
@@ -289,6 +296,22 @@ public:
 		m_socket = sok;
 	}
 
+	/** Remove the data which has been received from the server but
+	  * not parsed yet, and return it. This is needed when the data
+	  * which follows a response must be read differently (eg. when
+	  * compression starts after the response to COMPRESS).
+	  *
+	  * @return data received but not parsed yet
+	  */
+	string extractBufferedData() {
+
+		string data(m_buffer, m_bufferPos, m_bufferLength - m_bufferPos);
+
+		m_bufferLength = m_bufferPos = m_scanPos = 0;
+
+		return data;
+	}
+
 	/** Set the timeout handler currently used by this parser.
 	  *
 	  * @param toh timeout handler
@@ -447,6 +470,174 @@ public:
 	};
 
 
+	//
+	// responseHandler : untagged response data handler
+	//
+
+	class response_data;
+
+	class responseHandler {
+
+	public:
+
+		virtual ~responseHandler() { }
+
+
+		// Called for each untagged response data, as soon as it has been
+		// parsed (see IMAPParser::readStreamedResponse())
+		//
+		// Returns :
+		//    . true if the data has been consumed: it is freed immediately
+		//    . false to keep the data in the response
+
+		virtual bool handleResponseData(const response_data& data) = 0;
+	};
+
+
+	//
+	// Memory arena for the components of a response
+	//
+
+	/** Allocates memory from large blocks, which are all released at
+	  * once when the arena is destroyed. All the components of a
+	  * response are allocated from an arena owned by the response.
+	  *
+	  * Only memory is released in bulk: components hold strings and
+	  * child components, so the destructor of each component of a
+	  * response still runs when the response is deleted.
+	  */
+	class arena {
+
+	public:
+
+		/** A position in the arena, as returned by getPosition().
+		  */
+		struct position {
+
+			position() : blockCount(0), current(NULL), offset(BLOCK_SIZE) { }
+
+			size_t blockCount;
+			byte_t* current;
+			size_t offset;
+		};
+
+
+		arena()
+			: m_current(NULL),
+			  m_offset(BLOCK_SIZE),
+			  m_allocationCount(0) {
+
+		}
+
+		~arena() {
+
+			for (std::vector <void*>::iterator it = m_blocks.begin() ; it != m_blocks.end() ; ++it) {
+				::operator delete(*it);
+			}
+		}
+
+		/** Allocate memory from the arena. Memory is released when
+		  * the arena is destroyed.
+		  *
+		  * @param size number of bytes to allocate
+		  * @return pointer to allocated memory
+		  */
+		void* allocate(const size_t size) {
+
+			const size_t alignedSize = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+			++m_allocationCount;
+
+			if (alignedSize > BLOCK_SIZE - m_offset) {
+
+				// Large allocations get a block of their own
+				if (alignedSize > BLOCK_SIZE / 4) {
+
+					void* block = ::operator new(alignedSize);
+					m_blocks.push_back(block);
+
+					return block;
+				}
+
+				m_current = static_cast <byte_t*>(::operator new(BLOCK_SIZE));
+				m_blocks.push_back(m_current);
+
+				m_offset = 0;
+			}
+
+			void* ptr = m_current + m_offset;
+			m_offset += alignedSize;
+
+			return ptr;
+		}
+
+		/** Return the current allocation position.
+		  *
+		  * @return current position
+		  */
+		const position getPosition() const {
+
+			position pos;
+			pos.blockCount = m_blocks.size();
+			pos.current = m_current;
+			pos.offset = m_offset;
+
+			return pos;
+		}
+
+		/** Release the memory allocated since the specified position.
+		  * All the objects allocated since then must have been destroyed.
+		  *
+		  * @param pos position returned by getPosition()
+		  */
+		void rewind(const position& pos) {
+
+			while (m_blocks.size() > pos.blockCount) {
+
+				::operator delete(m_blocks.back());
+				m_blocks.pop_back();
+			}
+
+			m_current = pos.current;
+			m_offset = pos.offset;
+		}
+
+		/** Return the number of blocks currently allocated on the heap.
+		  *
+		  * @return number of blocks
+		  */
+		size_t getBlockCount() const {
+
+			return m_blocks.size();
+		}
+
+		/** Return the number of allocations served by this arena since
+		  * it was created, including those released by rewind().
+		  *
+		  * @return number of allocations
+		  */
+		size_t getAllocationCount() const {
+
+			return m_allocationCount;
+		}
+
+	private:
+
+		arena(const arena&);
+		arena& operator=(const arena&);
+
+		static const size_t BLOCK_SIZE = 32768;
+		static const size_t ALIGNMENT = 16;
+
+		std::vector <void*> m_blocks;
+
+		byte_t* m_current;
+		size_t m_offset;
+
+		size_t m_allocationCount;
+	};
+
+
 	//
 	// Base class for a terminal or a non-terminal
 	//
@@ -458,6 +649,33 @@ public:
 		component() { }
 		virtual ~component() { }
 
+
+		// Components are either allocated on the heap or in an arena.
+		// A header before each component tells which, so that the
+		// memory of components in an arena is released with the arena.
+
+		static void* operator new(const size_t size) {
+
+			return allocate(size, NULL);
+		}
+
+		static void* operator new(const size_t size, arena& a) {
+
+			return allocate(size, &a);
+		}
+
+		static void operator delete(void* ptr) {
+
+			if (ptr != NULL && getHeader(ptr)->owner == NULL) {
+				::operator delete(getHeader(ptr));
+			}
+		}
+
+		static void operator delete(void* /* ptr */, arena& /* a */) {
+
+			// Memory is released with the arena
+		}
+
 		virtual const string getComponentName() const = 0;
 
 		bool parse(IMAPParser& parser, string& line, size_t* currentPos) {
@@ -471,24 +689,31 @@ public:
 		virtual bool parseImpl(IMAPParser& parser, string& line, size_t* currentPos) = 0;
 
 
-		const string makeResponseLine(
-			const string& comp,
-			const string& line,
-			const size_t pos
-		) {
+	private:
 
-#if DEBUG_RESPONSE
-			if (pos > line.length()) {
-				std::cout << "WARNING: component::makeResponseLine(): pos > line.length()" << std::endl;
-			}
-#endif
+		union header {
+
+			arena* owner;
+			double align1;
+			vmime_uint64 align2;
+			void* align3;
+			byte_t pad[16];
+		};
+
+		static void* allocate(const size_t size, arena* a) {
+
+			void* mem = (a != NULL)
+				? a->allocate(sizeof(header) + size)
+				: ::operator new(sizeof(header) + size);
+
+			static_cast <header*>(mem)->owner = a;
+
+			return static_cast <header*>(mem) + 1;
+		}
 
-			string result(line.substr(0, pos));
-			result += "[^]";   // indicates current parser position
-			result += line.substr(pos, line.length());
-			if (!comp.empty()) result += " [" + comp + "]";
+		static header* getHeader(void* ptr) {
 
-			return (result);
+			return static_cast <header*>(ptr) - 1;
 		}
 	};
 
@@ -1055,6 +1280,11 @@ public:
 	//                     ;; Number represents the number of CHAR8 octets
 	// CHAR8           ::= <any 8-bit octet except NUL, 0x01 - 0xff>
 	//
+	// IMAP4 Binary Content Extension (RFC-3516):
+	//
+	//   literal8      ::= "~{" number "}" CRLF *OCTET
+	//                     ;; Number represents the number of OCTETs
+	//
 
 	DECLARE_COMPONENT(xstring)
 
@@ -1129,7 +1359,10 @@ public:
 					DEBUG_FOUND("string[quoted]", "<length=" << value.length() << ", value='" << value << "'>");
 
 				// literal ::= "{" number "}" CRLF *CHAR8
-				} else if (VIMAP_PARSER_TRY_CHECK(one_char <'{'>)) {
+				// literal8 ::= "~{" number "}" CRLF *OCTET
+				} else if (VIMAP_PARSER_TRY_CHECK(one_char <'{'>) ||
+				           (VIMAP_PARSER_TRY_CHECK(one_char <'~'>) &&
+				            VIMAP_PARSER_TRY_CHECK(one_char <'{'>))) {
 
 					shared_ptr <number> num;
 					VIMAP_PARSER_GET(number, num);
@@ -2270,6 +2503,89 @@ public:
 	};
 
 
+	//
+	// IMAP ENABLE Extension (RFC-5161):
+	//
+	//   enable-data   = "ENABLED" *(SP capability)
+	//
+
+	DECLARE_COMPONENT(enable_data)
+
+		bool parseImpl(IMAPParser& parser, string& line, size_t* currentPos) {
+
+			size_t pos = *currentPos;
+
+			VIMAP_PARSER_CHECK_WITHARG(special_atom, "enabled");
+
+			while (VIMAP_PARSER_TRY_CHECK(SPACE)) {
+
+				std::unique_ptr <capability> cap;
+
+				if (parser.isStrict()) {
+					VIMAP_PARSER_GET(capability, cap);
+				} else {
+					VIMAP_PARSER_TRY_GET(capability, cap);  // allow SPACE at end of line
+				}
+
+				if (!cap) {
+					break;
+				}
+
+				capabilities.push_back(std::move(cap));
+			}
+
+			*currentPos = pos;
+
+			return true;
+		}
+
+
+		std::vector <std::unique_ptr <capability>> capabilities;
+	};
+
+
+	//
+	// IMAP Extensions for Quick Mailbox Resynchronization (RFC-7162):
+	//
+	//   expunged-resp = "VANISHED" [SP "(EARLIER)"] SP known-uids
+	//
+
+	DECLARE_COMPONENT(expunged_resp)
+
+		expunged_resp()
+			: earlier(false) {
+
+		}
+
+		bool parseImpl(IMAPParser& parser, string& line, size_t* currentPos) {
+
+			size_t pos = *currentPos;
+
+			VIMAP_PARSER_CHECK_WITHARG(special_atom, "vanished");
+			VIMAP_PARSER_CHECK(SPACE);
+
+			if (VIMAP_PARSER_TRY_CHECK(one_char <'('> )) {
+
+				VIMAP_PARSER_CHECK_WITHARG(special_atom, "earlier");
+				VIMAP_PARSER_CHECK(one_char <')'> );
+				VIMAP_PARSER_CHECK(SPACE);
+
+				earlier = true;
+			}
+
+			VIMAP_PARSER_GET(IMAPParser::uid_set, uid_set);
+
+			*currentPos = pos;
+
+			return true;
+		}
+
+
+		bool earlier;
+		std::unique_ptr <IMAPParser::uid_set> uid_set;
+	};
+
+
 	//
 	// date_day_fixed  ::= (SPACE digit) / 2digit
 	//                    ;; Fixed-format version of date_day
@@ -3531,6 +3847,14 @@ public:
 	// IMAP Extension for Conditional STORE (RFC-4551):
 	//
 	//   msg_att_item      /= "MODSEQ" SP "(" mod_sequence_value ")"
+	//
+	// IMAP4 Binary Content Extension (RFC-3516):
+	//
+	//   msg_att_item      /= "BINARY" section_binary ["<" number ">"] SP
+	//                        (nstring / literal8) /
+	//                        "BINARY.SIZE" section_binary SP number
+	//
+	//   section_binary    ::= "[" [section_part] "]"
 
 	DECLARE_COMPONENT(msg_att_item)
 
@@ -3641,6 +3965,33 @@ public:
 					VIMAP_PARSER_GET(IMAPParser::body, body);
 				}
 
+			// "BINARY.SIZE" section_binary SP number
+			} else if (VIMAP_PARSER_TRY_CHECK_WITHARG(special_atom, "binary.size")) {
+
+				type = BINARY_SIZE;
+
+				VIMAP_PARSER_GET(IMAPParser::section, section);
+				VIMAP_PARSER_CHECK(SPACE);
+				VIMAP_PARSER_GET(IMAPParser::number, number);
+
+			// "BINARY" section_binary ["<" number ">"] SP (nstring / literal8)
+			} else if (VIMAP_PARSER_TRY_CHECK_WITHARG(special_atom, "binary")) {
+
+				type = BINARY_SECTION;
+
+				VIMAP_PARSER_GET(IMAPParser::section, section);
+
+				if (VIMAP_PARSER_TRY_CHECK(one_char <'<'> )) {
+					VIMAP_PARSER_GET(IMAPParser::number, number);
+					VIMAP_PARSER_CHECK(one_char <'>'> );
+				}
+
+				VIMAP_PARSER_CHECK(SPACE);
+
+				nstring.reset(parser.getWithArgs <IMAPParser::nstring>(line, &pos, this, BINARY_SECTION));
+
+				VIMAP_PARSER_FAIL_UNLESS(nstring);
+
 			// "MODSEQ" SP "(" mod_sequence_value ")"
 			} else if (VIMAP_PARSER_TRY_CHECK_WITHARG(special_atom, "modseq")) {
 
@@ -3681,6 +4032,8 @@ public:
 			BODY,
 			BODY_SECTION,
 			BODY_STRUCTURE,
+			BINARY_SECTION,
+			BINARY_SIZE,
 			UID,
 			MODSEQ
 		};
@@ -4323,6 +4676,14 @@ public:
 	// response_data  ::= "*" SPACE (resp_cond_state / resp_cond_bye /
 	//                    mailbox_data / message_data / capability_data) CRLF
 	//
+	// IMAP ENABLE Extension (RFC-5161):
+	//
+	//   response-data =/ "*" SP enable-data CRLF
+	//
+	// IMAP Extensions for Quick Mailbox Resynchronization (RFC-7162):
+	//
+	//   message-data  =/ expunged-resp
+	//
 
 	DECLARE_COMPONENT(response_data)
 
@@ -4337,7 +4698,11 @@ public:
 				if (!VIMAP_PARSER_TRY_GET(IMAPParser::resp_cond_bye, resp_cond_bye)) {
 					if (!VIMAP_PARSER_TRY_GET(IMAPParser::mailbox_data, mailbox_data)) {
 						if (!VIMAP_PARSER_TRY_GET(IMAPParser::message_data, message_data)) {
-							VIMAP_PARSER_GET(IMAPParser::capability_data, capability_data);
+							if (!VIMAP_PARSER_TRY_GET(IMAPParser::expunged_resp, expunged_resp)) {
+								if (!VIMAP_PARSER_TRY_GET(IMAPParser::enable_data, enable_data)) {
+									VIMAP_PARSER_GET(IMAPParser::capability_data, capability_data);
+								}
+							}
 						}
 					}
 				}
@@ -4363,6 +4728,8 @@ public:
 		std::unique_ptr <IMAPParser::resp_cond_bye> resp_cond_bye;
 		std::unique_ptr <IMAPParser::mailbox_data> mailbox_data;
 		std::unique_ptr <IMAPParser::message_data> message_data;
+		std::unique_ptr <IMAPParser::expunged_resp> expunged_resp;
+		std::unique_ptr <IMAPParser::enable_data> enable_data;
 		std::unique_ptr <IMAPParser::capability_data> capability_data;
 	};
 
@@ -4490,6 +4857,33 @@ public:
 
 	DECLARE_COMPONENT(response)
 
+		/** Set the arena from which the components of this response
+		  * are allocated. The response keeps the arena alive.
+		  *
+		  * @param a arena owning the components of this response
+		  */
+		void setArena(const shared_ptr <arena>& a) {
+
+			m_arena = a;
+		}
+
+		/** Return the arena from which the components of this
+		  * response are allocated.
+		  *
+		  * @return arena owning the components of this response
+		  */
+		const shared_ptr <arena>& getArena() const {
+
+			return m_arena;
+		}
+
+	private:
+
+		// Declared first, so that it is destroyed after the components
+		shared_ptr <arena> m_arena;
+
+	public:
+
 		bool parseImpl(IMAPParser& parser, string& line, size_t* currentPos) {
 
 			size_t pos = *currentPos;
@@ -4498,20 +4892,39 @@ public:
 
 			IMAPParser::continue_req_or_response_data* resp = NULL;
 
-			while ((resp = parser.get <IMAPParser::continue_req_or_response_data>(curLine, &pos))) {
+			while (true) {
 
-				continue_req_or_response_data.push_back(
-					std::move(
-						std::unique_ptr <IMAPParser::continue_req_or_response_data>(resp)
-					)
-				);
+				const arena::position mark =
+					parser.m_arena ? parser.m_arena->getPosition() : arena::position();
 
-				// Partial response (continue_req)
-				if (resp->continue_req) {
-					partial = true;
+				if (!(resp = parser.get <IMAPParser::continue_req_or_response_data>(curLine, &pos))) {
 					break;
 				}
 
+				std::unique_ptr <IMAPParser::continue_req_or_response_data> respPtr(resp);
+
+				// In streaming mode, data consumed by the handler is freed
+				// immediately, and its memory is reused for the next data
+				if (resp->response_data && parser.m_responseHandler &&
+				    parser.m_responseHandler->handleResponseData(*resp->response_data)) {
+
+					respPtr.reset();
+
+					if (parser.m_arena) {
+						parser.m_arena->rewind(mark);
+					}
+
+				} else {
+
+					continue_req_or_response_data.push_back(std::move(respPtr));
+
+					// Partial response (continue_req)
+					if (resp->continue_req) {
+						partial = true;
+						break;
+					}
+				}
+
 				// We have read a CRLF, read another line
 				curLine = parser.readLine();
 				pos = 0;
@@ -4617,6 +5030,28 @@ public:
 
 	response* readResponse(const IMAPTag& tag, literalHandler* lh = NULL) {
 
+		return readStreamedResponse(tag, NULL, lh);
+	}
+
+	/** Read a response, handing each untagged response data to the
+	  * specified handler as soon as it has been parsed. Data consumed
+	  * by the handler is freed immediately and does not appear in the
+	  * returned response, so that the memory used to read a response
+	  * does not depend on the number of untagged data it contains.
+	  *
+	  * Untagged responses are not related to a specific command, so
+	  * the handler may also receive data for pipelined commands whose
+	  * response is read at the same time. An exception thrown by the
+	  * handler interrupts the reading of the response.
+	  *
+	  * @param tag tag of the command whose response is expected
+	  * @param handler handler for untagged response data, or NULL
+	  * to keep all data in the response
+	  * @param lh literal handler, or NULL
+	  * @return response
+	  */
+	response* readStreamedResponse(const IMAPTag& tag, responseHandler* handler, literalHandler* lh = NULL) {
+
 		while (true) {
 
 			auto it = m_pendingResponses.find(std::string(tag));
@@ -4630,12 +5065,35 @@ public:
 			size_t pos = 0;
 			string line = readLine();
 
+			// All the components of the response are allocated from
+			// an arena owned by the response, and released with it
+			response* resp = new response;
+			resp->setArena(make_shared <arena>());
+
 			m_literalHandler = lh;
-			response* resp = get <response>(line, &pos);
+			m_responseHandler = handler;
+			m_arena = resp->getArena();
+
+			try {
+
+				resp = internalGet <response>(resp, line, &pos);
+
+			} catch (...) {
+
+				m_literalHandler = NULL;
+				m_responseHandler = NULL;
+				m_arena.reset();
+
+				delete resp;
+				throw;
+			}
+
 			m_literalHandler = NULL;
+			m_responseHandler = NULL;
+			m_arena.reset();
 
 			if (!resp) {
-				throw exceptions::invalid_response("", m_errorResponseLine);
+				throw exceptions::invalid_response("", makeErrorResponseLine());
 			}
 
 			resp->setErrorLog(lastLine());
@@ -4665,6 +5123,180 @@ public:
 	}
 
 
+	/** Read the next part of a response: either one untagged response
+	  * data, which is handed to the handler (or kept in the response if
+	  * the handler does not consume it), or the final tagged response.
+	  * Unlike readStreamedResponse(), only one part is read, so that the
+	  * responses received on several connections can be read in turn by
+	  * a single thread (see isLineAvailable()).
+	  *
+	  * @param tag tag of the command whose response is expected
+	  * @param handler handler for untagged response data, or NULL
+	  * @param resp response being read; it is created on the first call,
+	  * and must be passed again until the response is complete
+	  * @return true if the response is complete, false otherwise
+	  */
+	bool readResponsePart(const IMAPTag& tag, responseHandler* handler, scoped_ptr <response>& resp) {
+
+		if (!resp) {
+
+			auto it = m_pendingResponses.find(std::string(tag));
+
+			if (it != m_pendingResponses.end()) {
+
+				resp.reset(it->second);
+				m_pendingResponses.erase(it);
+
+				return true;
+			}
+
+			resp.reset(new response);
+			resp->setArena(make_shared <arena>());
+		}
+
+		size_t pos = 0;
+		string line = readLine();
+
+		m_arena = resp->getArena();
+
+		const arena::position mark = m_arena->getPosition();
+
+		continue_req_or_response_data* data = NULL;
+		response_done* done = NULL;
+
+		try {
+
+			if (!(data = get <continue_req_or_response_data>(line, &pos))) {
+				done = get <response_done>(line, &pos);
+			}
+
+		} catch (...) {
+
+			m_arena.reset();
+			throw;
+		}
+
+		m_arena.reset();
+
+		if (data) {
+
+			std::unique_ptr <continue_req_or_response_data> dataPtr(data);
+
+			// Data consumed by the handler is freed immediately
+			if (data->response_data && handler &&
+			    handler->handleResponseData(*data->response_data)) {
+
+				dataPtr.reset();
+				resp->getArena()->rewind(mark);
+
+			} else {
+
+				resp->continue_req_or_response_data.push_back(std::move(dataPtr));
+			}
+
+			return false;
+		}
+
+		if (!done) {
+			throw exceptions::invalid_response("", makeErrorResponseLine());
+		}
+
+		resp->response_done.reset(done);
+		resp->setErrorLog(lastLine());
+
+		// Not our response tag, cache it for later
+		if (done->response_tagged && done->response_tagged->tag &&
+		    !(tag == done->response_tagged->tag->tagString)) {
+
+			m_pendingResponses[done->response_tagged->tag->tagString] = resp.release();
+			return false;
+		}
+
+		return true;
+	}
+
+
+	/** Read a single untagged response, for example a notification
+	  * sent by the server while the connection is in IDLE state.
+	  *
+	  * @return response which contains the untagged response data,
+	  * and no response_done
+	  */
+	response* readUntaggedResponse() {
+
+		size_t pos = 0;
+		string line = readLine();
+
+		response* resp = new response;
+		resp->setArena(make_shared <arena>());
+
+		m_arena = resp->getArena();
+
+		continue_req_or_response_data* data = NULL;
+
+		try {
+
+			data = get <continue_req_or_response_data>(line, &pos);
+
+		} catch (...) {
+
+			m_arena.reset();
+
+			delete resp;
+			throw;
+		}
+
+		m_arena.reset();
+
+		if (!data) {
+
+			delete resp;
+			throw exceptions::invalid_response("", makeErrorResponseLine());
+		}
+
+		resp->continue_req_or_response_data.push_back(
+			std::unique_ptr <continue_req_or_response_data>(data)
+		);
+
+		resp->setErrorLog(lastLine());
+
+		return resp;
+	}
+
+	/** Return whether a complete line has been received, so that a
+	  * response can be read without waiting for data.
+	  *
+	  * @param receive if true, data available on the socket is
+	  * received first, without waiting; if false, only data which
+	  * has already been received is checked
+	  * @return true if a line can be read without waiting
+	  */
+	bool isLineAvailable(const bool receive = true) {
+
+		if (findLineEnd() != string::npos) {
+			return true;
+		}
+
+		if (!receive) {
+			return false;
+		}
+
+		shared_ptr <socket> sok = m_socket.lock();
+
+		if (!sok)
+			throw exceptions::illegal_state("Store disconnected");
+
+		while (sok->waitForRead(0) && receiveRaw(*sok) != 0) {
+
+			if (findLineEnd() != string::npos) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+
 	greeting* readGreeting() {
 
 		size_t pos = 0;
@@ -4673,7 +5305,7 @@ public:
 		greeting* greet = get <greeting>(line, &pos);
 
 		if (!greet) {
-			throw exceptions::invalid_response("", m_errorResponseLine);
+			throw exceptions::invalid_response("", makeErrorResponseLine());
 		}
 
 		greet->setErrorLog(lastLine());
@@ -4695,8 +5327,20 @@ public:
 	template <class TYPE>
 	TYPE* get(string& line, size_t* currentPos) {
 
-		component* resp = new TYPE;
-		return internalGet <TYPE>(resp, line, currentPos);
+		if (m_arena) {
+
+			const arena::position mark = m_arena->getPosition();
+			TYPE* resp = internalGet <TYPE>(new (*m_arena) TYPE, line, currentPos);
+
+			// Reuse the memory of a failed attempt
+			if (!resp) {
+				m_arena->rewind(mark);
+			}
+
+			return resp;
+		}
+
+		return internalGet <TYPE>(new TYPE, line, currentPos);
 	}
 
 	/** Parse a token which takes 2 arguments and advance.
@@ -4716,8 +5360,20 @@ public:
 	template <class TYPE, class ARG1_TYPE, class ARG2_TYPE>
 	TYPE* getWithArgs(string& line, size_t* currentPos, ARG1_TYPE arg1, ARG2_TYPE arg2) {
 
-		component* resp = new TYPE(arg1, arg2);
-		return internalGet <TYPE>(resp, line, currentPos);
+		if (m_arena) {
+
+			const arena::position mark = m_arena->getPosition();
+			TYPE* resp = internalGet <TYPE>(new (*m_arena) TYPE(arg1, arg2), line, currentPos);
+
+			// Reuse the memory of a failed attempt
+			if (!resp) {
+				m_arena->rewind(mark);
+			}
+
+			return resp;
+		}
+
+		return internalGet <TYPE>(new TYPE(arg1, arg2), line, currentPos);
 	}
 
 private:
@@ -4739,6 +5395,42 @@ private:
 		return static_cast <TYPE*>(resp);
 	}
 
+	/** Record the position at which the parsing of a component failed.
+	  * Failures are frequent while trying alternatives, so the error
+	  * message is only built when needed (see makeErrorResponseLine()).
+	  *
+	  * @param comp name of the component
+	  * @param line line being parsed
+	  * @param pos position of the failure in the line
+	  */
+	void setErrorPosition(const string& comp, const string& line, const size_t pos) {
+
+#if DEBUG_RESPONSE
+		if (pos > line.length()) {
+			std::cout << "WARNING: IMAPParser::setErrorPosition(): pos > line.length()" << std::endl;
+		}
+#endif
+
+		// assign() reuses the storage of the previous error
+		m_errorComponent.assign(comp);
+		m_errorLine.assign(line);
+		m_errorPos = pos;
+	}
+
+	/** Build the error message for the last parsing error.
+	  *
+	  * @return response line, with the position of the error
+	  */
+	const string makeErrorResponseLine() const {
+
+		string result(m_errorLine.substr(0, m_errorPos));
+		result += "[^]";   // indicates current parser position
+		result += m_errorLine.substr(m_errorPos, m_errorLine.length());
+		if (!m_errorComponent.empty()) result += " [" + m_errorComponent + "]";
+
+		return (result);
+	}
+
 	const string lastLine() const {
 
 		// Remove blanks and new lines at the end of the line.
@@ -4825,14 +5517,28 @@ private:
 	bool m_strict;
 
 	literalHandler* m_literalHandler;
+	responseHandler* m_responseHandler;
+
+	shared_ptr <arena> m_arena;  // arena of the response being parsed, if any
 
 	weak_ptr <timeoutHandler> m_timeoutHandler;
 
 
+	static const size_t READ_BLOCK_SIZE = 65536;
+
+	// Input buffer: only the first m_bufferLength bytes are used; data
+	// before m_bufferPos has already been consumed, and data before
+	// m_scanPos is known not to contain a line end
 	string m_buffer;
+	size_t m_bufferLength;
+	size_t m_bufferPos;
+	size_t m_scanPos;
 
 	string m_lastLine;
-	string m_errorResponseLine;
+	// Position of the last parsing error (see setErrorPosition())
+	string m_errorComponent;
+	string m_errorLine;
+	size_t m_errorPos;
 
 	std::map <std::string, response*> m_pendingResponses;
 
@@ -4848,15 +5554,13 @@ public:
 
 		size_t pos;
 
-		while ((pos = m_buffer.find('\n')) == string::npos) {
+		while ((pos = findLineEnd()) == string::npos) {
 			read();
 		}
 
-		string line;
-		line.resize(pos + 1);
-		std::copy(m_buffer.begin(), m_buffer.begin() + pos + 1, line.begin());
+		string line(m_buffer, m_bufferPos, pos + 1 - m_bufferPos);
 
-		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + pos + 1);
+		m_bufferPos = m_scanPos = pos + 1;
 
 		m_lastLine = line;
 
@@ -4878,8 +5582,6 @@ public:
 	  */
 	void read() {
 
-		string receiveBuffer;
-
 		shared_ptr <timeoutHandler> toh = m_timeoutHandler.lock();
 		shared_ptr <socket> sok = m_socket.lock();
 
@@ -4890,7 +5592,7 @@ public:
 			toh->resetTimeOut();
 		}
 
-		while (receiveBuffer.empty()) {
+		while (true) {
 
 			// Check whether the time-out delay is elapsed
 			if (toh && toh->isTimeOut()) {
@@ -4899,10 +5601,7 @@ public:
 				}
 			}
 
-			// We have received data: reset the time-out counter
-			sok->receive(receiveBuffer);
-
-			if (receiveBuffer.empty()) {   // buffer is empty
+			if (receiveRaw(*sok) == 0) {   // no data available
 
 				if (sok->getStatus() & socket::STATUS_WANT_WRITE) {
 					sok->waitForWrite();
@@ -4913,100 +5612,100 @@ public:
 				continue;
 			}
 
-			// We have received data ...
+			// We have received data: reset the time-out counter
 			if (toh) {
 				toh->resetTimeOut();
 			}
-		}
 
-		m_buffer += receiveBuffer;
+			break;
+		}
 	}
 
+	/** Search the input buffer for the end of the next line. Only the
+	  * data received since the last search is scanned.
+	  *
+	  * @return position of the next line feed, or string::npos if
+	  * no complete line has been received
+	  */
+	size_t findLineEnd() {
 
-	void readLiteral(literalHandler::target& buffer, size_t count) {
+		const char* begin = m_buffer.data();
+		const void* lf = (m_scanPos < m_bufferLength)
+			? std::memchr(begin + m_scanPos, '\n', m_bufferLength - m_scanPos)
+			: NULL;
 
-		size_t len = 0;
-		string receiveBuffer;
+		if (lf == NULL) {
 
-		shared_ptr <timeoutHandler> toh = m_timeoutHandler.lock();
-		shared_ptr <socket> sok = m_socket.lock();
+			m_scanPos = m_bufferLength;
+			return string::npos;
+		}
 
-		if (!sok)
-			throw exceptions::illegal_state("Store disconnected");
+		return static_cast <const char*>(lf) - begin;
+	}
 
-		if (m_progress) {
-			m_progress->start(count);
-		}
+	/** Receive the data available on the socket directly at the end
+	  * of the input buffer.
+	  *
+	  * @param sok socket from which to receive data
+	  * @return number of bytes received
+	  */
+	size_t receiveRaw(socket& sok) {
 
-		if (toh) {
-			toh->resetTimeOut();
-		}
+		if (m_bufferPos == m_bufferLength) {
 
-		if (!m_buffer.empty()) {
+			m_bufferLength = m_bufferPos = m_scanPos = 0;
 
-			if (m_buffer.length() > count) {
+		} else if (m_buffer.length() - m_bufferLength < READ_BLOCK_SIZE &&
+		           m_bufferPos >= m_bufferLength - m_bufferPos) {
 
-				buffer.putData(string(m_buffer.begin(), m_buffer.begin() + count));
-				m_buffer.erase(m_buffer.begin(), m_buffer.begin() + count);
-				len = count;
+			// Discard consumed data once there is more of it than unread
+			// data, so that each byte is moved at most once on average
+			std::memmove(&m_buffer[0], &m_buffer[m_bufferPos], m_bufferLength - m_bufferPos);
 
-			} else {
+			m_bufferLength -= m_bufferPos;
+			m_scanPos -= m_bufferPos;
+			m_bufferPos = 0;
+		}
 
-				len += m_buffer.length();
-				buffer.putData(m_buffer);
-				m_buffer.clear();
-			}
+		// Grow the buffer geometrically, so that its size only changes
+		// a logarithmic number of times
+		if (m_buffer.length() - m_bufferLength < READ_BLOCK_SIZE) {
+			m_buffer.resize(std::max(2 * m_buffer.length(), m_bufferLength + READ_BLOCK_SIZE));
 		}
 
-		while (len < count) {
+		const size_t count = sok.receiveRaw(
+			reinterpret_cast <byte_t*>(&m_buffer[m_bufferLength]),
+			m_buffer.length() - m_bufferLength
+		);
 
-			// Check whether the time-out delay is elapsed
-			if (toh && toh->isTimeOut()) {
+		m_bufferLength += count;
 
-				if (!toh->handleTimeOut()) {
-					throw exceptions::operation_timed_out();
-				}
+		return count;
+	}
 
-				toh->resetTimeOut();
-			}
 
-			// Receive data from the socket
-			sok->receive(receiveBuffer);
+	void readLiteral(literalHandler::target& buffer, size_t count) {
 
-			if (receiveBuffer.empty()) {  // buffer is empty
+		size_t len = 0;
 
-				if (sok->getStatus() & socket::STATUS_WANT_WRITE) {
-					sok->waitForWrite();
-				} else {
-					sok->waitForRead();
-				}
+		if (m_progress) {
+			m_progress->start(count);
+		}
 
-				continue;
-			}
+		while (len < count) {
 
-			// We have received data: reset the time-out counter
-			if (toh) {
-				toh->resetTimeOut();
+			if (m_bufferPos == m_bufferLength) {
+				read();
 			}
 
-			if (len + receiveBuffer.length() > count) {
-
-				const size_t remaining = count - len;
-
-				// Get the needed amount of data
-				buffer.putData(string(receiveBuffer.begin(), receiveBuffer.begin() + remaining));
+			// Get the needed amount of data; the remaining data
+			// stays in the input buffer
+			const size_t n = std::min(count - len, m_bufferLength - m_bufferPos);
 
-				// Put the remaining data into the internal response buffer
-				receiveBuffer.erase(receiveBuffer.begin(), receiveBuffer.begin() + remaining);
-				m_buffer += receiveBuffer;
+			buffer.putData(string(m_buffer, m_bufferPos, n));
 
-				len = count;
-
-			} else {
-
-				buffer.putData(receiveBuffer);
-				len += receiveBuffer.length();
-			}
+			m_bufferPos += n;
+			len += n;
 
 			// Notify progress
 			if (m_progress) {
@@ -5014,6 +5713,10 @@ public:
 			}
 		}
 
+		if (m_scanPos < m_bufferPos) {
+			m_scanPos = m_bufferPos;
+		}
+
 		if (m_tracer) {
 			m_tracer->traceReceiveBytes(count);
 		}
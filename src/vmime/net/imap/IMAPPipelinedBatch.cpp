@@ -0,0 +1,117 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/net/imap/IMAPPipelinedBatch.hpp"
+#include "vmime/net/imap/IMAPCommand.hpp"
+#include "vmime/net/imap/IMAPConnection.hpp"
+
+#include "vmime/exception.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+IMAPPipelinedBatch::IMAPPipelinedBatch(const shared_ptr <IMAPConnection>& conn)
+	: m_conn(conn),
+	  m_pendingCount(0) {
+
+}
+
+
+IMAPPipelinedBatch::~IMAPPipelinedBatch() {
+
+	try {
+
+		for (size_t i = 0 ; m_pendingCount != 0 && i < m_tags.size() ; ++i) {
+
+			if (!m_responseRead[i]) {
+				delete readResponse(i);
+			}
+		}
+
+	} catch (...) {
+
+		// Don't throw in destructor
+	}
+}
+
+
+size_t IMAPPipelinedBatch::send(const shared_ptr <IMAPCommand>& cmd) {
+
+	cmd->send(m_conn);
+
+	m_tags.push_back(*m_conn->getTag());
+	m_responseRead.push_back(false);
+
+	++m_pendingCount;
+
+	return m_tags.size() - 1;
+}
+
+
+IMAPParser::response* IMAPPipelinedBatch::readResponse(
+	const size_t index,
+	IMAPParser::literalHandler* lh
+) {
+
+	if (index >= m_tags.size()) {
+		throw exceptions::invalid_argument();
+	}
+
+	if (m_responseRead[index]) {
+		throw exceptions::illegal_state("Response already read");
+	}
+
+	m_responseRead[index] = true;
+	--m_pendingCount;
+
+	return m_conn->readResponse(m_tags[index], lh);
+}
+
+
+size_t IMAPPipelinedBatch::getCommandCount() const {
+
+	return m_tags.size();
+}
+
+
+size_t IMAPPipelinedBatch::getPendingCount() const {
+
+	return m_pendingCount;
+}
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
@@ -0,0 +1,140 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_NET_IMAP_IMAPPIPELINEDBATCH_HPP_INCLUDED
+#define VMIME_NET_IMAP_IMAPPIPELINEDBATCH_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+
+#include "vmime/object.hpp"
+#include "vmime/base.hpp"
+
+#include "vmime/net/imap/IMAPParser.hpp"
+#include "vmime/net/imap/IMAPTag.hpp"
+
+
+namespace vmime {
+namespace net {
+namespace imap {
+
+
+class IMAPConnection;
+class IMAPCommand;
+
+
+/** A batch of commands sent to the server before any response is read
+  * (pipelining), so that the batch costs a single round-trip.
+  *
+  * Commands are sent as soon as they are added to the batch. Their
+  * tagged responses can then be read in any order: responses to other
+  * commands received in the meantime are kept by the parser until
+  * they are requested.
+  *
+  * Untagged data is not routed to the command which caused it: it is
+  * returned with the response of the first command that completes
+  * after it was received. A batch is therefore only suitable for
+  * commands whose untagged responses identify what they relate to (eg.
+  * FETCH responses carry the message number, STATUS responses carry
+  * the mailbox name), so that the caller can dispatch them itself.
+  *
+  * Commands which require a continuation from the server (eg. commands
+  * with synchronizing literals or AUTHENTICATE) must not be sent through
+  * a batch.
+  */
+class VMIME_EXPORT IMAPPipelinedBatch : public object {
+
+public:
+
+	/** Construct a new, empty batch for sending commands on the
+	  * specified connection.
+	  *
+	  * @param conn connection onto which commands will be sent
+	  */
+	IMAPPipelinedBatch(const shared_ptr <IMAPConnection>& conn);
+
+	/** Read and discard the responses to the commands which have not
+	  * been read yet, to keep the connection in a consistent state.
+	  */
+	~IMAPPipelinedBatch();
+
+	/** Send the specified command, without waiting for its response.
+	  *
+	  * @param cmd command to send
+	  * @return index of the command in the batch, to be passed to
+	  * readResponse()
+	  */
+	size_t send(const shared_ptr <IMAPCommand>& cmd);
+
+	/** Read the response to the specified command. The response to
+	  * each command can only be read once.
+	  *
+	  * When a literal handler is used, responses should be read in the
+	  * order in which the commands have been sent: literals received
+	  * while waiting for a response are passed to the handler of the
+	  * response being read.
+	  *
+	  * @param index index of the command, as returned by send()
+	  * @param lh literal handler, or NULL to receive literals as strings
+	  * @return parsed response; the caller is responsible for deleting it
+	  * @throw exceptions::invalid_argument if the index is invalid
+	  * @throw exceptions::illegal_state if the response has already been read
+	  */
+	IMAPParser::response* readResponse(const size_t index, IMAPParser::literalHandler* lh = NULL);
+
+	/** Return the number of commands sent through this batch.
+	  *
+	  * @return number of commands
+	  */
+	size_t getCommandCount() const;
+
+	/** Return the number of commands for which the response has not
+	  * been read yet.
+	  *
+	  * @return number of pending responses
+	  */
+	size_t getPendingCount() const;
+
+private:
+
+	shared_ptr <IMAPConnection> m_conn;
+
+	std::vector <IMAPTag> m_tags;
+	std::vector <bool> m_responseRead;
+
+	size_t m_pendingCount;
+};
+
+
+} // imap
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_IMAP
+
+#endif // VMIME_NET_IMAP_IMAPPIPELINEDBATCH_HPP_INCLUDED
@@ -59,6 +59,10 @@ const IMAPServiceInfos::props& IMAPServiceInfos::getProperties() const {
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_ZLIB_SUPPORT
+		property("options.compress", serviceInfos::property::TYPE_BOOLEAN, "true"),
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+		property("options.connection-pool-size", serviceInfos::property::TYPE_INTEGER, "0"),
 
 		// Common properties
 		property(serviceInfos::property::AUTH_USERNAME, serviceInfos::property::FLAG_REQUIRED),
@@ -79,6 +83,10 @@ const IMAPServiceInfos::props& IMAPServiceInfos::getProperties() const {
 		property("options.sasl", serviceInfos::property::TYPE_BOOLEAN, "true"),
 		property("options.sasl.fallback", serviceInfos::property::TYPE_BOOLEAN, "true"),
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_ZLIB_SUPPORT
+		property("options.compress", serviceInfos::property::TYPE_BOOLEAN, "true"),
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+		property("options.connection-pool-size", serviceInfos::property::TYPE_INTEGER, "0"),
 
 		// Common properties
 		property(serviceInfos::property::AUTH_USERNAME, serviceInfos::property::FLAG_REQUIRED),
@@ -107,6 +115,10 @@ const std::vector <serviceInfos::property> IMAPServiceInfos::getAvailablePropert
 	list.push_back(p.PROPERTY_OPTIONS_SASL);
 	list.push_back(p.PROPERTY_OPTIONS_SASL_FALLBACK);
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_ZLIB_SUPPORT
+	list.push_back(p.PROPERTY_OPTIONS_COMPRESS);
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+	list.push_back(p.PROPERTY_OPTIONS_CONNECTION_POOL_SIZE);
 
 	// Common properties
 	list.push_back(p.PROPERTY_AUTH_USERNAME);
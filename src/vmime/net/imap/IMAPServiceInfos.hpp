@@ -53,6 +53,10 @@ public:
 		serviceInfos::property PROPERTY_OPTIONS_SASL;
 		serviceInfos::property PROPERTY_OPTIONS_SASL_FALLBACK;
 #endif // VMIME_HAVE_SASL_SUPPORT
+#if VMIME_HAVE_ZLIB_SUPPORT
+		serviceInfos::property PROPERTY_OPTIONS_COMPRESS;
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+		serviceInfos::property PROPERTY_OPTIONS_CONNECTION_POOL_SIZE;
 
 		// Common properties
 		serviceInfos::property PROPERTY_AUTH_USERNAME;
@@ -32,10 +32,13 @@
 #include "vmime/net/imap/IMAPConnection.hpp"
 #include "vmime/net/imap/IMAPFolderStatus.hpp"
 #include "vmime/net/imap/IMAPCommand.hpp"
+#include "vmime/net/imap/IMAPServiceInfos.hpp"
 
 #include "vmime/exception.hpp"
 #include "vmime/platform.hpp"
 
+#include "vmime/utility/sync/autoLock.hpp"
+
 #include <map>
 
 
@@ -51,6 +54,7 @@ IMAPStore::IMAPStore(
 )
 	: store(sess, getInfosInstance(), auth),
 	  m_connection(null),
+	  m_idleConnectionsLock(platform::getHandler()->createCriticalSection()),
 	  m_isIMAPS(secured) {
 
 }
@@ -189,6 +193,22 @@ void IMAPStore::disconnect() {
 
 	m_folders.clear();
 
+	std::vector <shared_ptr <IMAPConnection> > idleConnections;
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_idleConnectionsLock);
+		idleConnections.swap(m_idleConnections);
+	}
+
+	for (size_t i = 0, n = idleConnections.size() ; i < n ; ++i) {
+
+		try {
+			idleConnections[i]->disconnect();
+		} catch (exceptions::socket_exception&) {
+			// Ignore
+		}
+	}
+
 	if (m_connection) {
 		m_connection->disconnect();
 		m_connection = null;
@@ -233,6 +253,73 @@ shared_ptr <IMAPConnection> IMAPStore::connection() {
 }
 
 
+size_t IMAPStore::getConnectionPoolSize() {
+
+	const int size = getInfos().getPropertyValue <int>(
+		getSession(),
+		dynamic_cast <const IMAPServiceInfos&>(getInfos()).getProperties().PROPERTY_OPTIONS_CONNECTION_POOL_SIZE
+	);
+
+	return size > 0 ? static_cast <size_t>(size) : 0;
+}
+
+
+size_t IMAPStore::getIdleConnectionCount() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_idleConnectionsLock);
+
+	return m_idleConnections.size();
+}
+
+
+shared_ptr <IMAPConnection> IMAPStore::acquireConnection() {
+
+	{
+		// The pool is shared by all the folders of this store
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_idleConnectionsLock);
+
+		while (!m_idleConnections.empty()) {
+
+			shared_ptr <IMAPConnection> conn = m_idleConnections.back();
+			m_idleConnections.pop_back();
+
+			// The server may have closed the connection meanwhile
+			if (conn->isConnected()) {
+				return conn;
+			}
+		}
+	}
+
+	shared_ptr <IMAPConnection> conn =
+		make_shared <IMAPConnection>(dynamicCast <IMAPStore>(shared_from_this()), getAuthenticator());
+
+	conn->connect();
+
+	return conn;
+}
+
+
+void IMAPStore::releaseConnection(const shared_ptr <IMAPConnection>& conn) {
+
+	if (conn->isConnected() && conn->state() == IMAPConnection::STATE_AUTHENTICATED) {
+
+		const size_t poolSize = getConnectionPoolSize();
+
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_idleConnectionsLock);
+
+		if (m_idleConnections.size() < poolSize) {
+
+			m_idleConnections.push_back(conn);
+			return;
+		}
+	}
+
+	if (conn->isConnected()) {
+		conn->disconnect();
+	}
+}
+
+
 void IMAPStore::registerFolder(IMAPFolder* folder) {
 
 	m_folders.push_back(folder);
@@ -38,6 +38,8 @@
 #include "vmime/net/imap/IMAPServiceInfos.hpp"
 #include "vmime/net/imap/IMAPConnection.hpp"
 
+#include "vmime/utility/sync/criticalSection.hpp"
+
 
 namespace vmime {
 namespace net {
@@ -92,6 +94,22 @@ public:
 	shared_ptr <connectionInfos> getConnectionInfos() const;
 	shared_ptr <IMAPConnection> getConnection();
 
+	/** Return the maximum number of idle connections kept by the store
+	  * (see "options.connection-pool-size" property). If zero, the
+	  * connections used by folders are closed as soon as they are
+	  * released, and messages are always fetched over the connection
+	  * of their folder.
+	  *
+	  * @return connection pool size
+	  */
+	size_t getConnectionPoolSize();
+
+	/** Return the number of idle connections currently in the pool.
+	  *
+	  * @return number of idle connections
+	  */
+	size_t getIdleConnectionCount() const;
+
 protected:
 
 	// Connection
@@ -101,6 +119,24 @@ protected:
 
 	shared_ptr <IMAPConnection> connection();
 
+	/** Get an authenticated connection, from the pool if one is
+	  * available. Otherwise, a new connection is opened.
+	  *
+	  * @return connection in the authenticated state
+	  */
+	shared_ptr <IMAPConnection> acquireConnection();
+
+	/** Give back a connection obtained with acquireConnection(). It is
+	  * kept in the pool if it is still in the authenticated state and
+	  * the pool is not full; otherwise, it is closed.
+	  *
+	  * @param conn connection to release
+	  */
+	void releaseConnection(const shared_ptr <IMAPConnection>& conn);
+
+	std::vector <shared_ptr <IMAPConnection> > m_idleConnections;
+	shared_ptr <utility::sync::criticalSection> m_idleConnectionsLock;
+
 
 	void registerFolder(IMAPFolder* folder);
 	void unregisterFolder(IMAPFolder* folder);
@@ -36,6 +36,13 @@
 #include <sstream>
 #include <iterator>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if VMIME_PLATFORM_IS_POSIX
+#	include <poll.h>
+#	include <errno.h>
+#endif // VMIME_PLATFORM_IS_POSIX
 
 
 namespace vmime {
@@ -407,7 +414,7 @@ void IMAPUtils::mailboxFlagsToFolderAttributes(
 
 	// If CHILDREN extension (RFC-3348) is not supported, assume folder has children
 	// as we have no hint about it
-	if (!cnt->hasCapability("CHILDREN")) {
+	if (!cnt->hasCapability(IMAPConnection::CAPABILITY_CHILDREN)) {
 		flags |= folderAttributes::FLAG_HAS_CHILDREN;
 	}
 
@@ -631,6 +638,39 @@ const string IMAPUtils::dateTime(const vmime::datetime& date) {
 }
 
 
+// static
+const string IMAPUtils::appendArguments(
+	const std::vector <string>& flags,
+	const vmime::datetime* date,
+	const size_t size,
+	const bool nonSynchronizing
+) {
+
+	std::ostringstream res;
+	res.imbue(std::locale::classic());
+
+	if (!flags.empty()) {
+
+		res << "(";
+
+		for (size_t i = 0, n = flags.size() ; i < n ; ++i) {
+			if (i != 0) res << " ";
+			res << flags[i];
+		}
+
+		res << ") ";
+	}
+
+	if (date != NULL) {
+		res << dateTime(*date) << " ";
+	}
+
+	res << "{" << size << (nonSynchronizing ? "+}" : "}");
+
+	return res.str();
+}
+
+
 // static
 shared_ptr <IMAPCommand> IMAPUtils::buildFetchCommand(
 	const shared_ptr <IMAPConnection>& cnt,
@@ -655,7 +695,7 @@ shared_ptr <IMAPCommand> IMAPUtils::buildFetchCommand(
 		items.push_back("FLAGS");
 	}
 
-	if (options.has(fetchAttributes::STRUCTURE)) {
+	if (options.has(fetchAttributes::STRUCTURE) || options.has(fetchAttributes::PART_HEADERS)) {
 		items.push_back("BODYSTRUCTURE");
 	}
 
@@ -664,7 +704,7 @@ shared_ptr <IMAPCommand> IMAPUtils::buildFetchCommand(
 		items.push_back("UID");
 
 		// Also fetch MODSEQ if CONDSTORE is supported
-		if (cnt && cnt->hasCapability("CONDSTORE") && !cnt->isMODSEQDisabled()) {
+		if (cnt && cnt->hasCapability(IMAPConnection::CAPABILITY_CONDSTORE) && !cnt->isMODSEQDisabled()) {
 			items.push_back("MODSEQ");
 		}
 	}
@@ -720,6 +760,34 @@ shared_ptr <IMAPCommand> IMAPUtils::buildFetchCommand(
 }
 
 
+// static
+shared_ptr <IMAPCommand> IMAPUtils::buildFetchPartHeadersCommand(
+	const messageSet& msgs,
+	const std::vector <string>& sections
+) {
+
+	// Example:
+	//   C: A655 FETCH 2:3 (BODY.PEEK[HEADER] BODY.PEEK[1.MIME] BODY.PEEK[2.MIME])
+	//   S: * 2 FETCH (BODY[HEADER] {342}
+	//   S: ...
+	//   S: A655 OK FETCH completed
+
+	std::vector <string> items;
+	items.reserve(sections.size());
+
+	for (std::vector <string>::const_iterator it = sections.begin() ; it != sections.end() ; ++it) {
+
+		if (it->empty()) {
+			items.push_back("BODY.PEEK[HEADER]");
+		} else {
+			items.push_back("BODY.PEEK[" + *it + ".MIME]");   // "MIME" not "HEADER" for parts
+		}
+	}
+
+	return IMAPCommand::FETCH(msgs, items);
+}
+
+
 // static
 void IMAPUtils::convertAddressList(
 	const IMAPParser::address_list& src,
@@ -866,6 +934,91 @@ messageSet IMAPUtils::buildMessageSet(const IMAPParser::uid_set& uidSetRef) {
 }
 
 
+// static
+bool IMAPUtils::waitForData(
+	dataAvailabilityChecker& checker,
+	const size_t count,
+	const int msecs,
+	std::vector <bool>& ready
+) {
+
+	ready.assign(count, false);
+
+	if (count == 0) {
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(msecs));
+		return false;
+	}
+
+#if VMIME_PLATFORM_IS_POSIX
+
+	std::vector <pollfd> fds(count);
+	bool haveDescriptors = true;
+	bool any = false;
+
+	for (size_t i = 0 ; i < count ; ++i) {
+
+		ready[i] = checker.isDataAvailable(i, &fds[i].fd);
+		any = any || ready[i];
+
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+
+		haveDescriptors = haveDescriptors && (fds[i].fd >= 0);
+	}
+
+	if (any) {
+		return true;
+	}
+
+	if (haveDescriptors) {
+
+		const int ret = ::poll(&fds[0], fds.size(), msecs);
+
+		if (ret < 0) {
+
+			if (errno != EINTR) {
+				throw exceptions::socket_exception("poll() failed");
+			}
+
+			return false;
+		}
+
+		for (size_t i = 0 ; i < fds.size() ; ++i) {
+
+			// Errors are reported when reading from the connection
+			ready[i] = (fds[i].revents != 0);
+		}
+
+		return ret > 0;
+	}
+
+#endif // VMIME_PLATFORM_IS_POSIX
+
+	// Descriptors are not available: check each connection in turn
+	const int step = 10;
+
+	for (int remaining = msecs ; ; remaining -= step) {
+
+		bool any = false;
+
+		for (size_t i = 0 ; i < count ; ++i) {
+
+			ready[i] = checker.isDataAvailable(i, NULL);
+			any = any || ready[i];
+		}
+
+		if (any) {
+			return true;
+		} else if (remaining <= 0) {
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(remaining, step)));
+	}
+}
+
+
 } // imap
 } // net
 } // vmime
@@ -99,6 +99,24 @@ public:
 	  */
 	static const string dateTime(const vmime::datetime& date);
 
+	/** Format the arguments of a message to append with the APPEND
+	  * command: flag list, date/time and literal size. With MULTIAPPEND
+	  * (RFC-3502), this is repeated for each message.
+	  *
+	  * @param flags message flags (may be empty)
+	  * @param date date/time of the message, or NULL
+	  * @param size size of the message data, in bytes
+	  * @param nonSynchronizing if true, a non-synchronizing literal
+	  * is announced ("{size+}", RFC-7888)
+	  * @return formatted arguments, eg. "(\Seen) {1234}"
+	  */
+	static const string appendArguments(
+		const std::vector <string>& flags,
+		const vmime::datetime* date,
+		const size_t size,
+		const bool nonSynchronizing
+	);
+
 	/** Construct a fetch request for the specified messages, designated
 	  * either by their sequence numbers or their UIDs.
 	  *
@@ -113,6 +131,21 @@ public:
 		const fetchAttributes& options
 	);
 
+	/** Construct a fetch request for the header of one or more body
+	  * parts of the specified messages. The same sections are fetched
+	  * for every message in the set.
+	  *
+	  * @param msgs message set
+	  * @param sections part section specifiers, without the trailing
+	  * ".MIME" (eg. "1.2"); an empty specifier designates the header
+	  * of the message itself
+	  * @return fetch request
+	  */
+	static shared_ptr <IMAPCommand> buildFetchPartHeadersCommand(
+		const messageSet& msgs,
+		const std::vector <string>& sections
+	);
+
 	/** Convert a parser-style address list to a mailbox list.
 	  *
 	  * @param src input address list
@@ -134,6 +167,48 @@ public:
 	  */
 	static messageSet buildMessageSet(const IMAPParser::uid_set& uidSet);
 
+	/** Tells whether data can be read on each of several connections,
+	  * for waitForData().
+	  */
+	class dataAvailabilityChecker {
+
+	public:
+
+		virtual ~dataAvailabilityChecker() { }
+
+		/** Check whether data can be read without waiting on the
+		  * specified connection. Data may already be buffered inside
+		  * the socket (eg. decrypted TLS records, or inflated data),
+		  * which poll() would not notice.
+		  *
+		  * @param index index of the connection
+		  * @param descriptor if not NULL, receives the descriptor of the
+		  * socket, or -1 if it is not available
+		  * @return true if data is available, false otherwise
+		  */
+		virtual bool isDataAvailable(const size_t index, int* descriptor) = 0;
+	};
+
+	/** Wait until data can be read on at least one of several
+	  * connections. If the descriptors of all the sockets are available,
+	  * a single poll() waits on them; otherwise, the connections are
+	  * checked in turn at short intervals.
+	  *
+	  * @param checker tells whether data can be read on each connection
+	  * @param count number of connections
+	  * @param msecs maximum time to wait, in milliseconds
+	  * @param ready receives, for each connection, whether data is
+	  * available (or an error occurred on the socket)
+	  * @return true if data is available on at least one connection
+	  * @throw exceptions::socket_exception if poll() fails
+	  */
+	static bool waitForData(
+		dataAvailabilityChecker& checker,
+		const size_t count,
+		const int msecs,
+		std::vector <bool>& ready
+	);
+
 private:
 
 	static const string buildFetchRequestImpl
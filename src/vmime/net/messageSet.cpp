@@ -178,6 +178,20 @@ messageSet::messageSet(const messageSet& other)
 }
 
 
+messageSet& messageSet::operator=(const messageSet& other) {
+
+	if (this != &other) {
+
+		// Clone into a temporary set first, so that this set is left
+		// unchanged if cloning fails
+		messageSet tmp(other);
+		m_ranges.swap(tmp.m_ranges);
+	}
+
+	return *this;
+}
+
+
 messageSet::~messageSet() {
 
 	for (size_t i = 0, n = m_ranges.size() ; i < n ; ++i) {
@@ -37,6 +37,9 @@
 
 #include "vmime/net/defaultConnectionInfos.hpp"
 
+#include <algorithm>
+#include <sstream>
+
 #if VMIME_HAVE_SASL_SUPPORT
 	#include "vmime/security/sasl/SASLContext.hpp"
 #endif // VMIME_HAVE_SASL_SUPPORT
@@ -62,6 +65,29 @@ namespace net {
 namespace pop3 {
 
 
+// Names of the capabilities in POP3Connection::Capabilities
+static const char* const KNOWN_CAPABILITIES[] = {
+	"TOP",
+	"USER",
+	"SASL",
+	"RESP-CODES",
+	"LOGIN-DELAY",
+	"PIPELINING",
+	"EXPIRE",
+	"UIDL",
+	"IMPLEMENTATION",
+	"STLS",
+	"UTF8"
+};
+
+static const size_t KNOWN_CAPABILITY_COUNT = sizeof(KNOWN_CAPABILITIES) / sizeof(KNOWN_CAPABILITIES[0]);
+
+static_assert(
+	KNOWN_CAPABILITY_COUNT == POP3Connection::CAPABILITY_COUNT,
+	"KNOWN_CAPABILITIES must have an entry for each value of POP3Connection::Capabilities"
+);
+
+
 
 POP3Connection::POP3Connection(
 	const shared_ptr <POP3Store>& store,
@@ -73,6 +99,7 @@ POP3Connection::POP3Connection(
 	  m_timeoutHandler(null),
 	  m_authenticated(false),
 	  m_secured(false),
+	  m_capabilities(KNOWN_CAPABILITIES, KNOWN_CAPABILITY_COUNT),
 	  m_capabilitiesFetched(false) {
 
 	static int connectionId = 0;
@@ -223,6 +250,8 @@ void POP3Connection::internalDisconnect() {
 		m_socket = null;
 	}
 
+	m_receiveBuffer.clear();
+
 	m_timeoutHandler = null;
 
 	m_authenticated = false;
@@ -379,42 +408,17 @@ void POP3Connection::authenticateSASL() {
 		throw exceptions::authentication_error("No SASL authenticator available.");
 	}
 
-	std::vector <string> capa = getCapabilities();
+	// C: CAPA
+	// S: +OK List of capabilities follows
+	// S: LOGIN-DELAY 0
+	// S: PIPELINING
+	// S: UIDL
+	// S: ...
+	// S: SASL DIGEST-MD5 CRAM-MD5   <-----
+	// S: EXPIRE NEVER
+	// S: ...
 	std::vector <string> saslMechs;
-
-	for (unsigned int i = 0 ; i < capa.size() ; ++i) {
-
-		const string& x = capa[i];
-
-		// C: CAPA
-		// S: +OK List of capabilities follows
-		// S: LOGIN-DELAY 0
-		// S: PIPELINING
-		// S: UIDL
-		// S: ...
-		// S: SASL DIGEST-MD5 CRAM-MD5   <-----
-		// S: EXPIRE NEVER
-		// S: ...
-
-		if (x.length() > 5 &&
-		    (x[0] == 'S' || x[0] == 's') &&
-		    (x[1] == 'A' || x[1] == 'a') &&
-		    (x[2] == 'S' || x[2] == 's') &&
-		    (x[3] == 'L' || x[3] == 'l') &&
-		    (x[4] == ' ' || x[4] == '\t')) {
-
-			const string list(x.begin() + 5, x.end());
-
-			std::istringstream iss(list);
-			iss.imbue(std::locale::classic());
-
-			string mech;
-
-			while (iss >> mech) {
-				saslMechs.push_back(mech);
-			}
-		}
-	}
+	hasCapability(CAPABILITY_SASL, &saslMechs);
 
 	if (saslMechs.empty()) {
 		throw exceptions::authentication_error("No SASL mechanism available.");
@@ -605,6 +609,10 @@ void POP3Connection::startTLS() {
 
 		shared_ptr <tls::TLSSocket> tlsSocket = tlsSession->getSocket(m_socket);
 
+		// Do not let data sent in clear text before the handshake
+		// be taken as a response received over the secured channel
+		m_receiveBuffer.clear();
+
 		tlsSocket->handshake();
 
 		m_socket = tlsSocket;
@@ -637,13 +645,31 @@ void POP3Connection::startTLS() {
 #endif // VMIME_HAVE_TLS_SUPPORT
 
 
-const std::vector <string> POP3Connection::getCapabilities() {
+bool POP3Connection::hasCapability(const string& capa, std::vector <string>* params) {
 
 	if (!m_capabilitiesFetched) {
 		fetchCapabilities();
 	}
 
-	return m_capabilities;
+	if (params) {
+		return m_capabilities.getParameters(capa, *params);
+	}
+
+	return m_capabilities.has(capa);
+}
+
+
+bool POP3Connection::hasCapability(const Capabilities capa, std::vector <string>* params) {
+
+	if (!m_capabilitiesFetched) {
+		fetchCapabilities();
+	}
+
+	if (params) {
+		return m_capabilities.getParameters(capa, *params);
+	}
+
+	return m_capabilities.has(capa);
 }
 
 
@@ -661,20 +687,103 @@ void POP3Connection::fetchCapabilities() {
 	shared_ptr <POP3Response> response =
 		POP3Response::readMultilineResponse(dynamicCast <POP3Connection>(shared_from_this()));
 
-	std::vector <string> res;
+	m_capabilities.clear();
 
 	if (response->isSuccess()) {
 
+		// One capability per line, format is: CAPA PARAM1 PARAM2...
 		for (size_t i = 0, n = response->getLineCount() ; i < n ; ++i) {
-			res.push_back(response->getLineAt(i));
+
+			std::istringstream iss(response->getLineAt(i));
+			iss.imbue(std::locale::classic());
+
+			string capa;
+			iss >> capa;
+
+			std::vector <string> params;
+			string param;
+
+			while (iss >> param) {
+				params.push_back(param);
+			}
+
+			if (!capa.empty()) {
+				m_capabilities.add(capa, params);
+			}
 		}
 	}
 
-	m_capabilities = res;
 	m_capabilitiesFetched = true;
 }
 
 
+void POP3Connection::sendPipelined(
+	const std::vector <shared_ptr <POP3Command> >& cmds,
+	pipelinedResponseHandler& handler
+) {
+
+	if (cmds.empty()) {
+		return;
+	}
+
+	shared_ptr <POP3Connection> conn = dynamicCast <POP3Connection>(shared_from_this());
+
+	// Limit the number of commands in flight, so that neither side
+	// blocks on a full send buffer while the other is not reading
+	const size_t window = hasCapability(CAPABILITY_PIPELINING) ? 64 : 1;
+
+	scoped_ptr <exceptions::command_error> error;
+	size_t sent = 0, received = 0;
+
+	while (received < cmds.size()) {
+
+		if (!error && sent < cmds.size() && sent - received <= window / 2) {
+
+			const size_t end = std::min(cmds.size(), received + window);
+
+			string buffer;
+
+			for (size_t i = sent ; i < end ; ++i) {
+				buffer += cmds[i]->getText();
+				buffer += "\r\n";
+			}
+
+			getSocket()->send(buffer);
+
+			if (getTracer()) {
+
+				for (size_t i = sent ; i < end ; ++i) {
+					getTracer()->traceSend(cmds[i]->getTraceText());
+				}
+			}
+
+			sent = end;
+
+		} else if (received == sent) {
+
+			break;  // stopped on error
+		}
+
+		try {
+
+			handler.readResponse(received, conn);
+
+		} catch (exceptions::command_error& e) {
+
+			if (!error) {
+				error.reset(new exceptions::command_error(e));
+			}
+		}
+
+		++received;
+	}
+
+	if (error) {
+		throw *error;
+	}
+}
+
+
 bool POP3Connection::isConnected() const {
 
 	return m_socket && m_socket->isConnected() && m_authenticated;
@@ -38,6 +38,7 @@
 #include "vmime/net/session.hpp"
 #include "vmime/net/connectionInfos.hpp"
 #include "vmime/net/tracer.hpp"
+#include "vmime/net/capabilitySet.hpp"
 
 #include "vmime/net/pop3/POP3Command.hpp"
 #include "vmime/net/pop3/POP3Response.hpp"
@@ -63,6 +64,8 @@ class POP3Store;
   */
 class VMIME_EXPORT POP3Connection : public object, public enable_shared_from_this <POP3Connection> {
 
+	friend class POP3Response;
+
 public:
 
 	POP3Connection(
@@ -87,6 +90,88 @@ public:
 	virtual shared_ptr <session> getSession();
 	virtual shared_ptr <tracer> getTracer();
 
+	/** Capabilities known by this implementation, which can be tested
+	  * without looking up their name (see hasCapability()).
+	  */
+	enum Capabilities {
+		CAPABILITY_TOP,
+		CAPABILITY_USER,
+		CAPABILITY_SASL,
+		CAPABILITY_RESP_CODES,
+		CAPABILITY_LOGIN_DELAY,
+		CAPABILITY_PIPELINING,
+		CAPABILITY_EXPIRE,
+		CAPABILITY_UIDL,
+		CAPABILITY_IMPLEMENTATION,
+		CAPABILITY_STLS,
+		CAPABILITY_UTF8,
+
+		CAPABILITY_COUNT
+	};
+
+	/** Test whether the server supports the specified capability,
+	  * as reported by the CAPA command (RFC 2449). Capabilities are
+	  * requested from the server the first time they are needed.
+	  *
+	  * @param capa capability name (case-insensitive)
+	  * @param params if not NULL, receives the capability parameters
+	  * @return true if the capability is supported, false otherwise
+	  */
+	bool hasCapability(const string& capa, std::vector <string>* params = NULL);
+
+	/** Test whether the server supports the specified capability,
+	  * as reported by the CAPA command (RFC 2449). Capabilities are
+	  * requested from the server the first time they are needed.
+	  *
+	  * @param capa capability
+	  * @param params if not NULL, receives the capability parameters
+	  * @return true if the capability is supported, false otherwise
+	  */
+	bool hasCapability(const Capabilities capa, std::vector <string>* params = NULL);
+
+	/** Receives the responses to the commands sent with sendPipelined().
+	  */
+	class VMIME_EXPORT pipelinedResponseHandler {
+
+	public:
+
+		virtual ~pipelinedResponseHandler() { }
+
+		/** Called when the response to a command is the next one
+		  * to arrive. The handler must consume the whole response
+		  * (eg. using POP3Response::readResponse() or one of the
+		  * multiline variants, depending on the command).
+		  *
+		  * @param index index of the command in the batch
+		  * @param conn connection from which to read the response
+		  */
+		virtual void readResponse(
+			const size_t index,
+			const shared_ptr <POP3Connection>& conn
+		) = 0;
+	};
+
+	/** Send a batch of commands and read their responses in order.
+	  *
+	  * If the server supports PIPELINING (RFC 2449), up to 64 commands
+	  * are kept in flight: they are written back-to-back in a single
+	  * write, and new commands are sent as soon as half of the responses
+	  * have been read. Otherwise, each command is sent only after the
+	  * response to the previous one has been read.
+	  *
+	  * If the handler throws exceptions::command_error, no more commands
+	  * are sent; the responses to the commands already sent are still
+	  * passed to the handler so that the connection stays in sync, then
+	  * the first error is rethrown.
+	  *
+	  * @param cmds commands to send
+	  * @param handler object which reads the responses
+	  */
+	void sendPipelined(
+		const std::vector <shared_ptr <POP3Command> >& cmds,
+		pipelinedResponseHandler& handler
+	);
+
 private:
 
 	void authenticate(const messageId& randomMID);
@@ -100,7 +185,6 @@ private:
 
 	void fetchCapabilities();
 	void invalidateCapabilities();
-	const std::vector <string> getCapabilities();
 
 	void internalDisconnect();
 
@@ -117,8 +201,11 @@ private:
 
 	shared_ptr <connectionInfos> m_cntInfos;
 
-	std::vector <string> m_capabilities;
+	capabilitySet m_capabilities;
 	bool m_capabilitiesFetched;
+
+	// Data received after the end of the last response read
+	string m_receiveBuffer;
 };
 
 
@@ -45,6 +45,258 @@ namespace net {
 namespace pop3 {
 
 
+//
+// POP3Folder::fetchMessagesHandler
+//
+
+/** Reads the responses to the commands sent by POP3Folder::fetchMessages()
+  * and POP3Folder::fetchMessage(), and updates the messages accordingly.
+  */
+class POP3Folder::fetchMessagesHandler : public POP3Connection::pipelinedResponseHandler {
+
+public:
+
+	/** Information requested by a command. */
+	enum RequestType {
+		REQUEST_HEADER,      /**< Header of one message ("TOP n 0"). */
+		REQUEST_SIZE,        /**< Size of one message ("LIST n"). */
+		REQUEST_UID,         /**< UID of one message ("UIDL n"). */
+		REQUEST_ALL_SIZES,   /**< Size of all messages ("LIST"). */
+		REQUEST_ALL_UIDS     /**< UID of all messages ("UIDL"). */
+	};
+
+	fetchMessagesHandler(
+		const std::vector <shared_ptr <POP3Message> >& msgs,
+		utility::progressListener* progress
+	)
+		: m_msgs(msgs),
+		  m_progress(progress),
+		  m_current(0) {
+
+	}
+
+	void addRequest(const RequestType type, const shared_ptr <POP3Message>& msg = null) {
+
+		switch (type) {
+
+			case REQUEST_HEADER: m_commands.push_back(POP3Command::TOP(msg->m_num, 0)); break;
+			case REQUEST_SIZE: m_commands.push_back(POP3Command::LIST(msg->m_num)); break;
+			case REQUEST_UID: m_commands.push_back(POP3Command::UIDL(msg->m_num)); break;
+			case REQUEST_ALL_SIZES: m_commands.push_back(POP3Command::LIST()); break;
+			case REQUEST_ALL_UIDS: m_commands.push_back(POP3Command::UIDL()); break;
+		}
+
+		m_requests.push_back(std::make_pair(type, msg));
+	}
+
+	const std::vector <shared_ptr <POP3Command> >& getCommands() const {
+
+		return m_commands;
+	}
+
+	void readResponse(const size_t index, const shared_ptr <POP3Connection>& conn) {
+
+		const RequestType type = m_requests[index].first;
+		const shared_ptr <POP3Message>& msg = m_requests[index].second;
+
+		switch (type) {
+
+			case REQUEST_HEADER: {
+
+				msg->readHeaderResponse(conn);
+
+				if (m_progress) {
+					m_progress->progress(++m_current, m_msgs.size());
+				}
+
+				break;
+			}
+			case REQUEST_SIZE: {
+
+				// C: LIST 2
+				// S: +OK 2 4242
+				string value;
+
+				if (POP3Utils::parseListOrUidlResponse(POP3Response::readResponse(conn), value)) {
+					msg->m_size = parseSize(value);
+				}
+
+				break;
+			}
+			case REQUEST_UID: {
+
+				// C: UIDL 2
+				// S: +OK 2 QhdPYR:00WBw1Ph7x7
+				string value;
+
+				if (POP3Utils::parseListOrUidlResponse(POP3Response::readResponse(conn), value)) {
+					msg->m_uid = value;
+				}
+
+				break;
+			}
+			case REQUEST_ALL_SIZES:
+			case REQUEST_ALL_UIDS: {
+
+				// C: LIST
+				// S: +OK
+				// S: 1 47548
+				// S: 2 12653
+				// S: .
+				shared_ptr <POP3Response> response =
+					POP3Response::readMultilineResponse(conn);
+
+				if (!response->isSuccess()) {
+					break;
+				}
+
+				std::map <size_t, string> result;
+				POP3Utils::parseMultiListOrUidlResponse(response, result);
+
+				for (std::vector <shared_ptr <POP3Message> >::const_iterator it = m_msgs.begin() ;
+				     it != m_msgs.end() ; ++it) {
+
+					std::map <size_t, string>::const_iterator x = result.find((*it)->m_num);
+
+					if (x != result.end()) {
+
+						if (type == REQUEST_ALL_SIZES) {
+							(*it)->m_size = parseSize((*x).second);
+						} else {
+							(*it)->m_uid = (*x).second;
+						}
+					}
+				}
+
+				break;
+			}
+		}
+	}
+
+private:
+
+	static size_t parseSize(const string& value) {
+
+		size_t size = 0;
+
+		std::istringstream iss(value);
+		iss.imbue(std::locale::classic());
+		iss >> size;
+
+		return size;
+	}
+
+
+	const std::vector <shared_ptr <POP3Message> >& m_msgs;
+
+	std::vector <shared_ptr <POP3Command> > m_commands;
+	std::vector <std::pair <RequestType, shared_ptr <POP3Message> > > m_requests;
+
+	utility::progressListener* m_progress;
+	size_t m_current;
+};
+
+
+
+//
+// POP3Folder::deleteMessagesHandler
+//
+
+/** Reads the responses to the DELE commands sent by POP3Folder::deleteMessages().
+  */
+class POP3Folder::deleteMessagesHandler : public POP3Connection::pipelinedResponseHandler {
+
+public:
+
+	deleteMessagesHandler(const std::vector <size_t>& nums)
+		: m_nums(nums) {
+
+	}
+
+	void readResponse(const size_t index, const shared_ptr <POP3Connection>& conn) {
+
+		shared_ptr <POP3Response> response = POP3Response::readResponse(conn);
+
+		if (!response->isSuccess()) {
+			throw exceptions::command_error("DELE", response->getFirstLine());
+		}
+
+		m_deleted.push_back(m_nums[index]);
+	}
+
+	/** Return the numbers of the messages which have been deleted,
+	  * even if other DELE commands failed.
+	  */
+	const std::vector <size_t>& getDeletedMessages() const {
+
+		return m_deleted;
+	}
+
+private:
+
+	const std::vector <size_t>& m_nums;
+	std::vector <size_t> m_deleted;
+};
+
+
+
+//
+// POP3Folder::retrieveMessagesHandler
+//
+
+/** Reads the responses to the RETR commands sent by POP3Folder::retrieveMessages()
+  * and forwards the message data to the listener.
+  */
+class POP3Folder::retrieveMessagesHandler : public POP3Connection::pipelinedResponseHandler {
+
+public:
+
+	retrieveMessagesHandler(
+		const std::vector <size_t>& nums,
+		retrieveListener& listener,
+		utility::progressListener* progress
+	)
+		: m_nums(nums),
+		  m_listener(listener),
+		  m_progress(progress) {
+
+	}
+
+	void readResponse(const size_t index, const shared_ptr <POP3Connection>& conn) {
+
+		const size_t num = m_nums[index];
+
+		try {
+
+			POP3Response::readLargeResponse(
+				conn, m_listener.getOutputStream(num),
+				/* progress */ NULL, /* predictedSize */ 0
+			);
+
+			m_listener.messageRetrieved(num);
+
+		} catch (exceptions::command_error& e) {
+
+			// The error response has been read entirely, so the
+			// connection is still usable for the next messages
+			m_listener.messageFailed(num, exceptions::command_error("RETR", e.response()));
+		}
+
+		if (m_progress) {
+			m_progress->progress(index + 1, m_nums.size());
+		}
+	}
+
+private:
+
+	const std::vector <size_t>& m_nums;
+	retrieveListener& m_listener;
+
+	utility::progressListener* m_progress;
+};
+
+
+
 POP3Folder::POP3Folder(
 	const folder::path& path,
 	const shared_ptr <POP3Store>& store
@@ -355,98 +607,45 @@ void POP3Folder::fetchMessages(
 	}
 
 	const size_t total = msg.size();
-	size_t current = 0;
 
 	if (progress) {
 		progress->start(total);
 	}
 
+	std::vector <shared_ptr <POP3Message> > messages;
+	messages.reserve(total);
+
 	for (std::vector <shared_ptr <message> >::iterator it = msg.begin() ;
 	     it != msg.end() ; ++it) {
 
-		dynamicCast <POP3Message>(*it)->fetch(
-			dynamicCast <POP3Folder>(shared_from_this()),
-			options
-		);
+		messages.push_back(dynamicCast <POP3Message>(*it));
+	}
+
+	// Send all the commands at once if the server supports
+	// pipelining, instead of waiting for each header
+	fetchMessagesHandler handler(messages, progress);
+	size_t current = 0;
+
+	for (std::vector <shared_ptr <POP3Message> >::iterator it = messages.begin() ;
+	     it != messages.end() ; ++it) {
 
-		if (progress) {
+		if ((*it)->isHeaderFetchRequired(dynamicCast <POP3Folder>(shared_from_this()), options)) {
+			handler.addRequest(fetchMessagesHandler::REQUEST_HEADER, *it);
+		} else if (progress) {
 			progress->progress(++current, total);
 		}
 	}
 
 	if (options.has(fetchAttributes::SIZE)) {
-
-		// Send the "LIST" command
-		POP3Command::LIST()->send(store->getConnection());
-
-		// Get the response
-		shared_ptr <POP3Response> response =
-			POP3Response::readMultilineResponse(store->getConnection());
-
-		if (response->isSuccess()) {
-
-			// C: LIST
-			// S: +OK
-			// S: 1 47548
-			// S: 2 12653
-			// S: .
-			std::map <size_t, string> result;
-			POP3Utils::parseMultiListOrUidlResponse(response, result);
-
-			for (std::vector <shared_ptr <message> >::iterator it = msg.begin() ;
-			     it != msg.end() ; ++it) {
-
-				shared_ptr <POP3Message> m = dynamicCast <POP3Message>(*it);
-
-				std::map <size_t, string>::const_iterator x = result.find(m->m_num);
-
-				if (x != result.end()) {
-
-					size_t size = 0;
-
-					std::istringstream iss((*x).second);
-					iss.imbue(std::locale::classic());
-					iss >> size;
-
-					m->m_size = size;
-				}
-			}
-		}
+		handler.addRequest(fetchMessagesHandler::REQUEST_ALL_SIZES);
 	}
 
 	if (options.has(fetchAttributes::UID)) {
-
-		// Send the "UIDL" command
-		POP3Command::UIDL()->send(store->getConnection());
-
-		// Get the response
-		shared_ptr <POP3Response> response =
-			POP3Response::readMultilineResponse(store->getConnection());
-
-		if (response->isSuccess()) {
-
-			// C: UIDL
-			// S: +OK
-			// S: 1 whqtswO00WBw418f9t5JxYwZ
-			// S: 2 QhdPYR:00WBw1Ph7x7
-			// S: .
-			std::map <size_t, string> result;
-			POP3Utils::parseMultiListOrUidlResponse(response, result);
-
-			for (std::vector <shared_ptr <message> >::iterator it = msg.begin() ;
-			     it != msg.end() ; ++it) {
-
-				shared_ptr <POP3Message> m = dynamicCast <POP3Message>(*it);
-
-				std::map <size_t, string>::const_iterator x = result.find(m->m_num);
-
-				if (x != result.end()) {
-					m->m_uid = (*x).second;
-				}
-			}
-		}
+		handler.addRequest(fetchMessagesHandler::REQUEST_ALL_UIDS);
 	}
 
+	store->getConnection()->sendPipelined(handler.getCommands(), handler);
+
 	if (progress) {
 		progress->stop(total);
 	}
@@ -463,71 +662,24 @@ void POP3Folder::fetchMessage(const shared_ptr <message>& msg, const fetchAttrib
 		throw exceptions::illegal_state("Folder not open");
 	}
 
-	dynamicCast <POP3Message>(msg)->fetch(
-		dynamicCast <POP3Folder>(shared_from_this()),
-		options
-	);
-
-	if (options.has(fetchAttributes::SIZE)) {
-
-		// Send the "LIST" command
-		POP3Command::LIST(msg->getNumber())->send(store->getConnection());
-
-		// Get the response
-		shared_ptr <POP3Response> response =
-			POP3Response::readResponse(store->getConnection());
-
-		if (response->isSuccess()) {
-
-			string responseText = response->getText();
-
-			// C: LIST 2
-			// S: +OK 2 4242
-			string::iterator it = responseText.begin();
+	std::vector <shared_ptr <POP3Message> > messages;
+	messages.push_back(dynamicCast <POP3Message>(msg));
 
-			while (it != responseText.end() && (*it == ' ' || *it == '\t')) ++it;
-			while (it != responseText.end() && !(*it == ' ' || *it == '\t')) ++it;
-			while (it != responseText.end() && (*it == ' ' || *it == '\t')) ++it;
+	fetchMessagesHandler handler(messages, /* progress */ NULL);
 
-			if (it != responseText.end()) {
-
-				size_t size = 0;
-
-				std::istringstream iss(string(it, responseText.end()));
-				iss.imbue(std::locale::classic());
-				iss >> size;
+	if (messages[0]->isHeaderFetchRequired(dynamicCast <POP3Folder>(shared_from_this()), options)) {
+		handler.addRequest(fetchMessagesHandler::REQUEST_HEADER, messages[0]);
+	}
 
-				dynamicCast <POP3Message>(msg)->m_size = size;
-			}
-		}
+	if (options.has(fetchAttributes::SIZE)) {
+		handler.addRequest(fetchMessagesHandler::REQUEST_SIZE, messages[0]);
 	}
 
 	if (options.has(fetchAttributes::UID)) {
-
-		// Send the "UIDL" command
-		POP3Command::UIDL(msg->getNumber())->send(store->getConnection());
-
-		// Get the response
-		shared_ptr <POP3Response> response =
-			POP3Response::readResponse(store->getConnection());
-
-		if (response->isSuccess()) {
-
-			string responseText = response->getText();
-
-			// C: UIDL 2
-			// S: +OK 2 QhdPYR:00WBw1Ph7x7
-			string::iterator it = responseText.begin();
-
-			while (it != responseText.end() && (*it == ' ' || *it == '\t')) ++it;
-			while (it != responseText.end() && !(*it == ' ' || *it == '\t')) ++it;
-			while (it != responseText.end() && (*it == ' ' || *it == '\t')) ++it;
-
-			if (it != responseText.end()) {
-				dynamicCast <POP3Message>(msg)->m_uid = string(it, responseText.end());
-			}
-		}
+		handler.addRequest(fetchMessagesHandler::REQUEST_UID, messages[0]);
 	}
+
+	store->getConnection()->sendPipelined(handler.getCommands(), handler);
 }
 
 
@@ -614,26 +766,41 @@ void POP3Folder::deleteMessages(const messageSet& msgs) {
 		throw exceptions::illegal_state("Folder not open");
 	}
 
+	std::vector <shared_ptr <POP3Command> > commands;
+	commands.reserve(nums.size());
+
 	for (std::vector <size_t>::const_iterator
 	     it = nums.begin() ; it != nums.end() ; ++it) {
 
-		POP3Command::DELE(*it)->send(store->getConnection());
+		commands.push_back(POP3Command::DELE(*it));
+	}
 
-		shared_ptr <POP3Response> response =
-			POP3Response::readResponse(store->getConnection());
+	deleteMessagesHandler handler(nums);
+	scoped_ptr <exceptions::command_error> error;
 
-		if (!response->isSuccess()) {
-			throw exceptions::command_error("DELE", response->getFirstLine());
-		}
+	try {
+
+		store->getConnection()->sendPipelined(commands, handler);
+
+	} catch (exceptions::command_error& e) {
+
+		// Some messages may have been deleted nonetheless: update
+		// them before reporting the error
+		error.reset(new exceptions::command_error(e));
 	}
 
 	// Sort message list
-	std::vector <size_t> list;
+	std::vector <size_t> list = handler.getDeletedMessages();
+	std::sort(list.begin(), list.end());
 
-	list.resize(nums.size());
-	std::copy(nums.begin(), nums.end(), list.begin());
+	if (list.empty()) {
 
-	std::sort(list.begin(), list.end());
+		if (error) {
+			throw *error;
+		}
+
+		return;
+	}
 
 	// Update local flags
 	for (std::map <POP3Message*, size_t>::iterator it =
@@ -655,6 +822,52 @@ void POP3Folder::deleteMessages(const messageSet& msgs) {
 		);
 
 	notifyMessageChanged(event);
+
+	if (error) {
+		throw *error;
+	}
+}
+
+
+void POP3Folder::retrieveMessages(
+	const messageSet& msgs,
+	retrieveListener& listener,
+	utility::progressListener* progress
+) {
+
+	shared_ptr <POP3Store> store = m_store.lock();
+
+	const std::vector <size_t> nums = POP3Utils::messageSetToNumberList(msgs, m_messageCount);
+
+	if (!store) {
+		throw exceptions::illegal_state("Store disconnected");
+	} else if (!isOpen()) {
+		throw exceptions::illegal_state("Folder not open");
+	}
+
+	if (nums.empty()) {
+		return;
+	}
+
+	if (progress) {
+		progress->start(nums.size());
+	}
+
+	std::vector <shared_ptr <POP3Command> > commands;
+	commands.reserve(nums.size());
+
+	for (std::vector <size_t>::const_iterator
+	     it = nums.begin() ; it != nums.end() ; ++it) {
+
+		commands.push_back(POP3Command::RETR(*it));
+	}
+
+	retrieveMessagesHandler handler(nums, listener, progress);
+	store->getConnection()->sendPipelined(commands, handler);
+
+	if (progress) {
+		progress->stop(nums.size());
+	}
 }
 
 
@@ -37,6 +37,7 @@
 #include "vmime/types.hpp"
 
 #include "vmime/net/folder.hpp"
+#include "vmime/exception.hpp"
 
 
 namespace vmime {
@@ -144,8 +145,61 @@ public:
 
 	std::vector <size_t> getMessageNumbersStartingOnUID(const message::uid& uid);
 
+	/** Receives the messages downloaded by retrieveMessages().
+	  */
+	class VMIME_EXPORT retrieveListener {
+
+	public:
+
+		virtual ~retrieveListener() { }
+
+		/** Called when the response to the RETR command of a message
+		  * is about to be read.
+		  *
+		  * @param num message number
+		  * @return stream to which the message data will be written
+		  */
+		virtual utility::outputStream& getOutputStream(const size_t num) = 0;
+
+		/** Called when the whole message data has been received.
+		  *
+		  * @param num message number
+		  */
+		virtual void messageRetrieved(const size_t num) = 0;
+
+		/** Called instead of messageRetrieved() when the server
+		  * refused to send a message. The next messages are still
+		  * retrieved.
+		  *
+		  * @param num message number
+		  * @param err reason of the failure
+		  */
+		virtual void messageFailed(const size_t num, const exceptions::command_error& err) = 0;
+	};
+
+	/** Download the contents of several messages.
+	  *
+	  * If the server supports PIPELINING, the RETR commands are sent
+	  * in batches instead of waiting for each message to be received
+	  * before asking for the next one (see POP3Connection::sendPipelined()).
+	  *
+	  * @param msgs set of messages to retrieve
+	  * @param listener object which receives the message data
+	  * @param progress progress listener, notified once per message
+	  * (can be NULL)
+	  */
+	void retrieveMessages(
+		const messageSet& msgs,
+		retrieveListener& listener,
+		utility::progressListener* progress = NULL
+	);
+
 private:
 
+	class fetchMessagesHandler;
+	class deleteMessagesHandler;
+	class retrieveMessagesHandler;
+
 	void registerMessage(POP3Message* msg);
 	void unregisterMessage(POP3Message* msg);
 
@@ -200,10 +200,10 @@ void POP3Message::fetchPartHeader(const shared_ptr <messagePart>& /* p */) {
 }
 
 
-void POP3Message::fetch(
+bool POP3Message::isHeaderFetchRequired(
 	const shared_ptr <POP3Folder>& msgFolder,
 	const fetchAttributes& options
-) {
+) const {
 
 	shared_ptr <POP3Folder> folder = m_folder.lock();
 
@@ -221,18 +221,14 @@ void POP3Message::fetch(
 		fetchAttributes::ENVELOPE | fetchAttributes::CONTENT_INFO |
 		fetchAttributes::FULL_HEADER | fetchAttributes::IMPORTANCE;
 
-	if (!options.has(optionsRequiringHeader)) {
-		return;
-	}
-
 	// No need to differenciate between ENVELOPE, CONTENT_INFO, ...
 	// since POP3 only permits to retrieve the whole header and not
 	// fields in particular.
+	return options.has(optionsRequiringHeader);
+}
 
-	// Emit the "TOP" command
-	shared_ptr <POP3Store> store = folder->m_store.lock();
 
-	POP3Command::TOP(m_num, 0)->send(store->getConnection());
+void POP3Message::readHeaderResponse(const shared_ptr <POP3Connection>& conn) {
 
 	try {
 
@@ -240,8 +236,7 @@ void POP3Message::fetch(
 		utility::outputStreamStringAdapter bufferStream(buffer);
 
 		POP3Response::readLargeResponse(
-			store->getConnection(),
-			bufferStream, /* progress */ NULL, /* predictedSize */ 0
+			conn, bufferStream, /* progress */ NULL, /* predictedSize */ 0
 		);
 
 		m_header = make_shared <header>();
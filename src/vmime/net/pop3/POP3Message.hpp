@@ -41,6 +41,7 @@ namespace pop3 {
 
 
 class POP3Folder;
+class POP3Connection;
 
 
 /** POP3 message implementation.
@@ -99,7 +100,25 @@ public:
 
 private:
 
-	void fetch(const shared_ptr <POP3Folder>& folder, const fetchAttributes& options);
+	/** Check the specified fetch attributes and return whether the
+	  * header of this message must be retrieved (with the TOP command)
+	  * to honour them.
+	  *
+	  * @param folder folder which requests the attributes
+	  * @param options attributes to fetch
+	  * @return true if the header must be retrieved, false otherwise
+	  */
+	bool isHeaderFetchRequired(
+		const shared_ptr <POP3Folder>& folder,
+		const fetchAttributes& options
+	) const;
+
+	/** Read the response to a "TOP n 0" command for this message
+	  * and parse the header it contains.
+	  *
+	  * @param conn connection from which to read the response
+	  */
+	void readHeaderResponse(const shared_ptr <POP3Connection>& conn);
 
 	void onFolderClosed();
 
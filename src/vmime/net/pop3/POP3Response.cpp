@@ -33,13 +33,12 @@
 #include "vmime/platform.hpp"
 
 #include "vmime/utility/stringUtils.hpp"
-#include "vmime/utility/filteredStream.hpp"
-#include "vmime/utility/stringUtils.hpp"
-#include "vmime/utility/inputStreamSocketAdapter.hpp"
 
 #include "vmime/net/socket.hpp"
 #include "vmime/net/timeoutHandler.hpp"
 
+#include <algorithm>
+
 
 namespace vmime {
 namespace net {
@@ -68,7 +67,7 @@ shared_ptr <POP3Response> POP3Response::readResponse(
 	);
 
 	string buffer;
-	resp->readResponseImpl(buffer, /* multiLine */ false);
+	resp->readResponseImpl(conn->m_receiveBuffer, buffer, /* multiLine */ false);
 
 	resp->m_firstLine = buffer;
 	resp->m_code = getResponseCode(buffer);
@@ -92,7 +91,7 @@ shared_ptr <POP3Response> POP3Response::readMultilineResponse(
 	);
 
 	string buffer;
-	resp->readResponseImpl(buffer, /* multiLine */ true);
+	resp->readResponseImpl(conn->m_receiveBuffer, buffer, /* multiLine */ true);
 
 	string firstLine, nextLines;
 	stripFirstLine(buffer, nextLines, &firstLine);
@@ -139,7 +138,9 @@ shared_ptr <POP3Response> POP3Response::readLargeResponse(
 	);
 
 	string firstLine;
-	const size_t length = resp->readResponseImpl(firstLine, os, progress, predictedSize);
+	const size_t length = resp->readResponseImpl(
+		conn->m_receiveBuffer, firstLine, os, progress, predictedSize
+	);
 
 	resp->m_firstLine = firstLine;
 	resp->m_code = getResponseCode(firstLine);
@@ -191,19 +192,9 @@ size_t POP3Response::getLineCount() const {
 }
 
 
-void POP3Response::readResponseImpl(string& buffer, const bool multiLine) {
-
-	bool foundTerminator = false;
+void POP3Response::receiveData(string& buffer) {
 
-	if (m_timeoutHandler) {
-		m_timeoutHandler->resetTimeOut();
-	}
-
-	buffer.clear();
-
-	char last1 = '\0', last2 = '\0';
-
-	for ( ; !foundTerminator ; ) {
+	for ( ; ; ) {
 
 		// Check whether the time-out delay is elapsed
 		if (m_timeoutHandler && m_timeoutHandler->isTimeOut()) {
@@ -235,49 +226,59 @@ void POP3Response::readResponseImpl(string& buffer, const bool multiLine) {
 			m_timeoutHandler->resetTimeOut();
 		}
 
-		// Check for transparent characters: '\n..' becomes '\n.'
-		const char first = receiveBuffer[0];
+		buffer += receiveBuffer;
+		break;
+	}
+}
 
-		if (first == '.' && last2 == '\n' && last1 == '.') {
 
-			receiveBuffer.erase(receiveBuffer.begin());
+void POP3Response::readResponseImpl(string& pending, string& buffer, const bool multiLine) {
 
-		} else if (receiveBuffer.length() >= 2 && first == '.' &&
-		           receiveBuffer[1] == '.' && last1 == '\n') {
+	if (m_timeoutHandler) {
+		m_timeoutHandler->resetTimeOut();
+	}
 
-			receiveBuffer.erase(receiveBuffer.begin());
-		}
+	// Data received after the end of the response (if the commands
+	// have been pipelined) is kept in the connection for the next
+	// response
+	size_t end = 0;
+	size_t scanPos = 0;
 
-		for (size_t trans ;
-		     string::npos != (trans = receiveBuffer.find("\n..")) ; ) {
+	while (!findTerminator(pending, multiLine, scanPos, end)) {
+		receiveData(pending);
+	}
 
-			receiveBuffer.replace(trans, 3, "\n.");
-		}
+	buffer.assign(pending, 0, end);
+	pending.erase(0, end);
 
-		last1 = receiveBuffer[receiveBuffer.length() - 1];
-		last2 = static_cast <char>((receiveBuffer.length() >= 2) ? receiveBuffer[receiveBuffer.length() - 2] : 0);
+	// Strip terminator
+	buffer.erase(buffer.length() - 1);  // '\n'
 
-		// Append the data to the response buffer
-		buffer += receiveBuffer;
+	if (!buffer.empty() && buffer[buffer.length() - 1] == '\r') {
+		buffer.erase(buffer.length() - 1);
+	}
 
-		// Check for terminator string (and strip it if present)
-		foundTerminator = checkTerminator(buffer, multiLine);
+	if (multiLine && buffer[0] != '-') {
 
-		// If there is an error (-ERR) when executing a command that
-		// requires a multi-line response, the error response will
-		// include only one line, so we stop waiting for a multi-line
-		// terminator and check for a "normal" one.
-		if (multiLine &&
-		    !foundTerminator &&
-		    buffer.length() >= 4 && buffer[0] == '-') {
+		buffer.erase(buffer.length() - 1);  // '.'
+		buffer.erase(buffer.length() - 1);  // '\n'
 
-			foundTerminator = checkTerminator(buffer, false);
+		if (!buffer.empty() && buffer[buffer.length() - 1] == '\r') {
+			buffer.erase(buffer.length() - 1);
 		}
 	}
+
+	// Check for transparent characters: '\n..' becomes '\n.'
+	for (size_t trans = 0 ;
+	     string::npos != (trans = buffer.find("\n..", trans)) ; ++trans) {
+
+		buffer.erase(trans + 1, 1);
+	}
 }
 
 
 size_t POP3Response::readResponseImpl(
+	string& pending,
 	string& firstLine,
 	utility::outputStream& os,
 	utility::progressListener* progress,
@@ -286,9 +287,6 @@ size_t POP3Response::readResponseImpl(
 
 	size_t current = 0, total = predictedSize;
 
-	string temp;
-	bool codeDone = false;
-
 	if (progress) {
 		progress->start(total);
 	}
@@ -297,80 +295,126 @@ size_t POP3Response::readResponseImpl(
 		m_timeoutHandler->resetTimeOut();
 	}
 
-	utility::inputStreamSocketAdapter sis(*m_socket);
-	utility::stopSequenceFilteredInputStream <5> sfis1(sis, "\r\n.\r\n");
-	utility::stopSequenceFilteredInputStream <3> sfis2(sfis1, "\n.\n");
-	utility::dotFilteredInputStream dfis(sfis2);   // "\n.." --> "\n."
+	bool codeDone = false;
+	bool atLineStart = true;
+	bool finished = false;
 
-	utility::inputStream& is = dfis;
+	// Line break of the previous line: it is not written until we know
+	// the next line is not the terminator, which is stripped with the
+	// line break preceding it
+	string lineBreak;
 
-	while (!is.eof()) {
+	string data;
 
-		// Check whether the time-out delay is elapsed
-		if (m_timeoutHandler && m_timeoutHandler->isTimeOut()) {
+	while (!finished) {
 
-			if (!m_timeoutHandler->handleTimeOut()) {
-				throw exceptions::operation_timed_out();
+		size_t pos = 0;
+
+		// If we don't have extracted the response code yet
+		if (!codeDone) {
+
+			const size_t end = pending.find('\n');
+
+			if (end != string::npos) {
+
+				firstLine = utility::stringUtils::trim(pending.substr(0, end));
+				pos = end + 1;
+
+				if (getResponseCode(firstLine) != CODE_OK) {
+
+					pending.erase(0, pos);
+					throw exceptions::command_error("?", firstLine);
+				}
+
+				codeDone = true;
 			}
 		}
 
-		// Receive data from the socket
-		byte_t buffer[65536];
-		const size_t read = is.read(buffer, sizeof(buffer));
+		while (codeDone && pos < pending.length()) {
 
-		if (read == 0) {  // buffer is empty
+			const size_t end = pending.find('\n', pos);
 
-			if (m_socket->getStatus() & socket::STATUS_WANT_WRITE) {
-				m_socket->waitForWrite();
-			} else if (m_socket->getStatus() & socket::STATUS_WANT_READ) {
-				m_socket->waitForRead();
-			} else {
-				// Input stream needs more bytes to continue, but there
-				// is enough data into socket buffer. Do not waitForRead(),
-				// just retry read()ing on the stream.
-			}
+			if (atLineStart) {
 
-			continue;
-		}
+				// Not enough data to tell whether this is the terminator
+				if (end == string::npos && pending.length() - pos < 3) {
+					break;
+				}
 
-		// We have received data: reset the time-out counter
-		if (m_timeoutHandler) {
-			m_timeoutHandler->resetTimeOut();
-		}
+				if (pending[pos] == '.') {
 
-		// Notify progress
-		current += read;
+					if (pending[pos + 1] == '\n') {
 
-		if (progress) {
-			total = std::max(total, current);
-			progress->progress(current, total);
-		}
+						pos += 2;
+						finished = true;
+						break;
 
-		// If we don't have extracted the response code yet
-		if (!codeDone) {
+					} else if (pending[pos + 1] == '\r' && pos + 2 < pending.length() &&
+					           pending[pos + 2] == '\n') {
 
-			vmime::utility::stringUtils::appendBytesToString(temp, buffer, read);
+						pos += 3;
+						finished = true;
+						break;
 
-			string responseData;
+					} else if (pending[pos + 1] == '.') {
 
-			if (stripFirstLine(temp, responseData, &firstLine) == true) {
+						++pos;  // '\n..' becomes '\n.'
+					}
+				}
 
-				if (getResponseCode(firstLine) != CODE_OK) {
-					throw exceptions::command_error("?", firstLine);
+				data += lineBreak;
+				lineBreak.clear();
+
+				atLineStart = false;
+			}
+
+			if (end == string::npos) {
+
+				// Keep a trailing '\r', which may be part of the line break
+				size_t last = pending.length();
+
+				if (pending[last - 1] == '\r') {
+					--last;
 				}
 
-				codeDone = true;
+				data.append(pending, pos, last - pos);
+				pos = last;
+
+				break;
+			}
 
-				os.write(responseData.data(), responseData.length());
-				temp.clear();
+			size_t lineEnd = end;
 
-				continue;
+			if (lineEnd > pos && pending[lineEnd - 1] == '\r') {
+				--lineEnd;
 			}
 
-		} else {
+			data.append(pending, pos, lineEnd - pos);
+			lineBreak.assign(pending, lineEnd, end + 1 - lineEnd);
 
-			// Inject the data into the output stream
-			os.write(buffer, read);
+			pos = end + 1;
+			atLineStart = true;
+		}
+
+		pending.erase(0, pos);
+
+		// Inject the data into the output stream
+		if (!data.empty()) {
+
+			os.write(data.data(), data.length());
+			data.clear();
+		}
+
+		// Notify progress
+		current += pos;
+
+		if (progress) {
+			total = std::max(total, current);
+			progress->progress(current, total);
+		}
+
+		if (!finished) {
+			receiveData(pending);
 		}
 	}
 
@@ -457,41 +501,49 @@ void POP3Response::stripResponseCode(const string& buffer, string& result) {
 
 
 // static
-bool POP3Response::checkTerminator(string& buffer, const bool multiLine) {
-
-	// Multi-line response
-	if (multiLine) {
-
-		static const string term1("\r\n.\r\n");
-		static const string term2("\n.\n");
+bool POP3Response::findTerminator(
+	const string& buffer,
+	const bool multiLine,
+	size_t& scanPos,
+	size_t& end
+) {
 
-		return checkOneTerminator(buffer, term1) ||
-		       checkOneTerminator(buffer, term2);
+	const size_t firstLineEnd = buffer.find('\n');
 
-	// Normal response
-	} else {
+	if (firstLineEnd == string::npos) {
+		return false;
+	}
 
-		static const string term1("\r\n");
-		static const string term2("\n");
+	// If there is an error (-ERR) when executing a command that
+	// requires a multi-line response, the error response will
+	// include only one line
+	if (!multiLine || buffer[0] == '-') {
 
-		return checkOneTerminator(buffer, term1) ||
-		       checkOneTerminator(buffer, term2);
+		end = firstLineEnd + 1;
+		return true;
 	}
 
-	return false;
-}
+	// Multi-line response: look for a line containing only a dot,
+	// starting where the previous call stopped
+	for (size_t pos = std::max(firstLineEnd, scanPos) ;
+	     string::npos != (pos = buffer.find("\n.", pos)) ; ++pos) {
 
+		if (pos + 2 < buffer.length() && buffer[pos + 2] == '\n') {
 
-// static
-bool POP3Response::checkOneTerminator(string& buffer, const string& term) {
+			end = pos + 3;
+			return true;
 
-	if (buffer.length() >= term.length() &&
-		std::equal(buffer.end() - term.length(), buffer.end(), term.begin())) {
+		} else if (pos + 3 < buffer.length() && buffer[pos + 2] == '\r' && buffer[pos + 3] == '\n') {
 
-		buffer.erase(buffer.end() - term.length(), buffer.end());
-		return true;
+			end = pos + 4;
+			return true;
+		}
 	}
 
+	// The terminator may have been partially received: scan its
+	// possible beginning again when more data is available
+	scanPos = (buffer.length() > 4) ? buffer.length() - 4 : 0;
+
 	return false;
 }
 
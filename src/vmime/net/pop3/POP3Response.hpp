@@ -152,9 +152,17 @@ private:
 		const shared_ptr <tracer>& tracer
 	);
 
-	void readResponseImpl(string& buffer, const bool multiLine);
+	/** Receive more data from the socket and append it to the
+	  * specified buffer. Waits until some data is available.
+	  *
+	  * @param buffer buffer to which data is appended
+	  */
+	void receiveData(string& buffer);
+
+	void readResponseImpl(string& pending, string& buffer, const bool multiLine);
 
 	size_t readResponseImpl(
+		string& pending,
 		string& firstLine,
 		utility::outputStream& os,
 		utility::progressListener* progress,
@@ -168,8 +176,18 @@ private:
 
 	static void stripResponseCode(const string& buffer, string& result);
 
-	static bool checkTerminator(string& buffer, const bool multiLine);
-	static bool checkOneTerminator(string& buffer, const string& term);
+	/** Look for the end of a response in the specified buffer.
+	  *
+	  * @param buffer received data
+	  * @param multiLine whether the response is a multi-line response
+	  * @param scanPos offset from which to look for the terminator; it
+	  * is updated so that the next call, once more data has been appended
+	  * to the buffer, does not scan the same data again (start with 0)
+	  * @param end receives the offset following the terminator
+	  * @return true if the end of the response has been found, false
+	  * if more data is needed
+	  */
+	static bool findTerminator(const string& buffer, const bool multiLine, size_t& scanPos, size_t& end);
 
 
 	shared_ptr <socket> m_socket;
@@ -75,6 +75,32 @@ void POP3Utils::parseMultiListOrUidlResponse(
 }
 
 
+bool POP3Utils::parseListOrUidlResponse(
+	const shared_ptr <POP3Response>& response,
+	string& result
+) {
+
+	if (!response->isSuccess()) {
+		return false;
+	}
+
+	const string responseText = response->getText();
+	string::const_iterator it = responseText.begin();
+
+	while (it != responseText.end() && (*it == ' ' || *it == '\t')) ++it;
+	while (it != responseText.end() && !(*it == ' ' || *it == '\t')) ++it;
+	while (it != responseText.end() && (*it == ' ' || *it == '\t')) ++it;
+
+	if (it == responseText.end()) {
+		return false;
+	}
+
+	result = string(it, responseText.end());
+
+	return true;
+}
+
+
 
 class POP3MessageSetEnumerator : public messageSetEnumerator {
 
@@ -68,6 +68,22 @@ public:
 		std::map <size_t, string>& result
 	);
 
+	/** Parse a single-line response of type [integer] [string].
+	  * This is used in LIST or UIDL commands for a specific message:
+	  *
+	  *    C: UIDL 2
+	  *    S: +OK 2 QhdPYR:00WBw1Ph7x7
+	  *
+	  * @param response response as returned by the server
+	  * @param result receives the message data (either UID or size)
+	  * @return true if the response is successful and contains data,
+	  * false otherwise
+	  */
+	static bool parseListOrUidlResponse(
+		const shared_ptr <POP3Response>& response,
+		string& result
+	);
+
 	/** Returns a list of message numbers given a message set.
 	  *
 	  * @param msgs message set
@@ -88,7 +88,7 @@ void SMTPChunkingOutputStreamAdapter::sendChunk(
 	}
 
 	// If PIPELINING is not supported, read one response for this BDAT command
-	if (!m_connection->hasExtension("PIPELINING")) {
+	if (!m_connection->hasExtension(SMTPConnection::EXTENSION_PIPELINING)) {
 
 		shared_ptr <SMTPResponse> resp = m_connection->readResponse();
 
@@ -66,6 +66,28 @@ namespace net {
 namespace smtp {
 
 
+// Names of the extensions in SMTPConnection::Extensions
+static const char* const KNOWN_EXTENSIONS[] = {
+	"PIPELINING",
+	"SIZE",
+	"AUTH",
+	"STARTTLS",
+	"DSN",
+	"8BITMIME",
+	"BINARYMIME",
+	"CHUNKING",
+	"SMTPUTF8",
+	"ENHANCEDSTATUSCODES"
+};
+
+static const size_t KNOWN_EXTENSION_COUNT = sizeof(KNOWN_EXTENSIONS) / sizeof(KNOWN_EXTENSIONS[0]);
+
+static_assert(
+	KNOWN_EXTENSION_COUNT == SMTPConnection::EXTENSION_COUNT,
+	"KNOWN_EXTENSIONS must have an entry for each value of SMTPConnection::Extensions"
+);
+
+
 
 SMTPConnection::SMTPConnection(
 	const shared_ptr <SMTPTransport>& transport,
@@ -77,7 +99,8 @@ SMTPConnection::SMTPConnection(
 	  m_timeoutHandler(null),
 	  m_authenticated(false),
 	  m_secured(false),
-	  m_extendedSMTP(false) {
+	  m_extendedSMTP(false),
+	  m_extensions(KNOWN_EXTENSIONS, KNOWN_EXTENSION_COUNT) {
 
 	static int connectionId = 0;
 
@@ -266,7 +289,7 @@ void SMTPConnection::helo() {
 				params.push_back(utility::stringUtils::toUpper(param));
 			}
 
-			m_extensions[ext] = params;
+			m_extensions.add(ext, params);
 		}
 	}
 }
@@ -277,21 +300,24 @@ bool SMTPConnection::hasExtension(
 	std::vector <string>* params
 ) const {
 
-	std::map <string, std::vector <string> >::const_iterator
-		it = m_extensions.find(extName);
-
-	if (it != m_extensions.end()) {
+	if (params) {
+		return m_extensions.getParameters(extName, *params);
+	}
 
-		if (params) {
-			*params = (*it).second;
-		}
+	return m_extensions.has(extName);
+}
 
-		return true;
 
-	} else {
+bool SMTPConnection::hasExtension(
+	const Extensions ext,
+	std::vector <string>* params
+) const {
 
-		return false;
+	if (params) {
+		return m_extensions.getParameters(ext, *params);
 	}
+
+	return m_extensions.has(ext);
 }
 
 
@@ -327,7 +353,7 @@ void SMTPConnection::authenticate() {
 	if (m_secured) {
 
 		std::vector <string> authMechs;
-		hasExtension("AUTH", &authMechs);
+		hasExtension(EXTENSION_AUTH, &authMechs);
 
 		if (authMechs.empty()) {
 			throw exceptions::authentication_error("No AUTH mechanism available.");
@@ -379,7 +405,7 @@ void SMTPConnection::authenticateSASL() {
 
 	// Obtain SASL mechanisms supported by server from ESMTP extensions
 	std::vector <string> saslMechs;
-	hasExtension("AUTH", &saslMechs);
+	hasExtension(EXTENSION_AUTH, &saslMechs);
 
 	if (saslMechs.empty()) {
 		throw exceptions::authentication_error("No SASL mechanism available.");
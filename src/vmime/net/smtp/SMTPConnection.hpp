@@ -38,6 +38,7 @@
 #include "vmime/net/session.hpp"
 #include "vmime/net/connectionInfos.hpp"
 #include "vmime/net/tracer.hpp"
+#include "vmime/net/capabilitySet.hpp"
 
 #include "vmime/net/smtp/SMTPCommand.hpp"
 #include "vmime/net/smtp/SMTPResponse.hpp"
@@ -90,7 +91,26 @@ public:
 	void sendRequest(const shared_ptr <SMTPCommand>& cmd);
 	shared_ptr <SMTPResponse> readResponse();
 
+	/** Extensions known by this implementation, which can be tested
+	  * without looking up their name (see hasExtension()).
+	  */
+	enum Extensions {
+		EXTENSION_PIPELINING,
+		EXTENSION_SIZE,
+		EXTENSION_AUTH,
+		EXTENSION_STARTTLS,
+		EXTENSION_DSN,
+		EXTENSION_8BITMIME,
+		EXTENSION_BINARYMIME,
+		EXTENSION_CHUNKING,
+		EXTENSION_SMTPUTF8,
+		EXTENSION_ENHANCEDSTATUSCODES,
+
+		EXTENSION_COUNT
+	};
+
 	bool hasExtension(const std::string& extName, std::vector <string>* params = NULL) const;
+	bool hasExtension(const Extensions ext, std::vector <string>* params = NULL) const;
 
 private:
 
@@ -122,7 +142,7 @@ private:
 	shared_ptr <connectionInfos> m_cntInfos;
 
 	bool m_extendedSMTP;
-	std::map <string, std::vector <string> > m_extensions;
+	capabilitySet m_extensions;
 };
 
 
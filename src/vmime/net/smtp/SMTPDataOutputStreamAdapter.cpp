@@ -0,0 +1,131 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+
+#include "vmime/net/smtp/SMTPDataOutputStreamAdapter.hpp"
+
+#include "vmime/net/smtp/SMTPConnection.hpp"
+
+#include <algorithm>
+
+
+namespace vmime {
+namespace net {
+namespace smtp {
+
+
+SMTPDataOutputStreamAdapter::SMTPDataOutputStreamAdapter(
+	const shared_ptr <SMTPConnection>& conn,
+	const size_t size,
+	utility::progressListener* progress
+)
+	: m_connection(conn),
+	  m_bufferSize(0),
+	  m_totalSize(size),
+	  m_totalSent(0),
+	  m_progress(progress) {
+
+	if (progress) {
+		progress->start(size);
+	}
+}
+
+
+void SMTPDataOutputStreamAdapter::sendBuffer() {
+
+	if (m_bufferSize == 0) {
+		return;
+	}
+
+	m_connection->getSocket()->sendRaw(m_buffer, m_bufferSize);
+
+	m_totalSent += m_bufferSize;
+	m_bufferSize = 0;
+
+	if (m_progress) {
+
+		m_totalSize = std::max(m_totalSize, m_totalSent);
+		m_progress->progress(m_totalSent, m_totalSize);
+	}
+}
+
+
+void SMTPDataOutputStreamAdapter::writeImpl(
+	const byte_t* const data,
+	const size_t count
+) {
+
+	const byte_t* curData = data;
+	size_t curCount = count;
+
+	while (curCount != 0) {
+
+		// Fill the buffer
+		const size_t remaining = sizeof(m_buffer) - m_bufferSize;
+		const size_t bytesToCopy = std::min(remaining, curCount);
+
+		std::copy(curData, curData + bytesToCopy, m_buffer + m_bufferSize);
+
+		m_bufferSize += bytesToCopy;
+		curData += bytesToCopy;
+		curCount -= bytesToCopy;
+
+		// If the buffer is full, send it
+		if (m_bufferSize >= sizeof(m_buffer)) {
+			sendBuffer();
+		}
+	}
+}
+
+
+void SMTPDataOutputStreamAdapter::flush() {
+
+	sendBuffer();
+
+	if (m_progress) {
+		m_progress->stop(m_totalSize);
+	}
+
+	if (m_connection->getTracer()) {
+		m_connection->getTracer()->traceSendBytes(m_totalSent);
+	}
+}
+
+
+size_t SMTPDataOutputStreamAdapter::getBlockSize() {
+
+	return sizeof(m_buffer);
+}
+
+
+} // smtp
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
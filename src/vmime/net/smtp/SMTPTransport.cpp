@@ -32,6 +32,7 @@
 #include "vmime/net/smtp/SMTPCommand.hpp"
 #include "vmime/net/smtp/SMTPCommandSet.hpp"
 #include "vmime/net/smtp/SMTPChunkingOutputStreamAdapter.hpp"
+#include "vmime/net/smtp/SMTPDataOutputStreamAdapter.hpp"
 #include "vmime/net/smtp/SMTPExceptions.hpp"
 #include "vmime/net/smtp/SMTPSendOptions.hpp"
 
@@ -44,6 +45,7 @@
 #include "vmime/utility/outputStreamSocketAdapter.hpp"
 #include "vmime/utility/streamUtils.hpp"
 #include "vmime/utility/outputStreamAdapter.hpp"
+#include "vmime/utility/outputStreamStringAdapter.hpp"
 #include "vmime/utility/inputStreamStringAdapter.hpp"
 
 
@@ -179,13 +181,49 @@ bool SMTPTransport::mailboxNeedsUTF8(const mailbox& mb) {
 }
 
 
-void SMTPTransport::sendEnvelope(
+void SMTPTransport::throwEnvelopeError(
+	const shared_ptr <SMTPCommand>& cmd,
+	const shared_ptr <SMTPResponse>& resp
+) {
+
+	// SIZE extension: insufficient system storage
+	if (resp->getCode() == 452) {
+
+		throw SMTPMessageSizeExceedsCurLimitsException(
+			SMTPCommandError(
+				cmd->getText(), resp->getText(),
+				resp->getCode(), resp->getEnhancedCode()
+			)
+		);
+
+	// SIZE extension: message size exceeds fixed maximum message size
+	} else if (resp->getCode() == 552) {
+
+		throw SMTPMessageSizeExceedsMaxLimitsException(
+			SMTPCommandError(
+				cmd->getText(), resp->getText(),
+				resp->getCode(), resp->getEnhancedCode()
+			)
+		);
+
+	// Other error
+	} else {
+
+		throw SMTPCommandError(
+			cmd->getText(), resp->getText(),
+			resp->getCode(), resp->getEnhancedCode()
+		);
+	}
+}
+
+
+void SMTPTransport::createEnvelopeCommands(
 	const mailbox& expeditor,
 	const mailboxList& recipients,
 	const mailbox& sender,
-	bool sendDATACommand,
 	const size_t size,
-	const sendOptions& options
+	const sendOptions& options,
+	std::vector <shared_ptr <SMTPCommand> >& commands
 ) {
 
 	auto opts = dynamic_cast <const SMTPSendOptions*>(&options);
@@ -198,26 +236,12 @@ void SMTPTransport::sendEnvelope(
 	}
 
 	// If DSN extension is used, ensure it is supported by the server
-	if (opts && opts->getDSNAttributes() && !m_connection->hasExtension("DSN")) {
+	if (opts && opts->getDSNAttributes() && !m_connection->hasExtension(SMTPConnection::EXTENSION_DSN)) {
 		throw SMTPDSNExtensionNotSupportedException();
 	}
 
-
-	const bool needReset = m_needReset;
-	const bool hasPipelining = m_connection->hasExtension("PIPELINING") &&
-		getInfos().getPropertyValue <bool>(getSession(),
-			dynamic_cast <const SMTPServiceInfos&>(getInfos()).getProperties().PROPERTY_OPTIONS_PIPELINING);
-
-	shared_ptr <SMTPResponse> resp;
-	shared_ptr <SMTPCommandSet> commands = SMTPCommandSet::create(hasPipelining);
-
-	// Emit a "RSET" command if we previously sent a message on this connection
-	if (needReset) {
-		commands->addCommand(SMTPCommand::RSET());
-	}
-
 	// Check whether we need SMTPUTF8
-	const bool hasSMTPUTF8 = m_connection->hasExtension("SMTPUTF8");
+	const bool hasSMTPUTF8 = m_connection->hasExtension(SMTPConnection::EXTENSION_SMTPUTF8);
 	bool needSMTPUTF8 = false;
 
 	if (!sender.isEmpty()) {
@@ -233,41 +257,62 @@ void SMTPTransport::sendEnvelope(
 	}
 
 	// Emit the "MAIL" command
-	const bool hasSize = m_connection->hasExtension("SIZE");
-
-	if (!sender.isEmpty()) {
-
-		commands->addCommand(
-			SMTPCommand::MAIL(
-				sender, hasSMTPUTF8 && needSMTPUTF8, hasSize ? size : 0,
-				opts ? opts->getDSNAttributes() : nullptr
-			)
-		);
-
-	} else {
-
-		commands->addCommand(
-			SMTPCommand::MAIL(
-				expeditor, hasSMTPUTF8 && needSMTPUTF8, hasSize ? size : 0,
-				opts ? opts->getDSNAttributes() : nullptr
-			)
-		);
-	}
-
-	// Now, we will need to reset next time
-	m_needReset = true;
+	const bool hasSize = m_connection->hasExtension(SMTPConnection::EXTENSION_SIZE);
+
+	commands.push_back(
+		SMTPCommand::MAIL(
+			!sender.isEmpty() ? sender : expeditor,
+			hasSMTPUTF8 && needSMTPUTF8, hasSize ? size : 0,
+			opts ? opts->getDSNAttributes() : nullptr
+		)
+	);
 
 	// Emit a "RCPT TO" command for each recipient
 	for (size_t i = 0 ; i < recipients.getMailboxCount() ; ++i) {
 
 		const mailbox& mbox = *recipients.getMailboxAt(i);
-		commands->addCommand(
+		commands.push_back(
 			SMTPCommand::RCPT(
 				mbox, hasSMTPUTF8 && needSMTPUTF8,
 				opts ? opts->getDSNAttributes() : nullptr
 			)
 		);
 	}
+}
+
+
+void SMTPTransport::sendEnvelope(
+	const mailbox& expeditor,
+	const mailboxList& recipients,
+	const mailbox& sender,
+	bool sendDATACommand,
+	const size_t size,
+	const sendOptions& options
+) {
+
+	std::vector <shared_ptr <SMTPCommand> > envelope;
+	createEnvelopeCommands(expeditor, recipients, sender, size, options, envelope);
+
+	const bool needReset = m_needReset;
+	const bool hasPipelining = m_connection->hasExtension(SMTPConnection::EXTENSION_PIPELINING) &&
+		getInfos().getPropertyValue <bool>(getSession(),
+			dynamic_cast <const SMTPServiceInfos&>(getInfos()).getProperties().PROPERTY_OPTIONS_PIPELINING);
+
+	shared_ptr <SMTPResponse> resp;
+	shared_ptr <SMTPCommandSet> commands = SMTPCommandSet::create(hasPipelining);
+
+	// Emit a "RSET" command if we previously sent a message on this connection
+	if (needReset) {
+		commands->addCommand(SMTPCommand::RSET());
+	}
+
+	// Emit the "MAIL" and "RCPT TO" commands
+	for (size_t i = 0 ; i < envelope.size() ; ++i) {
+		commands->addCommand(envelope[i]);
+	}
+
+	// Now, we will need to reset next time
+	m_needReset = true;
 
 	// Prepare sending of message data
 	if (sendDATACommand) {
@@ -299,34 +344,11 @@ void SMTPTransport::sendEnvelope(
 
 	if ((resp = m_connection->readResponse())->getCode() != 250) {
 
-		// SIZE extension: insufficient system storage
-		if (resp->getCode() == 452) {
-
-			throw SMTPMessageSizeExceedsCurLimitsException(
-				SMTPCommandError(
-					commands->getLastCommandSent()->getText(), resp->getText(),
-					resp->getCode(), resp->getEnhancedCode()
-				)
-			);
-
-		// SIZE extension: message size exceeds fixed maximum message size
-		} else if (resp->getCode() == 552) {
-
-			throw SMTPMessageSizeExceedsMaxLimitsException(
-				SMTPCommandError(
-					commands->getLastCommandSent()->getText(), resp->getText(),
-				 	resp->getCode(), resp->getEnhancedCode()
-				 )
-			);
-
-		// Other error
-		} else {
-
-			throw SMTPCommandError(
-				commands->getLastCommandSent()->getText(), resp->getText(),
-				resp->getCode(), resp->getEnhancedCode()
-			);
+		if (hasPipelining) {
+			readPipelinedReplies(recipients.getMailboxCount() + (sendDATACommand ? 1 : 0), sendDATACommand);
 		}
+
+		throwEnvelopeError(commands->getLastCommandSent(), resp);
 	}
 
 	// Read responses for "RCPT TO" commands
@@ -339,34 +361,11 @@ void SMTPTransport::sendEnvelope(
 		if (resp->getCode() != 250 &&
 		    resp->getCode() != 251) {
 
-			// SIZE extension: insufficient system storage
-			if (resp->getCode() == 452) {
-
-				throw SMTPMessageSizeExceedsCurLimitsException(
-					SMTPCommandError(
-						commands->getLastCommandSent()->getText(), resp->getText(),
-						resp->getCode(), resp->getEnhancedCode()
-					)
-				);
-
-			// SIZE extension: message size exceeds fixed maximum message size
-			} else if (resp->getCode() == 552) {
-
-				throw SMTPMessageSizeExceedsMaxLimitsException(
-					SMTPCommandError(
-						commands->getLastCommandSent()->getText(), resp->getText(),
-						resp->getCode(), resp->getEnhancedCode()
-					)
-				);
-
-			// Other error
-			} else {
-
-				throw SMTPCommandError(
-					commands->getLastCommandSent()->getText(), resp->getText(),
-					resp->getCode(), resp->getEnhancedCode()
-				);
+			if (hasPipelining) {
+				readPipelinedReplies(recipients.getMailboxCount() - i - 1 + (sendDATACommand ? 1 : 0), sendDATACommand);
 			}
+
+			throwEnvelopeError(commands->getLastCommandSent(), resp);
 		}
 	}
 
@@ -386,6 +385,32 @@ void SMTPTransport::sendEnvelope(
 }
 
 
+void SMTPTransport::readPipelinedReplies(const size_t count, const bool lastIsDATA) {
+
+	try {
+
+		for (size_t i = 0 ; i < count ; ++i) {
+
+			shared_ptr <SMTPResponse> resp = m_connection->readResponse();
+
+			// The server is waiting for the message data (some recipients
+			// have been accepted): the transaction cannot be cancelled
+			// without sending the message, so close the connection
+			if (lastIsDATA && i + 1 == count && resp->getCode() == 354) {
+				disconnect();
+			}
+		}
+
+	} catch (exception&) {
+
+		// The replies cannot be read: the connection cannot be reused
+		if (isConnected()) {
+			disconnect();
+		}
+	}
+}
+
+
 void SMTPTransport::send(
 	const mailbox& expeditor,
 	const mailboxList& recipients,
@@ -404,9 +429,10 @@ void SMTPTransport::send(
 	sendEnvelope(expeditor, recipients, sender, /* sendDATACommand */ true, size, options);
 
 	// Send the message data
-	// Stream copy with "\n." to "\n.." transformation
+	// Stream copy with dot-stuffing; the data is sent as-is otherwise, so
+	// that the number of bytes sent matches the size given in the envelope
 	utility::outputStreamSocketAdapter sos(*m_connection->getSocket());
-	utility::dotFilteredOutputStream fos(sos);
+	utility::SMTPDataFilteredOutputStream fos(sos, /* normalizeLineBreaks */ false);
 
 	utility::bufferedStreamCopy(is, fos, size, progress);
 
@@ -444,41 +470,444 @@ void SMTPTransport::send(
 	// Generate the message with Internationalized Email support,
 	// if this is supported by the SMTP server
 	generationContext ctx(generationContext::getDefaultContext());
-	ctx.setInternationalizedEmailSupport(m_connection->hasExtension("SMTPUTF8"));
+	ctx.setInternationalizedEmailSupport(m_connection->hasExtension(SMTPConnection::EXTENSION_SMTPUTF8));
+
+	// The exact size of the message is only needed for SIZE extension
+	// and progress notification. It is computed without storing the
+	// generated message (the size of encoded contents is memoized, see
+	// component::getExactGeneratedSize()), then the message is generated
+	// again to be sent.
+	// If some contents cannot be read twice (eg. a stream which cannot be
+	// reset), the message is generated only once, into memory.
+	size_t msgSize = 0;
+	string msgData;
+	bool msgBuffered = false;
+
+	if (progress || m_connection->hasExtension(SMTPConnection::EXTENSION_SIZE)) {
+
+		if (msg->getBody()->isBuffered()) {
+
+			msgSize = msg->getExactGeneratedSize(ctx);
 
-	// If CHUNKING is not supported, generate the message to a temporary
-	// buffer then use the send() method which takes an inputStream
-	if (!m_connection->hasExtension("CHUNKING") ||
+		} else {
+
+			utility::outputStreamStringAdapter msgDataAdapter(msgData);
+			msg->generate(ctx, msgDataAdapter);
+
+			msgSize = msgData.length();
+			msgBuffered = true;
+		}
+	}
+
+	// If CHUNKING is not supported, generate the message directly to the
+	// connection after the DATA command
+	if (!m_connection->hasExtension(SMTPConnection::EXTENSION_CHUNKING) ||
 	    !getInfos().getPropertyValue <bool>(getSession(),
 			dynamic_cast <const SMTPServiceInfos&>(getInfos()).getProperties().PROPERTY_OPTIONS_CHUNKING)) {
 
-		std::ostringstream oss;
-		utility::outputStreamAdapter ossAdapter(oss);
+		// Send message envelope
+		sendEnvelope(expeditor, recipients, sender, /* sendDATACommand */ true, msgSize, options);
+
+		// Send the message data, with dot-stuffing and CRLF line endings
+		SMTPDataOutputStreamAdapter dataStream(m_connection, msgSize, progress);
+		utility::SMTPDataFilteredOutputStream fos(dataStream);
+
+		if (msgBuffered) {
+			fos.write(msgData.data(), msgData.length());
+		} else {
+			msg->generate(ctx, fos);
+		}
+
+		fos.flush();
 
-		msg->generate(ctx, ossAdapter);
+		// Send end-of-data delimiter
+		m_connection->getSocket()->send("\r\n.\r\n");
 
-		const string& str(oss.str());
+		if (m_connection->getTracer()) {
+			m_connection->getTracer()->traceSend(".");
+		}
 
-		utility::inputStreamStringAdapter isAdapter(str);
+		shared_ptr <SMTPResponse> resp;
+
+		if ((resp = m_connection->readResponse())->getCode() != 250) {
+			throw SMTPCommandError("DATA", resp->getText(), resp->getCode(), resp->getEnhancedCode());
+		}
 
-		send(expeditor, recipients, isAdapter, str.length(), progress, sender, options);
 		return;
 	}
 
 	// Send message envelope
-	const size_t msgSize = msg->getGeneratedSize(ctx);
-
 	sendEnvelope(expeditor, recipients, sender, /* sendDATACommand */ false, msgSize, options);
 
 	// Send the message by chunks
 	SMTPChunkingOutputStreamAdapter chunkStream(m_connection, msgSize, progress);
 
-	msg->generate(ctx, chunkStream);
+	if (msgBuffered) {
+		chunkStream.write(msgData.data(), msgData.length());
+	} else {
+		msg->generate(ctx, chunkStream);
+	}
 
 	chunkStream.flush();
 }
 
 
+SMTPTransport::bulkMessage::bulkMessage(
+	const shared_ptr <vmime::message>& msg,
+	const mailbox& expeditor,
+	const mailboxList& recipients,
+	const mailbox& sender
+)
+	: message(msg),
+	  expeditor(expeditor),
+	  recipients(recipients),
+	  sender(sender) {
+
+}
+
+
+size_t SMTPTransport::prepareBulkMessage(
+	const std::vector <bulkMessage>& messages,
+	size_t index,
+	const generationContext& ctx,
+	const sendOptions& options,
+	std::vector <shared_ptr <SMTPCommand> >& commands,
+	string& data,
+	bulkErrorList& skipped
+) {
+
+	for ( ; index < messages.size() ; ++index) {
+
+		const bulkMessage& bm = messages[index];
+
+		// Generate the message with dot-stuffing and CRLF line endings
+		data.clear();
+
+		utility::outputStreamStringAdapter dataAdapter(data);
+		utility::SMTPDataFilteredOutputStream fos(dataAdapter);
+
+		bm.message->generate(ctx, fos);
+
+		fos.flush();
+
+		// The size of the message is only needed for SIZE extension; the
+		// length of the data exceeds it by the number of doubled dots, which
+		// is negligible and avoids generating the message a second time
+		const size_t msgSize = m_connection->hasExtension(SMTPConnection::EXTENSION_SIZE)
+			? data.length() : 0;
+
+		commands.clear();
+
+		try {
+
+			createEnvelopeCommands(
+				bm.expeditor, bm.recipients, bm.sender,
+				msgSize, options, commands
+			);
+
+		} catch (SMTPDSNExtensionNotSupportedException& e) {
+
+			skipped.push_back(std::make_pair(index, shared_ptr <exception>(e.clone())));
+			continue;
+
+		} catch (exceptions::no_recipient& e) {
+
+			skipped.push_back(std::make_pair(index, shared_ptr <exception>(e.clone())));
+			continue;
+
+		} catch (exceptions::no_expeditor& e) {
+
+			skipped.push_back(std::make_pair(index, shared_ptr <exception>(e.clone())));
+			continue;
+		}
+
+		commands.push_back(SMTPCommand::DATA());
+
+		return index;
+	}
+
+	return messages.size();
+}
+
+
+// static
+void SMTPTransport::reportBulkErrors(bulkSendListener& listener, bulkErrorList& errors) {
+
+	for (size_t i = 0 ; i < errors.size() ; ++i) {
+		listener.messageFailed(errors[i].first, *errors[i].second);
+	}
+
+	errors.clear();
+}
+
+
+// static
+void SMTPTransport::appendCommands(string& buffer, const std::vector <shared_ptr <SMTPCommand> >& commands) {
+
+	for (size_t i = 0 ; i < commands.size() ; ++i) {
+		buffer += commands[i]->getText() + "\r\n";
+	}
+}
+
+
+void SMTPTransport::traceCommands(const std::vector <shared_ptr <SMTPCommand> >& commands) {
+
+	shared_ptr <tracer> tr = m_connection->getTracer();
+
+	if (tr) {
+
+		for (size_t i = 0 ; i < commands.size() ; ++i) {
+			tr->traceSend(commands[i]->getTraceText());
+		}
+	}
+}
+
+
+void SMTPTransport::sendMessages(
+	const std::vector <bulkMessage>& messages,
+	bulkSendListener& listener,
+	const sendOptions& options
+) {
+
+	if (!isConnected()) {
+		throw exceptions::not_connected();
+	}
+
+	const bool hasPipelining = m_connection->hasExtension(SMTPConnection::EXTENSION_PIPELINING) &&
+		getInfos().getPropertyValue <bool>(getSession(),
+			dynamic_cast <const SMTPServiceInfos&>(getInfos()).getProperties().PROPERTY_OPTIONS_PIPELINING);
+
+	generationContext ctx(generationContext::getDefaultContext());
+	ctx.setInternationalizedEmailSupport(m_connection->hasExtension(SMTPConnection::EXTENSION_SMTPUTF8));
+
+	shared_ptr <socket> sok = m_connection->getSocket();
+	shared_ptr <tracer> tr = m_connection->getTracer();
+
+	const size_t count = messages.size();
+
+	std::vector <shared_ptr <SMTPCommand> > commands, nextCommands;
+	string data, nextData;
+
+	// Messages which could not be prepared, reported to the listener
+	// once the result of the previous messages is known
+	bulkErrorList skipped;
+
+	size_t index = prepareBulkMessage(messages, 0, ctx, options, nextCommands, nextData, skipped);
+
+	reportBulkErrors(listener, skipped);
+
+	if (index == count) {
+		return;
+	}
+
+	// Send the envelope of the first message, preceded by a "RSET"
+	// command if we previously sent a message on this connection
+	bool resetSent = m_needReset;
+
+	commands.swap(nextCommands);
+	data.swap(nextData);
+
+	if (resetSent) {
+		commands.insert(commands.begin(), SMTPCommand::RSET());
+	}
+
+	string buffer;
+
+	if (hasPipelining) {
+
+		appendCommands(buffer, commands);
+
+		sok->send(buffer);
+		traceCommands(commands);
+	}
+
+	m_needReset = true;
+
+	while (index < count) {
+
+		// Generate the next message; with pipelining, this is done
+		// while the server processes the envelope of this one
+		size_t nextIndex;
+
+		try {
+
+			nextIndex = prepareBulkMessage(messages, index + 1, ctx, options, nextCommands, nextData, skipped);
+
+		} catch (...) {
+
+			// The replies to the pipelined commands have not been read:
+			// the connection cannot be used anymore
+			if (hasPipelining) {
+				disconnect();
+			}
+
+			throw;
+		}
+
+		shared_ptr <exception> error;
+		shared_ptr <SMTPResponse> resp;
+
+		mailboxList refused;
+
+		size_t cmd = 0;
+
+		// Read response for "RSET" command
+		if (resetSent) {
+
+			if (!hasPipelining) {
+				m_connection->sendRequest(commands[cmd]);
+			}
+
+			resp = m_connection->readResponse();
+
+			if (resp->getCode() != 250 &&
+			    resp->getCode() != 200) {
+
+				disconnect();
+
+				throw SMTPCommandError(
+					commands[cmd]->getText(), resp->getText(),
+					resp->getCode(), resp->getEnhancedCode()
+				);
+			}
+
+			++cmd;
+		}
+
+		// Index of the first "RCPT TO" command
+		const size_t firstRcpt = cmd + 1;
+
+		// Read responses for "MAIL", "RCPT TO" and "DATA" commands; the
+		// server will accept data as long as at least one recipient is valid
+		for ( ; cmd < commands.size() ; ++cmd) {
+
+			const bool isDATA = (cmd + 1 == commands.size());
+
+			// Without pipelining, commands are sent one at a time, until
+			// "MAIL" or all the "RCPT TO" commands have been refused
+			if (!hasPipelining) {
+
+				if (error && (refused.isEmpty() ||
+				              (isDATA && refused.getMailboxCount() == cmd - firstRcpt))) {
+
+					break;
+				}
+
+				m_connection->sendRequest(commands[cmd]);
+			}
+
+			resp = m_connection->readResponse();
+
+			const int code = resp->getCode();
+
+			if (isDATA ? code == 354 : (code == 250 || code == 251)) {
+				continue;
+			}
+
+			if (!isDATA && cmd >= firstRcpt) {
+
+				refused.appendMailbox(vmime::clone(
+					messages[index].recipients.getMailboxAt(cmd - firstRcpt)
+				));
+			}
+
+			if (!error) {
+
+				try {
+
+					if (isDATA) {
+
+						throw SMTPCommandError(
+							commands[cmd]->getText(), resp->getText(),
+							resp->getCode(), resp->getEnhancedCode()
+						);
+
+					} else {
+
+						throwEnvelopeError(commands[cmd], resp);
+					}
+
+				} catch (exception& e) {
+
+					error.reset(e.clone());
+				}
+			}
+		}
+
+		const bool dataAccepted = (resp->getCode() == 354);
+
+		buffer.clear();
+
+		// Send the message data and the end-of-data delimiter, along with
+		// the envelope of the next message. If the transaction failed, the
+		// next one must start with a "RSET" command.
+		if (dataAccepted) {
+			buffer = data + "\r\n.\r\n";
+		} else if (nextIndex < count) {
+			nextCommands.insert(nextCommands.begin(), SMTPCommand::RSET());
+		}
+
+		const bool sendNextCommands = hasPipelining && nextIndex < count;
+
+		if (sendNextCommands) {
+			appendCommands(buffer, nextCommands);
+		}
+
+		if (!buffer.empty()) {
+
+			sok->send(buffer);
+
+			if (tr && dataAccepted) {
+				tr->traceSendBytes(data.length());
+				tr->traceSend(".");
+			}
+
+			if (sendNextCommands) {
+				traceCommands(nextCommands);
+			}
+		}
+
+		// Read response for end-of-data delimiter
+		if (dataAccepted) {
+
+			resp = m_connection->readResponse();
+
+			if (resp->getCode() != 250) {
+
+				listener.messageFailed(
+					index,
+					SMTPCommandError(
+						"DATA", resp->getText(),
+						resp->getCode(), resp->getEnhancedCode()
+					)
+				);
+
+			} else if (!refused.isEmpty()) {
+
+				// Delivered to the accepted recipients only
+				listener.messagePartiallySent(index, refused);
+
+			} else {
+
+				listener.messageSent(index);
+			}
+
+		} else {
+
+			listener.messageFailed(index, *error);
+		}
+
+		reportBulkErrors(listener, skipped);
+
+		resetSent = !dataAccepted;
+		index = nextIndex;
+
+		commands.swap(nextCommands);
+		data.swap(nextData);
+	}
+}
+
+
 
 // Service infos
 
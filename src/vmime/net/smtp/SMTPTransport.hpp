@@ -38,6 +38,8 @@
 #include "vmime/net/smtp/SMTPServiceInfos.hpp"
 #include "vmime/net/smtp/SMTPConnection.hpp"
 
+#include <vector>
+
 
 namespace vmime {
 namespace net {
@@ -45,6 +47,7 @@ namespace smtp {
 
 
 class SMTPCommand;
+class SMTPResponse;
 
 
 /** SMTP transport service.
@@ -91,6 +94,87 @@ public:
 		const sendOptions& options = sendOptions()
 	);
 
+	/** A message to be sent with sendMessages(), along with its envelope.
+	  */
+	class VMIME_EXPORT bulkMessage {
+
+	public:
+
+		bulkMessage(
+			const shared_ptr <vmime::message>& msg,
+			const mailbox& expeditor,
+			const mailboxList& recipients,
+			const mailbox& sender = mailbox()
+		);
+
+		shared_ptr <vmime::message> message;
+		mailbox expeditor;
+		mailboxList recipients;
+		mailbox sender;
+	};
+
+	/** Receives the result of each message sent with sendMessages(),
+	  * as soon as the server has replied for this message. Results
+	  * are reported in the order of the messages.
+	  */
+	class VMIME_EXPORT bulkSendListener {
+
+	public:
+
+		virtual ~bulkSendListener() { }
+
+		/** Called when the server has accepted a message.
+		  *
+		  * @param index index of the message in the list
+		  */
+		virtual void messageSent(const size_t index) = 0;
+
+		/** Called when the server has accepted a message, but refused
+		  * some of its recipients. The message has been delivered to the
+		  * other recipients, so it must not be sent again to them.
+		  *
+		  * @param index index of the message in the list
+		  * @param refusedRecipients recipients which have been refused
+		  */
+		virtual void messagePartiallySent(const size_t index, const mailboxList& refusedRecipients) = 0;
+
+		/** Called when a message could not be sent. The session
+		  * is still usable and the next messages will be sent.
+		  *
+		  * @param index index of the message in the list
+		  * @param err reason of the failure (eg. SMTPCommandError)
+		  */
+		virtual void messageFailed(const size_t index, const exception& err) = 0;
+	};
+
+	/** Send several messages over the current session.
+	  *
+	  * If the server supports PIPELINING, the envelope (MAIL, RCPT
+	  * and DATA commands) of the next message is sent along with
+	  * the data and end-of-data delimiter of the previous message,
+	  * so that each message costs a single round-trip instead of one
+	  * per command. Otherwise, commands are sent one at a time.
+	  *
+	  * Errors which only affect one message (rejected sender or
+	  * recipient, size limits, etc.) are reported to the listener and
+	  * do not stop the batch. Connection errors are thrown.
+	  *
+	  * If only some of the recipients of a message are rejected, the
+	  * message is delivered to the other recipients and reported with
+	  * bulkSendListener::messagePartiallySent(), along with the refused
+	  * recipients, whether pipelining is used or not.
+	  *
+	  * @param messages messages to send
+	  * @param listener receives the result for each message
+	  * @param options sending options (applied to all messages)
+	  * @throw exceptions::not_connected if the transport is not connected
+	  */
+	void sendMessages(
+		const std::vector <bulkMessage>& messages,
+		bulkSendListener& listener,
+		const sendOptions& options = sendOptions()
+	);
+
 	bool isSecuredConnection() const;
 	shared_ptr <connectionInfos> getConnectionInfos() const;
 	shared_ptr <SMTPConnection> getConnection();
@@ -101,6 +185,35 @@ private:
 
 	static bool mailboxNeedsUTF8(const mailbox& mb);
 
+	/** Throws the exception matching an error response to a MAIL
+	  * or RCPT command.
+	  *
+	  * @param cmd command which failed
+	  * @param resp response received from the server
+	  */
+	static void throwEnvelopeError(
+		const shared_ptr <SMTPCommand>& cmd,
+		const shared_ptr <SMTPResponse>& resp
+	);
+
+	/** Create the MAIL and RCPT commands for the specified envelope.
+	  *
+	  * @param expeditor expeditor mailbox
+	  * @param recipients list of recipient mailboxes
+	  * @param sender envelope sender (if empty, expeditor will be used)
+	  * @param size message size, in bytes (or 0, if not known)
+	  * @param options sending options
+	  * @param commands receives the commands to send
+	  */
+	void createEnvelopeCommands(
+		const mailbox& expeditor,
+		const mailboxList& recipients,
+		const mailbox& sender,
+		const size_t size,
+		const sendOptions& options,
+		std::vector <shared_ptr <SMTPCommand> >& commands
+	);
+
 	/** Send the MAIL and RCPT commands to the server, checking the
 	  * response, and using pipelining if supported by the server.
 	  * Optionally, the DATA command can also be sent.
@@ -122,6 +235,70 @@ private:
 	);
 
 
+	/** Read the replies to the commands which have been pipelined
+	  * after a MAIL or RCPT command which failed, so that the connection
+	  * can be used for the next message (the transaction is reset with
+	  * RSET before the next message is sent). If the connection cannot
+	  * be reused, it is closed.
+	  *
+	  * @param count number of replies to read
+	  * @param lastIsDATA whether the last pipelined command is DATA
+	  */
+	void readPipelinedReplies(const size_t count, const bool lastIsDATA);
+
+
+	/** Messages of a batch which could not be sent, along with the error.
+	  */
+	typedef std::vector <std::pair <size_t, shared_ptr <exception> > > bulkErrorList;
+
+	/** Prepare the next message of a batch sent with sendMessages():
+	  * generate its data, with dot-stuffing and CRLF line endings, and
+	  * the commands of its envelope, ending with DATA. Messages whose
+	  * envelope cannot be created are skipped.
+	  *
+	  * @param messages messages of the batch
+	  * @param index index of the first message to consider
+	  * @param ctx generation context
+	  * @param options sending options
+	  * @param commands receives the envelope commands
+	  * @param data receives the message data
+	  * @param skipped receives the messages which have been skipped
+	  * @return index of the prepared message, or the number of messages
+	  * if no message is left to send
+	  */
+	size_t prepareBulkMessage(
+		const std::vector <bulkMessage>& messages,
+		size_t index,
+		const generationContext& ctx,
+		const sendOptions& options,
+		std::vector <shared_ptr <SMTPCommand> >& commands,
+		string& data,
+		bulkErrorList& skipped
+	);
+
+	/** Report failed messages to the listener, and clear the list.
+	  *
+	  * @param listener listener to notify
+	  * @param errors messages which could not be sent
+	  */
+	static void reportBulkErrors(bulkSendListener& listener, bulkErrorList& errors);
+
+	/** Append the text of the specified commands to a buffer, to send
+	  * them at once.
+	  *
+	  * @param buffer buffer to which the commands will be appended
+	  * @param commands commands to append
+	  */
+	static void appendCommands(string& buffer, const std::vector <shared_ptr <SMTPCommand> >& commands);
+
+	/** Trace the specified commands, once they have been sent with
+	  * the data of a buffer filled by appendCommands().
+	  *
+	  * @param commands commands which have been sent
+	  */
+	void traceCommands(const std::vector <shared_ptr <SMTPCommand> >& commands);
+
+
 	shared_ptr <SMTPConnection> m_connection;
 
 
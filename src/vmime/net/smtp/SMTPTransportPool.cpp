@@ -0,0 +1,557 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
+
+
+#include "vmime/net/smtp/SMTPTransportPool.hpp"
+#include "vmime/net/smtp/SMTPExceptions.hpp"
+
+#include "vmime/platform.hpp"
+#include "vmime/exception.hpp"
+
+#include "vmime/utility/stringUtils.hpp"
+#include "vmime/utility/sync/autoLock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+
+namespace vmime {
+namespace net {
+namespace smtp {
+
+
+SMTPTransportPool::SMTPTransportPool(const shared_ptr <session>& sess)
+	: m_session(sess),
+	  m_maxConnectionsPerDestination(4),
+	  m_maxIdleTime(60),
+	  m_healthCheckInterval(10),
+	  m_acquireTimeout(0),
+	  m_lock(platform::getHandler()->createCriticalSection()) {
+
+}
+
+
+SMTPTransportPool::~SMTPTransportPool() {
+
+	for (std::map <string, shared_ptr <destination> >::iterator it = m_destinations.begin() ;
+	     it != m_destinations.end() ; ++it) {
+
+		for (std::list <idleTransport>::iterator jt = it->second->idle.begin() ;
+		     jt != it->second->idle.end() ; ++jt) {
+
+			closeTransport(jt->transport);
+		}
+	}
+}
+
+
+void SMTPTransportPool::setMaxConnectionsPerDestination(const size_t count) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_maxConnectionsPerDestination = std::max(count, static_cast <size_t>(1));
+
+	// Waiting callers may now be able to open a connection
+	for (std::map <string, shared_ptr <destination> >::iterator it = m_destinations.begin() ;
+	     it != m_destinations.end() ; ++it) {
+
+		it->second->released.notify_all();
+	}
+}
+
+
+size_t SMTPTransportPool::getMaxConnectionsPerDestination() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	return m_maxConnectionsPerDestination;
+}
+
+
+void SMTPTransportPool::setMaxIdleTime(const unsigned int secs) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_maxIdleTime = secs;
+}
+
+
+unsigned int SMTPTransportPool::getMaxIdleTime() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	return m_maxIdleTime;
+}
+
+
+void SMTPTransportPool::setHealthCheckInterval(const unsigned int secs) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_healthCheckInterval = secs;
+}
+
+
+unsigned int SMTPTransportPool::getHealthCheckInterval() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	return m_healthCheckInterval;
+}
+
+
+void SMTPTransportPool::setAcquireTimeout(const unsigned int secs) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_acquireTimeout = secs;
+}
+
+
+unsigned int SMTPTransportPool::getAcquireTimeout() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	return m_acquireTimeout;
+}
+
+
+void SMTPTransportPool::setSocketFactory(const shared_ptr <socketFactory>& sf) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_socketFactory = sf;
+}
+
+
+void SMTPTransportPool::setTimeoutHandlerFactory(const shared_ptr <timeoutHandlerFactory>& thf) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_timeoutHandlerFactory = thf;
+}
+
+
+#if VMIME_HAVE_TLS_SUPPORT
+
+void SMTPTransportPool::setCertificateVerifier(const shared_ptr <security::cert::certificateVerifier>& cv) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	m_certificateVerifier = cv;
+}
+
+#endif // VMIME_HAVE_TLS_SUPPORT
+
+
+// static
+const string SMTPTransportPool::getDestinationKey(const utility::url& url) {
+
+	std::ostringstream key;
+	key.imbue(std::locale::classic());
+
+	key << utility::stringUtils::toLower(url.getProtocol()) << "://"
+	    << url.getUsername() << ':' << url.getPassword() << '@'
+	    << utility::stringUtils::toLower(url.getHost()) << ':' << url.getPort();
+
+	return key.str();
+}
+
+
+shared_ptr <SMTPTransportPool::destination> SMTPTransportPool::getDestination(const utility::url& url) {
+
+	const string key = getDestinationKey(url);
+
+	std::map <string, shared_ptr <destination> >::iterator it = m_destinations.find(key);
+
+	if (it != m_destinations.end()) {
+		return it->second;
+	}
+
+	// Server address and credentials are stored in the session
+	// properties, so each destination needs its own session
+	shared_ptr <destination> dest = make_shared <destination>();
+	dest->sess = session::create(m_session->getProperties());
+	dest->configured = false;
+	dest->activeCount = 0;
+
+#if VMIME_HAVE_TLS_SUPPORT
+	dest->sess->setTLSProperties(m_session->getTLSProperties());
+#endif // VMIME_HAVE_TLS_SUPPORT
+
+	m_destinations[key] = dest;
+
+	return dest;
+}
+
+
+shared_ptr <SMTPTransport> SMTPTransportPool::createTransport(
+	const shared_ptr <destination>& dest,
+	const utility::url& url
+) {
+
+	// Apply the URL to the session only once, as other transports
+	// may be reading the session properties at the same time
+	shared_ptr <transport> tr;
+
+	if (dest->configured) {
+		tr = dest->sess->getTransport(url.getProtocol());
+	} else {
+		tr = dest->sess->getTransport(url);
+	}
+
+	shared_ptr <SMTPTransport> smtpTr = dynamicCast <SMTPTransport>(tr);
+
+	if (!smtpTr) {
+		throw exceptions::no_factory_available("No SMTP transport for protocol '" + url.getProtocol() + "'.");
+	}
+
+	dest->configured = true;
+
+	if (m_socketFactory) {
+		smtpTr->setSocketFactory(m_socketFactory);
+	}
+
+	if (m_timeoutHandlerFactory) {
+		smtpTr->setTimeoutHandlerFactory(m_timeoutHandlerFactory);
+	}
+
+#if VMIME_HAVE_TLS_SUPPORT
+	if (m_certificateVerifier) {
+		smtpTr->setCertificateVerifier(m_certificateVerifier);
+	}
+#endif // VMIME_HAVE_TLS_SUPPORT
+
+	return smtpTr;
+}
+
+
+// static
+void SMTPTransportPool::closeTransport(const shared_ptr <SMTPTransport>& tr) {
+
+	try {
+
+		if (tr->isConnected()) {
+			tr->disconnect();
+		}
+
+	} catch (exception&) {
+
+		// Ignore
+	}
+}
+
+
+void SMTPTransportPool::takeExpiredTransports(
+	const shared_ptr <destination>& dest,
+	const unsigned long now,
+	std::vector <shared_ptr <SMTPTransport> >& expired
+) {
+
+	// Transports are sorted by release time
+	while (!dest->idle.empty() &&
+	       now >= dest->idle.front().releaseTime + m_maxIdleTime) {
+
+		expired.push_back(dest->idle.front().transport);
+		dest->idle.pop_front();
+	}
+}
+
+
+shared_ptr <SMTPTransport> SMTPTransportPool::acquire(const utility::url& url) {
+
+	std::chrono::steady_clock::time_point deadline;
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+		deadline = std::chrono::steady_clock::now() + std::chrono::seconds(m_acquireTimeout);
+	}
+
+	while (true) {
+
+		std::vector <shared_ptr <SMTPTransport> > expired;
+		shared_ptr <destination> dest;
+		idleTransport idle;
+		bool needCheck = false;
+		shared_ptr <SMTPTransport> newTransport;
+
+		{
+			utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+			dest = getDestination(url);
+
+			const unsigned long now = platform::getHandler()->getUnixTime();
+
+			// Close transports which have been idle for too long
+			takeExpiredTransports(dest, now, expired);
+
+			if (!expired.empty()) {
+
+				// Transports are closed below, without holding the lock
+
+			// Reuse the most recently released transport, checking it is
+			// still alive if it has not been used for some time
+			} else if (!dest->idle.empty()) {
+
+				idle = dest->idle.back();
+				dest->idle.pop_back();
+
+				++dest->activeCount;
+
+				needCheck = (now >= idle.releaseTime + m_healthCheckInterval);
+
+			// Open a new connection if the limit is not reached
+			} else if (dest->activeCount < m_maxConnectionsPerDestination) {
+
+				newTransport = createTransport(dest, url);
+
+				++dest->activeCount;
+
+			// Wait for a transport to be released (this releases the
+			// lock while waiting), then try again
+			} else if (m_acquireTimeout == 0) {
+
+				dest->released.wait(*m_lock);
+
+			} else {
+
+				if (std::chrono::steady_clock::now() >= deadline) {
+					throw exceptions::operation_timed_out();
+				}
+
+				dest->released.wait_until(*m_lock, deadline);
+			}
+		}
+
+		if (!expired.empty()) {
+
+			for (size_t i = 0 ; i < expired.size() ; ++i) {
+				closeTransport(expired[i]);
+			}
+
+		} else if (idle.transport) {
+
+			bool alive = idle.transport->isConnected();
+
+			if (alive && needCheck) {
+
+				try {
+
+					idle.transport->noop();
+
+				} catch (exception&) {
+
+					alive = false;
+				}
+			}
+
+			if (!alive) {
+				closeTransport(idle.transport);
+			}
+
+			utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+			if (alive) {
+
+				m_activeTransports[idle.transport.get()] = dest;
+				return idle.transport;
+			}
+
+			--dest->activeCount;
+
+			dest->released.notify_one();
+
+		} else if (newTransport) {
+
+			try {
+
+				newTransport->connect();
+
+			} catch (...) {
+
+				utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+				--dest->activeCount;
+
+				dest->released.notify_one();
+
+				throw;
+			}
+
+			utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+			m_activeTransports[newTransport.get()] = dest;
+
+			return newTransport;
+		}
+	}
+}
+
+
+void SMTPTransportPool::release(const shared_ptr <SMTPTransport>& tr) {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	std::map <SMTPTransport*, shared_ptr <destination> >::iterator it =
+		m_activeTransports.find(tr.get());
+
+	if (it == m_activeTransports.end()) {
+		return;  // not from this pool
+	}
+
+	shared_ptr <destination> dest = it->second;
+	m_activeTransports.erase(it);
+
+	--dest->activeCount;
+
+	if (tr->isConnected()) {
+
+		idleTransport idle;
+		idle.transport = tr;
+		idle.releaseTime = platform::getHandler()->getUnixTime();
+
+		dest->idle.push_back(idle);
+	}
+
+	dest->released.notify_one();
+}
+
+
+void SMTPTransportPool::send(
+	const utility::url& url,
+	const shared_ptr <vmime::message>& msg,
+	const mailbox& expeditor,
+	const mailboxList& recipients,
+	utility::progressListener* progress,
+	const mailbox& sender,
+	const transport::sendOptions& options
+) {
+
+	shared_ptr <SMTPTransport> tr = acquire(url);
+
+	try {
+
+		tr->send(msg, expeditor, recipients, progress, sender, options);
+
+	} catch (SMTPCommandError&) {
+
+		// The message has been refused: the transport has read the
+		// replies to the pipelined commands (or closed the connection
+		// if it could not), and the transaction will be reset before
+		// the next message is sent, so the transport can be reused
+		release(tr);
+		throw;
+
+	} catch (SMTPMessageSizeExceedsCurLimitsException&) {
+
+		release(tr);
+		throw;
+
+	} catch (SMTPMessageSizeExceedsMaxLimitsException&) {
+
+		release(tr);
+		throw;
+
+	} catch (...) {
+
+		// The state of the connection is unknown (eg. the message data
+		// has only been partially sent)
+		closeTransport(tr);
+		release(tr);
+		throw;
+	}
+
+	release(tr);
+}
+
+
+size_t SMTPTransportPool::retireIdleConnections() {
+
+	std::vector <shared_ptr <SMTPTransport> > expired;
+
+	{
+		utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+		const unsigned long now = platform::getHandler()->getUnixTime();
+
+		for (std::map <string, shared_ptr <destination> >::iterator it = m_destinations.begin() ;
+		     it != m_destinations.end() ; ++it) {
+
+			takeExpiredTransports(it->second, now, expired);
+		}
+	}
+
+	for (size_t i = 0 ; i < expired.size() ; ++i) {
+		closeTransport(expired[i]);
+	}
+
+	return expired.size();
+}
+
+
+size_t SMTPTransportPool::getIdleConnectionCount() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	size_t count = 0;
+
+	for (std::map <string, shared_ptr <destination> >::const_iterator it = m_destinations.begin() ;
+	     it != m_destinations.end() ; ++it) {
+
+		count += it->second->idle.size();
+	}
+
+	return count;
+}
+
+
+size_t SMTPTransportPool::getActiveConnectionCount() const {
+
+	utility::sync::autoLock <utility::sync::criticalSection> lock(m_lock);
+
+	size_t count = 0;
+
+	for (std::map <string, shared_ptr <destination> >::const_iterator it = m_destinations.begin() ;
+	     it != m_destinations.end() ; ++it) {
+
+		count += it->second->activeCount;
+	}
+
+	return count;
+}
+
+
+} // smtp
+} // net
+} // vmime
+
+
+#endif // VMIME_HAVE_MESSAGING_FEATURES && VMIME_HAVE_MESSAGING_PROTO_SMTP
@@ -27,6 +27,7 @@
 
 #include "vmime/net/smtp/SMTPTransport.hpp"
 #include "vmime/net/smtp/SMTPSTransport.hpp"
+#include "vmime/net/smtp/SMTPTransportPool.hpp"
 #include "vmime/net/smtp/SMTPExceptions.hpp"
 #include "vmime/net/smtp/SMTPSendOptions.hpp"
 
@@ -181,6 +181,16 @@ public:
 	  */
 	virtual shared_ptr <tracer> getTracer() = 0;
 
+	/** Return the descriptor of the underlying system socket, which
+	  * can be used to wait for data on several sockets at once (for
+	  * example, with poll()). Note that some data may already have
+	  * been received and buffered (eg. by a TLS layer) when none is
+	  * available on the descriptor.
+	  *
+	  * @return system socket descriptor, or -1 if not available
+	  */
+	virtual int getDescriptor() const { return -1; }
+
 protected:
 
 	socket() { }
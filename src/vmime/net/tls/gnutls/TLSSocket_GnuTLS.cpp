@@ -161,8 +161,19 @@ shared_ptr <net::tracer> TLSSocket_GnuTLS::getTracer() {
 }
 
 
+int TLSSocket_GnuTLS::getDescriptor() const {
+
+	return m_wrapped->getDescriptor();
+}
+
+
 bool TLSSocket_GnuTLS::waitForRead(const int msecs) {
 
+	// Data may already have been received and decrypted
+	if (m_connected && gnutls_record_check_pending(*m_session->m_gnutlsSession) > 0) {
+		return true;
+	}
+
 	return m_wrapped->waitForRead(msecs);
 }
 
@@ -86,6 +86,8 @@ public:
 	void setTracer(const shared_ptr <net::tracer>& tracer);
 	shared_ptr <net::tracer> getTracer();
 
+	int getDescriptor() const;
+
 private:
 
 	void resetException();
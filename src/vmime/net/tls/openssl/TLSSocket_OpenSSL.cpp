@@ -262,8 +262,19 @@ shared_ptr <net::tracer> TLSSocket_OpenSSL::getTracer() {
 }
 
 
+int TLSSocket_OpenSSL::getDescriptor() const {
+
+	return m_wrapped->getDescriptor();
+}
+
+
 bool TLSSocket_OpenSSL::waitForRead(const int msecs) {
 
+	// Data may already have been received and decrypted
+	if (m_ssl && SSL_pending(m_ssl) > 0) {
+		return true;
+	}
+
 	return m_wrapped->waitForRead(msecs);
 }
 
@@ -94,6 +94,8 @@ public:
 	void setTracer(const shared_ptr <net::tracer>& tracer);
 	shared_ptr <net::tracer> getTracer();
 
+	int getDescriptor() const;
+
 private:
 
 	static BIO_METHOD sm_customBIOMethod;
@@ -102,17 +102,17 @@ void transport::processHeader(const shared_ptr <header>& header) {
 
 	// Add missing header fields
 	// -- Date
-	if (!header->hasField(fields::DATE)) {
+	if (!header->hasField(fields::ID_DATE)) {
 		header->Date()->setValue(datetime::now());
 	}
 
 	// -- Mime-Version
-	if (!header->hasField(fields::MIME_VERSION)) {
+	if (!header->hasField(fields::ID_MIME_VERSION)) {
 		header->MimeVersion()->setValue(string(SUPPORTED_MIME_VERSION));
 	}
 
 	// -- Message-Id
-	if (!header->hasField(fields::MESSAGE_ID)) {
+	if (!header->hasField(fields::ID_MESSAGE_ID)) {
 		header->MessageId()->setValue(messageId::generateId());
 	}
 }
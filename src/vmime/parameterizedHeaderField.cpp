@@ -77,6 +77,14 @@ struct paramInfo {
 #endif // VMIME_BUILDING_DOC
 
 
+bool parameterizedHeaderField::supportsLazyValueParsing() const {
+
+	// Parameters are accessed directly, so they must be available
+	// as soon as the field has been parsed
+	return false;
+}
+
+
 void parameterizedHeaderField::parseImpl(
 	parsingContext& ctx,
 	const string& buffer,
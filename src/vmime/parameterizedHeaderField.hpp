@@ -199,6 +199,8 @@ private:
 
 protected:
 
+	bool supportsLazyValueParsing() const;
+
 	void parseImpl(
 		parsingContext& ctx,
 		const string& buffer,
@@ -84,7 +84,7 @@ void plainTextPart::parse(
 	m_text = vmime::clone(textPart->getBody()->getContents());
 
 	shared_ptr <const contentTypeField> ctf =
-		textPart->getHeader()->findField <contentTypeField>(fields::CONTENT_TYPE);
+		textPart->getHeader()->findField <contentTypeField>(fields::ID_CONTENT_TYPE);
 
 	if (ctf && ctf->hasCharset()) {
 		m_charset = ctf->getCharset();
@@ -943,6 +943,12 @@ shared_ptr <net::tracer> posixSocket::getTracer() {
 }
 
 
+int posixSocket::getDescriptor() const {
+
+	return m_desc;
+}
+
+
 
 //
 // posixSocketFactory
@@ -76,6 +76,8 @@ public:
 	void setTracer(const shared_ptr <net::tracer>& tracer);
 	shared_ptr <net::tracer> getTracer();
 
+	int getDescriptor() const;
+
 protected:
 
 	void resolve(struct ::addrinfo** addrInfo, const vmime::string& address, const vmime::port_t port);
@@ -121,8 +121,19 @@ shared_ptr <net::tracer> SASLSocket::getTracer() {
 }
 
 
+int SASLSocket::getDescriptor() const {
+
+	return m_wrapped->getDescriptor();
+}
+
+
 bool SASLSocket::waitForRead(const int msecs) {
 
+	// Data may already have been received and decoded
+	if (m_pendingLen != 0) {
+		return true;
+	}
+
 	return m_wrapped->waitForRead(msecs);
 }
 
@@ -85,6 +85,8 @@ public:
 	void setTracer(const shared_ptr <net::tracer>& tracer);
 	shared_ptr <net::tracer> getTracer();
 
+	int getDescriptor() const;
+
 private:
 
 	shared_ptr <SASLSession> m_session;
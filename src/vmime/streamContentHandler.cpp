@@ -79,6 +79,8 @@ streamContentHandler& streamContentHandler::operator=(const streamContentHandler
 	m_stream = cts.m_stream;
 	m_length = cts.m_length;
 
+	incrementRevision();
+
 	return *this;
 }
 
@@ -92,6 +94,8 @@ void streamContentHandler::setData(
 	m_encoding = enc;
 	m_length = length;
 	m_stream = is;
+
+	incrementRevision();
 }
 
 
@@ -110,8 +114,8 @@ void streamContentHandler::generate(
 
 		// The data is already encoded but the encoding specified for
 		// the generation is different from the current one. We need
-		// to re-encode data: decode from input buffer to temporary
-		// buffer, and then re-encode to output stream...
+		// to re-encode data: decode from input buffer, and re-encode
+		// decoded data to output stream as it is decoded...
 		if (m_encoding != enc) {
 
 			shared_ptr <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
@@ -122,15 +126,12 @@ void streamContentHandler::generate(
 
 			m_stream->reset();  // may not work...
 
-			std::ostringstream oss;
-			utility::outputStreamAdapter tempOut(oss);
-
-			theDecoder->decode(*m_stream, tempOut);
+			shared_ptr <utility::filteredOutputStream> encodingStream =
+				theEncoder->getEncodingFilteredOutputStream(os);
 
-			string str = oss.str();
-			utility::inputStreamStringAdapter tempIn(str);
+			theDecoder->decode(*m_stream, *encodingStream);
 
-			theEncoder->encode(tempIn, os);
+			encodingStream->flush();
 
 		// No encoding to perform
 		} else {
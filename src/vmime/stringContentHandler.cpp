@@ -74,6 +74,8 @@ stringContentHandler& stringContentHandler::operator=(const stringContentHandler
 	m_encoding = cts.m_encoding;
 	m_string = cts.m_string;
 
+	incrementRevision();
+
 	return *this;
 }
 
@@ -82,6 +84,8 @@ void stringContentHandler::setData(const string& buffer, const vmime::encoding&
 
 	m_encoding = enc;
 	m_string = buffer;
+
+	incrementRevision();
 }
 
 
@@ -103,8 +107,8 @@ void stringContentHandler::generate(
 
 		// The data is already encoded but the encoding specified for
 		// the generation is different from the current one. We need
-		// to re-encode data: decode from input buffer to temporary
-		// buffer, and then re-encode to output stream...
+		// to re-encode data: decode from input buffer, and re-encode
+		// decoded data to output stream as it is decoded...
 		if (m_encoding != enc) {
 
 			shared_ptr <utility::encoder::encoder> theDecoder = m_encoding.getEncoder();
@@ -115,15 +119,12 @@ void stringContentHandler::generate(
 
 			utility::inputStreamStringAdapter in(m_string);
 
-			std::ostringstream oss;
-			utility::outputStreamAdapter tempOut(oss);
-
-			theDecoder->decode(in, tempOut);
+			shared_ptr <utility::filteredOutputStream> encodingStream =
+				theEncoder->getEncodingFilteredOutputStream(os);
 
-			string str = oss.str();
-			utility::inputStreamStringAdapter tempIn(str);
+			theDecoder->decode(in, *encodingStream);
 
-			theEncoder->encode(tempIn, os);
+			encodingStream->flush();
 
 		// No encoding to perform
 		} else {
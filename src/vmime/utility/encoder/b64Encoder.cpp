@@ -22,8 +22,11 @@
 //
 
 #include "vmime/utility/encoder/b64Encoder.hpp"
+#include "vmime/utility/encoder/b64Kernels.hpp"
 #include "vmime/parserHelpers.hpp"
 
+#include <algorithm>
+
 
 namespace vmime {
 namespace utility {
@@ -68,81 +71,161 @@ const unsigned char b64Encoder::sm_decodeMap[256] = {
 	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,  // 0xf0 - 0xff
 };
 
-#ifndef VMIME_BUILDING_DOC
-	#define B64_WRITE(s, x, l) s.write(reinterpret_cast <byte_t*>(x), l)
-#endif // VMIME_BUILDING_DOC
+/** Encodes data written into it to Base64, block by block.
+  *
+  * Complete groups are encoded by the fastest kernel supported by
+  * the processor (see b64Kernels); this class only deals with line
+  * cutting, padding and buffering.
+  */
+class b64Encoder::encodingStream : public utility::filteredOutputStream {
+
+public:
+
+	/** Construct a new encoding stream.
+	  *
+	  * @param os stream into which write encoded data
+	  * @param maxLineLength maximum line length, or -1 to
+	  * disable line cutting
+	  */
+	encodingStream(utility::outputStream& os, const size_t maxLineLength)
+		: m_stream(os),
+		  m_cutLines(maxLineLength != static_cast <size_t>(-1)),
+		  m_maxLineLength(maxLineLength),
+		  m_pendingCount(0),
+		  m_curCol(0),
+		  m_outBufferPos(0),
+		  m_total(0),
+		  m_kernel(b64Kernels::getDefaultKernel()) {
 
+	}
 
+	utility::outputStream& getNextOutputStream() {
 
-size_t b64Encoder::encode(
-	utility::inputStream& in,
-	utility::outputStream& out,
-	utility::progressListener* progress
-) {
+		return m_stream;
+	}
 
-	in.reset();  // may not work...
+	void flush() {
 
-	const size_t propMaxLineLength =
-		getProperties().getProperty <size_t>("maxlinelength", static_cast <size_t>(-1));
+		finish();
 
-	const bool cutLines = (propMaxLineLength != static_cast <size_t>(-1));
-	const size_t maxLineLength = std::min(propMaxLineLength, static_cast <size_t>(76));
+		m_stream.flush();
+	}
 
-	// Process data
-	byte_t buffer[65536];
-	size_t bufferLength = 0;
-	size_t bufferPos = 0;
+	/** Encode remaining bytes (with padding), without flushing
+	  * the next output stream.
+	  */
+	void finish() {
 
-	byte_t bytes[3];
-	byte_t output[4];
+		if (m_pendingCount != 0) {
+			encodeGroup(m_pending, m_pendingCount);
+			m_pendingCount = 0;
+		}
 
-	size_t total = 0;
-	size_t inTotal = 0;
+		writeOutBuffer();
+	}
 
-	size_t curCol = 0;
+	/** Return the number of encoded bytes written so far.
+	  *
+	  * @return number of bytes written into the next output stream
+	  */
+	size_t getTotalWritten() const {
 
-	if (progress) {
-		progress->start(0);
+		return m_total + m_outBufferPos;
 	}
 
-	while (bufferPos < bufferLength || !in.eof()) {
+protected:
 
-		if (bufferPos >= bufferLength) {
+	void writeImpl(const byte_t* const data, const size_t count) {
 
-			bufferLength = in.read(buffer, sizeof(buffer));
-			bufferPos = 0;
+		const byte_t* pos = data;
+		const byte_t* const end = data + count;
 
-			if (bufferLength == 0) {
-				break;
+		// Complete the group of 3 bytes left from previous data
+		if (m_pendingCount != 0) {
+
+			while (m_pendingCount < 3 && pos != end) {
+				m_pending[m_pendingCount++] = *pos++;
 			}
-		}
 
-		// Get 3 bytes of data
-		int count = 0;
+			if (m_pendingCount < 3) {
+				return;
+			}
 
-		while (count < 3 && bufferPos < bufferLength) {
-			bytes[count++] = buffer[bufferPos++];
+			encodeGroup(m_pending, 3);
+			m_pendingCount = 0;
 		}
 
-		while (count < 3) {
+		// Encode complete groups, one line (or output buffer) at a time
+		while (end - pos >= 3) {
+
+			if (m_outBufferPos + 4 + 2 /* CRLF */ > sizeof(m_outBuffer)) {
+				writeOutBuffer();
+			}
 
-			// There may be more data in the next chunk...
-			if (bufferPos >= bufferLength) {
+			const size_t maxGroups = (sizeof(m_outBuffer) - 2 /* CRLF */ - m_outBufferPos) / 4;
 
-				bufferLength = in.read(buffer, sizeof(buffer));
-				bufferPos = 0;
+			const size_t groups = std::min(
+				std::min(static_cast <size_t>(end - pos) / 3, maxGroups),
+				getGroupsLeftInLine()
+			);
 
-				if (bufferLength == 0) {
-					break;
-				}
-			}
+			encodeGroups(pos, groups);
+			pos += groups * 3;
 
-			while (count < 3 && bufferPos < bufferLength) {
-				bytes[count++] = buffer[bufferPos++];
+			if (m_cutLines && m_curCol + 2 /* \r\n */ + 4 /* next bytes */ >= m_maxLineLength) {
+
+				m_outBuffer[m_outBufferPos++] = '\r';
+				m_outBuffer[m_outBufferPos++] = '\n';
+
+				m_curCol = 0;
 			}
 		}
 
-		// Encode data
+		while (pos != end) {
+			m_pending[m_pendingCount++] = *pos++;
+		}
+
+		writeOutBuffer();
+	}
+
+private:
+
+	/** Return the number of groups which can be written before
+	  * the current line is cut.
+	  */
+	size_t getGroupsLeftInLine() const {
+
+		if (!m_cutLines) {
+			return static_cast <size_t>(-1);
+		}
+
+		// A line is cut after a group if: col + 2 (CRLF) + 4 (next group) >= max
+		if (m_curCol + 4 + 2 + 4 >= m_maxLineLength) {
+			return 1;
+		}
+
+		return (m_maxLineLength - 2 - 4 - m_curCol + 3) / 4;
+	}
+
+	/** Encode complete groups of 3 bytes, without any line break.
+	  * There must be enough space left in the output buffer.
+	  */
+	void encodeGroups(const byte_t* bytes, const size_t count) {
+
+		b64Kernels::encode(m_kernel, bytes, count, m_outBuffer + m_outBufferPos);
+
+		m_outBufferPos += count * 4;
+		m_curCol += count * 4;
+	}
+
+	void encodeGroup(const byte_t* bytes, const size_t count) {
+
+		if (m_outBufferPos + 4 + 2 > sizeof(m_outBuffer)) {
+			writeOutBuffer();
+		}
+
+		byte_t* output = m_outBuffer + m_outBufferPos;
+
 		switch (count) {
 
 			case 1:
@@ -174,153 +257,356 @@ size_t b64Encoder::encode(
 				break;
 		}
 
-		// Write encoded data to output stream
-		B64_WRITE(out, output, 4);
+		m_outBufferPos += 4;
+		m_curCol += 4;
 
-		inTotal += count;
-		total += 4;
-		curCol += 4;
+		if (m_cutLines && m_curCol + 2 /* \r\n */ + 4 /* next bytes */ >= m_maxLineLength) {
 
-		if (cutLines && curCol + 2 /* \r\n */ + 4 /* next bytes */ >= maxLineLength) {
-			out.write("\r\n", 2);
-			curCol = 0;
+			m_outBuffer[m_outBufferPos++] = '\r';
+			m_outBuffer[m_outBufferPos++] = '\n';
+
+			m_curCol = 0;
 		}
+	}
 
-		if (progress) {
-			progress->progress(inTotal, inTotal);
+	void writeOutBuffer() {
+
+		if (m_outBufferPos != 0) {
+
+			m_stream.write(m_outBuffer, m_outBufferPos);
+
+			m_total += m_outBufferPos;
+			m_outBufferPos = 0;
 		}
 	}
 
-	if (progress) {
-		progress->stop(inTotal);
+
+	utility::outputStream& m_stream;
+
+	const bool m_cutLines;
+	const size_t m_maxLineLength;
+
+	byte_t m_pending[3];
+	size_t m_pendingCount;
+
+	size_t m_curCol;
+
+	byte_t m_outBuffer[16384];
+	size_t m_outBufferPos;
+
+	size_t m_total;
+
+	const b64Kernels::Kernel m_kernel;
+};
+
+
+/** Decodes Base64 data written into it, block by block.
+  */
+class b64Encoder::decodingStream : public utility::filteredOutputStream {
+
+public:
+
+	/** Construct a new decoding stream.
+	  *
+	  * @param os stream into which write decoded data
+	  */
+	decodingStream(utility::outputStream& os)
+		: m_stream(os),
+		  m_count(0),
+		  m_end(false),
+		  m_outBufferPos(0),
+		  m_total(0),
+		  m_kernel(b64Kernels::getDefaultKernel()) {
+
 	}
 
-	return total;
-}
+	utility::outputStream& getNextOutputStream() {
 
+		return m_stream;
+	}
 
-size_t b64Encoder::decode(
-	utility::inputStream& in,
-	utility::outputStream& out,
-	utility::progressListener* progress
-) {
+	void flush() {
 
-	in.reset();  // may not work...
+		finish();
 
-	// Process the data
-	byte_t buffer[16384];
-	size_t bufferLength = 0;
-	size_t bufferPos = 0;
+		m_stream.flush();
+	}
 
-	size_t total = 0;
-	size_t inTotal = 0;
+	/** Write decoded data, without flushing the next output stream.
+	  * Incomplete groups of 4 bytes are ignored.
+	  */
+	void finish() {
 
-	byte_t bytes[4];
-	byte_t output[3];
+		m_count = 0;
 
-	if (progress) {
-		progress->start(0);
+		writeOutBuffer();
 	}
 
-	while (bufferPos < bufferLength || !in.eof()) {
+	/** Return the number of decoded bytes written so far.
+	  *
+	  * @return number of bytes written into the next output stream
+	  */
+	size_t getTotalWritten() const {
 
-		bytes[0] = '=';
-		bytes[1] = '=';
-		bytes[2] = '=';
-		bytes[3] = '=';
+		return m_total + m_outBufferPos;
+	}
 
-		// Need to get more data?
-		if (bufferPos >= bufferLength) {
+protected:
 
-			bufferLength = in.read(buffer, sizeof(buffer));
-			bufferPos = 0;
+	void writeImpl(const byte_t* const data, const size_t count) {
 
-			// No more data
-			if (bufferLength == 0) {
-				break;
+		// 4 bytes of input provide 3 bytes of output
+		for (size_t i = 0 ; !m_end && i < count ; ++i) {
+
+			// Fast path: decode groups of 4 valid characters, which
+			// do not contain any whitespace or padding
+			if (m_count == 0) {
+
+				i = decodeGroups(data, i, count);
+
+				if (i >= count) {
+					break;
+				}
 			}
-		}
 
-		// 4 bytes of input provide 3 bytes of output, so
-		// get the next 4 bytes from the input stream.
-		int count = 0;
+			const byte_t c = data[i];
 
-		while (count < 4 && bufferPos < bufferLength) {
+			if (parserHelpers::isSpace(c)) {
+				continue;
+			}
 
-			const byte_t c = buffer[bufferPos++];
+			m_bytes[m_count++] = c;
 
-			if (!parserHelpers::isSpace(c)) {
-				bytes[count++] = c;
+			if (m_count == 4) {
+				decodeGroup();
+				m_count = 0;
 			}
 		}
 
-		if (count != 4) {
+		writeOutBuffer();
+	}
 
-			while (count < 4 && !in.eof()) {
+private:
 
-				// Data continues on the next chunk
-				bufferLength = in.read(buffer, sizeof(buffer));
-				bufferPos = 0;
+	/** Decode complete groups of 4 valid Base64 characters, and stop
+	  * on the first group which needs special processing.
+	  *
+	  * @param data input data
+	  * @param pos position of the first group in input data
+	  * @param count length of input data
+	  * @return position of the first character which has not been decoded
+	  */
+	size_t decodeGroups(const byte_t* const data, size_t pos, const size_t count) {
 
-				while (count < 4 && bufferPos < bufferLength) {
+		while (count - pos >= 4) {
 
-					const byte_t c = buffer[bufferPos++];
+			if (m_outBufferPos + 3 > sizeof(m_outBuffer)) {
+				writeOutBuffer();
+			}
 
-					if (!parserHelpers::isSpace(c)) {
-						bytes[count++] = c;
-					}
-				}
+			const size_t maxGroups = std::min(
+				(count - pos) / 4,
+				(sizeof(m_outBuffer) - m_outBufferPos) / 3
+			);
+
+			const size_t groups = b64Kernels::decode(
+				m_kernel, data + pos, maxGroups, m_outBuffer + m_outBufferPos
+			);
+
+			m_outBufferPos += groups * 3;
+			pos += groups * 4;
+
+			if (groups < maxGroups) {
+				break;
 			}
 		}
 
-		if (count != 4) {  // input length is not a multiple of 4 bytes
-			break;
+		return pos;
+	}
+
+	void decodeGroup() {
+
+		if (m_outBufferPos + 3 > sizeof(m_outBuffer)) {
+			writeOutBuffer();
 		}
 
-		// Decode the bytes
-		byte_t c1 = bytes[0];
-		byte_t c2 = bytes[1];
+		byte_t* output = m_outBuffer + m_outBufferPos;
+
+		byte_t c1 = m_bytes[0];
+		byte_t c2 = m_bytes[1];
 
 		if (c1 == '=' || c2 == '=') {  // end
-			break;
+			m_end = true;
+			return;
 		}
 
 		output[0] = static_cast <byte_t>((sm_decodeMap[c1] << 2) | ((sm_decodeMap[c2] & 0x30) >> 4));
 
-		c1 = bytes[2];
+		c1 = m_bytes[2];
 
 		if (c1 == '=') {  // end
-			B64_WRITE(out, output, 1);
-			total += 1;
-			break;
+			m_outBufferPos += 1;
+			m_end = true;
+			return;
 		}
 
 		output[1] = static_cast <byte_t>(((sm_decodeMap[c2] & 0xf) << 4) | ((sm_decodeMap[c1] & 0x3c) >> 2));
 
-		c2 = bytes[3];
+		c2 = m_bytes[3];
 
 		if (c2 == '=') {  // end
-			B64_WRITE(out, output, 2);
-			total += 2;
-			break;
+			m_outBufferPos += 2;
+			m_end = true;
+			return;
 		}
 
 		output[2] = static_cast <byte_t>(((sm_decodeMap[c1] & 0x03) << 6) | sm_decodeMap[c2]);
 
-		B64_WRITE(out, output, 3);
-		total += 3;
-		inTotal += count;
+		m_outBufferPos += 3;
+	}
+
+	void writeOutBuffer() {
+
+		if (m_outBufferPos != 0) {
+
+			m_stream.write(m_outBuffer, m_outBufferPos);
+
+			m_total += m_outBufferPos;
+			m_outBufferPos = 0;
+		}
+	}
+
+
+	utility::outputStream& m_stream;
+
+	byte_t m_bytes[4];
+	size_t m_count;
+
+	bool m_end;
+
+	byte_t m_outBuffer[16384];
+	size_t m_outBufferPos;
+
+	size_t m_total;
+
+	const b64Kernels::Kernel m_kernel;
+};
+
+
+size_t b64Encoder::getMaxLineLength() const {
+
+	const size_t propMaxLineLength =
+		getProperties().getProperty <size_t>("maxlinelength", static_cast <size_t>(-1));
+
+	if (propMaxLineLength == static_cast <size_t>(-1)) {
+		return propMaxLineLength;  // do not cut lines
+	}
+
+	return std::min(propMaxLineLength, static_cast <size_t>(76));
+}
+
+
+shared_ptr <utility::filteredOutputStream>
+	b64Encoder::getEncodingFilteredOutputStream(utility::outputStream& os) {
+
+	return make_shared <encodingStream>(os, getMaxLineLength());
+}
+
+
+shared_ptr <utility::filteredOutputStream>
+	b64Encoder::getDecodingFilteredOutputStream(utility::outputStream& os) {
+
+	return make_shared <decodingStream>(os);
+}
+
+
+size_t b64Encoder::encode(
+	utility::inputStream& in,
+	utility::outputStream& out,
+	utility::progressListener* progress
+) {
+
+	in.reset();  // may not work...
+
+	encodingStream stream(out, getMaxLineLength());
+
+	// Process data
+	byte_t buffer[65536];
+	size_t inTotal = 0;
+
+	if (progress) {
+		progress->start(0);
+	}
+
+	while (!in.eof()) {
+
+		const size_t bufferLength = in.read(buffer, sizeof(buffer));
+
+		if (bufferLength == 0) {
+			break;
+		}
+
+		stream.write(buffer, bufferLength);
+
+		inTotal += bufferLength;
 
 		if (progress) {
 			progress->progress(inTotal, inTotal);
 		}
 	}
 
+	stream.finish();
+
+	if (progress) {
+		progress->stop(inTotal);
+	}
+
+	return stream.getTotalWritten();
+}
+
+
+size_t b64Encoder::decode(
+	utility::inputStream& in,
+	utility::outputStream& out,
+	utility::progressListener* progress
+) {
+
+	in.reset();  // may not work...
+
+	decodingStream stream(out);
+
+	// Process the data
+	byte_t buffer[16384];
+	size_t inTotal = 0;
+
+	if (progress) {
+		progress->start(0);
+	}
+
+	while (!in.eof()) {
+
+		const size_t bufferLength = in.read(buffer, sizeof(buffer));
+
+		if (bufferLength == 0) {
+			break;
+		}
+
+		stream.write(buffer, bufferLength);
+
+		inTotal += bufferLength;
+
+		if (progress) {
+			progress->progress(inTotal, inTotal);
+		}
+	}
+
+	stream.finish();
+
 	if (progress) {
 		progress->stop(inTotal);
 	}
 
-	return total;
+	return stream.getTotalWritten();
 }
 
 
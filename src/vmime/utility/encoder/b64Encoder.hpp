@@ -53,6 +53,12 @@ public:
 		utility::progressListener* progress = NULL
 	);
 
+	shared_ptr <utility::filteredOutputStream>
+		getEncodingFilteredOutputStream(utility::outputStream& os);
+
+	shared_ptr <utility::filteredOutputStream>
+		getDecodingFilteredOutputStream(utility::outputStream& os);
+
 	const std::vector <string> getAvailableProperties() const;
 
 	size_t getEncodedSize(const size_t n) const;
@@ -62,6 +68,15 @@ protected:
 
 	static const unsigned char sm_alphabet[];
 	static const unsigned char sm_decodeMap[256];
+
+private:
+
+	class encodingStream;
+	class decodingStream;
+
+	size_t getMaxLineLength() const;
+
+	friend class b64Kernels;
 };
 
 
@@ -0,0 +1,505 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "vmime/utility/encoder/b64Kernels.hpp"
+#include "vmime/utility/encoder/b64Encoder.hpp"
+
+
+// The SSSE3 and AVX2 kernels are compiled with function-level target
+// attributes, so that the library itself does not require more than
+// the baseline instruction set; they are only called after checking
+// the processor with CPUID.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#define VMIME_B64KERNELS_X86 1
+	#define VMIME_B64KERNELS_TARGET(x) __attribute__((target(x)))
+	#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#define VMIME_B64KERNELS_X86 1
+	#define VMIME_B64KERNELS_TARGET(x)
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+
+namespace vmime {
+namespace utility {
+namespace encoder {
+
+
+#if VMIME_B64KERNELS_X86
+
+
+static bool cpuSupportsSSSE3() {
+
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+
+static bool cpuSupportsAVX2() {
+
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+
+	if (info[0] < 7) {
+		return false;
+	}
+
+	// The OS must save YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+	__cpuid(info, 1);
+
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+
+// Base64 encoding of 12 bytes into 16 characters, as described by
+// Wojciech Mula ("Base64 encoding with SIMD instructions").
+//
+// Each 32-bit lane receives 3 input bytes in the order [b1 b0 b2 b1],
+// from which the four 6-bit values are moved to one byte each with a
+// multiplication; the values are then translated to ASCII by adding an
+// offset which depends on their range (A-Z, a-z, 0-9, '+' or '/').
+
+static VMIME_B64KERNELS_TARGET("ssse3") inline __m128i encodeBlockSSSE3(const __m128i in) {
+
+	const __m128i bytes = _mm_shuffle_epi8(
+		in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1)
+	);
+
+	const __m128i ac = _mm_mulhi_epu16(
+		_mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040)
+	);
+	const __m128i bd = _mm_mullo_epi16(
+		_mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010)
+	);
+
+	const __m128i values = _mm_or_si128(ac, bd);
+
+	// Offset index: 0..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12,
+	// then 0..25 -> 13
+	__m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+	index = _mm_or_si128(index, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), values), _mm_set1_epi8(13)));
+
+	const __m128i offsets = _mm_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+	);
+
+	return _mm_add_epi8(values, _mm_shuffle_epi8(offsets, index));
+}
+
+
+static VMIME_B64KERNELS_TARGET("avx2") inline __m256i encodeBlockAVX2(const __m256i in) {
+
+	const __m256i bytes = _mm256_shuffle_epi8(
+		in, _mm256_set_epi8(
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+		)
+	);
+
+	const __m256i ac = _mm256_mulhi_epu16(
+		_mm256_and_si256(bytes, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040)
+	);
+	const __m256i bd = _mm256_mullo_epi16(
+		_mm256_and_si256(bytes, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010)
+	);
+
+	const __m256i values = _mm256_or_si256(ac, bd);
+
+	__m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+	index = _mm256_or_si256(index, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), values), _mm256_set1_epi8(13)));
+
+	const __m256i offsets = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+	);
+
+	return _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, index));
+}
+
+
+// Base64 decoding of 16 characters into 12 bytes. Characters are
+// translated with signed range compares (bytes >= 0x80 are negative,
+// so they are outside all ranges); the four 6-bit values of each
+// 32-bit lane are then merged with multiply-add instructions.
+//
+// Return false if a character is not part of the alphabet.
+
+static VMIME_B64KERNELS_TARGET("ssse3") inline bool decodeBlockSSSE3(const __m128i in, __m128i& out) {
+
+	const __m128i upper = _mm_and_si128(
+		_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('Z' + 1))
+	);
+	const __m128i lower = _mm_and_si128(
+		_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('z' + 1))
+	);
+	const __m128i digit = _mm_and_si128(
+		_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1))
+	);
+	const __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+	const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+
+	const __m128i valid = _mm_or_si128(
+		_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash))
+	);
+
+	if (_mm_movemask_epi8(valid) != 0xffff) {
+		return false;
+	}
+
+	const __m128i shift = _mm_or_si128(
+		_mm_or_si128(
+			_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+			_mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))
+		),
+		_mm_or_si128(
+			_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+			_mm_or_si128(
+				_mm_and_si128(plus, _mm_set1_epi8(62 - '+')),
+				_mm_and_si128(slash, _mm_set1_epi8(63 - '/'))
+			)
+		)
+	);
+
+	const __m128i values = _mm_add_epi8(in, shift);
+
+	// [a b c d] -> [ab cd] (12 bits) -> [abcd] (24 bits)
+	const __m128i ab_cd = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+	const __m128i abcd = _mm_madd_epi16(ab_cd, _mm_set1_epi32(0x00011000));
+
+	out = _mm_shuffle_epi8(
+		abcd, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+	);
+
+	return true;
+}
+
+
+static VMIME_B64KERNELS_TARGET("avx2") inline bool decodeBlockAVX2(const __m256i in, __m256i& out) {
+
+	const __m256i upper = _mm256_andnot_si256(
+		_mm256_cmpgt_epi8(in, _mm256_set1_epi8('Z')), _mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1))
+	);
+	const __m256i lower = _mm256_andnot_si256(
+		_mm256_cmpgt_epi8(in, _mm256_set1_epi8('z')), _mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1))
+	);
+	const __m256i digit = _mm256_andnot_si256(
+		_mm256_cmpgt_epi8(in, _mm256_set1_epi8('9')), _mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1))
+	);
+	const __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+	const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+
+	const __m256i valid = _mm256_or_si256(
+		_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(plus, slash))
+	);
+
+	if (_mm256_movemask_epi8(valid) != -1) {
+		return false;
+	}
+
+	const __m256i shift = _mm256_or_si256(
+		_mm256_or_si256(
+			_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+			_mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))
+		),
+		_mm256_or_si256(
+			_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+			_mm256_or_si256(
+				_mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')),
+				_mm256_and_si256(slash, _mm256_set1_epi8(63 - '/'))
+			)
+		)
+	);
+
+	const __m256i values = _mm256_add_epi8(in, shift);
+
+	const __m256i ab_cd = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+	const __m256i abcd = _mm256_madd_epi16(ab_cd, _mm256_set1_epi32(0x00011000));
+
+	const __m256i packed = _mm256_shuffle_epi8(
+		abcd, _mm256_setr_epi8(
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+		)
+	);
+
+	// Move the 12 bytes of the upper lane next to those of the lower lane
+	out = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+	return true;
+}
+
+
+// The block functions below process as many groups as they can, and
+// return the number of groups processed; the remaining ones are left
+// to the next kernel. Loads and stores are wider than the groups they
+// process, so a block is only handled if the following groups cover
+// the extra bytes.
+
+static VMIME_B64KERNELS_TARGET("ssse3") size_t encodeSSSE3(const byte_t* in, const size_t count, byte_t* out) {
+
+	size_t done = 0;
+
+	// Read 16 bytes to encode 4 groups (12 bytes)
+	for ( ; count - done >= 6 ; done += 4, in += 12, out += 16) {
+
+		const __m128i block = _mm_loadu_si128(reinterpret_cast <const __m128i*>(in));
+
+		_mm_storeu_si128(reinterpret_cast <__m128i*>(out), encodeBlockSSSE3(block));
+	}
+
+	return done;
+}
+
+
+static VMIME_B64KERNELS_TARGET("avx2") size_t encodeAVX2(const byte_t* in, const size_t count, byte_t* out) {
+
+	size_t done = 0;
+
+	// Read 28 bytes to encode 8 groups (24 bytes), 12 bytes per lane
+	for ( ; count - done >= 10 ; done += 8, in += 24, out += 32) {
+
+		const __m256i block = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast <const __m128i*>(in))),
+			_mm_loadu_si128(reinterpret_cast <const __m128i*>(in + 12)),
+			1
+		);
+
+		_mm256_storeu_si256(reinterpret_cast <__m256i*>(out), encodeBlockAVX2(block));
+	}
+
+	return done;
+}
+
+
+static VMIME_B64KERNELS_TARGET("ssse3") size_t decodeSSSE3(const byte_t* in, const size_t count, byte_t* out) {
+
+	size_t done = 0;
+
+	// Write 16 bytes to decode 4 groups (12 bytes)
+	for ( ; count - done >= 6 ; done += 4, in += 16, out += 12) {
+
+		__m128i decoded;
+
+		if (!decodeBlockSSSE3(_mm_loadu_si128(reinterpret_cast <const __m128i*>(in)), decoded)) {
+			break;
+		}
+
+		_mm_storeu_si128(reinterpret_cast <__m128i*>(out), decoded);
+	}
+
+	return done;
+}
+
+
+static VMIME_B64KERNELS_TARGET("avx2") size_t decodeAVX2(const byte_t* in, const size_t count, byte_t* out) {
+
+	size_t done = 0;
+
+	// Write 32 bytes to decode 8 groups (24 bytes)
+	for ( ; count - done >= 11 ; done += 8, in += 32, out += 24) {
+
+		__m256i decoded;
+
+		if (!decodeBlockAVX2(_mm256_loadu_si256(reinterpret_cast <const __m256i*>(in)), decoded)) {
+			break;
+		}
+
+		_mm256_storeu_si256(reinterpret_cast <__m256i*>(out), decoded);
+	}
+
+	return done;
+}
+
+
+#endif // VMIME_B64KERNELS_X86
+
+
+// static
+b64Kernels::Kernel b64Kernels::detectKernel() {
+
+#if VMIME_B64KERNELS_X86
+
+	if (cpuSupportsAVX2()) {
+		return KERNEL_AVX2;
+	} else if (cpuSupportsSSSE3()) {
+		return KERNEL_SSSE3;
+	}
+
+#endif // VMIME_B64KERNELS_X86
+
+	return KERNEL_SCALAR;
+}
+
+
+// static
+b64Kernels::Kernel b64Kernels::getDefaultKernel() {
+
+	static const Kernel kernel = detectKernel();
+
+	return kernel;
+}
+
+
+// static
+bool b64Kernels::isKernelSupported(const Kernel kernel) {
+
+	switch (kernel) {
+
+		case KERNEL_SCALAR:
+
+			return true;
+
+#if VMIME_B64KERNELS_X86
+
+		case KERNEL_SSSE3:
+
+			return cpuSupportsSSSE3();
+
+		case KERNEL_AVX2:
+
+			return cpuSupportsAVX2();
+
+#endif // VMIME_B64KERNELS_X86
+
+		default:
+
+			return false;
+	}
+}
+
+
+// static
+void b64Kernels::encode(const Kernel kernel, const byte_t* in, const size_t count, byte_t* out) {
+
+	size_t done = 0;
+
+#if VMIME_B64KERNELS_X86
+
+	if (kernel == KERNEL_AVX2) {
+		done += encodeAVX2(in, count, out);
+	}
+
+	if (kernel == KERNEL_AVX2 || kernel == KERNEL_SSSE3) {
+		done += encodeSSSE3(in + done * 3, count - done, out + done * 4);
+	}
+
+#endif // VMIME_B64KERNELS_X86
+
+	encodeScalar(in + done * 3, count - done, out + done * 4);
+}
+
+
+// static
+size_t b64Kernels::decode(const Kernel kernel, const byte_t* in, const size_t count, byte_t* out) {
+
+	size_t done = 0;
+
+#if VMIME_B64KERNELS_X86
+
+	if (kernel == KERNEL_AVX2) {
+		done += decodeAVX2(in, count, out);
+	}
+
+	if (kernel == KERNEL_AVX2 || kernel == KERNEL_SSSE3) {
+		done += decodeSSSE3(in + done * 4, count - done, out + done * 3);
+	}
+
+#endif // VMIME_B64KERNELS_X86
+
+	return done + decodeScalar(in + done * 4, count - done, out + done * 3);
+}
+
+
+// static
+void b64Kernels::encodeScalar(const byte_t* in, size_t count, byte_t* out) {
+
+	const unsigned char* const alphabet = b64Encoder::sm_alphabet;
+
+	for ( ; count != 0 ; --count, in += 3, out += 4) {
+
+		const unsigned int value =
+			(static_cast <unsigned int>(in[0]) << 16) |
+			(static_cast <unsigned int>(in[1]) << 8) |
+			 static_cast <unsigned int>(in[2]);
+
+		out[0] = alphabet[(value >> 18) & 0x3F];
+		out[1] = alphabet[(value >> 12) & 0x3F];
+		out[2] = alphabet[(value >> 6) & 0x3F];
+		out[3] = alphabet[value & 0x3F];
+	}
+}
+
+
+// static
+size_t b64Kernels::decodeScalar(const byte_t* in, size_t count, byte_t* out) {
+
+	const unsigned char* const decodeMap = b64Encoder::sm_decodeMap;
+
+	size_t done = 0;
+
+	for ( ; done < count ; ++done, in += 4, out += 3) {
+
+		const unsigned int m1 = decodeMap[in[0]];
+		const unsigned int m2 = decodeMap[in[1]];
+		const unsigned int m3 = decodeMap[in[2]];
+		const unsigned int m4 = decodeMap[in[3]];
+
+		// Whitespace and invalid characters are mapped to 0xff
+		if ((m1 | m2 | m3 | m4) >= 64 || in[0] == '=' || in[1] == '=' || in[2] == '=' || in[3] == '=') {
+			break;
+		}
+
+		const unsigned int value = (m1 << 18) | (m2 << 12) | (m3 << 6) | m4;
+
+		out[0] = static_cast <byte_t>(value >> 16);
+		out[1] = static_cast <byte_t>(value >> 8);
+		out[2] = static_cast <byte_t>(value);
+	}
+
+	return done;
+}
+
+
+} // encoder
+} // utility
+} // vmime
@@ -0,0 +1,117 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_UTILITY_ENCODER_B64KERNELS_HPP_INCLUDED
+#define VMIME_UTILITY_ENCODER_B64KERNELS_HPP_INCLUDED
+
+
+#include "vmime/types.hpp"
+#include "vmime/base.hpp"
+
+
+namespace vmime {
+namespace utility {
+namespace encoder {
+
+
+/** Block kernels used by the Base64 encoder to translate complete
+  * groups of bytes, without line breaks, whitespace or padding.
+  *
+  * A scalar kernel is always available. On x86 processors, SSSE3 and
+  * AVX2 kernels are compiled in and the fastest one supported by the
+  * processor is selected at run time; they produce exactly the same
+  * output as the scalar kernel.
+  */
+class VMIME_EXPORT b64Kernels {
+
+public:
+
+	enum Kernel {
+		KERNEL_SCALAR,   /**< Portable kernel, using lookup tables. */
+		KERNEL_SSSE3,    /**< 16 characters at a time (x86 with SSSE3). */
+		KERNEL_AVX2      /**< 32 characters at a time (x86 with AVX2). */
+	};
+
+	/** Return the kernel used by the Base64 encoder, which is the
+	  * fastest one supported by the processor.
+	  *
+	  * @return default kernel
+	  */
+	static Kernel getDefaultKernel();
+
+	/** Test whether a kernel is compiled in and can be used on
+	  * this processor.
+	  *
+	  * @param kernel kernel to test
+	  * @return true if the kernel can be used, false otherwise
+	  */
+	static bool isKernelSupported(const Kernel kernel);
+
+	/** Encode complete groups of 3 bytes into groups of 4 characters.
+	  *
+	  * @param kernel kernel to use (must be supported)
+	  * @param in input data, of count * 3 bytes
+	  * @param count number of groups to encode
+	  * @param out output buffer, of count * 4 bytes
+	  */
+	static void encode(
+		const Kernel kernel,
+		const byte_t* in,
+		const size_t count,
+		byte_t* out
+	);
+
+	/** Decode complete groups of 4 characters into groups of 3 bytes.
+	  * Decoding stops on the first group containing a character which
+	  * is not part of the Base64 alphabet (including whitespace and
+	  * padding), which must be processed by the caller.
+	  *
+	  * @param kernel kernel to use (must be supported)
+	  * @param in input data
+	  * @param count number of groups available in input data
+	  * @param out output buffer, of count * 3 bytes; bytes after the
+	  * decoded groups may be overwritten
+	  * @return number of groups decoded
+	  */
+	static size_t decode(
+		const Kernel kernel,
+		const byte_t* in,
+		const size_t count,
+		byte_t* out
+	);
+
+private:
+
+	static Kernel detectKernel();
+
+	static void encodeScalar(const byte_t* in, size_t count, byte_t* out);
+	static size_t decodeScalar(const byte_t* in, size_t count, byte_t* out);
+};
+
+
+} // encoder
+} // utility
+} // vmime
+
+
+#endif // VMIME_UTILITY_ENCODER_B64KERNELS_HPP_INCLUDED
@@ -22,6 +22,7 @@
 //
 
 #include "vmime/utility/encoder/encoder.hpp"
+#include "vmime/utility/inputStreamStringAdapter.hpp"
 #include "vmime/exception.hpp"
 
 
@@ -71,6 +72,71 @@ const std::vector <string> encoder::getAvailableProperties() const {
 }
 
 
+/** Filtered output stream for encoders which do not support encoding
+  * or decoding block by block: data is encoded or decoded on flush().
+  */
+class encoder::bufferedFilteredOutputStream : public utility::filteredOutputStream {
+
+public:
+
+	bufferedFilteredOutputStream(encoder& enc, const bool decode, utility::outputStream& os)
+		: m_encoder(enc),
+		  m_decode(decode),
+		  m_stream(os) {
+
+	}
+
+	utility::outputStream& getNextOutputStream() {
+
+		return m_stream;
+	}
+
+	void flush() {
+
+		utility::inputStreamStringAdapter in(m_buffer);
+
+		if (m_decode) {
+			m_encoder.decode(in, m_stream);
+		} else {
+			m_encoder.encode(in, m_stream);
+		}
+
+		m_buffer.clear();
+
+		m_stream.flush();
+	}
+
+protected:
+
+	void writeImpl(const byte_t* const data, const size_t count) {
+
+		m_buffer.append(reinterpret_cast <const char*>(data), count);
+	}
+
+private:
+
+	encoder& m_encoder;
+	const bool m_decode;
+	utility::outputStream& m_stream;
+
+	string m_buffer;
+};
+
+
+shared_ptr <utility::filteredOutputStream>
+	encoder::getEncodingFilteredOutputStream(utility::outputStream& os) {
+
+	return make_shared <bufferedFilteredOutputStream>(*this, false, os);
+}
+
+
+shared_ptr <utility::filteredOutputStream>
+	encoder::getDecodingFilteredOutputStream(utility::outputStream& os) {
+
+	return make_shared <bufferedFilteredOutputStream>(*this, true, os);
+}
+
+
 } // encoder
 } // utility
 } // vmime
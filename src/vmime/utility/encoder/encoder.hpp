@@ -29,6 +29,7 @@
 #include "vmime/propertySet.hpp"
 #include "vmime/exception.hpp"
 #include "vmime/utility/progressListener.hpp"
+#include "vmime/utility/filteredStream.hpp"
 
 
 namespace vmime {
@@ -73,6 +74,42 @@ public:
 		utility::progressListener* progress = NULL
 	) = 0;
 
+	/** Return a filtered output stream which encodes data written into
+	  * it, and writes encoded data into the specified stream. This allows
+	  * data to be encoded block by block, as it becomes available.
+	  *
+	  * Properties of the encoder must be set before calling this function.
+	  * Once all data has been written, flush() must be called on the
+	  * returned stream to output the end of encoded data.
+	  *
+	  * The default implementation keeps all data in memory until flush()
+	  * is called; in this case, the encoder must not be destroyed before
+	  * the returned stream.
+	  *
+	  * @param os output stream for encoded data
+	  * @return a filtered output stream
+	  */
+	virtual shared_ptr <utility::filteredOutputStream>
+		getEncodingFilteredOutputStream(utility::outputStream& os);
+
+	/** Return a filtered output stream which decodes data written into
+	  * it, and writes decoded data into the specified stream. This allows
+	  * data to be decoded block by block, as it becomes available.
+	  *
+	  * Properties of the encoder must be set before calling this function.
+	  * Once all data has been written, flush() must be called on the
+	  * returned stream to output the end of decoded data.
+	  *
+	  * The default implementation keeps all data in memory until flush()
+	  * is called; in this case, the encoder must not be destroyed before
+	  * the returned stream.
+	  *
+	  * @param os output stream for decoded data
+	  * @return a filtered output stream
+	  */
+	virtual shared_ptr <utility::filteredOutputStream>
+		getDecodingFilteredOutputStream(utility::outputStream& os);
+
 	/** Return the properties of the encoder.
 	  *
 	  * @return properties of the encoder
@@ -122,6 +159,8 @@ protected:
 
 private:
 
+	class bufferedFilteredOutputStream;
+
 	propertySet m_props;
 	propertySet m_results;
 };
@@ -77,6 +77,59 @@ size_t noopEncoder::decode(
 }
 
 
+/** Writes data as-is to the next output stream.
+  */
+class noopEncoder::copyStream : public utility::filteredOutputStream {
+
+public:
+
+	copyStream(utility::outputStream& os)
+		: m_stream(os) {
+
+	}
+
+	utility::outputStream& getNextOutputStream() {
+
+		return m_stream;
+	}
+
+	void flush() {
+
+		m_stream.flush();
+	}
+
+	size_t getBlockSize() {
+
+		return m_stream.getBlockSize();
+	}
+
+protected:
+
+	void writeImpl(const byte_t* const data, const size_t count) {
+
+		m_stream.write(data, count);
+	}
+
+private:
+
+	utility::outputStream& m_stream;
+};
+
+
+shared_ptr <utility::filteredOutputStream>
+	noopEncoder::getEncodingFilteredOutputStream(utility::outputStream& os) {
+
+	return make_shared <copyStream>(os);
+}
+
+
+shared_ptr <utility::filteredOutputStream>
+	noopEncoder::getDecodingFilteredOutputStream(utility::outputStream& os) {
+
+	return make_shared <copyStream>(os);
+}
+
+
 size_t noopEncoder::getEncodedSize(const size_t n) const {
 
 	return n;
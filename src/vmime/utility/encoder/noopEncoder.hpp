@@ -53,8 +53,18 @@ public:
 		utility::progressListener* progress = NULL
 	);
 
+	shared_ptr <utility::filteredOutputStream>
+		getEncodingFilteredOutputStream(utility::outputStream& os);
+
+	shared_ptr <utility::filteredOutputStream>
+		getDecodingFilteredOutputStream(utility::outputStream& os);
+
 	size_t getEncodedSize(const size_t n) const;
 	size_t getDecodedSize(const size_t n) const;
+
+private:
+
+	class copyStream;
 };
 
 
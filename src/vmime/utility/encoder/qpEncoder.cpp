@@ -24,6 +24,11 @@
 #include "vmime/utility/encoder/qpEncoder.hpp"
 #include "vmime/parserHelpers.hpp"
 
+#include "vmime/utility/stringUtils.hpp"
+
+#include <algorithm>
+#include <cstring>
+
 
 namespace vmime {
 namespace utility {
@@ -95,6 +100,32 @@ const vmime_uint8 qpEncoder::sm_RFC2047EncodeTable[] = {
 };
 
 
+// Quoted-printable encoding table (when not encoding RFC-2047):
+//   0 = character may be represented literally (RFC-2045/6.7(2)),
+//       except '.' at the beginning of a line
+//   1 = character is always hex-encoded
+//   2 = special handling (SPACE, CR, LF)
+//
+const vmime_uint8 qpEncoder::sm_encodeClassTable[256] = {
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 2, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+
 // Hex-decoding table
 const vmime_uint8 qpEncoder::sm_hexDecodeTable[256] = {
 	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
@@ -146,81 +177,185 @@ int qpEncoder::RFC2047_getEncodedLength(const byte_t c) {
 }
 
 
-#ifndef VMIME_BUILDING_DOC
+/** Encodes data written into it to quoted-printable, block by block.
+  */
+class qpEncoder::encodingStream : public utility::filteredOutputStream {
+
+public:
+
+	/** Construct a new encoding stream.
+	  *
+	  * @param os stream into which write encoded data
+	  * @param maxLineLength maximum line length, or -1 to
+	  * disable line cutting
+	  * @param text if true, CR and LF characters are not encoded
+	  * @param rfc2047 if true, use RFC-2047 "Q" encoding
+	  */
+	encodingStream(
+		utility::outputStream& os,
+		const size_t maxLineLength,
+		const bool text,
+		const bool rfc2047
+	)
+		: m_stream(os),
+		  // Soft line breaks are never inserted in RFC-2047 mode
+		  m_cutLines(maxLineLength != static_cast <size_t>(-1) && !rfc2047),
+		  m_maxLineLength(maxLineLength),
+		  m_text(text),
+		  m_rfc2047(rfc2047),
+		  m_curCol(0),
+		  m_pendingSpace(false),
+		  m_outBufferPos(0),
+		  m_total(0) {
 
-#define QP_ENCODE_HEX(x) \
-	outBuffer[outBufferPos] = '=';                           \
-	outBuffer[outBufferPos + 1] = sm_hexDigits[x >> 4];  \
-	outBuffer[outBufferPos + 2] = sm_hexDigits[x & 0xF]; \
-	outBufferPos += 3;                                       \
-	curCol += 3
+	}
 
-#define QP_WRITE(s, x, l) s.write(reinterpret_cast <byte_t*>(x), l)
+	utility::outputStream& getNextOutputStream() {
 
-#endif // VMIME_BUILDING_DOC
+		return m_stream;
+	}
 
+	void flush() {
 
-size_t qpEncoder::encode(
-	utility::inputStream& in,
-	utility::outputStream& out,
-	utility::progressListener* progress
-) {
+		finish();
 
-	in.reset();  // may not work...
+		m_stream.flush();
+	}
 
-	const size_t propMaxLineLength =
-		getProperties().getProperty <size_t>("maxlinelength", static_cast <size_t>(-1));
+	/** Encode remaining data, without flushing the next output stream.
+	  */
+	void finish() {
 
-	const bool rfc2047 = getProperties().getProperty <bool>("rfc2047", false);
-	const bool text = getProperties().getProperty <bool>("text", false);  // binary mode by default
+		// Spaces cannot appear at the end of data
+		if (m_pendingSpace) {
 
-	const bool cutLines = (propMaxLineLength != static_cast <size_t>(-1));
-	const size_t maxLineLength = std::min(propMaxLineLength, static_cast <size_t>(74));
+			m_pendingSpace = false;
 
-	// Process the data
-	byte_t buffer[16384];
-	size_t bufferLength = 0;
-	size_t bufferPos = 0;
+			encodeHex(' ');
+			softLineBreak();
+		}
 
-	size_t curCol = 0;
+		writeOutBuffer();
+	}
 
-	byte_t outBuffer[16384];
-	size_t outBufferPos = 0;
+	/** Return the number of encoded bytes written so far.
+	  *
+	  * @return number of bytes written into the next output stream
+	  */
+	size_t getTotalWritten() const {
 
-	size_t total = 0;
-	size_t inTotal = 0;
+		return m_total + m_outBufferPos;
+	}
 
-	if (progress) {
-		progress->start(0);
+protected:
+
+	void writeImpl(const byte_t* const data, const size_t count) {
+
+		size_t i = 0;
+
+		while (i < count) {
+
+			// Flush current output buffer
+			if (m_outBufferPos + 6 >= sizeof(m_outBuffer)) {
+				writeOutBuffer();
+			}
+
+			// Copy a run of literal characters at once
+			if (!m_pendingSpace) {
+
+				const size_t n = scanLiterals(data + i, count - i);
+
+				if (n != 0) {
+
+					std::memcpy(m_outBuffer + m_outBufferPos, data + i, n);
+
+					m_outBufferPos += n;
+					m_curCol += n;
+					i += n;
+
+					softLineBreak();
+					continue;
+				}
+			}
+
+			const byte_t c = data[i++];
+
+			// Spaces cannot appear at the end of a line: the space
+			// is encoded if the next character is CR or LF
+			if (m_pendingSpace) {
+
+				m_pendingSpace = false;
+
+				if (c == '\r' || c == '\n') {
+					encodeHex(' ');
+				} else {
+					put(' ');
+				}
+
+				softLineBreak();
+			}
+
+			if (c == ' ' && !m_rfc2047) {
+				m_pendingSpace = true;
+			} else {
+				encodeChar(c);
+			}
+		}
+
+		writeOutBuffer();
 	}
 
-	while (bufferPos < bufferLength || !in.eof()) {
+private:
 
-		// Flush current output buffer
-		if (outBufferPos + 6 >= static_cast <int>(sizeof(outBuffer))) {
+	/** Return the number of characters at the beginning of the
+	  * specified data which can be copied as-is to the output, without
+	  * exceeding the current line or the output buffer.
+	  *
+	  * @param data data to encode
+	  * @param count number of bytes available
+	  * @return number of literal characters
+	  */
+	size_t scanLiterals(const byte_t* const data, const size_t count) const {
 
-			QP_WRITE(out, outBuffer, outBufferPos);
+		size_t max = std::min(count, sizeof(m_outBuffer) - 6 - m_outBufferPos);
 
-			total += outBufferPos;
-			outBufferPos = 0;
+		if (m_cutLines) {
+
+			// A soft line break is inserted as soon as the column
+			// reaches (maxLineLength - 1)
+			const size_t lineEnd = m_maxLineLength - 1;
+			const size_t lineRoom = (m_curCol < lineEnd) ? lineEnd - m_curCol : 1;
+
+			max = std::min(max, lineRoom);
 		}
 
-		// Need to get more data?
-		if (bufferPos >= bufferLength) {
+		size_t n = 0;
 
-			bufferLength = in.read(buffer, sizeof(buffer));
-			bufferPos = 0;
+		if (m_rfc2047) {
 
-			// No more data
-			if (bufferLength == 0) {
-				break;
+			while (n < max && data[n] < 128 && sm_RFC2047EncodeTable[data[n]] == 0) {
+				++n;
+			}
+
+		} else {
+
+			// '.' at the beginning of a line must be encoded
+			if (m_curCol == 0 && max != 0 && data[0] == '.') {
+				return 0;
 			}
+
+			// Literal characters (class 0 in sm_encodeClassTable) are
+			// the printable characters except '=' and '?'; the table
+			// is used for the character which ends the run
+			n = stringUtils::findFirstOutsideRange(data, data + max, '!', '~', '=', '?') - data;
 		}
 
-		// Get the next char and encode it
-		const byte_t c = buffer[bufferPos++];
+		return n;
+	}
+
+	void encodeChar(const byte_t c) {
 
-		if (rfc2047) {
+		if (m_rfc2047) {
 
 			if (c >= 128 || sm_RFC2047EncodeTable[c] != 0) {
 
@@ -229,316 +364,482 @@ size_t qpEncoder::encode(
 					// RFC-2047, Page 5, 4.2. The "Q" encoding:
 					// << The 8-bit hexadecimal value 20 (e.g., ISO-8859-1 SPACE) may be
 					// represented as "_" (underscore, ASCII 95.). >>
-					outBuffer[outBufferPos++] = '_';
-					++curCol;
+					put('_');
 
 				} else {
 
 					// Other characters: '=' + hexadecimal encoding
-					QP_ENCODE_HEX(c);
+					encodeHex(c);
 				}
 
 			} else {
 
 				// No encoding
-				outBuffer[outBufferPos++] = c;
-				++curCol;
+				put(c);
 			}
 
-		} else {
+			return;
+		}
+
+		switch (sm_encodeClassTable[c]) {
+
+			/*
+				Rule #2: (Literal representation) Octets with decimal values of 33
+				through 60 inclusive, and 62 through 126, inclusive, MAY be
+				represented as the ASCII characters which correspond to those
+				octets (EXCLAMATION POINT through LESS THAN, and GREATER THAN
+				through TILDE, respectively).
+			*/
+			case 0: {
+
+				if (c == '.' && m_curCol == 0) {
+					// If a '.' appears at the beginning of a line, we encode it to
+					// to avoid problems with SMTP servers... ("\r\n.\r\n" means the
+					// end of data transmission).
+					encodeHex('.');
+					return;
+				}
 
-			switch (c) {
+				put(c);
+				break;
+			}
+			case 2: {   // CR or LF
 
-				case 46: {  // .
+				// RFC-2045/6.7(4)
 
-					if (curCol == 0) {
-						// If a '.' appears at the beginning of a line, we encode it to
-						// to avoid problems with SMTP servers... ("\r\n.\r\n" means the
-						// end of data transmission).
-						QP_ENCODE_HEX('.');
-						continue;
-					}
+				// Text data
+				if (m_text) {
 
-					outBuffer[outBufferPos++] = '.';
-					++curCol;
-					break;
-				}
-				case 32: {  // space
+					put(c);
 
-					// Need to get more data?
-					if (bufferPos >= bufferLength) {
-						bufferLength = in.read(buffer, sizeof(buffer));
-						bufferPos = 0;
+					if (c == 10) {
+						m_curCol = 0;  // reset current line length
 					}
 
-					// Spaces cannot appear at the end of a line. So, encode the space.
-					if (bufferPos >= bufferLength ||
-					    (buffer[bufferPos] == '\r' || buffer[bufferPos] == '\n')) {
+				// Binary data
+				} else {
 
-						QP_ENCODE_HEX(' ');
+					encodeHex(c);
+				}
 
-					} else {
+				break;
+			}
+			default:
 
-						outBuffer[outBufferPos++] = ' ';
-						++curCol;
-					}
+				// Other characters: '=' + hexadecimal encoding
+				encodeHex(c);
+				break;
 
-					break;
-				}
-				case 9: {   // TAB
+		} // switch (sm_encodeClassTable[c])
 
-					QP_ENCODE_HEX(c);
-					break;
-				}
-				case 13:    // CR
-				case 10: {  // LF
+		softLineBreak();
+	}
 
-					// RFC-2045/6.7(4)
+	void put(const byte_t c) {
 
-					// Text data
-					if (text && !rfc2047) {
+		m_outBuffer[m_outBufferPos++] = c;
+		++m_curCol;
+	}
 
-						outBuffer[outBufferPos++] = c;
-						++curCol;
+	void encodeHex(const byte_t c) {
 
-						if (c == 10) {
-							curCol = 0;  // reset current line length
-						}
+		m_outBuffer[m_outBufferPos] = '=';
+		m_outBuffer[m_outBufferPos + 1] = sm_hexDigits[c >> 4];
+		m_outBuffer[m_outBufferPos + 2] = sm_hexDigits[c & 0xF];
 
-					// Binary data
-					} else {
+		m_outBufferPos += 3;
+		m_curCol += 3;
+	}
 
-						QP_ENCODE_HEX(c);
-					}
+	void softLineBreak() {
 
-					break;
-				}
-				case 61: {  // =
+		// Soft line break : "=\r\n"
+		if (m_cutLines && m_curCol >= m_maxLineLength - 1) {
 
-					QP_ENCODE_HEX('=');
-					break;
-				}
-				/*
-					Rule #2: (Literal representation) Octets with decimal values of 33
-					through 60 inclusive, and 62 through 126, inclusive, MAY be
-					represented as the ASCII characters which correspond to those
-					octets (EXCLAMATION POINT through LESS THAN, and GREATER THAN
-					through TILDE, respectively).
-				*/
-				default:
+			m_outBuffer[m_outBufferPos] = '=';
+			m_outBuffer[m_outBufferPos + 1] = '\r';
+			m_outBuffer[m_outBufferPos + 2] = '\n';
 
-					//if ((c >= 33 && c <= 60) || (c >= 62 && c <= 126))
-					if (c >= 33 && c <= 126 && c != 61 && c != 63) {
+			m_outBufferPos += 3;
+			m_curCol = 0;
+		}
+	}
 
-						outBuffer[outBufferPos++] = c;
-						++curCol;
+	void writeOutBuffer() {
 
-					// Other characters: '=' + hexadecimal encoding
-					} else {
+		if (m_outBufferPos != 0) {
 
-						QP_ENCODE_HEX(c);
-					}
+			m_stream.write(m_outBuffer, m_outBufferPos);
 
-					break;
+			m_total += m_outBufferPos;
+			m_outBufferPos = 0;
+		}
+	}
 
-			} // switch (c)
 
-			// Soft line break : "=\r\n"
-			if (cutLines && curCol >= maxLineLength - 1) {
+	utility::outputStream& m_stream;
 
-				outBuffer[outBufferPos] = '=';
-				outBuffer[outBufferPos + 1] = '\r';
-				outBuffer[outBufferPos + 2] = '\n';
+	const bool m_cutLines;
+	const size_t m_maxLineLength;
+	const bool m_text;
+	const bool m_rfc2047;
 
-				outBufferPos += 3;
-				curCol = 0;
-			}
+	size_t m_curCol;
+	bool m_pendingSpace;
 
-		} // !rfc2047
+	byte_t m_outBuffer[16384];
+	size_t m_outBufferPos;
 
-		++inTotal;
+	size_t m_total;
+};
 
-		if (progress) {
-			progress->progress(inTotal, inTotal);
-		}
-	}
 
-	// Flush remaining output buffer
-	if (outBufferPos != 0) {
-		QP_WRITE(out, outBuffer, outBufferPos);
-		total += outBufferPos;
-	}
+/** Decodes quoted-printable data written into it, block by block.
+  */
+class qpEncoder::decodingStream : public utility::filteredOutputStream {
+
+public:
+
+	/** Construct a new decoding stream.
+	  *
+	  * @param os stream into which write decoded data
+	  * @param rfc2047 if true, decode RFC-2047 "Q" encoding
+	  */
+	decodingStream(utility::outputStream& os, const bool rfc2047)
+		: m_stream(os),
+		  m_rfc2047(rfc2047),
+		  m_state(STATE_NORMAL),
+		  m_hexChar(0),
+		  m_outBufferPos(0),
+		  m_total(0) {
 
-	if (progress) {
-		progress->stop(inTotal);
 	}
 
-	return total;
-}
+	utility::outputStream& getNextOutputStream() {
 
+		return m_stream;
+	}
 
-size_t qpEncoder::decode(
-	utility::inputStream& in,
-	utility::outputStream& out,
-	utility::progressListener* progress
-) {
+	void flush() {
 
-	in.reset();  // may not work...
+		finish();
 
-	// Process the data
-	const bool rfc2047 = getProperties().getProperty <bool>("rfc2047", false);
+		m_stream.flush();
+	}
 
-	byte_t buffer[16384];
-	size_t bufferLength = 0;
-	size_t bufferPos = 0;
+	/** Write decoded data, without flushing the next output stream.
+	  * Incomplete sequences at the end of data are ignored.
+	  */
+	void finish() {
 
-	byte_t outBuffer[16384];
-	size_t outBufferPos = 0;
+		m_state = STATE_NORMAL;  // premature end-of-data
 
-	size_t total = 0;
-	size_t inTotal = 0;
+		writeOutBuffer();
+	}
 
-	while (bufferPos < bufferLength || !in.eof()) {
+	/** Return the number of decoded bytes written so far.
+	  *
+	  * @return number of bytes written into the next output stream
+	  */
+	size_t getTotalWritten() const {
 
-		// Flush current output buffer
-		if (outBufferPos >= sizeof(outBuffer)) {
+		return m_total + m_outBufferPos;
+	}
 
-			QP_WRITE(out, outBuffer, outBufferPos);
+protected:
 
-			total += outBufferPos;
-			outBufferPos = 0;
-		}
+	void writeImpl(const byte_t* const data, const size_t count) {
 
-		// Need to get more data?
-		if (bufferPos >= bufferLength) {
+		size_t i = 0;
 
-			bufferLength = in.read(buffer, sizeof(buffer));
-			bufferPos = 0;
+		while (i < count) {
 
-			// No more data
-			if (bufferLength == 0) {
-				break;
+			// Flush current output buffer
+			if (m_outBufferPos >= sizeof(m_outBuffer)) {
+				writeOutBuffer();
 			}
-		}
 
-		// Decode the next sequence (hex-encoded byte or printable character)
-		byte_t c = buffer[bufferPos++];
+			if (m_state == STATE_NORMAL) {
+
+				// Copy a run of literal characters at once
+				const size_t n = scanLiterals(
+					data + i, std::min(count - i, sizeof(m_outBuffer) - m_outBufferPos)
+				);
 
-		++inTotal;
+				if (n != 0) {
 
-		switch (c) {
+					std::memcpy(m_outBuffer + m_outBufferPos, data + i, n);
 
-			case '=': {
+					m_outBufferPos += n;
+					i += n;
 
-				if (bufferPos >= bufferLength) {
-					bufferLength = in.read(buffer, sizeof(buffer));
-					bufferPos = 0;
+					continue;
 				}
 
-				if (bufferPos < bufferLength) {
+				// Complete "=XX" sequence or soft line break
+				if (data[i] == '=' && count - i >= 3) {
+
+					const byte_t c1 = data[i + 1];
+
+					if (c1 == '\r') {
 
-					c = buffer[bufferPos++];
+						i += 3;  // skip the byte following "=\r"
 
-					++inTotal;
+					} else if (c1 == '\n') {
 
-					switch (c) {
+						i += 2;
 
-						// Ignore soft line break ("=\r\n" or "=\n")
-						case '\r':
+					} else {
+
+						m_outBuffer[m_outBufferPos++] = static_cast <byte_t>(
+							sm_hexDecodeTable[c1] * 16 + sm_hexDecodeTable[data[i + 2]]
+						);
 
-							// Read one byte more
-							if (bufferPos >= bufferLength) {
-								bufferLength = in.read(buffer, sizeof(buffer));
-								bufferPos = 0;
-							}
+						i += 3;
+					}
 
-							if (bufferPos < bufferLength) {
-								++bufferPos;
-								++inTotal;
-							}
+					continue;
+				}
+			}
 
-							break;
+			decodeChar(data[i++]);
+		}
 
-						case '\n':
+		writeOutBuffer();
+	}
 
-							break;
+private:
 
-						// Hex-encoded char
-						default:
-						{
-							// We need another byte...
-							if (bufferPos >= bufferLength) {
-								bufferLength = in.read(buffer, sizeof(buffer));
-								bufferPos = 0;
-							}
+	/** Return the number of characters at the beginning of the
+	  * specified data which are not part of an encoded sequence.
+	  *
+	  * @param data data to decode
+	  * @param count number of bytes available
+	  * @return number of literal characters
+	  */
+	size_t scanLiterals(const byte_t* const data, const size_t count) const {
 
-							if (bufferPos < bufferLength) {
+		const byte_t* const special = stringUtils::findFirstOf
+			(data, data + count, '=', m_rfc2047 ? '_' : '=');
 
-								const byte_t next = buffer[bufferPos++];
+		return special - data;
+	}
 
-								++inTotal;
+	/** Decode the next sequence (hex-encoded byte or printable character),
+	  * one byte at a time.
+	  *
+	  * @param c next input byte
+	  */
+	void decodeChar(const byte_t c) {
 
-								const byte_t value = static_cast <byte_t>(
-									sm_hexDecodeTable[c] * 16 + sm_hexDecodeTable[next]
-								);
+		switch (m_state) {
 
-								outBuffer[outBufferPos++] = value;
+			case STATE_NORMAL:
 
-							} else {
+				if (c == '=') {
 
-								// Premature end-of-data
-							}
+					m_state = STATE_EQUAL;
 
-							break;
-						}
+				} else if (c == '_' && m_rfc2047) {
 
-					}
+					// RFC-2047, Page 5, 4.2. The "Q" encoding:
+					// << Note that the "_" always represents hexadecimal 20, even if the SPACE
+					// character occupies a different code position in the character set in use. >>
+					m_outBuffer[m_outBufferPos++] = 0x20;
 
 				} else {
 
-					// Premature end-of-data
+					m_outBuffer[m_outBufferPos++] = c;
 				}
 
 				break;
-			}
-			case '_': {
 
-				if (rfc2047) {
+			case STATE_EQUAL:
 
-					// RFC-2047, Page 5, 4.2. The "Q" encoding:
-					// << Note that the "_" always represents hexadecimal 20, even if the SPACE
-					// character occupies a different code position in the character set in use. >>
-					outBuffer[outBufferPos++] = 0x20;
-					break;
+				// Ignore soft line break ("=\r\n" or "=\n")
+				if (c == '\r') {
+					m_state = STATE_SOFT_LINE_BREAK;
+				} else if (c == '\n') {
+					m_state = STATE_NORMAL;
+				// Hex-encoded char: we need another byte...
+				} else {
+					m_hexChar = c;
+					m_state = STATE_HEX;
 				}
 
-				outBuffer[outBufferPos++] = c;
 				break;
-			}
-			default: {
 
-				outBuffer[outBufferPos++] = c;
+			case STATE_SOFT_LINE_BREAK:
+
+				// Skip the byte following "=\r"
+				m_state = STATE_NORMAL;
 				break;
-			}
 
+			case STATE_HEX:
+
+				m_outBuffer[m_outBufferPos++] = static_cast <byte_t>(
+					sm_hexDecodeTable[m_hexChar] * 16 + sm_hexDecodeTable[c]
+				);
+
+				m_state = STATE_NORMAL;
+				break;
+		}
+	}
+
+	void writeOutBuffer() {
+
+		if (m_outBufferPos != 0) {
+
+			m_stream.write(m_outBuffer, m_outBufferPos);
+
+			m_total += m_outBufferPos;
+			m_outBufferPos = 0;
 		}
+	}
+
+
+	enum State {
+		STATE_NORMAL,           /**< Literal characters. */
+		STATE_EQUAL,            /**< After '='. */
+		STATE_SOFT_LINE_BREAK,  /**< After "=\r". */
+		STATE_HEX               /**< After '=' and first hex digit. */
+	};
+
+	utility::outputStream& m_stream;
+
+	const bool m_rfc2047;
+
+	State m_state;
+	byte_t m_hexChar;
+
+	byte_t m_outBuffer[16384];
+	size_t m_outBufferPos;
+
+	size_t m_total;
+};
+
+
+shared_ptr <qpEncoder::encodingStream> qpEncoder::createEncodingStream(utility::outputStream& os) const {
+
+	const size_t propMaxLineLength =
+		getProperties().getProperty <size_t>("maxlinelength", static_cast <size_t>(-1));
+
+	const bool rfc2047 = getProperties().getProperty <bool>("rfc2047", false);
+	const bool text = getProperties().getProperty <bool>("text", false);  // binary mode by default
+
+	const bool cutLines = (propMaxLineLength != static_cast <size_t>(-1));
+	const size_t maxLineLength =
+		cutLines ? std::min(propMaxLineLength, static_cast <size_t>(74)) : propMaxLineLength;
+
+	return make_shared <encodingStream>(os, maxLineLength, text, rfc2047);
+}
+
+
+shared_ptr <qpEncoder::decodingStream> qpEncoder::createDecodingStream(utility::outputStream& os) const {
+
+	const bool rfc2047 = getProperties().getProperty <bool>("rfc2047", false);
+
+	return make_shared <decodingStream>(os, rfc2047);
+}
+
+
+shared_ptr <utility::filteredOutputStream>
+	qpEncoder::getEncodingFilteredOutputStream(utility::outputStream& os) {
+
+	return createEncodingStream(os);
+}
+
+
+shared_ptr <utility::filteredOutputStream>
+	qpEncoder::getDecodingFilteredOutputStream(utility::outputStream& os) {
+
+	return createDecodingStream(os);
+}
+
+
+size_t qpEncoder::encode(
+	utility::inputStream& in,
+	utility::outputStream& out,
+	utility::progressListener* progress
+) {
+
+	in.reset();  // may not work...
+
+	shared_ptr <encodingStream> stream = createEncodingStream(out);
+
+	// Process the data
+	byte_t buffer[16384];
+	size_t inTotal = 0;
+
+	if (progress) {
+		progress->start(0);
+	}
+
+	while (!in.eof()) {
+
+		const size_t bufferLength = in.read(buffer, sizeof(buffer));
+
+		if (bufferLength == 0) {
+			break;
+		}
+
+		stream->write(buffer, bufferLength);
+
+		inTotal += bufferLength;
 
 		if (progress) {
 			progress->progress(inTotal, inTotal);
 		}
 	}
 
-	// Flush remaining output buffer
-	if (outBufferPos != 0) {
-		QP_WRITE(out, outBuffer, outBufferPos);
-		total += outBufferPos;
+	stream->finish();
+
+	if (progress) {
+		progress->stop(inTotal);
+	}
+
+	return stream->getTotalWritten();
+}
+
+
+size_t qpEncoder::decode(
+	utility::inputStream& in,
+	utility::outputStream& out,
+	utility::progressListener* progress
+) {
+
+	in.reset();  // may not work...
+
+	shared_ptr <decodingStream> stream = createDecodingStream(out);
+
+	// Process the data
+	byte_t buffer[16384];
+	size_t inTotal = 0;
+
+	while (!in.eof()) {
+
+		const size_t bufferLength = in.read(buffer, sizeof(buffer));
+
+		if (bufferLength == 0) {
+			break;
+		}
+
+		stream->write(buffer, bufferLength);
+
+		inTotal += bufferLength;
+
+		if (progress) {
+			progress->progress(inTotal, inTotal);
+		}
 	}
 
+	stream->finish();
+
 	if (progress) {
 		progress->stop(inTotal);
 	}
 
-	return total;
+	return stream->getTotalWritten();
 }
 
 
@@ -53,6 +53,12 @@ public:
 		utility::progressListener* progress = NULL
 	);
 
+	shared_ptr <utility::filteredOutputStream>
+		getEncodingFilteredOutputStream(utility::outputStream& os);
+
+	shared_ptr <utility::filteredOutputStream>
+		getDecodingFilteredOutputStream(utility::outputStream& os);
+
 	const std::vector <string> getAvailableProperties() const;
 
 	static bool RFC2047_isEncodingNeededForChar(const unsigned char c);
@@ -66,6 +72,16 @@ protected:
 	static const unsigned char sm_hexDigits[17];
 	static const unsigned char sm_hexDecodeTable[256];
 	static const unsigned char sm_RFC2047EncodeTable[128];
+
+private:
+
+	static const unsigned char sm_encodeClassTable[256];
+
+	class encodingStream;
+	class decodingStream;
+
+	shared_ptr <encodingStream> createEncodingStream(utility::outputStream& os) const;
+	shared_ptr <decodingStream> createDecodingStream(utility::outputStream& os) const;
 };
 
 
@@ -22,8 +22,10 @@
 //
 
 #include "vmime/utility/filteredStream.hpp"
+#include "vmime/utility/stringUtils.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 
 namespace vmime {
@@ -371,6 +373,142 @@ size_t LFToCRLFFilteredOutputStream::getBlockSize() {
 }
 
 
+// SMTPDataFilteredOutputStream
+
+SMTPDataFilteredOutputStream::SMTPDataFilteredOutputStream(
+	outputStream& os,
+	const bool normalizeLineBreaks
+)
+	: m_stream(os),
+	  m_normalizeLineBreaks(normalizeLineBreaks),
+	  m_previousChar('\0'),
+	  m_lineStart(true),
+	  m_bufferSize(0) {
+
+}
+
+
+outputStream& SMTPDataFilteredOutputStream::getNextOutputStream() {
+
+	return m_stream;
+}
+
+
+void SMTPDataFilteredOutputStream::output(const byte_t* const data, const size_t count) {
+
+	if (m_bufferSize + count > sizeof(m_buffer)) {
+		flushBuffer();
+	}
+
+	if (count >= sizeof(m_buffer)) {
+
+		m_stream.write(data, count);
+
+	} else {
+
+		std::memcpy(m_buffer + m_bufferSize, data, count);
+		m_bufferSize += count;
+	}
+}
+
+
+void SMTPDataFilteredOutputStream::flushBuffer() {
+
+	if (m_bufferSize != 0) {
+
+		m_stream.write(m_buffer, m_bufferSize);
+		m_bufferSize = 0;
+	}
+}
+
+
+void SMTPDataFilteredOutputStream::writeImpl(const byte_t* const data, const size_t count) {
+
+	static const byte_t CRLF[] = { '\r', '\n' };
+	static const byte_t DOT_DOT[] = { '.', '.' };
+
+	const byte_t* pos = data;
+	const byte_t* const end = data + count;
+
+	while (pos < end) {
+
+		if (m_lineStart) {
+
+			// LF of a CRLF sequence: CRLF has already been written
+			if (m_normalizeLineBreaks && *pos == '\n' && m_previousChar == '\r') {
+
+				m_previousChar = *pos++;
+				continue;
+
+			// Dot-stuffing
+			} else if (*pos == '.') {
+
+				output(DOT_DOT, 2);
+
+				m_previousChar = *pos++;
+				m_lineStart = false;
+
+				continue;
+			}
+		}
+
+		// Copy everything up to the next line break at once
+		if (!m_normalizeLineBreaks) {
+
+			const byte_t* lf = stringUtils::findFirstOf(pos, end, '\n', '\n');
+
+			if (lf != end) {
+				++lf;  // line break is written unchanged
+			}
+
+			output(pos, lf - pos);
+
+			m_previousChar = *(lf - 1);
+			m_lineStart = (m_previousChar == '\n');
+
+			pos = lf;
+
+			continue;
+		}
+
+		const byte_t* lineBreak = stringUtils::findFirstOf(pos, end, '\r', '\n');
+
+		if (lineBreak != pos) {
+
+			output(pos, lineBreak - pos);
+
+			m_previousChar = *(lineBreak - 1);
+			m_lineStart = false;
+		}
+
+		if (lineBreak == end) {
+			break;
+		}
+
+		// Normalize CR, LF and CRLF to CRLF
+		output(CRLF, 2);
+
+		m_previousChar = *lineBreak;
+		m_lineStart = true;
+
+		pos = lineBreak + 1;
+	}
+}
+
+
+void SMTPDataFilteredOutputStream::flush() {
+
+	flushBuffer();
+	m_stream.flush();
+}
+
+
+size_t SMTPDataFilteredOutputStream::getBlockSize() {
+
+	return sizeof(m_buffer);
+}
+
+
 // stopSequenceFilteredInputStream <1>
 
 template <>
@@ -189,6 +189,57 @@ private:
 };
 
 
+/** A filtered output stream which prepares data to be sent after
+  * the SMTP DATA command, in a single pass: CR or LF characters are
+  * replaced with CRLF sequences (like LFToCRLFFilteredOutputStream),
+  * and a '.' at the beginning of a line is doubled (RFC-5321, 4.5.2).
+  *
+  * Line break normalization can be disabled for data which is already
+  * formatted; then, line breaks are written unchanged and only LF
+  * characters start a new line, so that the number of bytes written is
+  * the number of input bytes plus one for each doubled '.'.
+  *
+  * Output is buffered and written to the next stream by blocks, so
+  * flush() must be called once all data has been written.
+  */
+class VMIME_EXPORT SMTPDataFilteredOutputStream : public filteredOutputStream {
+
+public:
+
+	/** Construct a new filter for the specified output stream.
+	  *
+	  * @param os stream into which write filtered data
+	  * @param normalizeLineBreaks if true, CR and LF characters are
+	  * replaced with CRLF sequences; if false, they are written unchanged
+	  */
+	SMTPDataFilteredOutputStream(outputStream& os, const bool normalizeLineBreaks = true);
+
+	outputStream& getNextOutputStream();
+
+	void flush();
+
+	size_t getBlockSize();
+
+protected:
+
+	void writeImpl(const byte_t* const data, const size_t count);
+
+private:
+
+	void output(const byte_t* const data, const size_t count);
+	void flushBuffer();
+
+
+	outputStream& m_stream;
+	bool m_normalizeLineBreaks;
+	byte_t m_previousChar;
+	bool m_lineStart;
+
+	byte_t m_buffer[16384];
+	size_t m_bufferSize;
+};
+
+
 /** A filtered input stream which stops when a specified sequence
   * is found (eof() method will return 'true').
   */
@@ -100,5 +100,13 @@ void inputStreamByteBufferAdapter::seek(const size_t pos) {
 }
 
 
+const byte_t* inputStreamByteBufferAdapter::getDirectBuffer(size_t* length) const {
+
+	*length = m_length;
+
+	return m_buffer;
+}
+
+
 } // utility
 } // vmime
@@ -47,6 +47,8 @@ public:
 	size_t getPosition() const;
 	void seek(const size_t pos);
 
+	const byte_t* getDirectBuffer(size_t* length) const;
+
 private:
 
 	const byte_t* m_buffer;
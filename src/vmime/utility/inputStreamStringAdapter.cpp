@@ -115,5 +115,13 @@ void inputStreamStringAdapter::seek(const size_t pos) {
 }
 
 
+const byte_t* inputStreamStringAdapter::getDirectBuffer(size_t* length) const {
+
+	*length = m_end - m_begin;
+
+	return reinterpret_cast <const byte_t*>(m_buffer.data()) + m_begin;
+}
+
+
 } // utility
 } // vmime
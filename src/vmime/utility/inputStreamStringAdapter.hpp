@@ -48,6 +48,8 @@ public:
 	size_t getPosition() const;
 	void seek(const size_t pos);
 
+	const byte_t* getDirectBuffer(size_t* length) const;
+
 private:
 
 	inputStreamStringAdapter(const inputStreamStringAdapter&);
@@ -0,0 +1,261 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "vmime/utility/mappedFileInputStream.hpp"
+
+
+#if VMIME_HAVE_FILESYSTEM_FEATURES
+
+
+#include "vmime/exception.hpp"
+#include "vmime/platform.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if VMIME_PLATFORM_IS_POSIX
+#	include <unistd.h>
+#	include <fcntl.h>
+#	include <errno.h>
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <sys/mman.h>
+#elif VMIME_PLATFORM_IS_WINDOWS
+#	include <windows.h>
+#endif
+
+
+namespace vmime {
+namespace utility {
+
+
+static void throwMappingError(const string& filename, const string& what) {
+
+	throw exceptions::filesystem_exception(
+		what,
+		platform::getHandler()->getFileSystemFactory()->stringToPath(filename)
+	);
+}
+
+
+#if VMIME_PLATFORM_IS_POSIX
+
+
+mappedFileInputStream::mappedFileInputStream(const string& filename)
+	: m_data(NULL),
+	  m_length(0),
+	  m_pos(0) {
+
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+
+	if (fd == -1) {
+		throwMappingError(filename, "Cannot open file: " + string(::strerror(errno)));
+	}
+
+	struct stat st;
+
+	if (::fstat(fd, &st) == -1) {
+
+		const int error = errno;
+		::close(fd);
+
+		throwMappingError(filename, "Cannot stat file: " + string(::strerror(error)));
+	}
+
+	m_length = static_cast <size_t>(st.st_size);
+
+	// mmap() fails with zero length
+	if (m_length != 0) {
+
+		void* addr = ::mmap(NULL, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (addr == MAP_FAILED) {
+
+			const int error = errno;
+			::close(fd);
+
+			throwMappingError(filename, "Cannot map file: " + string(::strerror(error)));
+		}
+
+		// Data will be read sequentially
+		::madvise(addr, m_length, MADV_SEQUENTIAL);
+
+		m_data = static_cast <const byte_t*>(addr);
+	}
+
+	// Mapping stays valid after the file descriptor is closed
+	::close(fd);
+}
+
+
+void mappedFileInputStream::unmap() {
+
+	if (m_data) {
+		::munmap(const_cast <byte_t*>(m_data), m_length);
+	}
+}
+
+
+#elif VMIME_PLATFORM_IS_WINDOWS
+
+
+mappedFileInputStream::mappedFileInputStream(const string& filename)
+	: m_data(NULL),
+	  m_length(0),
+	  m_pos(0),
+	  m_mapping(NULL) {
+
+	HANDLE file = ::CreateFileA(
+		filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+	);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		throwMappingError(filename, "Cannot open file");
+	}
+
+	LARGE_INTEGER size;
+
+	if (!::GetFileSizeEx(file, &size)) {
+
+		::CloseHandle(file);
+		throwMappingError(filename, "Cannot get file size");
+	}
+
+	m_length = static_cast <size_t>(size.QuadPart);
+
+	// CreateFileMapping() fails with zero length
+	if (m_length != 0) {
+
+		HANDLE mapping = ::CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping == NULL) {
+
+			::CloseHandle(file);
+			throwMappingError(filename, "Cannot map file");
+		}
+
+		void* addr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (addr == NULL) {
+
+			::CloseHandle(mapping);
+			::CloseHandle(file);
+
+			throwMappingError(filename, "Cannot map file");
+		}
+
+		m_mapping = mapping;
+		m_data = static_cast <const byte_t*>(addr);
+	}
+
+	// Mapping stays valid after the file handle is closed
+	::CloseHandle(file);
+}
+
+
+void mappedFileInputStream::unmap() {
+
+	if (m_data) {
+		::UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping) {
+		::CloseHandle(m_mapping);
+	}
+}
+
+
+#endif // VMIME_PLATFORM_IS_WINDOWS
+
+
+mappedFileInputStream::~mappedFileInputStream() {
+
+	unmap();
+}
+
+
+bool mappedFileInputStream::eof() const {
+
+	return m_pos >= m_length;
+}
+
+
+void mappedFileInputStream::reset() {
+
+	m_pos = 0;
+}
+
+
+size_t mappedFileInputStream::read(byte_t* const data, const size_t count) {
+
+	const size_t n = std::min(count, m_length - m_pos);
+
+	if (n != 0) {
+		std::memcpy(data, m_data + m_pos, n);
+	}
+
+	m_pos += n;
+
+	return n;
+}
+
+
+size_t mappedFileInputStream::skip(const size_t count) {
+
+	const size_t n = std::min(count, m_length - m_pos);
+
+	m_pos += n;
+
+	return n;
+}
+
+
+size_t mappedFileInputStream::getPosition() const {
+
+	return m_pos;
+}
+
+
+void mappedFileInputStream::seek(const size_t pos) {
+
+	if (pos <= m_length) {
+		m_pos = pos;
+	}
+}
+
+
+const byte_t* mappedFileInputStream::getDirectBuffer(size_t* length) const {
+
+	*length = m_length;
+
+	return m_data;
+}
+
+
+} // utility
+} // vmime
+
+
+#endif // VMIME_HAVE_FILESYSTEM_FEATURES
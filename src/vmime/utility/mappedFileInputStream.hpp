@@ -0,0 +1,96 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#ifndef VMIME_UTILITY_MAPPEDFILEINPUTSTREAM_HPP_INCLUDED
+#define VMIME_UTILITY_MAPPEDFILEINPUTSTREAM_HPP_INCLUDED
+
+
+#include "vmime/config.hpp"
+
+
+#if VMIME_HAVE_FILESYSTEM_FEATURES
+
+
+#include "vmime/utility/seekableInputStream.hpp"
+
+
+namespace vmime {
+namespace utility {
+
+
+/** An input stream for reading a file which is mapped read-only into
+  * memory. The contents of the file is directly accessible (see
+  * seekableInputStream::getDirectBuffer()), so that parsing a message
+  * from this stream does not copy the message body: body contents
+  * reference the mapped region.
+  *
+  * The file must not be modified while this stream (or any component
+  * parsed from it) is in use.
+  */
+class VMIME_EXPORT mappedFileInputStream : public seekableInputStream {
+
+public:
+
+	/** Maps the specified file into memory.
+	  *
+	  * @param filename native path of the file
+	  * @throw exceptions::filesystem_exception if the file cannot
+	  * be opened or mapped
+	  */
+	mappedFileInputStream(const string& filename);
+
+	~mappedFileInputStream();
+
+	bool eof() const;
+	void reset();
+	size_t read(byte_t* const data, const size_t count);
+	size_t skip(const size_t count);
+	size_t getPosition() const;
+	void seek(const size_t pos);
+
+	const byte_t* getDirectBuffer(size_t* length) const;
+
+private:
+
+	void unmap();
+
+
+	const byte_t* m_data;
+	size_t m_length;
+	size_t m_pos;
+
+#if VMIME_PLATFORM_IS_WINDOWS
+	void* m_mapping;
+#endif // VMIME_PLATFORM_IS_WINDOWS
+};
+
+
+} // utility
+} // vmime
+
+
+#endif // VMIME_HAVE_FILESYSTEM_FEATURES
+
+
+#endif // VMIME_UTILITY_MAPPEDFILEINPUTSTREAM_HPP_INCLUDED
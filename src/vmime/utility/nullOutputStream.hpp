@@ -0,0 +1,73 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#ifndef VMIME_UTILITY_NULLOUTPUTSTREAM_HPP_INCLUDED
+#define VMIME_UTILITY_NULLOUTPUTSTREAM_HPP_INCLUDED
+
+
+#include "vmime/utility/outputStream.hpp"
+
+
+namespace vmime {
+namespace utility {
+
+
+/** An output stream which discards all data written to it, and
+  * only counts the number of bytes. This can be used to compute
+  * the exact size of generated data without storing it.
+  */
+class VMIME_EXPORT nullOutputStream : public outputStream {
+
+public:
+
+	nullOutputStream();
+
+	void flush();
+
+	/** Return the number of bytes written to this stream so far.
+	  *
+	  * @return number of bytes written
+	  */
+	size_t getByteCount() const;
+
+	/** Count bytes as if they had been written to this stream.
+	  *
+	  * @param count number of bytes to add to the byte count
+	  */
+	void advance(const size_t count);
+
+protected:
+
+	void writeImpl(const byte_t* const data, const size_t count);
+
+private:
+
+	size_t m_count;
+};
+
+
+} // utility
+} // vmime
+
+
+#endif // VMIME_UTILITY_NULLOUTPUTSTREAM_HPP_INCLUDED
@@ -23,14 +23,19 @@
 
 #include "vmime/utility/parserInputStreamAdapter.hpp"
 
+#include <algorithm>
+
 
 namespace vmime {
 namespace utility {
 
 
 parserInputStreamAdapter::parserInputStreamAdapter(const shared_ptr <seekableInputStream>& stream)
-	: m_stream(stream) {
+	: m_stream(stream),
+	  m_directBuffer(NULL),
+	  m_directLength(0) {
 
+	m_directBuffer = m_stream->getDirectBuffer(&m_directLength);
 }
 
 
@@ -60,6 +65,14 @@ shared_ptr <seekableInputStream> parserInputStreamAdapter::getUnderlyingStream()
 
 const string parserInputStreamAdapter::extract(const size_t begin, const size_t end) const {
 
+	if (m_directBuffer) {
+
+		const size_t first = std::min(begin, m_directLength);
+		const size_t last = std::min(std::max(begin, end), m_directLength);
+
+		return string(m_directBuffer + first, m_directBuffer + last);
+	}
+
 	const size_t initialPos = m_stream->getPosition();
 
 	byte_t *buffer = NULL;
@@ -102,6 +115,32 @@ size_t parserInputStreamAdapter::findNext(
 		return npos;
 	}
 
+	// Search directly in memory, if possible
+	if (m_directBuffer) {
+
+		if (startPosition >= m_directLength || token.length() > m_directLength - startPosition) {
+			return npos;
+		}
+
+		const byte_t* const first = reinterpret_cast <const byte_t*>(token.data());
+		const byte_t* const last = m_directBuffer + m_directLength - token.length();
+
+		for (const byte_t* p = m_directBuffer + startPosition ; p <= last ; ++p) {
+
+			p = static_cast <const byte_t*>(::memchr(p, first[0], last - p + 1));
+
+			if (!p) {
+				break;
+			}
+
+			if (::memcmp(p + 1, first + 1, token.length() - 1) == 0) {
+				return p - m_directBuffer;
+			}
+		}
+
+		return npos;
+	}
+
 	const size_t initialPos = getPosition();
 
 	seek(startPosition);
@@ -65,6 +65,12 @@ public:
 		return m_stream->getPosition();
 	}
 
+	const byte_t* getDirectBuffer(size_t* length) const {
+
+		*length = m_directLength;
+		return m_directBuffer;
+	}
+
 	/** Get the byte at the current position without updating the
 	  * current position.
 	  *
@@ -74,6 +80,10 @@ public:
 
 		const size_t initialPos = m_stream->getPosition();
 
+		if (m_directBuffer) {
+			return (initialPos < m_directLength ? m_directBuffer[initialPos] : static_cast <byte_t>(0));
+		}
+
 		try {
 
 			byte_t buffer[1];
@@ -115,6 +125,12 @@ public:
 
 		const size_t initialPos = m_stream->getPosition();
 
+		if (m_directBuffer) {
+
+			return initialPos + length <= m_directLength &&
+			       ::memcmp(bytes, m_directBuffer + initialPos, length) == 0;
+		}
+
 		try {
 
 			byte_t buffer[32];
@@ -162,6 +178,10 @@ public:
 private:
 
 	mutable shared_ptr <seekableInputStream> m_stream;
+
+	// Contents of the stream, if directly accessible in memory
+	const byte_t* m_directBuffer;
+	size_t m_directLength;
 };
 
 
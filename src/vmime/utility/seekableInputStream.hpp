@@ -52,6 +52,23 @@ public:
 	  * beginning of the stream, at which to set the stream pointer.
 	  */
 	virtual void seek(const size_t pos) = 0;
+
+	/** Returns a pointer to the whole contents of this stream, if the
+	  * data is available in a contiguous memory area (for example, a
+	  * string buffer or a memory-mapped file). This allows parsers to
+	  * access the data without copying it.
+	  *
+	  * The default implementation returns NULL.
+	  *
+	  * @param length will receive the length of the data, in bytes
+	  * @return pointer to the first byte of the stream, or NULL if the
+	  * contents of this stream cannot be accessed directly
+	  */
+	virtual const byte_t* getDirectBuffer(size_t* length) const {
+
+		*length = 0;
+		return NULL;
+	}
 };
 
 
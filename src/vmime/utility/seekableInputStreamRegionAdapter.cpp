@@ -23,6 +23,8 @@
 
 #include "vmime/utility/seekableInputStreamRegionAdapter.hpp"
 
+#include <algorithm>
+
 
 namespace vmime {
 namespace utility {
@@ -107,5 +109,22 @@ void seekableInputStreamRegionAdapter::seek(const size_t pos) {
 }
 
 
+const byte_t* seekableInputStreamRegionAdapter::getDirectBuffer(size_t* length) const {
+
+	size_t streamLength = 0;
+	const byte_t* buffer = m_stream->getDirectBuffer(&streamLength);
+
+	if (!buffer || m_begin > streamLength) {
+
+		*length = 0;
+		return NULL;
+	}
+
+	*length = std::min(m_length, streamLength - m_begin);
+
+	return buffer + m_begin;
+}
+
+
 } // utility
 } // vmime
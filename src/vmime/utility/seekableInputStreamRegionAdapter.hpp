@@ -57,6 +57,8 @@ public:
 	size_t getPosition() const;
 	void seek(const size_t pos);
 
+	const byte_t* getDirectBuffer(size_t* length) const;
+
 private:
 
 	shared_ptr <seekableInputStream> m_stream;
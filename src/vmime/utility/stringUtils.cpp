@@ -24,6 +24,16 @@
 #include "vmime/utility/stringUtils.hpp"
 #include "vmime/parserHelpers.hpp"
 
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VMIME_STRINGUTILS_SSE2 1
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
 
 namespace vmime {
 namespace utility {
@@ -189,6 +199,116 @@ size_t stringUtils::findFirstNonASCIIchar(
 }
 
 
+const byte_t* stringUtils::findFirstOf(
+	const byte_t* begin,
+	const byte_t* const end,
+	const byte_t c1,
+	const byte_t c2
+) {
+
+	if (begin >= end) {
+		return end;
+	}
+
+	if (c1 == c2) {
+
+		const void* const found = std::memchr(begin, c1, end - begin);
+		return found ? static_cast <const byte_t*>(found) : end;
+	}
+
+#if VMIME_STRINGUTILS_SSE2
+
+	const __m128i v1 = _mm_set1_epi8(static_cast <char>(c1));
+	const __m128i v2 = _mm_set1_epi8(static_cast <char>(c2));
+
+	while (end - begin >= 16) {
+
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast <const __m128i*>(begin));
+		const int mask = _mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, v1), _mm_cmpeq_epi8(chunk, v2))
+		);
+
+		if (mask != 0) {
+
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, static_cast <unsigned long>(mask));
+			return begin + index;
+#else
+			return begin + __builtin_ctz(static_cast <unsigned int>(mask));
+#endif
+		}
+
+		begin += 16;
+	}
+
+#endif // VMIME_STRINGUTILS_SSE2
+
+	while (begin < end && *begin != c1 && *begin != c2) {
+		++begin;
+	}
+
+	return begin;
+}
+
+
+const byte_t* stringUtils::findFirstOutsideRange(
+	const byte_t* begin,
+	const byte_t* const end,
+	const byte_t first,
+	const byte_t last,
+	const byte_t c1,
+	const byte_t c2
+) {
+
+#if VMIME_STRINGUTILS_SSE2
+
+	// SSE2 only compares signed bytes: flip the sign bit of the
+	// data and the bounds to compare them as unsigned values
+	const __m128i sign = _mm_set1_epi8(static_cast <char>(0x80));
+	const __m128i vfirst = _mm_set1_epi8(static_cast <char>(first ^ 0x80));
+	const __m128i vlast = _mm_set1_epi8(static_cast <char>(last ^ 0x80));
+	const __m128i v1 = _mm_set1_epi8(static_cast <char>(c1));
+	const __m128i v2 = _mm_set1_epi8(static_cast <char>(c2));
+
+	while (end - begin >= 16) {
+
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast <const __m128i*>(begin));
+		const __m128i biased = _mm_xor_si128(chunk, sign);
+
+		const __m128i outside = _mm_or_si128(
+			_mm_cmplt_epi8(biased, vfirst), _mm_cmpgt_epi8(biased, vlast)
+		);
+		const __m128i equal = _mm_or_si128(
+			_mm_cmpeq_epi8(chunk, v1), _mm_cmpeq_epi8(chunk, v2)
+		);
+
+		const int mask = _mm_movemask_epi8(_mm_or_si128(outside, equal));
+
+		if (mask != 0) {
+
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, static_cast <unsigned long>(mask));
+			return begin + index;
+#else
+			return begin + __builtin_ctz(static_cast <unsigned int>(mask));
+#endif
+		}
+
+		begin += 16;
+	}
+
+#endif // VMIME_STRINGUTILS_SSE2
+
+	while (begin < end && *begin >= first && *begin <= last && *begin != c1 && *begin != c2) {
+		++begin;
+	}
+
+	return begin;
+}
+
+
 const string stringUtils::unquote(const string& str) {
 
 	if (str.length() < 2) {
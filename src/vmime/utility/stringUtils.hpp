@@ -189,6 +189,48 @@ public:
 		const string::const_iterator end
 	);
 
+	/** Returns a pointer to the first occurrence of either of two bytes
+	  * in a buffer. Searching for a single byte (c1 == c2) relies on
+	  * memchr(), which the C library vectorizes on every platform; two
+	  * bytes are searched for 16 bytes at a time when SSE2 is enabled
+	  * at compile time.
+	  *
+	  * @param begin start of the buffer
+	  * @param end end of the buffer
+	  * @param c1 first byte to search for
+	  * @param c2 second byte to search for
+	  * @return pointer to the first byte equal to c1 or c2, or end
+	  * if there is none
+	  */
+	static const byte_t* findFirstOf(
+		const byte_t* begin,
+		const byte_t* const end,
+		const byte_t c1,
+		const byte_t c2
+	);
+
+	/** Returns a pointer to the first byte in a buffer which is outside
+	  * the specified range, or equal to either of two bytes. Bytes are
+	  * checked 16 at a time when SSE2 is enabled at compile time.
+	  *
+	  * @param begin start of the buffer
+	  * @param end end of the buffer
+	  * @param first lowest byte value in the range
+	  * @param last highest byte value in the range
+	  * @param c1 first byte to stop at, even if it is in the range
+	  * @param c2 second byte to stop at, even if it is in the range
+	  * @return pointer to the first byte which is not in [first, last]
+	  * or which is equal to c1 or c2, or end if there is none
+	  */
+	static const byte_t* findFirstOutsideRange(
+		const byte_t* begin,
+		const byte_t* const end,
+		const byte_t first,
+		const byte_t last,
+		const byte_t c1,
+		const byte_t c2
+	);
+
 	/** Convert the specified value to a string value.
 	  *
 	  * @param value to convert
@@ -80,11 +80,13 @@
 #include "utility/inputStreamPointerAdapter.hpp"
 #include "utility/inputStreamSocketAdapter.hpp"
 #include "utility/inputStreamStringAdapter.hpp"
+#include "utility/mappedFileInputStream.hpp"
 #include "utility/outputStream.hpp"
 #include "utility/outputStreamAdapter.hpp"
 #include "utility/outputStreamByteArrayAdapter.hpp"
 #include "utility/outputStreamSocketAdapter.hpp"
 #include "utility/outputStreamStringAdapter.hpp"
+#include "utility/nullOutputStream.hpp"
 #include "utility/streamUtils.hpp"
 
 // Message builder/parser
@@ -0,0 +1,155 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/capabilitySet.hpp"
+
+
+namespace {
+
+	const char* const TEST_KNOWN_CAPABILITIES[] = { "IDLE", "LITERAL+", "AUTH" };
+
+	enum {
+		TEST_CAPABILITY_IDLE,
+		TEST_CAPABILITY_LITERAL_PLUS,
+		TEST_CAPABILITY_AUTH,
+
+		TEST_CAPABILITY_COUNT
+	};
+
+} // namespace
+
+
+VMIME_TEST_SUITE_BEGIN(capabilitySetTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testKnown)
+		VMIME_TEST(testUnknown)
+		VMIME_TEST(testParameters)
+		VMIME_TEST(testNames)
+		VMIME_TEST(testClear)
+	VMIME_TEST_LIST_END
+
+
+	void testKnown() {
+
+		vmime::net::capabilitySet set(TEST_KNOWN_CAPABILITIES, TEST_CAPABILITY_COUNT);
+
+		set.add("idle");
+		set.add("Literal+");
+
+		VASSERT_TRUE("1", set.has(TEST_CAPABILITY_IDLE));
+		VASSERT_TRUE("2", set.has(TEST_CAPABILITY_LITERAL_PLUS));
+		VASSERT_FALSE("3", set.has(TEST_CAPABILITY_AUTH));
+		VASSERT_FALSE("4", set.has(vmime::net::capabilitySet::MAX_KNOWN_CAPABILITIES));
+
+		VASSERT_TRUE("5", set.has("IDLE"));
+		VASSERT_TRUE("6", set.has("literal+"));
+		VASSERT_FALSE("7", set.has("AUTH"));
+	}
+
+	void testUnknown() {
+
+		vmime::net::capabilitySet set(TEST_KNOWN_CAPABILITIES, TEST_CAPABILITY_COUNT);
+
+		set.add("X-Custom-Extension");
+
+		VASSERT_TRUE("1", set.has("X-CUSTOM-EXTENSION"));
+		VASSERT_TRUE("2", set.has("x-custom-extension"));
+		VASSERT_FALSE("3", set.has("X-CUSTOM"));
+		VASSERT_FALSE("4", set.has(TEST_CAPABILITY_IDLE));
+	}
+
+	void testParameters() {
+
+		vmime::net::capabilitySet set(TEST_KNOWN_CAPABILITIES, TEST_CAPABILITY_COUNT);
+
+		std::vector <vmime::string> params;
+		params.push_back("PLAIN");
+		params.push_back("LOGIN");
+
+		set.add("AUTH", params);
+		set.add("SIZE", std::vector <vmime::string>(1, "1000"));
+
+		std::vector <vmime::string> res;
+
+		VASSERT_TRUE("1", set.getParameters(TEST_CAPABILITY_AUTH, res));
+		VASSERT_EQ("2", 2, res.size());
+		VASSERT_EQ("3", "PLAIN", res[0]);
+		VASSERT_EQ("4", "LOGIN", res[1]);
+
+		VASSERT_TRUE("5", set.getParameters("size", res));
+		VASSERT_EQ("6", 1, res.size());
+		VASSERT_EQ("7", "1000", res[0]);
+
+		res.clear();
+
+		VASSERT_FALSE("8", set.getParameters(TEST_CAPABILITY_IDLE, res));
+		VASSERT_FALSE("9", set.getParameters("PIPELINING", res));
+		VASSERT_EQ("10", 0, res.size());
+
+		// Parameters are replaced when a capability is added again
+		set.add("AUTH", std::vector <vmime::string>(1, "CRAM-MD5"));
+
+		VASSERT_TRUE("11", set.getParameters(TEST_CAPABILITY_AUTH, res));
+		VASSERT_EQ("12", 1, res.size());
+		VASSERT_EQ("13", "CRAM-MD5", res[0]);
+	}
+
+	void testNames() {
+
+		vmime::net::capabilitySet set(TEST_KNOWN_CAPABILITIES, TEST_CAPABILITY_COUNT);
+
+		set.add("IMAP4rev1");
+		set.add("idle");
+		set.add("AUTH=PLAIN");
+		set.add("IDLE");
+
+		const std::vector <vmime::string>& names = set.getNames();
+
+		VASSERT_EQ("1", 3, names.size());
+		VASSERT_EQ("2", "IMAP4REV1", names[0]);
+		VASSERT_EQ("3", "IDLE", names[1]);
+		VASSERT_EQ("4", "AUTH=PLAIN", names[2]);
+	}
+
+	void testClear() {
+
+		vmime::net::capabilitySet set(TEST_KNOWN_CAPABILITIES, TEST_CAPABILITY_COUNT);
+
+		VASSERT_TRUE("1", set.isEmpty());
+
+		set.add("IDLE");
+		set.add("X-OTHER");
+
+		VASSERT_FALSE("2", set.isEmpty());
+
+		set.clear();
+
+		VASSERT_TRUE("3", set.isEmpty());
+		VASSERT_FALSE("4", set.has(TEST_CAPABILITY_IDLE));
+		VASSERT_FALSE("5", set.has("X-OTHER"));
+	}
+
+VMIME_TEST_SUITE_END
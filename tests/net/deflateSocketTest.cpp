@@ -0,0 +1,186 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/deflateSocket.hpp"
+
+
+#if VMIME_HAVE_ZLIB_SUPPORT
+
+
+VMIME_TEST_SUITE_BEGIN(deflateSocketTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testSend)
+		VMIME_TEST(testReceive)
+		VMIME_TEST(testReceiveLarge)
+		VMIME_TEST(testReceiveInvalidData)
+		VMIME_TEST(testCounters)
+	VMIME_TEST_LIST_END
+
+
+	void testSend() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::deflateSocket> dsok =
+			vmime::make_shared <vmime::net::deflateSocket>(sok);
+
+		testDeflatePeer peer;
+		vmime::string data;
+
+		dsok->send("a001 NOOP\r\n");
+
+		sok->localReceive(data);
+		VASSERT_EQ("1", "a001 NOOP\r\n", peer.decompress(data));
+
+		// Each send is flushed, so that it can be decompressed immediately
+		dsok->send("a002 NOOP\r\n");
+
+		sok->localReceive(data);
+		VASSERT_EQ("2", "a002 NOOP\r\n", peer.decompress(data));
+	}
+
+	void testReceive() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::deflateSocket> dsok =
+			vmime::make_shared <vmime::net::deflateSocket>(sok);
+
+		testDeflatePeer peer;
+		vmime::string data;
+
+		sok->localSend(peer.compress("* OK first\r\n"));
+		sok->localSend(peer.compress("* OK second\r\n"));
+
+		vmime::string received;
+
+		while (received.length() < 25) {
+
+			dsok->receive(data);
+
+			VASSERT_FALSE("no data", data.empty());
+			received += data;
+		}
+
+		VASSERT_EQ("data", "* OK first\r\n* OK second\r\n", received);
+
+		// No more data
+		dsok->receive(data);
+		VASSERT_EQ("empty", "", data);
+	}
+
+	void testReceiveLarge() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::deflateSocket> dsok =
+			vmime::make_shared <vmime::net::deflateSocket>(sok);
+
+		testDeflatePeer peer;
+
+		std::ostringstream oss;
+
+		for (int i = 0 ; i < 10000 ; ++i) {
+			oss << "* " << i << " FETCH (UID " << (1000 + i) << " FLAGS (\\Seen))\r\n";
+		}
+
+		const vmime::string expected = oss.str();
+
+		sok->localSend(peer.compress(expected));
+
+		// Read through a small buffer: inflate() output for a single
+		// block of input must be returned over several calls
+		vmime::string received;
+		vmime::byte_t buffer[100];
+
+		while (dsok->waitForRead(0)) {
+
+			const size_t n = dsok->receiveRaw(buffer, sizeof(buffer));
+
+			if (n == 0) {
+				break;
+			}
+
+			received.append(reinterpret_cast <char*>(buffer), n);
+		}
+
+		VASSERT_EQ("length", expected.length(), received.length());
+		VASSERT_TRUE("data", expected == received);
+	}
+
+	void testReceiveInvalidData() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::deflateSocket> dsok =
+			vmime::make_shared <vmime::net::deflateSocket>(sok);
+
+		// Block type 3 is reserved: this is not a valid DEFLATE stream
+		sok->localSend("\x07\xff\xff\xff");
+
+		vmime::string data;
+
+		VASSERT_THROW("invalid", dsok->receive(data), vmime::exceptions::socket_exception);
+	}
+
+	void testCounters() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::deflateSocket> dsok =
+			vmime::make_shared <vmime::net::deflateSocket>(sok);
+
+		testDeflatePeer peer;
+		vmime::string data;
+
+		const vmime::string line = "* 1 FETCH (FLAGS (\\Seen \\Answered) UID 1001)\r\n";
+		vmime::string response;
+
+		for (int i = 0 ; i < 100 ; ++i) {
+			response += line;
+		}
+
+		const vmime::string compressed = peer.compress(response);
+
+		sok->localSend(compressed);
+
+		vmime::string received;
+
+		while (received.length() < response.length()) {
+			dsok->receive(data);
+			received += data;
+		}
+
+		VASSERT_EQ("uncompressed received", response.length(), dsok->getUncompressedBytesReceived());
+		VASSERT_EQ("compressed received", compressed.length(), dsok->getCompressedBytesReceived());
+		VASSERT_TRUE("ratio", dsok->getCompressedBytesReceived() * 5 < dsok->getUncompressedBytesReceived());
+
+		dsok->send(response);
+
+		sok->localReceive(data);
+
+		VASSERT_EQ("uncompressed sent", response.length(), dsok->getUncompressedBytesSent());
+		VASSERT_EQ("compressed sent", data.length(), dsok->getCompressedBytesSent());
+	}
+
+VMIME_TEST_SUITE_END
+
+#endif // VMIME_HAVE_ZLIB_SUPPORT
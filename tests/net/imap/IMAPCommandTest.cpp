@@ -52,9 +52,13 @@ VMIME_TEST_SUITE_BEGIN(IMAPCommandTest)
 		VMIME_TEST(testSEARCH)
 		VMIME_TEST(testSTARTTLS)
 		VMIME_TEST(testCAPABILITY)
+		VMIME_TEST(testENABLE)
+		VMIME_TEST(testCOMPRESS)
 		VMIME_TEST(testNOOP)
+		VMIME_TEST(testIDLE)
 		VMIME_TEST(testEXPUNGE)
 		VMIME_TEST(testCLOSE)
+		VMIME_TEST(testUNSELECT)
 		VMIME_TEST(testLOGOUT)
 		VMIME_TEST(testSend)
 	VMIME_TEST_LIST_END
@@ -272,6 +276,17 @@ VMIME_TEST_SUITE_BEGIN(IMAPCommandTest)
 
 		VASSERT_NOT_NULL("Not null", cmdUIDs);
 		VASSERT_EQ("Text", "UID FETCH 42:47 (param-1 param-2)", cmdUIDs->getText());
+
+
+		std::vector <vmime::string> modifiers;
+		modifiers.push_back("CHANGEDSINCE 12345");
+		modifiers.push_back("VANISHED");
+
+		vmime::shared_ptr <IMAPCommand> cmdMod =
+			IMAPCommand::FETCH(vmime::net::messageSet::byUID(42, 47), params, modifiers);
+
+		VASSERT_NOT_NULL("Not null", cmdMod);
+		VASSERT_EQ("Text", "UID FETCH 42:47 (param-1 param-2) (CHANGEDSINCE 12345 VANISHED)", cmdMod->getText());
 	}
 
 	void testSTORE() {
@@ -356,6 +371,13 @@ VMIME_TEST_SUITE_BEGIN(IMAPCommandTest)
 
 		VASSERT_NOT_NULL("Not null", cmdDate);
 		VASSERT_EQ("Text", "APPEND \"mailbox name\" (flag-1 flag-2) \"15-Mar-2014 23:11:47 +0200\" {1234}", cmdDate->getText());
+
+
+		vmime::shared_ptr <IMAPCommand> cmdNonSync =
+			IMAPCommand::APPEND("mailbox-name", std::vector <vmime::string>(), /* date */ NULL, 1234, true);
+
+		VASSERT_NOT_NULL("Not null", cmdNonSync);
+		VASSERT_EQ("Text", "APPEND mailbox-name {1234+}", cmdNonSync->getText());
 	}
 
 	void testCOPY() {
@@ -433,6 +455,26 @@ VMIME_TEST_SUITE_BEGIN(IMAPCommandTest)
 		VASSERT_EQ("Text", "CAPABILITY", cmd->getText());
 	}
 
+	void testENABLE() {
+
+		std::vector <vmime::string> caps;
+		caps.push_back("CONDSTORE");
+		caps.push_back("QRESYNC");
+
+		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::ENABLE(caps);
+
+		VASSERT_NOT_NULL("Not null", cmd);
+		VASSERT_EQ("Text", "ENABLE CONDSTORE QRESYNC", cmd->getText());
+	}
+
+	void testCOMPRESS() {
+
+		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::COMPRESS("DEFLATE");
+
+		VASSERT_NOT_NULL("Not null", cmd);
+		VASSERT_EQ("Text", "COMPRESS DEFLATE", cmd->getText());
+	}
+
 	void testNOOP() {
 
 		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::NOOP();
@@ -441,6 +483,14 @@ VMIME_TEST_SUITE_BEGIN(IMAPCommandTest)
 		VASSERT_EQ("Text", "NOOP", cmd->getText());
 	}
 
+	void testIDLE() {
+
+		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::IDLE();
+
+		VASSERT_NOT_NULL("Not null", cmd);
+		VASSERT_EQ("Text", "IDLE", cmd->getText());
+	}
+
 	void testEXPUNGE() {
 
 		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::EXPUNGE();
@@ -457,6 +507,14 @@ VMIME_TEST_SUITE_BEGIN(IMAPCommandTest)
 		VASSERT_EQ("Text", "CLOSE", cmd->getText());
 	}
 
+	void testUNSELECT() {
+
+		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::UNSELECT();
+
+		VASSERT_NOT_NULL("Not null", cmd);
+		VASSERT_EQ("Text", "UNSELECT", cmd->getText());
+	}
+
 	void testLOGOUT() {
 
 		vmime::shared_ptr <IMAPCommand> cmd = IMAPCommand::LOGOUT();
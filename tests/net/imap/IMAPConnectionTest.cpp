@@ -0,0 +1,261 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+#include "vmime/net/imap/IMAPStore.hpp"
+#include "vmime/net/imap/IMAPConnection.hpp"
+
+
+#if VMIME_HAVE_ZLIB_SUPPORT
+
+
+namespace {
+
+
+/** IMAP test server which supports COMPRESS=DEFLATE (RFC-4978).
+  * Once compression is active, data is inflated before being
+  * processed and responses are deflated before being sent.
+  */
+template <bool COMPRESS_SUPPORTED>
+class compressIMAPTestSocket : public scriptedIMAPTestSocket {
+
+public:
+
+	static int compressCount;
+	static vmime::string lastCommand;
+	static vmime::string dataAfterCompress;
+
+
+	compressIMAPTestSocket()
+		: m_compressed(false) {
+
+	}
+
+	void onDataReceived() {
+
+		vmime::string chunk;
+		localReceive(chunk);
+
+		if (m_compressed) {
+			chunk = m_peer.decompress(chunk);
+		}
+
+		m_buffer += chunk;
+
+		vmime::size_t eol;
+
+		while ((eol = m_buffer.find("\r\n")) != vmime::string::npos) {
+
+			const vmime::string line(m_buffer.begin(), m_buffer.begin() + eol);
+			m_buffer.erase(0, eol + 2);
+
+			processCommandLine(line);
+		}
+	}
+
+protected:
+
+	const vmime::string getCapabilities() const {
+
+		return COMPRESS_SUPPORTED ? "COMPRESS=DEFLATE" : "";
+	}
+
+	void sendResponse(const vmime::string& data) {
+
+		if (m_compressed) {
+			localSend(m_peer.compress(data));
+		} else {
+			localSend(data);
+		}
+	}
+
+	bool processIMAPCommand(const vmime::string& tag, const vmime::string& cmd, const vmime::string& args) {
+
+		lastCommand = cmd;
+
+		if (cmd == "COMPRESS") {
+
+			++compressCount;
+
+			VASSERT_EQ("COMPRESS", " DEFLATE", args);
+			VASSERT_FALSE("Already compressed", m_compressed);
+
+			// Compressed data may follow the response in the same packet
+			localSend(tag + " OK DEFLATE active\r\n"
+				+ (dataAfterCompress.empty() ? "" : m_peer.compress(dataAfterCompress)));
+
+			m_compressed = true;
+
+		} else if (cmd == "NOOP") {
+
+			sendResponse("* 3 EXISTS\r\n");
+			sendResponse(tag + " OK NOOP completed\r\n");
+
+		} else {
+
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	bool m_compressed;
+	testDeflatePeer m_peer;
+	vmime::string m_buffer;
+};
+
+
+template <bool COMPRESS_SUPPORTED>
+int compressIMAPTestSocket <COMPRESS_SUPPORTED>::compressCount = 0;
+
+template <bool COMPRESS_SUPPORTED>
+vmime::string compressIMAPTestSocket <COMPRESS_SUPPORTED>::lastCommand;
+
+template <bool COMPRESS_SUPPORTED>
+vmime::string compressIMAPTestSocket <COMPRESS_SUPPORTED>::dataAfterCompress;
+
+
+template <typename SOCKET>
+vmime::shared_ptr <vmime::net::imap::IMAPStore> getTestStore(const bool compress) {
+
+	vmime::shared_ptr <vmime::net::session> sess = vmime::net::session::create();
+
+	sess->getProperties()["store.imap.options.compress"] = compress;
+
+	return vmime::dynamicCast <vmime::net::imap::IMAPStore>
+		(createTestStore <SOCKET>(sess, "imap://localhost"));
+}
+
+
+} // namespace
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPConnectionTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testCompress)
+		VMIME_TEST(testCompressDataAfterResponse)
+		VMIME_TEST(testCompressNotSupported)
+		VMIME_TEST(testCompressDisabled)
+	VMIME_TEST_LIST_END
+
+
+	void testCompress() {
+
+		typedef compressIMAPTestSocket <true> socketType;
+
+		socketType::compressCount = 0;
+
+		vmime::shared_ptr <vmime::net::imap::IMAPStore> store = getTestStore <socketType>(true);
+
+		store->connect();
+
+		VASSERT_EQ("COMPRESS", 1, socketType::compressCount);
+		VASSERT_TRUE("Compressed", store->getConnection()->isCompressedConnection());
+
+		// Commands and responses go through the compression layer
+		store->noop();
+
+		VASSERT_EQ("NOOP", "NOOP", socketType::lastCommand);
+		VASSERT_TRUE("Connected", store->isConnected());
+
+		store->disconnect();
+
+		VASSERT_EQ("LOGOUT", "LOGOUT", socketType::lastCommand);
+	}
+
+	void testCompressDataAfterResponse() {
+
+		typedef compressIMAPTestSocket <true> socketType;
+
+		socketType::compressCount = 0;
+		socketType::dataAfterCompress = "* OK [ALERT] Compressed data\r\n";
+
+		vmime::shared_ptr <vmime::net::imap::IMAPStore> store = getTestStore <socketType>(true);
+
+		store->connect();
+
+		socketType::dataAfterCompress.clear();
+
+		VASSERT_EQ("COMPRESS", 1, socketType::compressCount);
+		VASSERT_TRUE("Compressed", store->getConnection()->isCompressedConnection());
+
+		// Data received along with the response to COMPRESS is inflated
+		store->noop();
+
+		VASSERT_EQ("NOOP", "NOOP", socketType::lastCommand);
+		VASSERT_TRUE("Connected", store->isConnected());
+
+		store->disconnect();
+	}
+
+	void testCompressNotSupported() {
+
+		typedef compressIMAPTestSocket <false> socketType;
+
+		socketType::compressCount = 0;
+
+		vmime::shared_ptr <vmime::net::imap::IMAPStore> store = getTestStore <socketType>(true);
+
+		store->connect();
+
+		VASSERT_EQ("COMPRESS", 0, socketType::compressCount);
+		VASSERT_FALSE("Compressed", store->getConnection()->isCompressedConnection());
+
+		VASSERT_TRUE("IMAP4rev1", store->getConnection()->hasCapability
+			(vmime::net::imap::IMAPConnection::CAPABILITY_IMAP4REV1));
+		VASSERT_FALSE("COMPRESS=DEFLATE", store->getConnection()->hasCapability
+			(vmime::net::imap::IMAPConnection::CAPABILITY_COMPRESS_DEFLATE));
+
+		store->noop();
+
+		VASSERT_EQ("NOOP", "NOOP", socketType::lastCommand);
+	}
+
+	void testCompressDisabled() {
+
+		typedef compressIMAPTestSocket <true> socketType;
+
+		socketType::compressCount = 0;
+
+		vmime::shared_ptr <vmime::net::imap::IMAPStore> store = getTestStore <socketType>(false);
+
+		store->connect();
+
+		VASSERT_EQ("COMPRESS", 0, socketType::compressCount);
+		VASSERT_FALSE("Compressed", store->getConnection()->isCompressedConnection());
+
+		VASSERT_TRUE("COMPRESS=DEFLATE", store->getConnection()->hasCapability
+			(vmime::net::imap::IMAPConnection::CAPABILITY_COMPRESS_DEFLATE));
+		VASSERT_TRUE("COMPRESS=DEFLATE (name)", store->getConnection()->hasCapability("compress=deflate"));
+	}
+
+VMIME_TEST_SUITE_END
+
+
+#endif // VMIME_HAVE_ZLIB_SUPPORT
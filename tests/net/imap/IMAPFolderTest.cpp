@@ -0,0 +1,1132 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+#include "vmime/net/imap/IMAPStore.hpp"
+#include "vmime/net/imap/IMAPFolder.hpp"
+#include "vmime/net/imap/IMAPMessage.hpp"
+#include "vmime/net/imap/IMAPUtils.hpp"
+
+#include <mutex>
+
+
+namespace {
+
+
+/** IMAP test server for folder resynchronization.
+  *
+  * The folder contains messages with UIDs 1-4, 6 and 8-11. UIDs 5 and 7
+  * have been expunged, UID 3 has changed and UID 11 is new since the
+  * state saved by the client (UIDVALIDITY 42, HIGHESTMODSEQ 100).
+  */
+template <bool QRESYNC>
+class resyncIMAPTestSocket : public scriptedIMAPTestSocket {
+
+public:
+
+	static int searchCount;
+	static bool failFetch;
+	static vmime::string searchResult;
+
+
+	resyncIMAPTestSocket()
+		: m_enabled(false),
+		  m_selected(false) {
+
+	}
+
+protected:
+
+	const vmime::string getCapabilities() const {
+
+		return QRESYNC ? "ENABLE CONDSTORE QRESYNC" : "CONDSTORE";
+	}
+
+	bool processIMAPCommand(const vmime::string& tag, const vmime::string& cmd, const vmime::string& args) {
+
+		if (cmd == "ENABLE") {
+
+			VASSERT("ENABLE must be sent before EXAMINE", !m_selected);
+			VASSERT_EQ("ENABLE", " QRESYNC", args);
+
+			localSend("* ENABLED QRESYNC\r\n");
+			localSend(tag + " OK Enabled\r\n");
+
+			m_enabled = true;
+
+		} else if (cmd == "EXAMINE") {
+
+			VASSERT("EXAMINE must follow CLOSE", !m_selected);
+
+			localSend("* 9 EXISTS\r\n");
+			localSend("* OK [UIDVALIDITY 42] UIDs valid\r\n");
+			localSend("* OK [HIGHESTMODSEQ 120] Highest\r\n");
+
+			if (QRESYNC) {
+
+				VASSERT("QRESYNC must be enabled", m_enabled);
+
+				if (args == " INBOX (QRESYNC (42 100 1:10))") {
+					localSend("* VANISHED (EARLIER) 5,7\r\n");
+					localSend("* 3 FETCH (UID 3 FLAGS (\\Seen) MODSEQ (110))\r\n");
+					localSend("* 9 FETCH (UID 11 FLAGS () MODSEQ (120))\r\n");
+				}
+
+			} else {
+
+				VASSERT_EQ("EXAMINE", " INBOX (CONDSTORE)", args);
+			}
+
+			localSend(tag + " OK [READ-ONLY] EXAMINE completed\r\n");
+
+			m_selected = true;
+
+		} else if (cmd == "UID" && args == " FETCH 1:* (UID FLAGS) (CHANGEDSINCE 100)") {
+
+			VASSERT("FETCH must follow EXAMINE", m_selected);
+
+			if (failFetch) {
+
+				localSend(tag + " NO FETCH failed\r\n");
+				return true;
+			}
+
+			localSend("* 3 FETCH (UID 3 FLAGS (\\Seen) MODSEQ (110))\r\n");
+			localSend("* 9 FETCH (UID 11 FLAGS () MODSEQ (120))\r\n");
+			localSend(tag + " OK FETCH completed\r\n");
+
+		} else if (cmd == "UID" && args.compare(0, 12, " SEARCH UID ") == 0) {
+
+			++searchCount;
+
+			localSend("* SEARCH " + searchResult + "\r\n");
+			localSend(tag + " OK SEARCH completed\r\n");
+
+		} else if (cmd == "CLOSE") {
+
+			VASSERT("CLOSE must follow EXAMINE", m_selected);
+
+			localSend(tag + " OK CLOSE completed\r\n");
+
+			m_selected = false;
+
+		} else {
+
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	bool m_enabled;
+	bool m_selected;
+};
+
+
+template <bool QRESYNC>
+int resyncIMAPTestSocket <QRESYNC>::searchCount = 0;
+
+template <bool QRESYNC>
+bool resyncIMAPTestSocket <QRESYNC>::failFetch = false;
+
+template <bool QRESYNC>
+vmime::string resyncIMAPTestSocket <QRESYNC>::searchResult = "1 2 3 4 6 8 9 10";
+
+
+/** IMAP test server for APPEND. Literals are read from the command
+  * line; a continuation request is sent only for synchronizing literals.
+  * Capabilities (eg. LITERAL+, MULTIAPPEND) are configurable.
+  */
+class appendIMAPTestSocket : public scriptedIMAPTestSocket {
+
+public:
+
+	static vmime::string capabilities;
+
+	static int appendCount;
+	static int continuationCount;
+	static int disconnectCount;
+	static std::vector <vmime::string> appendedData;
+	static std::vector <vmime::string> appendedArgs;
+
+
+	appendIMAPTestSocket()
+		: m_literalSize(0),
+		  m_inLiteral(false),
+		  m_assignedCount(0) {
+
+	}
+
+	static void reset(const vmime::string& capa) {
+
+		capabilities = capa;
+
+		appendCount = 0;
+		continuationCount = 0;
+		disconnectCount = 0;
+		appendedData.clear();
+		appendedArgs.clear();
+	}
+
+	void disconnect() {
+
+		++disconnectCount;
+		scriptedIMAPTestSocket::disconnect();
+	}
+
+	void onDataReceived() {
+
+		vmime::string chunk;
+		localReceive(chunk);
+
+		m_buffer += chunk;
+
+		while (true) {
+
+			if (m_inLiteral) {
+
+				if (m_buffer.length() < m_literalSize) {
+					break;
+				}
+
+				appendedData.push_back(m_buffer.substr(0, m_literalSize));
+				m_buffer.erase(0, m_literalSize);
+
+				m_inLiteral = false;
+				continue;
+			}
+
+			const size_t eol = m_buffer.find("\r\n");
+
+			if (eol == vmime::string::npos) {
+				break;
+			}
+
+			const vmime::string line(m_buffer.begin(), m_buffer.begin() + eol);
+			m_buffer.erase(0, eol + 2);
+
+			// Line ends with a literal: "{size}" or "{size+}"
+			const size_t brace = line.rfind('{');
+
+			if (!line.empty() && line[line.length() - 1] == '}' && brace != vmime::string::npos) {
+
+				const bool nonSync = (line[line.length() - 2] == '+');
+
+				std::istringstream iss(line.substr(brace + 1));
+				iss >> m_literalSize;
+
+				m_inLiteral = true;
+
+				// Record arguments, without the tag
+				if (m_command.empty()) {
+					const size_t tagEnd = line.find(' ') + 1;
+					appendedArgs.push_back(line.substr(tagEnd, brace - tagEnd));
+				} else {
+					appendedArgs.push_back(line.substr(0, brace));
+				}
+
+				m_command += line.substr(0, brace);
+
+				if (!nonSync) {
+
+					++continuationCount;
+					localSend("+ Ready for literal data\r\n");
+				}
+
+			} else {
+
+				m_command += line;
+
+				processCommandLine(m_command);
+				m_command.clear();
+			}
+		}
+	}
+
+protected:
+
+	const vmime::string getCapabilities() const {
+
+		return capabilities;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag, const vmime::string& cmd, const vmime::string& /* args */) {
+
+		if (cmd == "SELECT") {
+
+			localSend("* 3 EXISTS\r\n");
+			localSend("* OK [UIDVALIDITY 38505] UIDs valid\r\n");
+			localSend(tag + " OK [READ-WRITE] SELECT completed\r\n");
+
+		} else if (cmd == "APPEND") {
+
+			// Assign UIDs to the messages received with this command
+			const size_t first = 3955 + m_assignedCount;
+			const size_t last = 3955 + appendedData.size() - 1;
+
+			m_assignedCount = appendedData.size();
+
+			++appendCount;
+
+			std::ostringstream oss;
+			oss << tag << " OK [APPENDUID 38505 " << first;
+
+			if (last != first) {
+				oss << ":" << last;
+			}
+
+			oss << "] APPEND completed\r\n";
+
+			localSend(oss.str());
+
+		} else {
+
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	vmime::string m_buffer;
+	vmime::string m_command;
+
+	size_t m_literalSize;
+	bool m_inLiteral;
+
+	size_t m_assignedCount;
+};
+
+
+vmime::string appendIMAPTestSocket::capabilities;
+int appendIMAPTestSocket::appendCount = 0;
+int appendIMAPTestSocket::continuationCount = 0;
+int appendIMAPTestSocket::disconnectCount = 0;
+std::vector <vmime::string> appendIMAPTestSocket::appendedData;
+std::vector <vmime::string> appendIMAPTestSocket::appendedArgs;
+
+
+vmime::shared_ptr <vmime::message> buildTestMessage(const int n, const size_t bodySize) {
+
+	std::ostringstream subject;
+	subject << "Message " << n;
+
+	vmime::messageBuilder mb;
+	mb.setSubject(vmime::text(subject.str()));
+	mb.setExpeditor(vmime::mailbox("me@vmime.org"));
+	mb.getRecipients().appendAddress(vmime::make_shared <vmime::mailbox>("you@vmime.org"));
+	mb.getTextPart()->setText(vmime::make_shared <vmime::stringContentHandler>
+		(vmime::string(bodySize, 'x')));
+
+	return mb.construct();
+}
+
+
+const vmime::string generateMessage(const vmime::shared_ptr <vmime::message>& msg) {
+
+	vmime::string str;
+	vmime::utility::outputStreamStringAdapter os(str);
+
+	msg->generate(os);
+
+	return str;
+}
+
+
+/** IMAP test server for the connection pool of the store. The folder
+  * contains 750 messages, with UIDs 1001-1750. The number of connections,
+  * and the number of messages fetched on each connection, are recorded.
+  *
+  * If failingConnection is set, that connection replies to UID FETCH with
+  * an invalid response, and the reply of the folder connection (the
+  * second one) is held until the invalid response has been received.
+  */
+class poolIMAPTestSocket : public scriptedIMAPTestSocket {
+
+public:
+
+	static vmime::string capabilities;
+
+	static int connectionCount;
+	static int closeCount;
+	static int unselectCount;
+	static std::map <int, int> fetchedByConnection;
+
+	static int failingConnection;
+	static bool failureSent;
+
+	static std::mutex mutex;
+
+
+	static void reset(const vmime::string& capa, const int failing = 0) {
+
+		capabilities = capa;
+
+		connectionCount = 0;
+		closeCount = 0;
+		unselectCount = 0;
+		fetchedByConnection.clear();
+
+		failingConnection = failing;
+		failureSent = false;
+	}
+
+	size_t receiveRaw(vmime::byte_t* buffer, const size_t count) {
+
+		if (!m_held.empty()) {
+
+			bool release;
+
+			{
+				std::lock_guard <std::mutex> lock(mutex);
+				release = failureSent;
+			}
+
+			if (release) {
+
+				localSend(m_held);
+				m_held.clear();
+			}
+		}
+
+		const size_t n = scriptedIMAPTestSocket::receiveRaw(buffer, count);
+
+		if (n != 0 && m_failed) {
+
+			std::lock_guard <std::mutex> lock(mutex);
+			failureSent = true;
+		}
+
+		return n;
+	}
+
+	void onConnected() {
+
+		{
+			std::lock_guard <std::mutex> lock(mutex);
+			m_id = ++connectionCount;
+		}
+
+		scriptedIMAPTestSocket::onConnected();
+	}
+
+protected:
+
+	const vmime::string getCapabilities() const {
+
+		return capabilities;
+	}
+
+	bool processIMAPCommand(const vmime::string& tag, const vmime::string& cmd, const vmime::string& args) {
+
+		if (cmd == "SELECT" || cmd == "EXAMINE") {
+
+			localSend("* 750 EXISTS\r\n");
+			localSend("* OK [UIDVALIDITY 42] UIDs valid\r\n");
+
+			if (cmd == "SELECT") {
+				localSend(tag + " OK [READ-WRITE] SELECT completed\r\n");
+			} else {
+				localSend(tag + " OK [READ-ONLY] EXAMINE completed\r\n");
+			}
+
+		} else if (cmd == "FETCH") {
+
+			// Message UIDs, by sequence number
+			for (int num = 1 ; num <= 750 ; ++num) {
+				localSend("* " + toString(num) + " FETCH (UID " + toString(1000 + num) + ")\r\n");
+			}
+
+			localSend(tag + " OK FETCH completed\r\n");
+
+		} else if (cmd == "UID") {
+
+			std::istringstream iss(args);
+
+			vmime::string fetch, set;
+			iss >> fetch >> set;
+
+			VASSERT_EQ("UID FETCH", "FETCH", fetch);
+
+			if (m_id == failingConnection) {
+
+				localSend("* 1 FETCH (UID 1001 FLAGS (\\Seen))\r\n");
+				localSend("} invalid\r\n");
+
+				m_failed = true;
+
+				return true;
+			}
+
+			vmime::string reply;
+			int count = 0;
+
+			for (size_t pos = 0 ; pos < set.length() ; ) {
+
+				size_t end = set.find(',', pos);
+
+				if (end == vmime::string::npos) {
+					end = set.length();
+				}
+
+				const vmime::string range(set.begin() + pos, set.begin() + end);
+				const size_t sep = range.find(':');
+
+				const int first = atoi(range.substr(0, sep).c_str());
+				const int last = (sep == vmime::string::npos) ? first : atoi(range.substr(sep + 1).c_str());
+
+				for (int uid = first ; uid <= last ; ++uid, ++count) {
+
+					reply += "* " + toString(uid - 1000) + " FETCH (UID "
+						+ toString(uid) + " FLAGS (\\Seen))\r\n";
+				}
+
+				pos = end + 1;
+			}
+
+			reply += tag + " OK FETCH completed\r\n";
+
+			{
+				std::lock_guard <std::mutex> lock(mutex);
+				fetchedByConnection[m_id] += count;
+			}
+
+			if (failingConnection != 0 && m_id == 2) {
+				m_held = reply;
+			} else {
+				localSend(reply);
+			}
+
+		} else if (cmd == "NOOP") {
+
+			localSend(tag + " OK NOOP completed\r\n");
+
+		} else if (cmd == "CLOSE" || cmd == "UNSELECT") {
+
+			{
+				std::lock_guard <std::mutex> lock(mutex);
+				++(cmd == "CLOSE" ? closeCount : unselectCount);
+			}
+
+			localSend(tag + " OK " + cmd + " completed\r\n");
+
+		} else {
+
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+
+	static const vmime::string toString(const int n) {
+
+		std::ostringstream oss;
+		oss << n;
+
+		return oss.str();
+	}
+
+
+	int m_id;
+	bool m_failed = false;
+	vmime::string m_held;
+};
+
+
+vmime::string poolIMAPTestSocket::capabilities;
+int poolIMAPTestSocket::connectionCount = 0;
+int poolIMAPTestSocket::closeCount = 0;
+int poolIMAPTestSocket::unselectCount = 0;
+std::map <int, int> poolIMAPTestSocket::fetchedByConnection;
+int poolIMAPTestSocket::failingConnection = 0;
+bool poolIMAPTestSocket::failureSent = false;
+std::mutex poolIMAPTestSocket::mutex;
+
+
+/** Records the notifications received by a progress listener.
+  */
+class testProgressListener : public vmime::utility::progressListener {
+
+public:
+
+	testProgressListener()
+		: startCount(0), stopCount(0), progressCount(0), lastCurrent(0), lastTotal(0) {
+
+	}
+
+	void start(const size_t /* predictedTotal */) { ++startCount; }
+	void stop(const size_t /* total */) { ++stopCount; }
+
+	void progress(const size_t current, const size_t currentTotal) {
+
+		++progressCount;
+
+		lastCurrent = current;
+		lastTotal = currentTotal;
+	}
+
+	int startCount;
+	int stopCount;
+	int progressCount;
+	size_t lastCurrent;
+	size_t lastTotal;
+};
+
+
+template <typename SOCKET>
+vmime::shared_ptr <vmime::net::imap::IMAPFolder> getTestFolder
+	(vmime::shared_ptr <vmime::net::store>& store, const int poolSize = 0) {
+
+	vmime::shared_ptr <vmime::net::session> sess = vmime::net::session::create();
+	sess->getProperties()["store.imap.options.connection-pool-size"] = poolSize;
+
+	store = createTestStore <SOCKET>(sess, "imap://localhost");
+	store->connect();
+
+	return vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+		(store->getFolder(vmime::net::folder::path("INBOX")));
+}
+
+
+} // namespace
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPFolderTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testResyncQRESYNC)
+		VMIME_TEST(testResyncCONDSTORE)
+		VMIME_TEST(testResyncCONDSTORE_NoneVanished)
+		VMIME_TEST(testResyncCONDSTORE_HighestUID)
+		VMIME_TEST(testResyncCONDSTORE_Error)
+		VMIME_TEST(testResyncUIDValidityChanged)
+		VMIME_TEST(testAddMessage)
+		VMIME_TEST(testAddMessageLiteralPlus)
+		VMIME_TEST(testAddMessageLiteralMinus)
+		VMIME_TEST(testAddMessageUnbuffered)
+		VMIME_TEST(testAddMessageStream)
+		VMIME_TEST(testAddMessageStreamTooLong)
+		VMIME_TEST(testAddMessageStreamTooShort)
+		VMIME_TEST(testAddMessagesMultiAppend)
+		VMIME_TEST(testAddMessagesNoMultiAppend)
+		VMIME_TEST(testConnectionPool)
+		VMIME_TEST(testConnectionPoolDisabled)
+		VMIME_TEST(testConnectionPoolNoUnselect)
+		VMIME_TEST(testFetchMessagesParallel)
+		VMIME_TEST(testFetchMessagesParallelError)
+	VMIME_TEST_LIST_END
+
+
+	static void checkChangedMessages(const vmime::net::imap::IMAPFolder::resyncResult& result) {
+
+		VASSERT_EQ("changed", 2, result.changedMessages.size());
+
+		VASSERT_EQ("uid 1", "3", static_cast <vmime::string>(result.changedMessages[0]->getUID()));
+		VASSERT_EQ("flags 1", vmime::net::message::FLAG_SEEN, result.changedMessages[0]->getFlags());
+		VASSERT_EQ("modseq 1", 110, vmime::dynamicCast <vmime::net::imap::IMAPMessage>
+			(result.changedMessages[0])->getModSequence());
+
+		VASSERT_EQ("uid 2", "11", static_cast <vmime::string>(result.changedMessages[1]->getUID()));
+		VASSERT_EQ("number 2", 9, result.changedMessages[1]->getNumber());
+	}
+
+	void testResyncQRESYNC() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <resyncIMAPTestSocket <true> >(store);
+
+		const vmime::net::imap::IMAPFolder::resyncResult result =
+			folder->resync(42, 100, vmime::net::messageSet::byUID(1, 10));
+
+		VASSERT_FALSE("uid validity changed", result.uidValidityChanged);
+		VASSERT_EQ("uid validity", 42, result.uidValidity);
+		VASSERT_EQ("highest modseq", 120, result.highestModSeq);
+
+		checkChangedMessages(result);
+
+		VASSERT_EQ("vanished", "5,7",
+			vmime::net::imap::IMAPUtils::messageSetToSequenceSet(result.vanishedUIDs));
+
+		VASSERT_EQ("search", 0, resyncIMAPTestSocket <true>::searchCount);
+	}
+
+	void testResyncCONDSTORE() {
+
+		resyncIMAPTestSocket <false>::searchCount = 0;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <resyncIMAPTestSocket <false> >(store);
+
+		const vmime::net::imap::IMAPFolder::resyncResult result =
+			folder->resync(42, 100, vmime::net::messageSet::byUID(1, 10));
+
+		VASSERT_FALSE("uid validity changed", result.uidValidityChanged);
+		VASSERT_EQ("highest modseq", 120, result.highestModSeq);
+
+		checkChangedMessages(result);
+
+		VASSERT_EQ("vanished", "5,7",
+			vmime::net::imap::IMAPUtils::messageSetToSequenceSet(result.vanishedUIDs));
+
+		VASSERT_EQ("search", 1, resyncIMAPTestSocket <false>::searchCount);
+	}
+
+	void testResyncCONDSTORE_NoneVanished() {
+
+		resyncIMAPTestSocket <false>::searchCount = 0;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <resyncIMAPTestSocket <false> >(store);
+
+		// UIDs 5 and 7 were already known as expunged: the message
+		// count matches, so no search is needed
+		vmime::net::messageSet knownUIDs = vmime::net::messageSet::byUID(1, 4);
+		knownUIDs.addRange(vmime::net::UIDMessageRange(6));
+		knownUIDs.addRange(vmime::net::UIDMessageRange(8, 10));
+
+		const vmime::net::imap::IMAPFolder::resyncResult result =
+			folder->resync(42, 100, knownUIDs);
+
+		checkChangedMessages(result);
+
+		VASSERT_TRUE("vanished", result.vanishedUIDs.isEmpty());
+		VASSERT_EQ("search", 0, resyncIMAPTestSocket <false>::searchCount);
+	}
+
+	void testResyncCONDSTORE_HighestUID() {
+
+		resyncIMAPTestSocket <false>::searchCount = 0;
+		resyncIMAPTestSocket <false>::searchResult = "1 2 3 4 6 8 9 10 4294967295";
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <resyncIMAPTestSocket <false> >(store);
+
+		// The last known range ends at the highest possible UID,
+		// which still exists
+		vmime::net::messageSet knownUIDs = vmime::net::messageSet::byUID(1, 10);
+		knownUIDs.addRange(vmime::net::UIDMessageRange(4294967290u, 4294967295u));
+
+		const vmime::net::imap::IMAPFolder::resyncResult result =
+			folder->resync(42, 100, knownUIDs);
+
+		resyncIMAPTestSocket <false>::searchResult = "1 2 3 4 6 8 9 10";
+
+		VASSERT_EQ("vanished", "5,7,4294967290:4294967294",
+			vmime::net::imap::IMAPUtils::messageSetToSequenceSet(result.vanishedUIDs));
+
+		VASSERT_EQ("search", 1, resyncIMAPTestSocket <false>::searchCount);
+	}
+
+	void testResyncCONDSTORE_Error() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <resyncIMAPTestSocket <false> >(store);
+
+		resyncIMAPTestSocket <false>::failFetch = true;
+
+		VASSERT_THROW(
+			"resync",
+			folder->resync(42, 100, vmime::net::messageSet::byUID(1, 10)),
+			vmime::exceptions::command_error
+		);
+
+		resyncIMAPTestSocket <false>::failFetch = false;
+
+		// The folder has been closed: the connection is usable again
+		const vmime::net::imap::IMAPFolder::resyncResult result =
+			folder->resync(42, 100, vmime::net::messageSet::byUID(1, 10));
+
+		checkChangedMessages(result);
+	}
+
+	void testResyncUIDValidityChanged() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <resyncIMAPTestSocket <true> >(store);
+
+		const vmime::net::imap::IMAPFolder::resyncResult result =
+			folder->resync(41, 100, vmime::net::messageSet::byUID(1, 10));
+
+		VASSERT_TRUE("uid validity changed", result.uidValidityChanged);
+		VASSERT_EQ("uid validity", 42, result.uidValidity);
+		VASSERT_EQ("changed", 0, result.changedMessages.size());
+		VASSERT_TRUE("vanished", result.vanishedUIDs.isEmpty());
+	}
+
+	static vmime::shared_ptr <vmime::net::imap::IMAPFolder> getAppendFolder
+		(vmime::shared_ptr <vmime::net::store>& store, const vmime::string& capabilities) {
+
+		appendIMAPTestSocket::reset(capabilities);
+
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <appendIMAPTestSocket>(store);
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		return folder;
+	}
+
+	void testAddMessage() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "");
+
+		vmime::shared_ptr <vmime::message> msg = buildTestMessage(1, 100);
+
+		const vmime::net::messageSet uids = folder->addMessage(msg, vmime::net::message::FLAG_SEEN);
+
+		VASSERT_EQ("uids", "3955", vmime::net::imap::IMAPUtils::messageSetToSequenceSet(uids));
+
+		VASSERT_EQ("append", 1, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("continuation", 1, appendIMAPTestSocket::continuationCount);
+
+		VASSERT_EQ("data count", 1, appendIMAPTestSocket::appendedData.size());
+		VASSERT_EQ("data", generateMessage(msg), appendIMAPTestSocket::appendedData[0]);
+		VASSERT_EQ("args", "APPEND INBOX (\\Seen) ", appendIMAPTestSocket::appendedArgs[0]);
+	}
+
+	void testAddMessageLiteralPlus() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "LITERAL+");
+
+		vmime::shared_ptr <vmime::message> msg = buildTestMessage(1, 10000);
+
+		folder->addMessage(msg);
+
+		VASSERT_EQ("append", 1, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("continuation", 0, appendIMAPTestSocket::continuationCount);
+		VASSERT_EQ("data", generateMessage(msg), appendIMAPTestSocket::appendedData[0]);
+	}
+
+	void testAddMessageLiteralMinus() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "LITERAL-");
+
+		// Small message: non-synchronizing literal
+		vmime::shared_ptr <vmime::message> msg1 = buildTestMessage(1, 100);
+		folder->addMessage(msg1);
+
+		VASSERT_EQ("continuation 1", 0, appendIMAPTestSocket::continuationCount);
+
+		// Message larger than 4096 bytes: synchronizing literal
+		vmime::shared_ptr <vmime::message> msg2 = buildTestMessage(2, 10000);
+		folder->addMessage(msg2);
+
+		VASSERT_EQ("continuation 2", 1, appendIMAPTestSocket::continuationCount);
+
+		VASSERT_EQ("data count", 2, appendIMAPTestSocket::appendedData.size());
+		VASSERT_EQ("data 1", generateMessage(msg1), appendIMAPTestSocket::appendedData[0]);
+		VASSERT_EQ("data 2", generateMessage(msg2), appendIMAPTestSocket::appendedData[1]);
+	}
+
+	void testAddMessageUnbuffered() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "LITERAL+");
+
+		vmime::shared_ptr <vmime::message> msg = buildTestMessage(1, 10000);
+		const vmime::string expected = generateMessage(msg);
+
+		// Contents can only be read once: the message must be generated
+		// only once, and the whole contents sent
+		const vmime::string text(10000, 'x');
+
+		msg->getBody()->setContents(vmime::make_shared <vmime::streamContentHandler>
+			(vmime::make_shared <testUnbufferedInputStream>(text), text.length()));
+
+		folder->addMessage(msg);
+
+		VASSERT_EQ("append", 1, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("disconnect", 0, appendIMAPTestSocket::disconnectCount);
+		VASSERT_EQ("data", expected, appendIMAPTestSocket::appendedData[0]);
+	}
+
+	void testAddMessageStream() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "LITERAL+");
+
+		const vmime::string data = "Subject: test\r\n\r\nMessage body\r\n";
+		vmime::utility::inputStreamStringAdapter is(data);
+
+		vmime::datetime date(2014, 3, 15, 23, 11, 47, vmime::datetime::GMT2);
+
+		folder->addMessage(is, data.length(), -1, &date);
+
+		VASSERT_EQ("continuation", 0, appendIMAPTestSocket::continuationCount);
+		VASSERT_EQ("data", data, appendIMAPTestSocket::appendedData[0]);
+		VASSERT_EQ("args", "APPEND INBOX \"15-Mar-2014 23:11:47 +0200\" ",
+			appendIMAPTestSocket::appendedArgs[0]);
+	}
+
+	void testAddMessageStreamTooLong() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "LITERAL+");
+
+		const vmime::string data = "Subject: test\r\n\r\nMessage body\r\n";
+		const vmime::string extra = "a002 DELETE INBOX\r\n";
+		vmime::utility::inputStreamStringAdapter is(data + extra);
+
+		// Only the announced number of bytes is sent
+		folder->addMessage(is, data.length());
+
+		VASSERT_EQ("append", 1, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("data", data, appendIMAPTestSocket::appendedData[0]);
+		VASSERT_EQ("disconnect", 0, appendIMAPTestSocket::disconnectCount);
+	}
+
+	void testAddMessageStreamTooShort() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "LITERAL+");
+
+		const vmime::string data = "Subject: test\r\n\r\nMessage body\r\n";
+		vmime::utility::inputStreamStringAdapter is(data);
+
+		// The server would read the next command as message data
+		VASSERT_THROW("size", folder->addMessage(is, data.length() + 10), vmime::exceptions::invalid_argument);
+		VASSERT_EQ("append", 0, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("disconnect", 1, appendIMAPTestSocket::disconnectCount);
+	}
+
+	void testAddMessagesMultiAppend() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getAppendFolder(store, "LITERAL+ MULTIAPPEND");
+
+		std::vector <vmime::shared_ptr <vmime::message> > msgs;
+
+		for (int i = 0 ; i < 3 ; ++i) {
+			msgs.push_back(buildTestMessage(i, 1000 * (i + 1)));
+		}
+
+		const vmime::net::messageSet uids = folder->addMessages(msgs, vmime::net::message::FLAG_SEEN);
+
+		VASSERT_EQ("uids", "3955:3957", vmime::net::imap::IMAPUtils::messageSetToSequenceSet(uids));
+
+		// All messages sent with a single command, without round-trip
+		VASSERT_EQ("append", 1, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("continuation", 0, appendIMAPTestSocket::continuationCount);
+
+		VASSERT_EQ("data count", 3, appendIMAPTestSocket::appendedData.size());
+
+		for (int i = 0 ; i < 3 ; ++i) {
+			VASSERT_EQ("data", generateMessage(msgs[i]), appendIMAPTestSocket::appendedData[i]);
+		}
+
+		VASSERT_EQ("args 1", "APPEND INBOX (\\Seen) ", appendIMAPTestSocket::appendedArgs[0]);
+		VASSERT_EQ("args 2", " (\\Seen) ", appendIMAPTestSocket::appendedArgs[1]);
+		VASSERT_EQ("args 3", " (\\Seen) ", appendIMAPTestSocket::appendedArgs[2]);
+	}
+
+	void testAddMessagesNoMultiAppend() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder = getAppendFolder(store, "");
+
+		std::vector <vmime::shared_ptr <vmime::message> > msgs;
+
+		for (int i = 0 ; i < 3 ; ++i) {
+			msgs.push_back(buildTestMessage(i, 100));
+		}
+
+		const vmime::net::messageSet uids = folder->addMessages(msgs);
+
+		VASSERT_EQ("uids", "3955,3956,3957", vmime::net::imap::IMAPUtils::messageSetToSequenceSet(uids));
+
+		VASSERT_EQ("append", 3, appendIMAPTestSocket::appendCount);
+		VASSERT_EQ("continuation", 3, appendIMAPTestSocket::continuationCount);
+		VASSERT_EQ("data count", 3, appendIMAPTestSocket::appendedData.size());
+	}
+
+	void testConnectionPool() {
+
+		poolIMAPTestSocket::reset("UNSELECT");
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <poolIMAPTestSocket>(store, 1);
+
+		vmime::shared_ptr <vmime::net::imap::IMAPStore> imapStore =
+			vmime::dynamicCast <vmime::net::imap::IMAPStore>(store);
+
+		VASSERT_EQ("pool size", 1, imapStore->getConnectionPoolSize());
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		VASSERT_EQ("idle 1", 1, imapStore->getIdleConnectionCount());
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+		folder->close(false);
+
+		VASSERT_EQ("idle 2", 1, imapStore->getIdleConnectionCount());
+
+		// Store connection + one connection for the folder
+		VASSERT_EQ("connections", 2, poolIMAPTestSocket::connectionCount);
+		VASSERT_EQ("unselect", 1, poolIMAPTestSocket::unselectCount);
+		VASSERT_EQ("close", 1, poolIMAPTestSocket::closeCount);
+
+		store->disconnect();
+
+		VASSERT_EQ("idle 3", 0, imapStore->getIdleConnectionCount());
+	}
+
+	void testConnectionPoolDisabled() {
+
+		poolIMAPTestSocket::reset("UNSELECT");
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <poolIMAPTestSocket>(store);
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		VASSERT_EQ("idle", 0, vmime::dynamicCast <vmime::net::imap::IMAPStore>
+			(store)->getIdleConnectionCount());
+
+		VASSERT_EQ("connections", 3, poolIMAPTestSocket::connectionCount);
+		VASSERT_EQ("unselect", 0, poolIMAPTestSocket::unselectCount);
+	}
+
+	void testConnectionPoolNoUnselect() {
+
+		poolIMAPTestSocket::reset("");
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <poolIMAPTestSocket>(store, 1);
+
+		// Without UNSELECT, a read-write folder cannot be deselected
+		// without expunging it: the connection is not kept
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+		folder->close(false);
+
+		VASSERT_EQ("idle 1", 0, vmime::dynamicCast <vmime::net::imap::IMAPStore>
+			(store)->getIdleConnectionCount());
+
+		folder->open(vmime::net::folder::MODE_READ_ONLY);
+		folder->close(false);
+
+		VASSERT_EQ("idle 2", 1, vmime::dynamicCast <vmime::net::imap::IMAPStore>
+			(store)->getIdleConnectionCount());
+
+		VASSERT_EQ("connections", 3, poolIMAPTestSocket::connectionCount);
+		VASSERT_EQ("close", 1, poolIMAPTestSocket::closeCount);
+	}
+
+	void testFetchMessagesParallel() {
+
+		poolIMAPTestSocket::reset("UNSELECT");
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <poolIMAPTestSocket>(store, 2);
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		std::vector <vmime::shared_ptr <vmime::net::message> > msgs =
+			folder->getMessages(vmime::net::messageSet::byNumber(1, 750));
+
+		testProgressListener progress;
+		folder->fetchMessages(msgs, vmime::net::fetchAttributes::FLAGS, &progress);
+
+		// Messages are split across the folder connection and two
+		// connections from the pool, which are kept afterwards
+		VASSERT_EQ("connections", 4, poolIMAPTestSocket::connectionCount);
+		VASSERT_EQ("fetch connections", 3, poolIMAPTestSocket::fetchedByConnection.size());
+		VASSERT_EQ("fetch 1", 250, poolIMAPTestSocket::fetchedByConnection[2]);
+		VASSERT_EQ("fetch 2", 250, poolIMAPTestSocket::fetchedByConnection[3]);
+		VASSERT_EQ("fetch 3", 250, poolIMAPTestSocket::fetchedByConnection[4]);
+		VASSERT_EQ("close", 2, poolIMAPTestSocket::closeCount);
+
+		VASSERT_EQ("idle", 2, vmime::dynamicCast <vmime::net::imap::IMAPStore>
+			(store)->getIdleConnectionCount());
+
+		VASSERT_EQ("start", 1, progress.startCount);
+		VASSERT_EQ("stop", 1, progress.stopCount);
+		VASSERT_EQ("progress", 750, progress.progressCount);
+		VASSERT_EQ("progress current", 750, progress.lastCurrent);
+		VASSERT_EQ("progress total", 750, progress.lastTotal);
+
+		for (size_t i = 0 ; i < msgs.size() ; ++i) {
+
+			VASSERT_EQ("uid", static_cast <vmime::string>(vmime::net::message::uid(1001 + i)),
+				static_cast <vmime::string>(msgs[i]->getUID()));
+			VASSERT_EQ("flags", vmime::net::message::FLAG_SEEN, msgs[i]->getFlags());
+		}
+	}
+
+	void testFetchMessagesParallelError() {
+
+		// Error on a connection from the pool, while the response on
+		// the folder connection has not been read yet
+		poolIMAPTestSocket::reset("UNSELECT", /* failing */ 3);
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			getTestFolder <poolIMAPTestSocket>(store, 2);
+
+		folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+		std::vector <vmime::shared_ptr <vmime::net::message> > msgs =
+			folder->getMessages(vmime::net::messageSet::byNumber(1, 750));
+
+		VASSERT_THROW("fetch", folder->fetchMessages(msgs, vmime::net::fetchAttributes::FLAGS), vmime::exception);
+
+		// The connections from the pool are closed, and the response on
+		// the folder connection has been read: the folder is still usable
+		VASSERT_EQ("idle", 0, vmime::dynamicCast <vmime::net::imap::IMAPStore>
+			(store)->getIdleConnectionCount());
+
+		VASSERT_TRUE("open", folder->isOpen());
+		VASSERT_EQ("flags 1", vmime::net::message::FLAG_SEEN, msgs[0]->getFlags());
+		VASSERT_EQ("flags 250", vmime::net::message::FLAG_SEEN, msgs[249]->getFlags());
+		VASSERT_NO_THROW("noop", folder->noop());
+
+		folder->close(false);
+	}
+
+VMIME_TEST_SUITE_END
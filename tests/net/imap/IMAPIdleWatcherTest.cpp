@@ -0,0 +1,486 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+#include "vmime/net/imap/IMAPStore.hpp"
+#include "vmime/net/imap/IMAPFolder.hpp"
+#include "vmime/net/imap/IMAPIdleWatcher.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#if VMIME_PLATFORM_IS_POSIX
+#	include <unistd.h>
+#endif
+
+
+namespace {
+
+
+/** IMAP test server which announces a new message while in IDLE state.
+  */
+template <bool IDLE_SUPPORTED>
+class IDLEIMAPTestSocket : public scriptedIMAPTestSocket {
+
+protected:
+
+	const vmime::string getCapabilities() const {
+
+		return IDLE_SUPPORTED ? "IDLE" : "";
+	}
+
+	void processCommandLine(const vmime::string& line) {
+
+		if (line == "DONE") {
+
+			VASSERT("DONE must follow IDLE", !m_idleTag.empty());
+
+			localSend(m_idleTag + " OK IDLE terminated\r\n");
+			m_idleTag.clear();
+
+			return;
+		}
+
+		VASSERT("No command allowed in IDLE state", m_idleTag.empty());
+
+		scriptedIMAPTestSocket::processCommandLine(line);
+	}
+
+	bool processIMAPCommand(const vmime::string& tag, const vmime::string& cmd, const vmime::string& /* args */) {
+
+		if (cmd == "SELECT") {
+
+			localSend("* 3 EXISTS\r\n");
+			localSend("* 0 RECENT\r\n");
+			localSend("* OK [UIDVALIDITY 42] UIDs valid\r\n");
+			localSend(tag + " OK [READ-WRITE] SELECT completed\r\n");
+
+		} else if (cmd == "IDLE") {
+
+			m_idleTag = tag;
+
+			localSend("+ idling\r\n");
+			notify("* 4 EXISTS\r\n");
+
+		} else {
+
+			return false;
+		}
+
+		return true;
+	}
+
+	/** Send an untagged response while in IDLE state.
+	  */
+	virtual void notify(const vmime::string& data) {
+
+		localSend(data);
+	}
+
+private:
+
+	vmime::string m_idleTag;
+};
+
+
+/** IMAP test server which sends an invalid notification while in
+  * IDLE state.
+  */
+class invalidIDLEIMAPTestSocket : public IDLEIMAPTestSocket <true> {
+
+protected:
+
+	void notify(const vmime::string& /* data */) {
+
+		localSend("* 4 INVALID\r\n");
+	}
+};
+
+
+#if VMIME_PLATFORM_IS_POSIX
+
+/** IMAP test server whose IDLE notifications are held in the socket,
+  * as a TLS or compression layer would do: the descriptor does not
+  * become readable, only waitForRead() reports the data.
+  */
+class bufferingIDLEIMAPTestSocket : public IDLEIMAPTestSocket <true> {
+
+public:
+
+	bufferingIDLEIMAPTestSocket() {
+
+		VASSERT_EQ("pipe", 0, ::pipe(m_pipe));
+	}
+
+	~bufferingIDLEIMAPTestSocket() {
+
+		::close(m_pipe[0]);
+		::close(m_pipe[1]);
+	}
+
+	int getDescriptor() const {
+
+		return m_pipe[0];  // never readable
+	}
+
+	bool waitForRead(const int /* msecs */) {
+
+		return !m_pending.empty();
+	}
+
+	size_t receiveRaw(vmime::byte_t* buffer, const size_t count) {
+
+		size_t n = IDLEIMAPTestSocket <true>::receiveRaw(buffer, count);
+
+		if (n == 0 && !m_pending.empty()) {
+
+			localSend(m_pending);
+			m_pending.clear();
+
+			n = IDLEIMAPTestSocket <true>::receiveRaw(buffer, count);
+		}
+
+		return n;
+	}
+
+protected:
+
+	void notify(const vmime::string& data) {
+
+		m_pending += data;
+	}
+
+private:
+
+	int m_pipe[2];
+	vmime::string m_pending;
+};
+
+#endif // VMIME_PLATFORM_IS_POSIX
+
+
+class testMessageCountListener : public vmime::net::events::messageCountListener {
+
+public:
+
+	testMessageCountListener()
+		: added(0), lastNumber(0) {
+
+	}
+
+	void messagesAdded(const vmime::shared_ptr <vmime::net::events::messageCountEvent>& event) {
+
+		++added;
+		lastNumber = event->getNumbers().back();
+	}
+
+	void messagesRemoved(const vmime::shared_ptr <vmime::net::events::messageCountEvent>& /* event */) {
+
+	}
+
+	size_t added;
+	size_t lastNumber;
+};
+
+
+/** Listener which stops watching the folder when a message arrives.
+  */
+class removingMessageCountListener : public testMessageCountListener {
+
+public:
+
+	removingMessageCountListener(
+		vmime::net::imap::IMAPIdleWatcher& watcher,
+		const vmime::shared_ptr <vmime::net::imap::IMAPFolder>& folder
+	)
+		: m_watcher(watcher),
+		  m_folder(folder) {
+
+	}
+
+	void messagesAdded(const vmime::shared_ptr <vmime::net::events::messageCountEvent>& event) {
+
+		testMessageCountListener::messagesAdded(event);
+
+		m_watcher.removeFolder(m_folder);
+	}
+
+private:
+
+	vmime::net::imap::IMAPIdleWatcher& m_watcher;
+	vmime::shared_ptr <vmime::net::imap::IMAPFolder> m_folder;
+};
+
+
+/** Listener which fails when a message arrives.
+  */
+class throwingMessageCountListener : public testMessageCountListener {
+
+public:
+
+	throwingMessageCountListener()
+		: thrown(false) {
+
+	}
+
+	void messagesAdded(const vmime::shared_ptr <vmime::net::events::messageCountEvent>& /* event */) {
+
+		thrown = true;
+
+		throw std::runtime_error("listener failed");
+	}
+
+	std::atomic <bool> thrown;
+};
+
+
+template <typename SOCKET>
+vmime::shared_ptr <vmime::net::folder> openTestFolder(vmime::shared_ptr <vmime::net::store>& store) {
+
+	store = createTestStore <SOCKET>(vmime::net::session::create(), "imap://localhost");
+	store->connect();
+
+	vmime::shared_ptr <vmime::net::folder> folder =
+		store->getFolder(vmime::net::folder::path("INBOX"));
+
+	folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+	return folder;
+}
+
+
+} // namespace
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPIdleWatcherTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testIdle)
+		VMIME_TEST(testIdleNotSupported)
+		VMIME_TEST(testIdleError)
+		VMIME_TEST(testCommandWhileIdle)
+		VMIME_TEST(testPoll)
+#if VMIME_PLATFORM_IS_POSIX
+		VMIME_TEST(testPollBufferedData)
+#endif // VMIME_PLATFORM_IS_POSIX
+		VMIME_TEST(testRemoveFolder)
+		VMIME_TEST(testRemoveFolderFromListener)
+		VMIME_TEST(testBackgroundThreadError)
+	VMIME_TEST_LIST_END
+
+
+	void testIdle() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <true> >(store));
+
+		testMessageCountListener listener;
+		folder->addMessageCountListener(&listener);
+
+		VASSERT_TRUE("idle", folder->idle(1000));
+		VASSERT_FALSE("is idle", folder->isIdle());
+		VASSERT_EQ("added", 1, listener.added);
+		VASSERT_EQ("number", 4, listener.lastNumber);
+		VASSERT_EQ("count", 4, folder->getMessageCount());
+
+		folder->removeMessageCountListener(&listener);
+		folder->close(false);
+	}
+
+	void testIdleNotSupported() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <false> >(store));
+
+		VASSERT_THROW("start", folder->startIdle(), vmime::exceptions::operation_not_supported);
+		VASSERT_FALSE("is idle", folder->isIdle());
+
+		folder->close(false);
+	}
+
+	void testIdleError() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <invalidIDLEIMAPTestSocket>(store));
+
+		VASSERT_THROW("idle", folder->idle(1000), vmime::exception);
+		VASSERT_FALSE("is idle", folder->isIdle());
+	}
+
+	void testCommandWhileIdle() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <true> >(store));
+
+		folder->startIdle();
+
+		VASSERT_THROW("noop", folder->noop(), vmime::exceptions::illegal_state);
+		VASSERT_TRUE("is idle", folder->isIdle());
+
+		folder->stopIdle();
+		folder->close(false);
+	}
+
+	void testPoll() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <true> >(store));
+
+		testMessageCountListener listener;
+		folder->addMessageCountListener(&listener);
+
+		vmime::net::imap::IMAPIdleWatcher watcher;
+		watcher.addFolder(folder);
+
+		VASSERT_TRUE("is idle", folder->isIdle());
+		VASSERT_EQ("folders", 1, watcher.getFolders().size());
+
+		VASSERT_EQ("poll 1", 1, watcher.poll(100));
+		VASSERT_EQ("added", 1, listener.added);
+		VASSERT_EQ("number", 4, listener.lastNumber);
+		VASSERT_EQ("count", 4, folder->getMessageCount());
+
+		VASSERT_EQ("poll 2", 0, watcher.poll(0));
+		VASSERT_EQ("added 2", 1, listener.added);
+
+		watcher.removeFolder(folder);
+
+		folder->removeMessageCountListener(&listener);
+		folder->close(false);
+	}
+
+#if VMIME_PLATFORM_IS_POSIX
+
+	void testPollBufferedData() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <bufferingIDLEIMAPTestSocket>(store));
+
+		testMessageCountListener listener;
+		folder->addMessageCountListener(&listener);
+
+		vmime::net::imap::IMAPIdleWatcher watcher;
+		watcher.addFolder(folder);
+
+		VASSERT_EQ("poll", 1, watcher.poll(100));
+		VASSERT_EQ("added", 1, listener.added);
+		VASSERT_EQ("number", 4, listener.lastNumber);
+
+		watcher.removeFolder(folder);
+
+		folder->removeMessageCountListener(&listener);
+		folder->close(false);
+	}
+
+#endif // VMIME_PLATFORM_IS_POSIX
+
+	void testRemoveFolder() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <true> >(store));
+
+		vmime::net::imap::IMAPIdleWatcher watcher;
+
+		watcher.addFolder(folder);
+		watcher.addFolder(folder);  // ignored
+
+		VASSERT_EQ("folders", 1, watcher.getFolders().size());
+
+		watcher.removeFolder(folder);
+
+		VASSERT_EQ("folders 2", 0, watcher.getFolders().size());
+		VASSERT_FALSE("is idle", folder->isIdle());
+
+		folder->close(false);
+	}
+
+	void testRemoveFolderFromListener() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <true> >(store));
+
+		vmime::net::imap::IMAPIdleWatcher watcher;
+
+		removingMessageCountListener listener(watcher, folder);
+		folder->addMessageCountListener(&listener);
+
+		watcher.addFolder(folder);
+
+		VASSERT_EQ("poll", 1, watcher.poll(100));
+		VASSERT_EQ("added", 1, listener.added);
+		VASSERT_EQ("folders", 0, watcher.getFolders().size());
+		VASSERT_FALSE("is idle", folder->isIdle());
+
+		folder->removeMessageCountListener(&listener);
+		folder->close(false);
+	}
+
+	void testBackgroundThreadError() {
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> folder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>
+				(openTestFolder <IDLEIMAPTestSocket <true> >(store));
+
+		throwingMessageCountListener listener;
+		folder->addMessageCountListener(&listener);
+
+		vmime::net::imap::IMAPIdleWatcher watcher;
+		watcher.addFolder(folder);
+		watcher.start();
+
+		for (int i = 0 ; i < 500 && !listener.thrown ; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		VASSERT_TRUE("thrown", listener.thrown);
+
+		// The error terminates the thread instead of the process
+		VASSERT_THROW("stop", watcher.stop(), std::runtime_error);
+		VASSERT_FALSE("running", watcher.isRunning());
+		VASSERT_NO_THROW("stop 2", watcher.stop());
+
+		folder->removeMessageCountListener(&listener);
+	}
+
+VMIME_TEST_SUITE_END
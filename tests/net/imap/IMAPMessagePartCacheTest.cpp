@@ -0,0 +1,158 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/imap/IMAPMessagePartCache.hpp"
+
+
+using namespace vmime::net::imap;
+
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPMessagePartCacheTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testGetBlock)
+		VMIME_TEST(testBinaryAndBody)
+		VMIME_TEST(testEvictBySize)
+		VMIME_TEST(testBlockTooBig)
+		VMIME_TEST(testReplaceBlock)
+		VMIME_TEST(testRemoveMessage)
+	VMIME_TEST_LIST_END
+
+
+	// Messages are only used as keys
+	static const IMAPMessage* message(const int n) {
+
+		return reinterpret_cast <const IMAPMessage*>(static_cast <vmime::size_t>(n) * 16);
+	}
+
+	void testGetBlock() {
+
+		IMAPMessagePartCache cache(4, 100);
+		const IMAPMessagePartCache::partId part(message(1), "2", false);
+
+		cache.addBlock(part, 0, "abcd");
+		cache.addBlock(part, 1, "ef");
+
+		VASSERT_EQ("1", "abcd", *cache.getBlock(part, 0));
+		VASSERT_EQ("2", "ef", *cache.getBlock(part, 1));
+		VASSERT_TRUE("3", cache.getBlock(part, 2) == NULL);
+		VASSERT_TRUE("4", cache.getBlock(IMAPMessagePartCache::partId(message(1), "1", false), 0) == NULL);
+		VASSERT_TRUE("5", cache.getBlock(IMAPMessagePartCache::partId(message(2), "2", false), 0) == NULL);
+		VASSERT_EQ("6", 6, cache.getSize());
+	}
+
+	void testBinaryAndBody() {
+
+		IMAPMessagePartCache cache(4, 100);
+		const IMAPMessagePartCache::partId body(message(1), "2", false);
+		const IMAPMessagePartCache::partId binary(message(1), "2", true);
+
+		cache.addBlock(body, 0, "SGVs");
+		cache.addBlock(binary, 0, "Hell");
+
+		VASSERT_EQ("1", "SGVs", *cache.getBlock(body, 0));
+		VASSERT_EQ("2", "Hell", *cache.getBlock(binary, 0));
+	}
+
+	void testEvictBySize() {
+
+		IMAPMessagePartCache cache(4, 10);
+		const IMAPMessagePartCache::partId part1(message(1), "1", false);
+		const IMAPMessagePartCache::partId part2(message(2), "1", false);
+
+		cache.addBlock(part1, 0, "abcd");
+		cache.addBlock(part2, 0, "efgh");
+		cache.getBlock(part1, 0);
+
+		// Evicts the least recently used block (part2)
+		cache.addBlock(part1, 1, "ijkl");
+
+		VASSERT_TRUE("1", cache.hasBlock(part1, 0));
+		VASSERT_FALSE("2", cache.hasBlock(part2, 0));
+		VASSERT_TRUE("3", cache.hasBlock(part1, 1));
+		VASSERT_EQ("4", 8, cache.getSize());
+
+		// Short blocks take less room
+		cache.addBlock(part2, 1, "mn");
+
+		VASSERT_TRUE("5", cache.hasBlock(part1, 0));
+		VASSERT_EQ("6", 10, cache.getSize());
+	}
+
+	void testBlockTooBig() {
+
+		IMAPMessagePartCache cache(4, 3);
+		const IMAPMessagePartCache::partId part(message(1), "1", false);
+
+		cache.addBlock(part, 0, "abc");
+		cache.addBlock(part, 1, "defg");
+
+		VASSERT_TRUE("1", cache.hasBlock(part, 0));
+		VASSERT_FALSE("2", cache.hasBlock(part, 1));
+
+		// Disabled cache
+		cache.setLimits(4, 0);
+		cache.addBlock(part, 0, "abc");
+
+		VASSERT_FALSE("3", cache.hasBlock(part, 0));
+		VASSERT_EQ("4", 0, cache.getSize());
+	}
+
+	void testReplaceBlock() {
+
+		IMAPMessagePartCache cache(4, 8);
+		const IMAPMessagePartCache::partId part(message(1), "1", false);
+
+		cache.addBlock(part, 0, "ab");
+		cache.addBlock(part, 0, "abcd");
+
+		VASSERT_EQ("1", "abcd", *cache.getBlock(part, 0));
+		VASSERT_EQ("2", 4, cache.getSize());
+	}
+
+	void testRemoveMessage() {
+
+		IMAPMessagePartCache cache(4, 100);
+
+		cache.addBlock(IMAPMessagePartCache::partId(message(1), "1", false), 0, "abcd");
+		cache.addBlock(IMAPMessagePartCache::partId(message(2), "", true), 0, "efgh");
+		cache.addBlock(IMAPMessagePartCache::partId(message(2), "1.2", false), 3, "ij");
+		cache.addBlock(IMAPMessagePartCache::partId(message(3), "1", false), 0, "kl");
+
+		cache.removeMessage(message(2));
+
+		VASSERT_EQ("1", 6, cache.getSize());
+		VASSERT_TRUE("2", cache.hasBlock(IMAPMessagePartCache::partId(message(1), "1", false), 0));
+		VASSERT_FALSE("3", cache.hasBlock(IMAPMessagePartCache::partId(message(2), "", true), 0));
+		VASSERT_FALSE("4", cache.hasBlock(IMAPMessagePartCache::partId(message(2), "1.2", false), 3));
+		VASSERT_TRUE("5", cache.hasBlock(IMAPMessagePartCache::partId(message(3), "1", false), 0));
+
+		cache.clear();
+
+		VASSERT_EQ("6", 0, cache.getSize());
+	}
+
+VMIME_TEST_SUITE_END
@@ -0,0 +1,598 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "tests/net/imap/IMAPTestUtils.hpp"
+
+#include "vmime/net/imap/IMAPStore.hpp"
+#include "vmime/net/imap/IMAPFolder.hpp"
+#include "vmime/net/imap/IMAPMessage.hpp"
+#include "vmime/net/imap/IMAPMessagePartContentHandler.hpp"
+#include "vmime/net/imap/IMAPMessagePartInputStream.hpp"
+
+
+namespace {
+
+
+/** IMAP test server for the BINARY extension (RFC-3516) and for partial
+  * fetches. The folder contains one multipart message; its second part
+  * is encoded in base64. The server can decode it, unless UNKNOWN_CTE
+  * is set.
+  */
+template <bool BINARY, bool UNKNOWN_CTE = false>
+class binaryIMAPTestSocket : public scriptedIMAPTestSocket {
+
+public:
+
+	static std::vector <vmime::string> fetchCommands;
+
+protected:
+
+	const vmime::string getCapabilities() const {
+
+		return BINARY ? "BINARY" : "";
+	}
+
+	bool processIMAPCommand(const vmime::string& tag, const vmime::string& cmd, const vmime::string& args) {
+
+		if (cmd == "SELECT") {
+
+			localSend("* 1 EXISTS\r\n");
+			localSend(tag + " OK [READ-WRITE] SELECT completed\r\n");
+
+		} else if (cmd == "FETCH" && args.find("BODYSTRUCTURE") != vmime::string::npos) {
+
+			localSend(
+				"* 1 FETCH (BODYSTRUCTURE ("
+				"(\"TEXT\" \"PLAIN\" (\"CHARSET\" \"us-ascii\") NIL NIL \"7BIT\" 5 1 NIL NIL NIL NIL)"
+				"(\"APPLICATION\" \"OCTET-STREAM\" NIL NIL NIL \"BASE64\" 20 NIL NIL NIL NIL)"
+				" \"MIXED\" (\"BOUNDARY\" \"xyz\") NIL NIL NIL))\r\n"
+			);
+			localSend(tag + " OK FETCH completed\r\n");
+
+		} else if (cmd == "FETCH" && args.find("BODY.PEEK[HEADER]") != vmime::string::npos) {
+
+			fetchCommands.push_back(args);
+
+			localSend(
+				"* 1 FETCH (BODY[HEADER] {43}\r\nContent-Type: multipart/mixed; boundary=xyz"
+				" BODY[1.MIME] {42}\r\nContent-Type: text/plain; charset=us-ascii"
+				" BODY[2.MIME] {43}\r\nContent-Disposition: attachment; filename=a)\r\n"
+			);
+			localSend(tag + " OK FETCH completed\r\n");
+
+		} else if (cmd == "FETCH") {
+
+			fetchCommands.push_back(args);
+
+			if (args == " 1 BINARY.SIZE[2]" && BINARY && !UNKNOWN_CTE) {
+
+				localSend("* 1 FETCH (BINARY.SIZE[2] 14)\r\n");
+				localSend(tag + " OK FETCH completed\r\n");
+
+			} else if (args == " 1 BINARY[2]" && BINARY && !UNKNOWN_CTE) {
+
+				localSend("* 1 FETCH (BINARY[2] ~{14}\r\nHello binary!\n)\r\n");
+				localSend(tag + " OK FETCH completed\r\n");
+
+			} else if (args.compare(0, 16, " 1 BODY.PEEK[2]<") == 0) {
+
+				// Partial fetch: " 1 BODY.PEEK[2]<start.length>"
+				const vmime::string contents = "SGVsbG8gYmluYXJ5IQo=";
+
+				vmime::size_t start = 0, length = 0;
+				char dot;
+
+				std::istringstream range(args.substr(16));
+				range >> start >> dot >> length;
+
+				const vmime::string data = (start < contents.length())
+					? contents.substr(start, length) : "";
+
+				std::ostringstream resp;
+				resp << "* 1 FETCH (BODY[2]<" << start << "> {" << data.length() << "}\r\n" << data << ")\r\n";
+
+				localSend(resp.str());
+				localSend(tag + " OK FETCH completed\r\n");
+
+			} else if (args == " 1 BODY[2]") {
+
+				localSend("* 1 FETCH (BODY[2] {20}\r\nSGVsbG8gYmluYXJ5IQo=)\r\n");
+				localSend(tag + " OK FETCH completed\r\n");
+
+			} else if (BINARY && UNKNOWN_CTE) {
+
+				localSend(tag + " NO [UNKNOWN-CTE] Cannot decode part\r\n");
+
+			} else {
+
+				localSend(tag + " BAD Command not expected\r\n");
+			}
+
+		} else {
+
+			return false;
+		}
+
+		return true;
+	}
+};
+
+
+template <bool BINARY, bool UNKNOWN_CTE>
+std::vector <vmime::string> binaryIMAPTestSocket <BINARY, UNKNOWN_CTE>::fetchCommands;
+
+
+template <typename SOCKET>
+vmime::shared_ptr <vmime::net::imap::IMAPMessage> getTestMessage
+	(vmime::shared_ptr <vmime::net::store>& store, vmime::shared_ptr <vmime::net::folder>& folder) {
+
+	SOCKET::fetchCommands.clear();
+
+	store = createTestStore <SOCKET>(vmime::net::session::create(), "imap://localhost");
+	store->connect();
+
+	folder = store->getFolder(vmime::net::folder::path("INBOX"));
+	folder->open(vmime::net::folder::MODE_READ_WRITE);
+
+	vmime::shared_ptr <vmime::net::message> msg = folder->getMessage(1);
+	folder->fetchMessage(msg, vmime::net::fetchAttributes::STRUCTURE);
+
+	return vmime::dynamicCast <vmime::net::imap::IMAPMessage>(msg);
+}
+
+
+// Extract the second (base64-encoded) part of the message
+const vmime::string extractPart(const vmime::shared_ptr <vmime::net::imap::IMAPMessage>& msg) {
+
+	vmime::shared_ptr <vmime::net::messagePart> part =
+		msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1);
+
+	vmime::net::imap::IMAPMessagePartContentHandler cts
+		(msg, part, vmime::encoding(vmime::encodingTypes::BASE64));
+
+	vmime::string data;
+	vmime::utility::outputStreamStringAdapter os(data);
+
+	cts.extract(os);
+
+	return data;
+}
+
+
+} // namespace
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPMessageTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testExtractBinary)
+		VMIME_TEST(testExtractBinaryNotSupported)
+		VMIME_TEST(testExtractBinaryUnknownCTE)
+		VMIME_TEST(testGetDecodedPartSize)
+		VMIME_TEST(testGetDecodedPartSizeNotSupported)
+		VMIME_TEST(testPartInputStream)
+		VMIME_TEST(testPartInputStreamCoalesce)
+		VMIME_TEST(testPartInputStreamLRU)
+		VMIME_TEST(testExtractPartCached)
+		VMIME_TEST(testExtractPartCachedSeen)
+		VMIME_TEST(testExtractBinaryCached)
+		VMIME_TEST(testExtractPartCacheDisabled)
+		VMIME_TEST(testPartCacheMessageDestroyed)
+		VMIME_TEST(testGetAndFetchPartHeaders)
+		VMIME_TEST(testGetAndFetchReentrantCommand)
+	VMIME_TEST_LIST_END
+
+
+	void testExtractBinary() {
+
+		typedef binaryIMAPTestSocket <true> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		VASSERT_EQ("data", "Hello binary!\n", extractPart(msg));
+
+		VASSERT_EQ("fetch count", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch", " 1 BINARY[2]", socketType::fetchCommands[0]);
+	}
+
+	void testExtractBinaryNotSupported() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		VASSERT_EQ("data", "Hello binary!\n", extractPart(msg));
+
+		VASSERT_EQ("fetch count", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch", " 1 BODY[2]", socketType::fetchCommands[0]);
+	}
+
+	void testExtractBinaryUnknownCTE() {
+
+		typedef binaryIMAPTestSocket <true, true> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		// The server cannot decode the part: it is decoded by the client
+		VASSERT_EQ("data", "Hello binary!\n", extractPart(msg));
+
+		VASSERT_EQ("fetch count", 2, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 1", " 1 BINARY[2]", socketType::fetchCommands[0]);
+		VASSERT_EQ("fetch 2", " 1 BODY[2]", socketType::fetchCommands[1]);
+	}
+
+	void testGetDecodedPartSize() {
+
+		typedef binaryIMAPTestSocket <true> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		vmime::shared_ptr <vmime::net::messagePart> part =
+			msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1);
+
+		VASSERT_EQ("encoded size", 20, part->getSize());
+		VASSERT_EQ("decoded size", 14, msg->getDecodedPartSize(part));
+
+		VASSERT_EQ("fetch", " 1 BINARY.SIZE[2]", socketType::fetchCommands[0]);
+	}
+
+	void testGetDecodedPartSizeNotSupported() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		vmime::shared_ptr <vmime::net::messagePart> part =
+			msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1);
+
+		VASSERT_THROW("not supported", msg->getDecodedPartSize(part),
+			vmime::exceptions::operation_not_supported);
+	}
+
+	static vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> getPartInputStream(
+		const vmime::shared_ptr <vmime::net::folder>& folder,
+		const vmime::shared_ptr <vmime::net::imap::IMAPMessage>& msg,
+		const size_t maxCachedBlocks
+	) {
+
+		vmime::shared_ptr <vmime::net::messagePart> part =
+			msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1);
+
+		// 20 bytes, in blocks of 8 bytes
+		vmime::dynamicCast <vmime::net::imap::IMAPFolder>(folder)->setPartCacheLimits(8, maxCachedBlocks * 8);
+
+		return vmime::make_shared <vmime::net::imap::IMAPMessagePartInputStream>(msg, part);
+	}
+
+	static const vmime::string readAt
+		(vmime::utility::seekableInputStream& is, const size_t pos, const size_t count) {
+
+		vmime::byte_t buffer[64];
+
+		is.seek(pos);
+		const size_t n = is.read(buffer, count);
+
+		return vmime::string(reinterpret_cast <const char*>(buffer), n);
+	}
+
+	void testPartInputStream() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> is =
+			getPartInputStream(folder, msg, 16);
+
+		VASSERT_EQ("size", 20, is->getSize());
+
+		// Only the first block is fetched
+		VASSERT_EQ("read 1", "SGVs", readAt(*is, 0, 4));
+		VASSERT_EQ("fetch count 1", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 1", " 1 BODY.PEEK[2]<0.8>", socketType::fetchCommands[0]);
+
+		// Data is read from the cache
+		VASSERT_EQ("read 2", "Vs", readAt(*is, 2, 2));
+		VASSERT_EQ("fetch count 2", 1, socketType::fetchCommands.size());
+
+		// Read until the end of the part
+		VASSERT_EQ("read 3", "bG8gYmluYXJ5IQo=", readAt(*is, 4, 64));
+		VASSERT_TRUE("eof", is->eof());
+		VASSERT_EQ("fetch count 3", 2, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 3", " 1 BODY.PEEK[2]<8.16>", socketType::fetchCommands[1]);
+
+		// Everything is now in the cache
+		is->reset();
+		VASSERT_EQ("read 4", "SGVsbG8gYmluYXJ5IQo=", readAt(*is, 0, 64));
+		VASSERT_EQ("fetch count 4", 2, socketType::fetchCommands.size());
+	}
+
+	void testPartInputStreamCoalesce() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> is =
+			getPartInputStream(folder, msg, 16);
+
+		// Block 1 is cached: blocks 0 and 2 are fetched separately
+		VASSERT_EQ("read 1", "YmluYXJ5", readAt(*is, 8, 8));
+		VASSERT_EQ("read 2", "SGVsbG8gYmluYXJ5IQo=", readAt(*is, 0, 20));
+
+		VASSERT_EQ("fetch count", 3, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 1", " 1 BODY.PEEK[2]<8.8>", socketType::fetchCommands[0]);
+		VASSERT_EQ("fetch 2", " 1 BODY.PEEK[2]<0.8>", socketType::fetchCommands[1]);
+		VASSERT_EQ("fetch 3", " 1 BODY.PEEK[2]<16.8>", socketType::fetchCommands[2]);
+	}
+
+	void testPartInputStreamLRU() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		// Only two blocks are kept in the cache
+		vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> is =
+			getPartInputStream(folder, msg, 2);
+
+		VASSERT_EQ("read 1", "SG", readAt(*is, 0, 2));    // block 0
+		VASSERT_EQ("read 2", "Ym", readAt(*is, 8, 2));    // block 1
+		VASSERT_EQ("read 3", "SG", readAt(*is, 0, 2));    // block 0 (cached)
+		VASSERT_EQ("read 4", "IQ", readAt(*is, 16, 2));   // block 2, evicts block 1
+		VASSERT_EQ("read 5", "SG", readAt(*is, 0, 2));    // block 0 (cached)
+		VASSERT_EQ("read 6", "Ym", readAt(*is, 8, 2));    // block 1, fetched again
+
+		VASSERT_EQ("fetch count", 4, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 4", " 1 BODY.PEEK[2]<8.8>", socketType::fetchCommands[3]);
+	}
+
+	void testExtractPartCached() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		VASSERT_EQ("data 1", "Hello binary!\n", extractPart(msg));
+		VASSERT_EQ("data 2", "Hello binary!\n", extractPart(msg));
+
+		// The part is downloaded only once
+		VASSERT_EQ("fetch count", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch", " 1 BODY[2]", socketType::fetchCommands[0]);
+
+		// Streams over the part share the cache
+		vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> is =
+			vmime::make_shared <vmime::net::imap::IMAPMessagePartInputStream>
+				(msg, msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1));
+
+		VASSERT_EQ("read", "bG8gYmlu", readAt(*is, 4, 8));
+		VASSERT_EQ("stream fetch count", 1, socketType::fetchCommands.size());
+	}
+
+	void testExtractPartCachedSeen() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> is =
+			getPartInputStream(folder, msg, 16);
+
+		VASSERT_EQ("read", "SGVsbG8gYmluYXJ5IQo=", readAt(*is, 0, 64));
+		VASSERT_EQ("fetch count 1", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 1", " 1 BODY.PEEK[2]<0.24>", socketType::fetchCommands[0]);
+
+		// Data was fetched with "PEEK": it is fetched again so that
+		// the "\Seen" flag is set, then read from the cache
+		VASSERT_EQ("data 1", "Hello binary!\n", extractPart(msg));
+		VASSERT_EQ("fetch count 2", 2, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch 2", " 1 BODY[2]", socketType::fetchCommands[1]);
+
+		VASSERT_EQ("data 2", "Hello binary!\n", extractPart(msg));
+		VASSERT_EQ("fetch count 3", 2, socketType::fetchCommands.size());
+	}
+
+	void testExtractBinaryCached() {
+
+		typedef binaryIMAPTestSocket <true> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		VASSERT_EQ("data 1", "Hello binary!\n", extractPart(msg));
+		VASSERT_EQ("data 2", "Hello binary!\n", extractPart(msg));
+
+		// The decoded part is downloaded only once
+		VASSERT_EQ("fetch count", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch", " 1 BINARY[2]", socketType::fetchCommands[0]);
+
+		// Decoded data is not mixed up with the data stored on the server
+		vmime::shared_ptr <vmime::net::imap::IMAPMessagePartInputStream> is =
+			vmime::make_shared <vmime::net::imap::IMAPMessagePartInputStream>
+				(msg, msg->getStructure()->getPartAt(0)->getStructure()->getPartAt(1));
+
+		VASSERT_EQ("read", "SGVsbG8g", readAt(*is, 0, 8));
+		VASSERT_EQ("stream fetch count", 2, socketType::fetchCommands.size());
+		VASSERT_EQ("stream fetch", " 1 BODY.PEEK[2]<0.4096>", socketType::fetchCommands[1]);
+	}
+
+	void testExtractPartCacheDisabled() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		vmime::dynamicCast <vmime::net::imap::IMAPFolder>(folder)->setPartCacheLimits(4096, 0);
+
+		VASSERT_EQ("data 1", "Hello binary!\n", extractPart(msg));
+		VASSERT_EQ("data 2", "Hello binary!\n", extractPart(msg));
+
+		VASSERT_EQ("fetch count", 2, socketType::fetchCommands.size());
+	}
+
+	void testPartCacheMessageDestroyed() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg = getTestMessage <socketType>(store, folder);
+
+		VASSERT_EQ("data 1", "Hello binary!\n", extractPart(msg));
+
+		// Another object for the same message does not use the
+		// data cached for the first one, which is dropped with it
+		msg = vmime::null;
+
+		vmime::shared_ptr <vmime::net::imap::IMAPMessage> msg2 =
+			vmime::dynamicCast <vmime::net::imap::IMAPMessage>(folder->getMessage(1));
+
+		folder->fetchMessage(msg2, vmime::net::fetchAttributes::STRUCTURE);
+
+		VASSERT_EQ("data 2", "Hello binary!\n", extractPart(msg2));
+		VASSERT_EQ("fetch count", 2, socketType::fetchCommands.size());
+	}
+
+	class partHeadersFetchHandler : public vmime::net::imap::IMAPFolder::fetchHandler {
+
+	public:
+
+		void handleMessage(const vmime::shared_ptr <vmime::net::message>& msg) {
+
+			vmime::shared_ptr <const vmime::net::messagePart> root =
+				msg->getStructure()->getPartAt(0);
+
+			// Part headers have been fetched before the message is handed
+			fieldCounts.push_back(root->getHeader() ? root->getHeader()->getFieldCount() : 0);
+
+			for (size_t i = 0 ; i < 2 ; ++i) {
+
+				vmime::shared_ptr <const vmime::header> hdr =
+					root->getStructure()->getPartAt(i)->getHeader();
+
+				fieldCounts.push_back(hdr ? hdr->getFieldCount() : 0);
+			}
+		}
+
+		std::vector <size_t> fieldCounts;
+	};
+
+	void testGetAndFetchPartHeaders() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		getTestMessage <socketType>(store, folder);
+
+		partHeadersFetchHandler handler;
+
+		vmime::dynamicCast <vmime::net::imap::IMAPFolder>(folder)->getAndFetchMessages(
+			vmime::net::messageSet::byNumber(1),
+			vmime::net::fetchAttributes::PART_HEADERS,
+			handler
+		);
+
+		VASSERT_EQ("fetch count", 1, socketType::fetchCommands.size());
+		VASSERT_EQ("fetch", " 1 (BODY.PEEK[HEADER] BODY.PEEK[1.MIME] BODY.PEEK[2.MIME])", socketType::fetchCommands[0]);
+
+		VASSERT_EQ("parts", 3, handler.fieldCounts.size());
+		VASSERT_EQ("root", 1, handler.fieldCounts[0]);
+		VASSERT_EQ("part 1", 1, handler.fieldCounts[1]);
+		VASSERT_EQ("part 2", 1, handler.fieldCounts[2]);
+	}
+
+	class reentrantFetchHandler : public vmime::net::imap::IMAPFolder::fetchHandler {
+
+	public:
+
+		reentrantFetchHandler(const vmime::shared_ptr <vmime::net::imap::IMAPFolder>& folder)
+			: rejected(false),
+			  m_folder(folder) {
+
+		}
+
+		void handleMessage(const vmime::shared_ptr <vmime::net::message>& /* msg */) {
+
+			try {
+				m_folder->noop();
+			} catch (vmime::exceptions::illegal_state&) {
+				rejected = true;
+			}
+		}
+
+		bool rejected;
+
+	private:
+
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> m_folder;
+	};
+
+	void testGetAndFetchReentrantCommand() {
+
+		typedef binaryIMAPTestSocket <false> socketType;
+
+		vmime::shared_ptr <vmime::net::store> store;
+		vmime::shared_ptr <vmime::net::folder> folder;
+		getTestMessage <socketType>(store, folder);
+
+		vmime::shared_ptr <vmime::net::imap::IMAPFolder> imapFolder =
+			vmime::dynamicCast <vmime::net::imap::IMAPFolder>(folder);
+
+		reentrantFetchHandler handler(imapFolder);
+
+		imapFolder->getAndFetchMessages(
+			vmime::net::messageSet::byNumber(1),
+			vmime::net::fetchAttributes::STRUCTURE,
+			handler
+		);
+
+		VASSERT_TRUE("rejected", handler.rejected);
+	}
+
+VMIME_TEST_SUITE_END
@@ -25,6 +25,7 @@
 
 #include "vmime/net/imap/IMAPTag.hpp"
 #include "vmime/net/imap/IMAPParser.hpp"
+#include "vmime/net/imap/IMAPUtils.hpp"
 
 
 VMIME_TEST_SUITE_BEGIN(IMAPParserTest)
@@ -41,6 +42,14 @@ VMIME_TEST_SUITE_BEGIN(IMAPParserTest)
 		VMIME_TEST(testUnquotedMailboxName)
 		VMIME_TEST(testInvalidCharsInAstring)
 		VMIME_TEST(testExtraSpaceInSEARCHResponse)
+		VMIME_TEST(testLargeFETCHResponse)
+		VMIME_TEST(testBenchmarkFETCHResponse)
+		VMIME_TEST(testBenchmarkStreamedFETCHResponse)
+		VMIME_TEST(testStreamedResponse)
+		VMIME_TEST(testResponsePart)
+		VMIME_TEST(testSmallReads)
+		VMIME_TEST(testQRESYNCResponses)
+		VMIME_TEST(testBINARYResponses)
 	VMIME_TEST_LIST_END
 
 
@@ -543,4 +552,431 @@ VMIME_TEST_SUITE_BEGIN(IMAPParserTest)
 		}
 	}
 
+	// Components of a large response span several blocks of the arena
+	void testLargeFETCHResponse() {
+
+		const unsigned int count = 2000;
+
+		auto socket = vmime::make_shared <testSocket>();
+		auto toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::net::imap::IMAPTag tag;
+
+		for (unsigned int i = 1 ; i <= count ; ++i) {
+
+			std::ostringstream oss;
+			oss << "* " << i << " FETCH (UID " << (1000 + i) << " FLAGS (\\Seen)"
+			    << " ENVELOPE (\"Mon, 7 Feb 1994 21:52:25 -0800\" \"Subject " << i << "\""
+			    << " ((\"Fred\" NIL \"fred\" \"example.org\")) NIL NIL"
+			    << " ((NIL NIL \"joe\" \"example.org\")) NIL NIL NIL \"<" << i << "@example.org>\"))\r\n";
+
+			socket->localSend(oss.str());
+		}
+
+		socket->localSend("a001 OK FETCH completed\r\n");
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(toh);
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp(parser->readResponse(tag));
+
+		VASSERT("response", resp);
+		VASSERT_EQ("response tag", "a001", resp->response_done->response_tagged->tag->tagString);
+		VASSERT_EQ("resp data size", count, resp->continue_req_or_response_data.size());
+
+		for (unsigned int i = 1 ; i <= count ; ++i) {
+
+			auto* msgData = resp->continue_req_or_response_data[i - 1]->response_data->message_data.get();
+
+			VASSERT_EQ("message number", i, msgData->number);
+			VASSERT_EQ("items size", 3, msgData->msg_att->items.size());
+			VASSERT_EQ("uid", 1000 + i, msgData->msg_att->items[0]->uniqueid->value);
+
+			auto* env = msgData->msg_att->items[2]->envelope.get();
+
+			std::ostringstream subject;
+			subject << "Subject " << i;
+
+			VASSERT_EQ("subject", subject.str(), env->env_subject->value);
+			VASSERT_EQ("from", "fred", env->env_from->addresses[0]->addr_mailbox->value);
+		}
+	}
+
+	// Benchmark: the test runner reports the duration of this test, which
+	// parses and releases a FETCH response for BENCHMARK_MESSAGE_COUNT messages
+	static const unsigned int BENCHMARK_MESSAGE_COUNT = 5000;
+
+	void testBenchmarkFETCHResponse() {
+
+		auto socket = vmime::make_shared <testSocket>();
+		auto toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::net::imap::IMAPTag tag;
+
+		for (unsigned int i = 1 ; i <= BENCHMARK_MESSAGE_COUNT ; ++i) {
+
+			std::ostringstream oss;
+			oss << "* " << i << " FETCH (UID " << (1000 + i) << " FLAGS (\\Seen \\Answered)"
+			    << " ENVELOPE (\"Mon, 7 Feb 1994 21:52:25 -0800\" \"Subject " << i << "\""
+			    << " ((\"Fred\" NIL \"fred\" \"example.org\")) ((\"Fred\" NIL \"fred\" \"example.org\"))"
+			    << " ((\"Fred\" NIL \"fred\" \"example.org\")) ((NIL NIL \"joe\" \"example.org\"))"
+			    << " NIL NIL NIL \"<" << i << "@example.org>\")"
+			    << " BODYSTRUCTURE ((\"TEXT\" \"PLAIN\" (\"CHARSET\" \"utf-8\") NIL NIL \"QUOTED-PRINTABLE\" 1152 23 NIL NIL NIL NIL)"
+			    << "(\"TEXT\" \"HTML\" (\"CHARSET\" \"utf-8\") NIL NIL \"QUOTED-PRINTABLE\" 4539 92 NIL NIL NIL NIL)"
+			    << "(\"APPLICATION\" \"PDF\" (\"NAME\" \"doc.pdf\") NIL NIL \"BASE64\" 84210 NIL"
+			    << " (\"ATTACHMENT\" (\"FILENAME\" \"doc.pdf\")) NIL NIL)"
+			    << " \"MIXED\" (\"BOUNDARY\" \"----=_Part_" << i << "\") NIL NIL NIL))\r\n";
+
+			socket->localSend(oss.str());
+		}
+
+		socket->localSend("a001 OK FETCH completed\r\n");
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(toh);
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp(parser->readResponse(tag));
+
+		VASSERT("response", resp);
+		VASSERT_EQ("resp data size", BENCHMARK_MESSAGE_COUNT, resp->continue_req_or_response_data.size());
+
+		auto* msgData = resp->continue_req_or_response_data.back()->response_data->message_data.get();
+
+		VASSERT_EQ("items size", 4, msgData->msg_att->items.size());
+		VASSERT_EQ("parts", 3, msgData->msg_att->items[3]->body->body_type_mpart->list.size());
+
+		// Components are served from a few large blocks
+		const vmime::shared_ptr <vmime::net::imap::IMAPParser::arena>& a = resp->getArena();
+
+		VASSERT("arena", a);
+		VASSERT("allocation count", a->getAllocationCount() > BENCHMARK_MESSAGE_COUNT * 100);
+		VASSERT("block count", a->getBlockCount() * 100 < a->getAllocationCount());
+
+		resp.reset();
+	}
+
+	// Counts the bytes of message data consumed from a streamed response
+	class byteCountResponseHandler : public vmime::net::imap::IMAPParser::responseHandler {
+
+	public:
+
+		byteCountResponseHandler()
+			: messageCount(0),
+			  byteCount(0) {
+
+		}
+
+		bool handleResponseData(const vmime::net::imap::IMAPParser::response_data& data) {
+
+			if (!data.message_data) {
+				return false;
+			}
+
+			for (auto& item : data.message_data->msg_att->items) {
+
+				if (item->nstring) {
+					byteCount += item->nstring->value.length();
+				}
+			}
+
+			++messageCount;
+
+			return true;
+		}
+
+		size_t messageCount;
+		size_t byteCount;
+	};
+
+	// Benchmark: the test runner reports the duration of this test, which
+	// reads a streamed FETCH response carrying about 50 MB of message data
+	void testBenchmarkStreamedFETCHResponse() {
+
+		const unsigned int count = 800;
+		const size_t size = 65536;
+
+		auto socket = vmime::make_shared <testSocket>();
+		auto toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::net::imap::IMAPTag tag;
+
+		vmime::string body;
+		body.reserve(size);
+
+		while (body.length() < size) {
+			body += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod.\r\n";
+		}
+
+		body.resize(size);
+
+		for (unsigned int i = 1 ; i <= count ; ++i) {
+
+			std::ostringstream oss;
+			oss << "* " << i << " FETCH (UID " << (1000 + i) << " BODY[] {" << size << "}\r\n";
+
+			socket->localSend(oss.str());
+			socket->localSend(body);
+			socket->localSend(")\r\n");
+		}
+
+		socket->localSend("a001 OK FETCH completed\r\n");
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(toh);
+
+		byteCountResponseHandler handler;
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp
+			(parser->readStreamedResponse(tag, &handler));
+
+		VASSERT("response", resp);
+		VASSERT_EQ("response tag", "a001", resp->response_done->response_tagged->tag->tagString);
+
+		VASSERT_EQ("messages", count, handler.messageCount);
+		VASSERT_EQ("bytes", count * size, handler.byteCount);
+	}
+
+	class testResponseHandler : public vmime::net::imap::IMAPParser::responseHandler {
+
+	public:
+
+		bool handleResponseData(const vmime::net::imap::IMAPParser::response_data& data) {
+
+			if (!data.message_data ||
+			    data.message_data->type != vmime::net::imap::IMAPParser::message_data::FETCH) {
+
+				return false;
+			}
+
+			numbers.push_back(data.message_data->number);
+
+			return true;
+		}
+
+		std::vector <unsigned int> numbers;
+	};
+
+	void testStreamedResponse() {
+
+		auto socket = vmime::make_shared <testSocket>();
+		auto toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::net::imap::IMAPTag tag;
+
+		socket->localSend(
+			"* 1 FETCH (UID 101)\r\n"
+			"* 12 EXISTS\r\n"
+			"* 2 FETCH (UID 102 FLAGS (\\Seen))\r\n"
+			"* 3 FETCH (UID 103 BODY[HEADER] {11}\r\nSubject: x\n)\r\n"
+			"a001 OK FETCH completed\r\n"
+		);
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(toh);
+
+		testResponseHandler handler;
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp
+			(parser->readStreamedResponse(tag, &handler));
+
+		VASSERT("response", resp);
+		VASSERT_EQ("response tag", "a001", resp->response_done->response_tagged->tag->tagString);
+
+		VASSERT_EQ("handled", 3, handler.numbers.size());
+		VASSERT_EQ("handled 1", 1, handler.numbers[0]);
+		VASSERT_EQ("handled 2", 2, handler.numbers[1]);
+		VASSERT_EQ("handled 3", 3, handler.numbers[2]);
+
+		// Data not consumed by the handler is kept in the response
+		VASSERT_EQ("kept", 1, resp->continue_req_or_response_data.size());
+		VASSERT("kept data", resp->continue_req_or_response_data[0]->response_data->mailbox_data);
+		VASSERT_EQ("kept EXISTS", 12, resp->continue_req_or_response_data[0]->response_data->mailbox_data->number->value);
+	}
+
+	void testResponsePart() {
+
+		auto socket = vmime::make_shared <testSocket>();
+		auto toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::net::imap::IMAPTag tag;
+
+		socket->localSend(
+			"* 1 FETCH (UID 101)\r\n"
+			"* 12 EXISTS\r\n"
+			"* 2 FETCH (UID 102 BODY[HEADER] {11}\r\nSubject: x\n)\r\n"
+			"a001 OK FETCH completed\r\n"
+		);
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(toh);
+
+		testResponseHandler handler;
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp;
+
+		// One part is read at a time
+		VASSERT_FALSE("part 1", parser->readResponsePart(tag, &handler, resp));
+		VASSERT_EQ("handled 1", 1, handler.numbers.size());
+
+		VASSERT_FALSE("part 2", parser->readResponsePart(tag, &handler, resp));
+		VASSERT_EQ("handled 2", 1, handler.numbers.size());
+
+		VASSERT_FALSE("part 3", parser->readResponsePart(tag, &handler, resp));
+		VASSERT_EQ("handled 3", 2, handler.numbers.size());
+		VASSERT_EQ("number 3", 2, handler.numbers[1]);
+
+		VASSERT_TRUE("part 4", parser->readResponsePart(tag, &handler, resp));
+		VASSERT_EQ("response tag", "a001", resp->response_done->response_tagged->tag->tagString);
+
+		// Data not consumed by the handler is kept in the response
+		VASSERT_EQ("kept", 1, resp->continue_req_or_response_data.size());
+		VASSERT_EQ("kept EXISTS", 12, resp->continue_req_or_response_data[0]->response_data->mailbox_data->number->value);
+	}
+
+	// Socket which delivers data a few bytes at a time
+	class smallReadsTestSocket : public testSocket {
+
+	public:
+
+		size_t receiveRaw(vmime::byte_t* buffer, const size_t count) {
+
+			return testSocket::receiveRaw(buffer, std::min(count, static_cast <size_t>(3)));
+		}
+	};
+
+	void testSmallReads() {
+
+		auto socket = vmime::make_shared <smallReadsTestSocket>();
+		auto toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::net::imap::IMAPTag tag;
+
+		const std::string longSubject(100000, 'x');
+
+		socket->localSend(
+			"* 1 FETCH (UID 101 BODY[HEADER] {11}\r\nSubject: x\n)\r\n"
+			"* 2 FETCH (UID 102 ENVELOPE (NIL \"" + longSubject + "\" NIL NIL NIL NIL NIL NIL NIL NIL))\r\n"
+			"a001 OK FETCH completed\r\n"
+			"a002 OK NOOP completed\r\n"
+		);
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(toh);
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp(parser->readResponse(tag));
+
+		VASSERT_EQ("response tag", "a001", resp->response_done->response_tagged->tag->tagString);
+		VASSERT_EQ("resp data size", 2, resp->continue_req_or_response_data.size());
+
+		auto* msgData1 = resp->continue_req_or_response_data[0]->response_data->message_data.get();
+
+		VASSERT_EQ("items 1", 2, msgData1->msg_att->items.size());
+		VASSERT_EQ("literal", "Subject: x\n", msgData1->msg_att->items[1]->nstring->value);
+
+		auto* msgData2 = resp->continue_req_or_response_data[1]->response_data->message_data.get();
+
+		VASSERT_EQ("long line", longSubject, msgData2->msg_att->items[1]->envelope->env_subject->value);
+
+		// Data following the response is kept for the next one
+		++tag;
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> resp2(parser->readResponse(tag));
+
+		VASSERT_EQ("response tag 2", "a002", resp2->response_done->response_tagged->tag->tagString);
+	}
+
+	void testQRESYNCResponses() {
+
+		const char* resp =
+			"* ENABLED QRESYNC\r\n"
+			"* VANISHED (EARLIER) 41,43:116\r\n"
+			"* VANISHED 405\r\n"
+			"* 49 FETCH (UID 117 FLAGS (\\Seen) MODSEQ (90060115194045001))\r\n"
+			"a001 OK done\r\n";
+
+		auto socket = vmime::make_shared <testSocket>();
+		socket->localSend(resp);
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+		auto tag = vmime::make_shared <vmime::net::imap::IMAPTag>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(vmime::make_shared <testTimeoutHandler>());
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> response(parser->readResponse(*tag));
+		auto& data = response->continue_req_or_response_data;
+
+		VASSERT_EQ("count", 4, data.size());
+
+		VASSERT_NOT_NULL("enabled", data[0]->response_data->enable_data.get());
+		VASSERT_EQ("enabled count", 1, data[0]->response_data->enable_data->capabilities.size());
+		VASSERT_EQ("enabled capa", "QRESYNC", data[0]->response_data->enable_data->capabilities[0]->atom->value);
+
+		const auto* vanished1 = data[1]->response_data->expunged_resp.get();
+
+		VASSERT_NOT_NULL("vanished 1", vanished1);
+		VASSERT_TRUE("vanished 1 earlier", vanished1->earlier);
+		VASSERT_EQ("vanished 1 uids", "41,43:116",
+			vmime::net::imap::IMAPUtils::messageSetToSequenceSet(
+				vmime::net::imap::IMAPUtils::buildMessageSet(*vanished1->uid_set)));
+
+		const auto* vanished2 = data[2]->response_data->expunged_resp.get();
+
+		VASSERT_NOT_NULL("vanished 2", vanished2);
+		VASSERT_FALSE("vanished 2 earlier", vanished2->earlier);
+
+		VASSERT_NOT_NULL("fetch", data[3]->response_data->message_data.get());
+	}
+
+	void testBINARYResponses() {
+
+		// Decoded data is sent as a literal8, which may contain NUL bytes
+		const vmime::string resp(
+			"* 3 FETCH (UID 42 BINARY[2] ~{5}\r\nab\0cd BINARY.SIZE[2] 5)\r\n"
+			"* 4 FETCH (BINARY[1]<0> \"xyz\")\r\n"
+			"a001 OK done\r\n", 105
+		);
+
+		auto socket = vmime::make_shared <testSocket>();
+		socket->localSend(resp);
+
+		auto parser = vmime::make_shared <vmime::net::imap::IMAPParser>();
+		auto tag = vmime::make_shared <vmime::net::imap::IMAPTag>();
+
+		parser->setSocket(socket);
+		parser->setTimeoutHandler(vmime::make_shared <testTimeoutHandler>());
+
+		std::unique_ptr <vmime::net::imap::IMAPParser::response> response(parser->readResponse(*tag));
+		auto& data = response->continue_req_or_response_data;
+
+		VASSERT_EQ("count", 2, data.size());
+
+		const auto& items1 = data[0]->response_data->message_data->msg_att->items;
+
+		VASSERT_EQ("items 1", 3, items1.size());
+		VASSERT_EQ("binary type", vmime::net::imap::IMAPParser::msg_att_item::BINARY_SECTION, items1[1]->type);
+		VASSERT_EQ("binary section", 1, items1[1]->section->nz_numbers.size());
+		VASSERT_EQ("binary section number", 2, items1[1]->section->nz_numbers[0]);
+		VASSERT_EQ("binary data", vmime::string("ab\0cd", 5), items1[1]->nstring->value);
+		VASSERT_EQ("binary size type", vmime::net::imap::IMAPParser::msg_att_item::BINARY_SIZE, items1[2]->type);
+		VASSERT_EQ("binary size", 5, items1[2]->number->value);
+
+		const auto& items2 = data[1]->response_data->message_data->msg_att->items;
+
+		VASSERT_EQ("items 2", 1, items2.size());
+		VASSERT_EQ("binary origin", 0, items2[0]->number->value);
+		VASSERT_EQ("binary quoted", "xyz", items2[0]->nstring->value);
+	}
+
 VMIME_TEST_SUITE_END
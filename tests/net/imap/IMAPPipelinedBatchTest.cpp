@@ -0,0 +1,194 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/net/imap/IMAPCommand.hpp"
+#include "vmime/net/imap/IMAPPipelinedBatch.hpp"
+#include "vmime/net/imap/IMAPStore.hpp"
+#include "vmime/net/imap/IMAPConnection.hpp"
+
+
+using namespace vmime::net::imap;
+
+
+VMIME_TEST_SUITE_BEGIN(IMAPPipelinedBatchTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testSendBeforeRead)
+		VMIME_TEST(testReadOutOfOrder)
+		VMIME_TEST(testReadTwice)
+		VMIME_TEST(testDiscardUnread)
+	VMIME_TEST_LIST_END
+
+
+	static vmime::shared_ptr <IMAPConnection> createConnection(const vmime::shared_ptr <testSocket>& sok) {
+
+		vmime::shared_ptr <vmime::net::session> sess = vmime::net::session::create();
+
+		vmime::shared_ptr <vmime::security::authenticator> auth =
+			vmime::make_shared <vmime::security::defaultAuthenticator>();
+
+		vmime::shared_ptr <IMAPStore> store =
+			vmime::make_shared <IMAPStore>(sess, auth, /* secured */ false);
+
+		vmime::shared_ptr <IMAPConnection> conn =
+			vmime::make_shared <IMAPConnection>(store, auth);
+
+		conn->setSocket(sok);
+
+		return conn;
+	}
+
+	static const vmime::string getResponseText(const IMAPParser::response* resp) {
+
+		return resp->response_done->response_tagged->resp_cond_state->resp_text->text;
+	}
+
+
+	void testSendBeforeRead() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <IMAPConnection> conn = createConnection(sok);
+
+		IMAPPipelinedBatch batch(conn);
+
+		VASSERT_EQ("1", 0, batch.send(IMAPCommand::NOOP()));
+		VASSERT_EQ("2", 1, batch.send(IMAPCommand::createCommand("STATUS A (UIDNEXT)")));
+		VASSERT_EQ("3", 2, batch.send(IMAPCommand::createCommand("STATUS B (UIDNEXT)")));
+
+		// All commands are sent before any response is read
+		vmime::string sent;
+		sok->localReceive(sent);
+
+		VASSERT_EQ(
+			"Sent",
+			"a001 NOOP\r\n"
+			"a002 STATUS A (UIDNEXT)\r\n"
+			"a003 STATUS B (UIDNEXT)\r\n",
+			sent
+		);
+
+		VASSERT_EQ("Count", 3, batch.getCommandCount());
+		VASSERT_EQ("Pending", 3, batch.getPendingCount());
+
+		sok->localSend(
+			"a001 OK NOOP done\r\n"
+			"* STATUS A (UIDNEXT 42)\r\n"
+			"a002 OK STATUS A done\r\n"
+			"* STATUS B (UIDNEXT 43)\r\n"
+			"a003 OK STATUS B done\r\n"
+		);
+
+		for (size_t i = 0 ; i < 3 ; ++i) {
+
+			vmime::scoped_ptr <IMAPParser::response> resp(batch.readResponse(i));
+
+			VASSERT_EQ("Tag", "a00" + std::string(1, '1' + i), resp->response_done->response_tagged->tag->tagString);
+		}
+
+		VASSERT_EQ("Pending after read", 0, batch.getPendingCount());
+	}
+
+	void testReadOutOfOrder() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <IMAPConnection> conn = createConnection(sok);
+
+		IMAPPipelinedBatch batch(conn);
+
+		batch.send(IMAPCommand::createCommand("STATUS A (UIDNEXT)"));
+		batch.send(IMAPCommand::createCommand("STATUS B (UIDNEXT)"));
+
+		sok->localSend(
+			"* STATUS A (UIDNEXT 42)\r\n"
+			"a001 OK STATUS A done\r\n"
+			"* STATUS B (UIDNEXT 43)\r\n"
+			"a002 OK STATUS B done\r\n"
+		);
+
+		// Untagged data is routed along with its completion
+		vmime::scoped_ptr <IMAPParser::response> resp2(batch.readResponse(1));
+
+		VASSERT_EQ("2.text", "STATUS B done", getResponseText(resp2.get()));
+		VASSERT_EQ("2.data", 1, resp2->continue_req_or_response_data.size());
+		VASSERT_EQ(
+			"2.mailbox", "B",
+			resp2->continue_req_or_response_data[0]->response_data->mailbox_data->mailbox->name
+		);
+
+		vmime::scoped_ptr <IMAPParser::response> resp1(batch.readResponse(0));
+
+		VASSERT_EQ("1.text", "STATUS A done", getResponseText(resp1.get()));
+		VASSERT_EQ("1.data", 1, resp1->continue_req_or_response_data.size());
+		VASSERT_EQ(
+			"1.mailbox", "A",
+			resp1->continue_req_or_response_data[0]->response_data->mailbox_data->mailbox->name
+		);
+	}
+
+	void testReadTwice() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <IMAPConnection> conn = createConnection(sok);
+
+		IMAPPipelinedBatch batch(conn);
+
+		batch.send(IMAPCommand::NOOP());
+
+		sok->localSend("a001 OK NOOP done\r\n");
+
+		delete batch.readResponse(0);
+
+		VASSERT_THROW("Read twice", batch.readResponse(0), vmime::exceptions::illegal_state);
+		VASSERT_THROW("Invalid index", batch.readResponse(1), vmime::exceptions::invalid_argument);
+	}
+
+	void testDiscardUnread() {
+
+		vmime::shared_ptr <testSocket> sok = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <IMAPConnection> conn = createConnection(sok);
+
+		sok->localSend(
+			"a001 OK NOOP done\r\n"
+			"a002 OK NOOP done\r\n"
+			"a003 OK LOGOUT done\r\n"
+		);
+
+		{
+			IMAPPipelinedBatch batch(conn);
+
+			batch.send(IMAPCommand::NOOP());
+			batch.send(IMAPCommand::NOOP());
+		}
+
+		// Responses to the queued commands have been consumed
+		IMAPCommand::LOGOUT()->send(conn);
+
+		vmime::scoped_ptr <IMAPParser::response> resp(conn->readResponse());
+
+		VASSERT_EQ("Tag", "a003", resp->response_done->response_tagged->tag->tagString);
+		VASSERT_EQ("Text", "LOGOUT done", getResponseText(resp.get()));
+	}
+
+VMIME_TEST_SUITE_END
@@ -0,0 +1,116 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include <sstream>
+
+
+/** Base class for scripted IMAP test servers. The server greets the
+  * client with a PREAUTH response announcing getCapabilities(), answers
+  * LIST and LOGOUT, and passes any other command to processIMAPCommand().
+  */
+class scriptedIMAPTestSocket : public lineBasedTestSocket {
+
+public:
+
+	void onConnected() {
+
+		const vmime::string capa = getCapabilities();
+
+		sendResponse("* PREAUTH [CAPABILITY IMAP4rev1"
+			+ (capa.empty() ? vmime::string() : " " + capa) + "] test.vmime.org ready\r\n");
+	}
+
+	void processCommand() {
+
+		while (haveMoreLines()) {
+			processCommandLine(getNextLine());
+		}
+	}
+
+protected:
+
+	/** Return the capabilities announced in the greeting, in addition
+	  * to IMAP4rev1.
+	  *
+	  * @return space-separated list of capabilities
+	  */
+	virtual const vmime::string getCapabilities() const {
+
+		return "";
+	}
+
+	/** Process a command line received from the client.
+	  *
+	  * @param line command line, without CRLF
+	  */
+	virtual void processCommandLine(const vmime::string& line) {
+
+		std::istringstream iss(line);
+
+		vmime::string tag, cmd;
+		iss >> tag >> cmd;
+
+		vmime::string args;
+		std::getline(iss, args);
+
+		if (processIMAPCommand(tag, cmd, args)) {
+
+			// Handled by the server
+
+		} else if (cmd == "LIST") {
+
+			sendResponse("* LIST (\\Noselect) \"/\" \"\"\r\n");
+			sendResponse(tag + " OK LIST completed\r\n");
+
+		} else if (cmd == "LOGOUT") {
+
+			sendResponse("* BYE\r\n");
+			sendResponse(tag + " OK LOGOUT completed\r\n");
+
+		} else {
+
+			sendResponse(tag + " BAD Command not expected\r\n");
+		}
+	}
+
+	/** Process a command specific to this server.
+	  *
+	  * @param tag command tag
+	  * @param cmd command name
+	  * @param args command arguments, with the leading space
+	  * @return true if the command has been handled, false otherwise
+	  */
+	virtual bool processIMAPCommand
+		(const vmime::string& tag, const vmime::string& cmd, const vmime::string& args) = 0;
+
+	/** Send data to the client.
+	  *
+	  * @param data response data
+	  */
+	virtual void sendResponse(const vmime::string& data) {
+
+		localSend(data);
+	}
+};
+
@@ -43,6 +43,7 @@ VMIME_TEST_SUITE_BEGIN(IMAPUtilsTest)
 		VMIME_TEST(testPathToString)
 		VMIME_TEST(testStringToPath)
 		VMIME_TEST(testBuildFetchCommand)
+		VMIME_TEST(testBuildFetchPartHeadersCommand)
 	VMIME_TEST_LIST_END
 
 
@@ -219,6 +220,14 @@ VMIME_TEST_SUITE_BEGIN(IMAPUtilsTest)
 			VASSERT_EQ("structure", "FETCH 42 BODYSTRUCTURE", cmd->getText());
 		}
 
+		// PART_HEADERS
+		{
+			vmime::net::fetchAttributes attribs = vmime::net::fetchAttributes::PART_HEADERS;
+
+			vmime::shared_ptr <IMAPCommand> cmd = IMAPUtils::buildFetchCommand(cnt, msgs, attribs);
+			VASSERT_EQ("part-headers", "FETCH 42 BODYSTRUCTURE", cmd->getText());
+		}
+
 		// UID
 		{
 			vmime::net::fetchAttributes attribs = vmime::net::fetchAttributes::UID;
@@ -280,4 +289,29 @@ VMIME_TEST_SUITE_BEGIN(IMAPUtilsTest)
 		}
 	}
 
+	void testBuildFetchPartHeadersCommand() {
+
+		std::vector <vmime::string> sections;
+		sections.push_back("");
+		sections.push_back("1");
+		sections.push_back("2");
+		sections.push_back("2.1");
+
+		vmime::shared_ptr <IMAPCommand> cmd = IMAPUtils::buildFetchPartHeadersCommand(
+			vmime::net::messageSet::byNumber(42, 43), sections
+		);
+
+		VASSERT_EQ(
+			"1",
+			"FETCH 42:43 (BODY.PEEK[HEADER] BODY.PEEK[1.MIME] BODY.PEEK[2.MIME] BODY.PEEK[2.1.MIME])",
+			cmd->getText()
+		);
+
+		cmd = IMAPUtils::buildFetchPartHeadersCommand(
+			vmime::net::messageSet::byUID(1234), std::vector <vmime::string>(1, "3")
+		);
+
+		VASSERT_EQ("2", "UID FETCH 1234 BODY.PEEK[3.MIME]", cmd->getText());
+	}
+
 VMIME_TEST_SUITE_END
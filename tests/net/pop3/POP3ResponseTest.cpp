@@ -31,6 +31,46 @@
 using namespace vmime::net::pop3;
 
 
+namespace {
+
+
+/** Test socket which returns received data in chunks of a fixed size,
+  * as a slow network would.
+  */
+class chunkedTestSocket : public testSocket {
+
+public:
+
+	chunkedTestSocket(const size_t chunkSize)
+		: m_chunkSize(chunkSize),
+		  m_pos(0) {
+
+	}
+
+	void receive(vmime::string& buffer) {
+
+		if (m_pos >= m_data.length()) {
+
+			testSocket::receive(m_data);
+			m_pos = 0;
+		}
+
+		buffer.assign(m_data, m_pos, m_chunkSize);
+		m_pos += buffer.length();
+	}
+
+private:
+
+	const size_t m_chunkSize;
+
+	vmime::string m_data;
+	size_t m_pos;
+};
+
+
+} // namespace
+
+
 VMIME_TEST_SUITE_BEGIN(POP3ResponseTest)
 
 	VMIME_TEST_LIST_BEGIN
@@ -41,7 +81,11 @@ VMIME_TEST_SUITE_BEGIN(POP3ResponseTest)
 		VMIME_TEST(testSingleLineResponseLF)
 		VMIME_TEST(testMultiLineResponse)
 		VMIME_TEST(testMultiLineResponseLF)
+		VMIME_TEST(testMultiLineResponseChunked)
+		VMIME_TEST(testMultiLineResponse_Benchmark)
 		VMIME_TEST(testLargeResponse)
+		VMIME_TEST(testLargeResponseDotStuffing)
+		VMIME_TEST(testPipelinedResponses)
 	VMIME_TEST_LIST_END
 
 
@@ -207,6 +251,65 @@ VMIME_TEST_SUITE_BEGIN(POP3ResponseTest)
 		VASSERT_EQ("Line 2", "Line 2", resp->getLineAt(1));
 	}
 
+	void testMultiLineResponseChunked() {
+
+		// The terminator is split across chunks
+		for (size_t chunkSize = 1 ; chunkSize <= 6 ; ++chunkSize) {
+
+			vmime::shared_ptr <chunkedTestSocket> socket = vmime::make_shared <chunkedTestSocket>(chunkSize);
+			vmime::shared_ptr <vmime::net::timeoutHandler> toh = vmime::make_shared <testTimeoutHandler>();
+
+			vmime::shared_ptr <POP3ConnectionTest> conn =
+				vmime::make_shared <POP3ConnectionTest>(
+					vmime::dynamicCast <vmime::net::socket>(socket), toh
+				);
+
+			socket->localSend("+OK\r\n1 100\r\n..2\r\n3 300\r\n.\r\n+OK Next\r\n");
+
+			vmime::shared_ptr <POP3Response> resp =
+				POP3Response::readMultilineResponse(conn);
+
+			VASSERT_EQ("Lines", 3, resp->getLineCount());
+			VASSERT_EQ("Line 1", "1 100", resp->getLineAt(0));
+			VASSERT_EQ("Line 2", ".2", resp->getLineAt(1));
+			VASSERT_EQ("Line 3", "3 300", resp->getLineAt(2));
+
+			vmime::shared_ptr <POP3Response> next = POP3Response::readResponse(conn);
+
+			VASSERT_EQ("Next", "Next", next->getText());
+		}
+	}
+
+	void testMultiLineResponse_Benchmark() {
+
+		// LIST response for a large mailbox, received in small chunks:
+		// the time must be linear in the size of the response
+		std::ostringstream data;
+
+		for (unsigned int i = 1 ; i <= 200000 ; ++i) {
+			data << i << " " << (1000 + i) << "\r\n";
+		}
+
+		vmime::shared_ptr <chunkedTestSocket> socket = vmime::make_shared <chunkedTestSocket>(1024);
+		vmime::shared_ptr <vmime::net::timeoutHandler> toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::shared_ptr <POP3ConnectionTest> conn =
+			vmime::make_shared <POP3ConnectionTest>(
+				vmime::dynamicCast <vmime::net::socket>(socket), toh
+			);
+
+		socket->localSend("+OK 200000 messages\r\n");
+		socket->localSend(data.str());
+		socket->localSend(".\r\n");
+
+		vmime::shared_ptr <POP3Response> resp =
+			POP3Response::readMultilineResponse(conn);
+
+		VASSERT_EQ("Lines", 200000, resp->getLineCount());
+		VASSERT_EQ("First", "1 1001", resp->getLineAt(0));
+		VASSERT_EQ("Last", "200000 201000", resp->getLineAt(199999));
+	}
+
 	void testLargeResponse() {
 
 		std::ostringstream data;
@@ -241,4 +344,75 @@ VMIME_TEST_SUITE_BEGIN(POP3ResponseTest)
 		VASSERT_EQ("Data Bytes", data.str(), receivedData);
 	}
 
+	void testLargeResponseDotStuffing() {
+
+		vmime::shared_ptr <testSocket> socket = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::timeoutHandler> toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::shared_ptr <POP3ConnectionTest> conn =
+			vmime::make_shared <POP3ConnectionTest>(
+				vmime::dynamicCast <vmime::net::socket>(socket), toh
+			);
+
+		socket->localSend("+OK Large Response Follows\r\n");
+		socket->localSend("..Line 1\r\n");
+		socket->localSend("Line .. 2\r\n");
+		socket->localSend("...\r\n");
+		socket->localSend(".\r\n");
+
+		vmime::string receivedData;
+		vmime::utility::outputStreamStringAdapter receivedDataStream(receivedData);
+
+		POP3Response::readLargeResponse(conn, receivedDataStream, NULL, 0);
+
+		VASSERT_EQ("Data", ".Line 1\r\nLine .. 2\r\n..", receivedData);
+	}
+
+	void testPipelinedResponses() {
+
+		vmime::shared_ptr <testSocket> socket = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::timeoutHandler> toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::shared_ptr <POP3ConnectionTest> conn =
+			vmime::make_shared <POP3ConnectionTest>(
+				vmime::dynamicCast <vmime::net::socket>(socket), toh
+			);
+
+		// All responses are available at once: each read must
+		// consume only its own response
+		socket->localSend(
+			"+OK 1 abcdef\r\n"
+			"+OK\r\nLine 1\r\n.\r\n"
+			"-ERR No such message\r\n"
+			"+OK\r\nData\r\n.\r\n"
+			"+OK Last\r\n"
+		);
+
+		vmime::shared_ptr <POP3Response> resp1 = POP3Response::readResponse(conn);
+
+		VASSERT_EQ("1", "1 abcdef", resp1->getText());
+
+		vmime::shared_ptr <POP3Response> resp2 = POP3Response::readMultilineResponse(conn);
+
+		VASSERT_EQ("2 Lines", 1, resp2->getLineCount());
+		VASSERT_EQ("2 Line 1", "Line 1", resp2->getLineAt(0));
+
+		vmime::string receivedData;
+		vmime::utility::outputStreamStringAdapter receivedDataStream(receivedData);
+
+		VASSERT_THROW(
+			"3",
+			POP3Response::readLargeResponse(conn, receivedDataStream, NULL, 0),
+			vmime::exceptions::command_error
+		);
+
+		POP3Response::readLargeResponse(conn, receivedDataStream, NULL, 0);
+
+		VASSERT_EQ("4", "Data", receivedData);
+
+		vmime::shared_ptr <POP3Response> resp5 = POP3Response::readResponse(conn);
+
+		VASSERT_EQ("5", "Last", resp5->getText());
+	}
+
 VMIME_TEST_SUITE_END
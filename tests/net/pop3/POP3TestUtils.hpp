@@ -21,6 +21,8 @@
 // the GNU General Public License cover the whole combination.
 //
 
+#include <algorithm>
+
 #include "vmime/net/pop3/POP3Connection.hpp"
 #include "vmime/net/pop3/POP3Store.hpp"
 
@@ -67,3 +69,173 @@ private:
 	vmime::shared_ptr <vmime::net::socket> m_socket;
 	vmime::shared_ptr <vmime::net::timeoutHandler> m_timeoutHandler;
 };
+
+
+
+/** POP3 test server which holds three messages. RETR of the second
+  * message always fails. Counts the commands received in each write,
+  * to check whether they have been pipelined.
+  */
+template <bool WITH_PIPELINING>
+class pipeliningPOP3TestSocket : public lineBasedTestSocket {
+
+public:
+
+	pipeliningPOP3TestSocket() {
+
+		maxCommandsPerWrite = 0;
+		writeCount = 0;
+		deletedCount = 0;
+	}
+
+	void onConnected() {
+
+		localSend("+OK POP3 server ready <1234.5678@test.vmime.org>\r\n");
+	}
+
+	void send(const vmime::string& buffer) {
+
+		const vmime::size_t count = std::count(buffer.begin(), buffer.end(), '\n');
+
+		++writeCount;
+
+		if (count > maxCommandsPerWrite) {
+			maxCommandsPerWrite = count;
+		}
+
+		lineBasedTestSocket::send(buffer);
+	}
+
+	void processCommand() {
+
+		if (!haveMoreLines()) {
+			return;
+		}
+
+		vmime::string line = getNextLine();
+		std::istringstream iss(line);
+
+		std::string cmd;
+		iss >> cmd;
+
+		unsigned int num = 0;
+		iss >> num;
+
+		if (cmd == "CAPA") {
+
+			localSend("+OK\r\n");
+			localSend("USER\r\n");
+			localSend("UIDL\r\n");
+			localSend("TOP\r\n");
+
+			if (WITH_PIPELINING) {
+				localSend("PIPELINING\r\n");
+			}
+
+			localSend(".\r\n");
+
+		} else if (cmd == "USER" || cmd == "PASS" || cmd == "QUIT") {
+
+			localSend("+OK\r\n");
+
+		} else if (cmd == "STAT") {
+
+			localSend("+OK 3 300\r\n");
+
+		} else if (cmd == "LIST" || cmd == "UIDL") {
+
+			if (num == 0) {
+
+				localSend("+OK\r\n");
+
+				for (unsigned int i = 1 ; i <= 3 ; ++i) {
+					localSend(messageInfo(cmd, i) + "\r\n");
+				}
+
+				localSend(".\r\n");
+
+			} else if (num <= 3) {
+
+				localSend("+OK " + messageInfo(cmd, num) + "\r\n");
+
+			} else {
+
+				localSend("-ERR No such message\r\n");
+			}
+
+		} else if (cmd == "TOP" && num >= 1 && num <= 3) {
+
+			localSend("+OK\r\n");
+			localSend(messageHeader(num));
+			localSend(".\r\n");
+
+		} else if (cmd == "RETR" && num >= 1 && num <= 3) {
+
+			if (num == 2) {
+
+				localSend("-ERR Message locked\r\n");
+
+			} else {
+
+				localSend("+OK\r\n");
+				localSend(messageHeader(num));
+				localSend("\r\n");
+				localSend("Body\r\n");
+				localSend(".\r\n");
+			}
+
+		} else if (cmd == "DELE" && num >= 1 && num <= 3) {
+
+			if (num == 2) {
+
+				localSend("-ERR Message locked\r\n");
+
+			} else {
+
+				localSend("+OK\r\n");
+				++deletedCount;
+			}
+
+		} else {
+
+			localSend("-ERR Invalid command\r\n");
+		}
+	}
+
+	static vmime::size_t maxCommandsPerWrite;
+	static vmime::size_t writeCount;
+	static unsigned int deletedCount;
+
+private:
+
+	static const vmime::string messageInfo(const vmime::string& cmd, const unsigned int num) {
+
+		std::ostringstream oss;
+		oss << num << " ";
+
+		if (cmd == "LIST") {
+			oss << num * 100;
+		} else {
+			oss << "uid" << num;
+		}
+
+		return oss.str();
+	}
+
+	static const vmime::string messageHeader(const unsigned int num) {
+
+		std::ostringstream oss;
+		oss << "Subject: Message " << num << "\r\n";
+
+		return oss.str();
+	}
+};
+
+template <bool WITH_PIPELINING>
+vmime::size_t pipeliningPOP3TestSocket <WITH_PIPELINING>::maxCommandsPerWrite = 0;
+
+template <bool WITH_PIPELINING>
+vmime::size_t pipeliningPOP3TestSocket <WITH_PIPELINING>::writeCount = 0;
+
+template <bool WITH_PIPELINING>
+unsigned int pipeliningPOP3TestSocket <WITH_PIPELINING>::deletedCount = 0;
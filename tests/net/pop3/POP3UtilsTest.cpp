@@ -36,6 +36,7 @@ VMIME_TEST_SUITE_BEGIN(POP3UtilsTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testParseMultiListOrUidlResponse)
+		VMIME_TEST(testParseListOrUidlResponse)
 		VMIME_TEST(testMessageSetToNumberList)
 	VMIME_TEST_LIST_END
 
@@ -72,6 +73,29 @@ VMIME_TEST_SUITE_BEGIN(POP3UtilsTest)
 		VASSERT_EQ("5 (with extra space)", "yz", result[8]);
 	}
 
+	void testParseListOrUidlResponse() {
+
+		vmime::shared_ptr <testSocket> socket = vmime::make_shared <testSocket>();
+		vmime::shared_ptr <vmime::net::timeoutHandler> toh = vmime::make_shared <testTimeoutHandler>();
+
+		vmime::shared_ptr <POP3ConnectionTest> conn =
+			vmime::make_shared <POP3ConnectionTest>(
+				vmime::dynamicCast <vmime::net::socket>(socket), toh
+			);
+
+		socket->localSend("+OK 2   QhdPYR:00WBw1Ph7x7\r\n");
+		socket->localSend("+OK 3\r\n");
+		socket->localSend("-ERR 4 abcdef\r\n");
+
+		vmime::string result;
+
+		VASSERT_TRUE("1", POP3Utils::parseListOrUidlResponse(POP3Response::readResponse(conn), result));
+		VASSERT_EQ("1 (value)", "QhdPYR:00WBw1Ph7x7", result);
+
+		VASSERT_FALSE("2 (no value)", POP3Utils::parseListOrUidlResponse(POP3Response::readResponse(conn), result));
+		VASSERT_FALSE("3 (error)", POP3Utils::parseListOrUidlResponse(POP3Response::readResponse(conn), result));
+	}
+
 	void testMessageSetToNumberList() {
 
 		const std::vector <size_t> msgNums = POP3Utils::messageSetToNumberList(
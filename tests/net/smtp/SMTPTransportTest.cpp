@@ -39,8 +39,12 @@ VMIME_TEST_SUITE_BEGIN(SMTPTransportTest)
 		VMIME_TEST(testChunking)
 		VMIME_TEST(testSize_Chunking)
 		VMIME_TEST(testSize_NoChunking)
+		VMIME_TEST(testSize_UnbufferedContents)
 		VMIME_TEST(testSMTPUTF8_available)
 		VMIME_TEST(testSMTPUTF8_notAvailable)
+		VMIME_TEST(testSendMessages_Pipelining)
+		VMIME_TEST(testSendMessages_NoPipelining)
+		VMIME_TEST(testSendMessages_GenerationError)
 	VMIME_TEST_LIST_END
 
 
@@ -185,6 +189,52 @@ VMIME_TEST_SUITE_BEGIN(SMTPTransportTest)
 		);
 	}
 
+	void testSize_UnbufferedContents() {
+
+		vmime::shared_ptr <vmime::net::session> session = vmime::net::session::create();
+
+		vmime::shared_ptr <vmime::net::transport> tr =
+			session->getTransport(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::make_shared <testSocketFactory <sizeRecordingSMTPTestSocket> >());
+		tr->setTimeoutHandlerFactory(vmime::make_shared <testTimeoutHandlerFactory>());
+
+		tr->connect();
+
+		vmime::mailbox exp("expeditor@test.vmime.org");
+
+		vmime::mailboxList recips;
+		recips.appendMailbox(vmime::make_shared <vmime::mailbox>("recipient@test.vmime.org"));
+
+		const vmime::string text(20000, 'x');
+
+		vmime::messageBuilder mb;
+		mb.setSubject(vmime::text("Unbuffered"));
+		mb.setExpeditor(exp);
+		mb.getRecipients().appendAddress(vmime::make_shared <vmime::mailbox>("recipient@test.vmime.org"));
+		mb.getTextPart()->setText(vmime::make_shared <vmime::stringContentHandler>(text));
+
+		vmime::shared_ptr <vmime::message> msg = mb.construct();
+
+		vmime::string expected;
+		vmime::utility::outputStreamStringAdapter expectedAdapter(expected);
+		msg->generate(expectedAdapter);
+
+		// Contents can only be read once: the message must be generated
+		// only once, and the whole contents sent
+		msg->getBody()->setContents(vmime::make_shared <vmime::streamContentHandler>
+			(vmime::make_shared <testUnbufferedInputStream>(text), text.length()));
+
+		VASSERT_FALSE("buffered", msg->getBody()->isBuffered());
+
+		tr->send(msg, exp, recips);
+
+		VASSERT_EQ("size", expected.length(), sizeRecordingSMTPTestSocket::receivedSize);
+		VASSERT_EQ("data", expected + "\r\n", sizeRecordingSMTPTestSocket::receivedData);
+
+		tr->disconnect();
+	}
+
 	void testSMTPUTF8_available() {
 
 		// Test with UTF8 sender
@@ -321,4 +371,133 @@ VMIME_TEST_SUITE_BEGIN(SMTPTransportTest)
 		}
 	}
 
+	class testBulkSendListener : public vmime::net::smtp::SMTPTransport::bulkSendListener {
+
+	public:
+
+		void messageSent(const size_t index) {
+
+			std::ostringstream oss;
+			oss << index << ":OK ";
+
+			results += oss.str();
+		}
+
+		void messagePartiallySent(const size_t index, const vmime::mailboxList& refusedRecipients) {
+
+			std::ostringstream oss;
+			oss << index << ":PARTIAL";
+
+			for (size_t i = 0 ; i < refusedRecipients.getMailboxCount() ; ++i) {
+				oss << ":" << refusedRecipients.getMailboxAt(i)->getEmail().toString();
+			}
+
+			results += oss.str() + " ";
+		}
+
+		void messageFailed(const size_t index, const vmime::exception& err) {
+
+			std::ostringstream oss;
+			oss << index << ":" << err.name() << " ";
+
+			results += oss.str();
+		}
+
+		std::string results;
+	};
+
+	template <typename SOCKET>
+	void sendBulkMessages(testBulkSendListener& listener) {
+
+		vmime::shared_ptr <vmime::net::session> session = vmime::net::session::create();
+
+		vmime::shared_ptr <vmime::net::transport> tr =
+			session->getTransport(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::make_shared <testSocketFactory <SOCKET> >());
+		tr->setTimeoutHandlerFactory(vmime::make_shared <testTimeoutHandlerFactory>());
+
+		tr->connect();
+
+		vmime::shared_ptr <vmime::message> msg = vmime::make_shared <vmime::message>();
+		msg->parse("Subject: Test\r\n\r\nMessage data\r\n.dot\r\n");
+
+		vmime::mailbox exp("expeditor@test.vmime.org");
+
+		vmime::mailboxList recips, rejected, none, some;
+		recips.appendMailbox(vmime::make_shared <vmime::mailbox>("recipient@test.vmime.org"));
+		rejected.appendMailbox(vmime::make_shared <vmime::mailbox>("rejected@test.vmime.org"));
+		some.appendMailbox(vmime::make_shared <vmime::mailbox>("recipient@test.vmime.org"));
+		some.appendMailbox(vmime::make_shared <vmime::mailbox>("rejected@test.vmime.org"));
+
+		typedef vmime::net::smtp::SMTPTransport::bulkMessage bulkMessage;
+
+		std::vector <bulkMessage> messages;
+		messages.push_back(bulkMessage(msg, exp, recips));
+		messages.push_back(bulkMessage(msg, exp, rejected));
+		messages.push_back(bulkMessage(msg, exp, none));
+		messages.push_back(bulkMessage(msg, exp, recips));
+		messages.push_back(bulkMessage(msg, exp, some));
+
+		vmime::dynamicCast <vmime::net::smtp::SMTPTransport>(tr)->sendMessages(messages, listener);
+
+		tr->disconnect();
+	}
+
+	void testSendMessages_Pipelining() {
+
+		testBulkSendListener listener;
+		sendBulkMessages <bulkSMTPTestSocket <true> >(listener);
+
+		VASSERT_EQ("Results", "0:OK 1:SMTPCommandError 2:no_recipient 3:OK 4:PARTIAL:rejected@test.vmime.org ", listener.results);
+	}
+
+	void testSendMessages_NoPipelining() {
+
+		testBulkSendListener listener;
+		sendBulkMessages <bulkSMTPTestSocket <false> >(listener);
+
+		VASSERT_EQ("Results", "0:OK 1:SMTPCommandError 2:no_recipient 3:OK 4:PARTIAL:rejected@test.vmime.org ", listener.results);
+	}
+
+	void testSendMessages_GenerationError() {
+
+		vmime::shared_ptr <vmime::net::session> session = vmime::net::session::create();
+
+		vmime::shared_ptr <vmime::net::transport> tr =
+			session->getTransport(vmime::utility::url("smtp://localhost"));
+
+		tr->setSocketFactory(vmime::make_shared <testSocketFactory <acceptingBulkSMTPTestSocket> >());
+		tr->setTimeoutHandlerFactory(vmime::make_shared <testTimeoutHandlerFactory>());
+
+		tr->connect();
+
+		vmime::shared_ptr <vmime::message> msg = vmime::make_shared <vmime::message>();
+		msg->parse("Subject: Test\r\n\r\nMessage data\r\n");
+
+		vmime::mailbox exp("expeditor@test.vmime.org");
+
+		vmime::mailboxList recips;
+		recips.appendMailbox(vmime::make_shared <vmime::mailbox>("recipient@test.vmime.org"));
+
+		typedef vmime::net::smtp::SMTPTransport::bulkMessage bulkMessage;
+
+		std::vector <bulkMessage> messages;
+		messages.push_back(bulkMessage(msg, exp, recips));
+		messages.push_back(bulkMessage(vmime::make_shared <failingSMTPTestMessage>(), exp, recips));
+
+		testBulkSendListener listener;
+
+		// The envelope of the first message has been pipelined when the
+		// second one fails: its replies are left unread
+		VASSERT_THROW(
+			"sendMessages",
+			vmime::dynamicCast <vmime::net::smtp::SMTPTransport>(tr)->sendMessages(messages, listener),
+			std::runtime_error
+		);
+
+		VASSERT_FALSE("Connected", tr->isConnected());
+	}
+
+
 VMIME_TEST_SUITE_END
@@ -791,3 +791,375 @@ private:
 
 	bool m_ehloSent, m_mailSent, m_rcptSent, m_dataSent, m_quitSent;
 };
+
+
+
+/** SMTP test server for sending several messages over one session.
+  *
+  * Recipient "rejected@test.vmime.org" is refused. When PIPELINING is
+  * advertised, checks that the envelope of the next message is sent in
+  * the same write as the end-of-data delimiter of the previous one.
+  */
+template <bool WITH_PIPELINING>
+class bulkSMTPTestSocket : public lineBasedTestSocket {
+
+public:
+
+	bulkSMTPTestSocket() {
+
+		m_state = STATE_NOT_CONNECTED;
+		m_writeCount = m_dotWrite = 0;
+		m_acceptedCount = m_rcptCount = 0;
+		m_mailSent = m_needReset = false;
+		m_transactionCount = m_resetCount = 0;
+	}
+
+	~bulkSMTPTestSocket() {
+
+		VASSERT_EQ("Messages accepted", 3, m_acceptedCount);
+		VASSERT_EQ("Transactions", 4, m_transactionCount);
+	}
+
+	void send(const vmime::string& buffer) {
+
+		++m_writeCount;
+		lineBasedTestSocket::send(buffer);
+	}
+
+	void onConnected() {
+
+		localSend("220 test.vmime.org Service ready\r\n");
+		processCommand();
+
+		m_state = STATE_COMMAND;
+	}
+
+	void processCommand() {
+
+		if (!haveMoreLines()) {
+			return;
+		}
+
+		vmime::string line = getNextLine();
+		std::istringstream iss(line);
+
+		switch (m_state) {
+
+		case STATE_NOT_CONNECTED:
+
+			localSend("451 Requested action aborted: invalid state\r\n");
+			break;
+
+		case STATE_COMMAND: {
+
+			std::string cmd;
+			iss >> cmd;
+
+			if (!WITH_PIPELINING && cmd != "EHLO") {
+				VASSERT("Commands must be sent one at a time", !haveMoreLines());
+			}
+
+			if (cmd == "EHLO") {
+
+				if (WITH_PIPELINING) {
+
+					localSend("250-test.vmime.org\r\n");
+					localSend("250 PIPELINING\r\n");
+
+				} else {
+
+					localSend("250 test.vmime.org\r\n");
+				}
+
+			} else if (cmd == "RSET") {
+
+				m_mailSent = m_needReset = false;
+				m_rcptCount = 0;
+				++m_resetCount;
+
+				localSend("250 OK\r\n");
+
+			} else if (cmd == "MAIL") {
+
+				VASSERT("Transaction must be reset", !m_needReset);
+				VASSERT("MAIL must not be sent twice", !m_mailSent);
+
+				if (WITH_PIPELINING && m_acceptedCount != 0 && m_resetCount == 0) {
+					VASSERT_EQ("MAIL sent with end-of-data", m_dotWrite, m_writeCount);
+				}
+
+				m_mailSent = true;
+				++m_transactionCount;
+
+				localSend("250 OK\r\n");
+
+			} else if (cmd == "RCPT") {
+
+				if (line.find("rejected@") != vmime::string::npos) {
+
+					localSend("550 No such user\r\n");
+
+				} else {
+
+					++m_rcptCount;
+					localSend("250 OK, recipient accepted\r\n");
+				}
+
+			} else if (cmd == "DATA") {
+
+				if (!m_mailSent || m_rcptCount == 0) {
+
+					m_needReset = m_mailSent;
+					localSend("554 No valid recipients\r\n");
+
+				} else {
+
+					localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+
+					m_state = STATE_DATA;
+					m_msgData.clear();
+				}
+
+			} else if (cmd == "QUIT") {
+
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+
+			} else {
+
+				localSend("502 Command not implemented\r\n");
+			}
+
+			break;
+		}
+		case STATE_DATA: {
+
+			if (line == ".") {
+
+				VASSERT("Data must be dot-stuffed", m_msgData.find("\r\n..dot\r\n") != vmime::string::npos);
+
+				localSend("250 Message accepted for delivery\r\n");
+
+				m_state = STATE_COMMAND;
+				m_mailSent = false;
+				m_rcptCount = 0;
+				m_dotWrite = m_writeCount;
+
+				++m_acceptedCount;
+
+			} else {
+
+				m_msgData += line + "\r\n";
+			}
+
+			break;
+		}
+
+		}
+
+		processCommand();
+	}
+
+private:
+
+	enum State {
+		STATE_NOT_CONNECTED,
+		STATE_COMMAND,
+		STATE_DATA
+	};
+
+	int m_state;
+
+	std::string m_msgData;
+
+	int m_writeCount, m_dotWrite;
+	int m_acceptedCount, m_rcptCount;
+	int m_transactionCount, m_resetCount;
+	bool m_mailSent, m_needReset;
+};
+
+
+/** Message which cannot be generated.
+  */
+class failingSMTPTestMessage : public vmime::message {
+
+public:
+
+	void generateImpl(
+		const vmime::generationContext& /* ctx */,
+		vmime::utility::outputStream& /* outputStream */,
+		const vmime::size_t /* curLinePos */ = 0,
+		vmime::size_t* /* newLinePos */ = NULL
+	) const {
+
+		throw std::runtime_error("generation failed");
+	}
+};
+
+
+/** SMTP test server for sendMessages() which supports PIPELINING,
+  * and accepts all commands.
+  */
+class acceptingBulkSMTPTestSocket : public lineBasedTestSocket {
+
+public:
+
+	acceptingBulkSMTPTestSocket()
+		: m_inData(false) {
+
+	}
+
+	void onConnected() {
+
+		localSend("220 test.vmime.org Service ready\r\n");
+	}
+
+	void processCommand() {
+
+		while (haveMoreLines()) {
+
+			const vmime::string line = getNextLine();
+
+			if (m_inData) {
+
+				if (line == ".") {
+
+					localSend("250 Message accepted for delivery\r\n");
+					m_inData = false;
+				}
+
+				continue;
+			}
+
+			std::istringstream iss(line);
+
+			vmime::string cmd;
+			iss >> cmd;
+
+			if (cmd == "EHLO") {
+
+				localSend("250-test.vmime.org\r\n");
+				localSend("250 PIPELINING\r\n");
+
+			} else if (cmd == "MAIL" || cmd == "RCPT" || cmd == "RSET") {
+
+				localSend("250 OK\r\n");
+
+			} else if (cmd == "DATA") {
+
+				localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+				m_inData = true;
+
+			} else if (cmd == "QUIT") {
+
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+
+			} else {
+
+				localSend("502 Command not implemented\r\n");
+			}
+		}
+	}
+
+private:
+
+	bool m_inData;
+};
+
+
+/** SMTP test server which advertises the SIZE extension, and records
+  * the size given with MAIL and the message data.
+  */
+class sizeRecordingSMTPTestSocket : public lineBasedTestSocket {
+
+public:
+
+	static vmime::size_t receivedSize;
+	static vmime::string receivedData;
+
+
+	sizeRecordingSMTPTestSocket()
+		: m_inData(false) {
+
+		receivedSize = 0;
+		receivedData.clear();
+	}
+
+	void onConnected() {
+
+		localSend("220 test.vmime.org Service ready\r\n");
+	}
+
+	void processCommand() {
+
+		while (haveMoreLines()) {
+
+			const vmime::string line = getNextLine();
+
+			if (m_inData) {
+
+				if (line == ".") {
+
+					localSend("250 Message accepted for delivery\r\n");
+					m_inData = false;
+
+				} else if (!line.empty() && line[0] == '.') {
+
+					receivedData += line.substr(1) + "\r\n";
+
+				} else {
+
+					receivedData += line + "\r\n";
+				}
+
+				continue;
+			}
+
+			std::istringstream iss(line);
+
+			std::string cmd;
+			iss >> cmd;
+
+			if (cmd == "EHLO") {
+
+				localSend("250-test.vmime.org\r\n");
+				localSend("250 SIZE 10000000\r\n");
+
+			} else if (cmd == "MAIL") {
+
+				std::string address, option;
+				iss >> address >> option;
+
+				VASSERT_EQ("MAIL/size", 0, option.find("SIZE="));
+
+				std::istringstream sizeStream(option.substr(5));
+				sizeStream >> receivedSize;
+
+				localSend("250 OK\r\n");
+
+			} else if (cmd == "RCPT") {
+
+				localSend("250 OK\r\n");
+
+			} else if (cmd == "DATA") {
+
+				localSend("354 Ready to accept data; end with <CRLF>.<CRLF>\r\n");
+				m_inData = true;
+
+			} else if (cmd == "QUIT") {
+
+				localSend("221 test.vmime.org Service closing transmission channel\r\n");
+
+			} else {
+
+				localSend("502 Command not implemented\r\n");
+			}
+		}
+	}
+
+private:
+
+	bool m_inData;
+};
+
+vmime::size_t sizeRecordingSMTPTestSocket::receivedSize = 0;
+vmime::string sizeRecordingSMTPTestSocket::receivedData;
@@ -23,6 +23,8 @@
 
 #include "tests/testUtils.hpp"
 
+#include "vmime/utility/parserInputStreamAdapter.hpp"
+
 
 VMIME_TEST_SUITE_BEGIN(bodyPartTest)
 
@@ -40,6 +42,11 @@ VMIME_TEST_SUITE_BEGIN(bodyPartTest)
 		VMIME_TEST(testTextUsageForQPEncoding)
 		VMIME_TEST(testParseVeryBigMessage)
 		VMIME_TEST(testParseBoundaryPrefix)
+		VMIME_TEST(testParseManyParts)
+		VMIME_TEST(testParseDeepNesting)
+		VMIME_TEST(testBenchmarkManyParts)
+		VMIME_TEST(testBenchmarkManyPartsFindNext)
+		VMIME_TEST(testBenchmarkDeepNesting)
 	VMIME_TEST_LIST_END
 
 
@@ -411,4 +418,233 @@ VMIME_TEST_SUITE_BEGIN(bodyPartTest)
 		VASSERT_EQ("part2-body", "P2", extractContents(relbd->getPartAt(1)->getBody()->getContents()));
 	}
 
+	void testParseManyParts() {
+
+		// Parts are big enough for boundaries to span the scanner's read blocks
+		static const unsigned int PART_COUNT = 500;
+		static const std::string LINE = "0123456789012345678901234567890123456789012345678901234567890123456789";
+
+		std::ostringstream oss;
+		oss << "Content-Type: multipart/mixed; boundary=\"MY-BOUNDARY\"\r\n"
+		    << "\r\n"
+		    << "Prolog\r\n";
+
+		for (unsigned int i = 0 ; i < PART_COUNT ; ++i) {
+
+			oss << "--MY-BOUNDARY\r\n"
+			    << "\r\n"
+			    << "PART" << i;
+
+			for (unsigned int j = 0 ; j < (i % 7) * 20 ; ++j) {
+				oss << "\r\n" << LINE;
+			}
+
+			// Not a boundary (not at beginning of line, no "--", prefix...)
+			oss << "\r\nX--MY-BOUNDARY\r\n-MY-BOUNDARY\r\n--MY-BOUNDARYX\r\n";
+		}
+
+		oss << "--MY-BOUNDARY--\r\n"
+		    << "Epilog";
+
+		const vmime::string str = oss.str();
+
+		vmime::shared_ptr <vmime::utility::inputStreamStringAdapter> is =
+			vmime::make_shared <vmime::utility::inputStreamStringAdapter>(str);
+
+		vmime::shared_ptr <vmime::message> msg = vmime::make_shared <vmime::message>();
+		msg->parse(is, str.length());
+
+		VASSERT_EQ("count", PART_COUNT, static_cast <unsigned int>(msg->getBody()->getPartCount()));
+		VASSERT_EQ("prolog", "Prolog", msg->getBody()->getPrologText());
+		VASSERT_EQ("epilog", "Epilog", msg->getBody()->getEpilogText());
+
+		for (unsigned int i = 0 ; i < PART_COUNT ; ++i) {
+
+			std::ostringstream expected;
+			expected << "PART" << i;
+
+			for (unsigned int j = 0 ; j < (i % 7) * 20 ; ++j) {
+				expected << "\r\n" << LINE;
+			}
+
+			expected << "\r\nX--MY-BOUNDARY\r\n-MY-BOUNDARY\r\n--MY-BOUNDARYX";
+
+			VASSERT_EQ(
+				"part",
+				expected.str(),
+				extractContents(msg->getBody()->getPartAt(i)->getBody()->getContents())
+			);
+		}
+	}
+
+	void testParseDeepNesting() {
+
+		static const unsigned int DEPTH = 50;
+
+		std::ostringstream oss;
+
+		for (unsigned int i = 0 ; i < DEPTH ; ++i) {
+
+			oss << "Content-Type: multipart/mixed; boundary=\"B" << i << "\"\n"
+			    << "\n"
+			    << "--B" << i << "\n"
+			    << "\n"
+			    << "FIRST" << i << "\n"
+			    << "--B" << i << "\n";
+		}
+
+		oss << "\n"
+		    << "INNERMOST\n";
+
+		for (unsigned int i = DEPTH ; i != 0 ; --i) {
+			oss << "--B" << (i - 1) << "--\n";
+		}
+
+		vmime::bodyPart p;
+		p.parse(oss.str());
+
+		vmime::shared_ptr <vmime::body> body = p.getBody();
+
+		for (unsigned int i = 0 ; i < DEPTH ; ++i) {
+
+			VASSERT_EQ("count", 2, body->getPartCount());
+
+			std::ostringstream first;
+			first << "FIRST" << i;
+
+			VASSERT_EQ("first", first.str(), extractContents(body->getPartAt(0)->getBody()->getContents()));
+
+			body = body->getPartAt(1)->getBody();
+		}
+
+		VASSERT_EQ("innermost", "INNERMOST", extractContents(body->getContents()));
+	}
+
+	// Benchmarks for boundary search: the test runner reports the
+	// duration of each test. Messages are parsed from a seekable
+	// stream, as big messages are.
+
+	static const vmime::string buildBenchmarkMessage(const unsigned int partCount) {
+
+		static const std::string LINE = "0123456789012345678901234567890123456789012345678901234567890123456789";
+
+		std::ostringstream oss;
+		oss << "Content-Type: multipart/mixed; boundary=\"MY-BOUNDARY\"\r\n"
+		    << "\r\n";
+
+		for (unsigned int i = 0 ; i < partCount ; ++i) {
+
+			oss << "--MY-BOUNDARY\r\n"
+			    << "\r\n";
+
+			for (unsigned int j = 0 ; j < 30 ; ++j) {
+				oss << LINE << "\r\n";
+			}
+		}
+
+		oss << "--MY-BOUNDARY--\r\n";
+
+		return oss.str();
+	}
+
+	void testBenchmarkManyParts() {
+
+		static const unsigned int PART_COUNT = 2000;
+
+		const vmime::string str = buildBenchmarkMessage(PART_COUNT);
+
+		vmime::shared_ptr <vmime::utility::inputStreamStringAdapter> is =
+			vmime::make_shared <vmime::utility::inputStreamStringAdapter>(str);
+
+		vmime::shared_ptr <vmime::message> msg = vmime::make_shared <vmime::message>();
+		msg->parse(is, str.length());
+
+		VASSERT_EQ("count", PART_COUNT, static_cast <unsigned int>(msg->getBody()->getPartCount()));
+	}
+
+	void testBenchmarkManyPartsFindNext() {
+
+		// Reference for testBenchmarkManyParts(): find the same boundaries
+		// one candidate at a time, as body parsing used to do
+		static const unsigned int PART_COUNT = 2000;
+
+		const vmime::string str = buildBenchmarkMessage(PART_COUNT);
+		const vmime::string boundary = "MY-BOUNDARY";
+
+		vmime::utility::parserInputStreamAdapter parser
+			(vmime::make_shared <vmime::utility::inputStreamStringAdapter>(str));
+
+		unsigned int count = 0;
+
+		for (size_t pos = parser.findNext(boundary, 0) ; pos != vmime::npos ;
+		     pos = parser.findNext(boundary, pos + 1)) {
+
+			if (pos < 3) {
+				continue;
+			}
+
+			parser.seek(pos - 3);
+
+			if (!parser.matchBytes("\n--", 3)) {
+				continue;
+			}
+
+			parser.seek(pos + boundary.length());
+
+			const vmime::byte_t next = parser.peekByte();
+
+			if (isspace(next) || next == '-') {
+				++count;
+			}
+		}
+
+		VASSERT_EQ("count", PART_COUNT + 1, count);
+	}
+
+	void testBenchmarkDeepNesting() {
+
+		// Each level is scanned for boundaries until its end
+		static const unsigned int DEPTH = 100;
+		static const std::string LINE = "0123456789012345678901234567890123456789012345678901234567890123456789";
+
+		std::ostringstream oss;
+
+		for (unsigned int i = 0 ; i < DEPTH ; ++i) {
+
+			oss << "Content-Type: multipart/mixed; boundary=\"B" << i << "\"\r\n"
+			    << "\r\n"
+			    << "--B" << i << "\r\n"
+			    << "\r\n";
+
+			for (unsigned int j = 0 ; j < 200 ; ++j) {
+				oss << LINE << "\r\n";
+			}
+
+			oss << "--B" << i << "\r\n";
+		}
+
+		oss << "\r\n"
+		    << "INNERMOST\r\n";
+
+		for (unsigned int i = DEPTH ; i != 0 ; --i) {
+			oss << "--B" << (i - 1) << "--\r\n";
+		}
+
+		const vmime::string str = oss.str();
+
+		vmime::shared_ptr <vmime::utility::inputStreamStringAdapter> is =
+			vmime::make_shared <vmime::utility::inputStreamStringAdapter>(str);
+
+		vmime::shared_ptr <vmime::message> msg = vmime::make_shared <vmime::message>();
+		msg->parse(is, str.length());
+
+		vmime::shared_ptr <vmime::body> body = msg->getBody();
+
+		for (unsigned int i = 0 ; i < DEPTH ; ++i) {
+
+			VASSERT_EQ("count", 2, body->getPartCount());
+			body = body->getPartAt(1)->getBody();
+		}
+	}
+
 VMIME_TEST_SUITE_END
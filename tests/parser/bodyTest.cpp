@@ -24,11 +24,46 @@
 #include "tests/testUtils.hpp"
 
 
+// Content handler which counts how many times its contents are encoded
+class countingContentHandler : public vmime::stringContentHandler {
+
+public:
+
+	countingContentHandler(const vmime::string& buffer)
+		: vmime::stringContentHandler(buffer) {
+
+	}
+
+	vmime::shared_ptr <vmime::contentHandler> clone() const {
+
+		return vmime::make_shared <countingContentHandler>(*this);
+	}
+
+	void generate(
+		vmime::utility::outputStream& os,
+		const vmime::encoding& enc,
+		const size_t maxLineLength
+	) const {
+
+		++generateCount;
+		vmime::stringContentHandler::generate(os, enc, maxLineLength);
+	}
+
+	static int generateCount;
+};
+
+int countingContentHandler::generateCount = 0;
+
+
 VMIME_TEST_SUITE_BEGIN(bodyTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testGenerate_Text)
 		VMIME_TEST(testGenerate_NonText)
+		VMIME_TEST(testExactGeneratedSize)
+		VMIME_TEST(testExactGeneratedSize_Memoized)
+		VMIME_TEST(testExactGeneratedSize_ContentsChanged)
+		VMIME_TEST(testIsBuffered)
 	VMIME_TEST_LIST_END
 
 	void testGenerate_Text() {
@@ -76,4 +111,137 @@ VMIME_TEST_SUITE_BEGIN(bodyTest)
 		);
 	}
 
+	void testExactGeneratedSize() {
+
+		vmime::messageBuilder mb;
+		mb.setSubject(vmime::text("Test message"));
+		mb.setExpeditor(vmime::mailbox("me@vmime.org"));
+		mb.getRecipients().appendAddress(vmime::make_shared <vmime::mailbox>("you@vmime.org"));
+		mb.getTextPart()->setText(vmime::make_shared <vmime::stringContentHandler>("Message body"));
+
+		mb.appendAttachment(
+			vmime::make_shared <vmime::defaultAttachment>(
+				vmime::make_shared <vmime::stringContentHandler>(vmime::string(1000, '\xfe')),
+				vmime::mediaType("application/octet-stream")
+			)
+		);
+
+		vmime::shared_ptr <vmime::message> msg = mb.construct();
+		const vmime::generationContext& ctx = vmime::generationContext::getDefaultContext();
+
+		const vmime::size_t size = msg->getExactGeneratedSize(ctx);
+
+		VASSERT_EQ("Size", generatedLength(*msg, ctx), size);
+		VASSERT_EQ("Size (memoized)", size, msg->getExactGeneratedSize(ctx));
+	}
+
+	static vmime::size_t generatedLength(const vmime::component& c, const vmime::generationContext& ctx) {
+
+		vmime::string str;
+		vmime::utility::outputStreamStringAdapter strStream(str);
+
+		c.generate(ctx, strStream);
+
+		return str.length();
+	}
+
+	void testExactGeneratedSize_Memoized() {
+
+		vmime::shared_ptr <countingContentHandler> contents =
+			vmime::make_shared <countingContentHandler>(vmime::string(1000, '\xfe'));
+
+		vmime::bodyPart p;
+		p.getBody()->setContents(
+			contents,
+			vmime::mediaType("application", "octet-stream"),
+			vmime::charset("utf-8"),
+			vmime::encoding("base64")
+		);
+
+		const vmime::generationContext& ctx = vmime::generationContext::getDefaultContext();
+
+		countingContentHandler::generateCount = 0;
+
+		const vmime::size_t size = p.getBody()->getExactGeneratedSize(ctx);
+
+		VASSERT_EQ("Count 1", 1, countingContentHandler::generateCount);
+		VASSERT_EQ("Size", generatedLength(*p.getBody(), ctx), size);
+
+		// Contents are not encoded again
+		countingContentHandler::generateCount = 0;
+
+		VASSERT_EQ("Size 2", size, p.getBody()->getExactGeneratedSize(ctx));
+		VASSERT_EQ("Size 3", size, p.getBody()->getGeneratedSize(ctx));
+		VASSERT_EQ("Count 2", 0, countingContentHandler::generateCount);
+
+		// Changing the encoding invalidates the memoized size
+		p.getBody()->setEncoding(vmime::encoding("quoted-printable"));
+
+		VASSERT_EQ("Size 4", generatedLength(*p.getBody(), ctx), p.getBody()->getExactGeneratedSize(ctx));
+
+		// So does modifying the contents in place
+		countingContentHandler::generateCount = 0;
+
+		contents->setData(vmime::string(1000, 'a'));
+
+		VASSERT_EQ("Size 5", generatedLength(*p.getBody(), ctx), p.getBody()->getExactGeneratedSize(ctx));
+		VASSERT_EQ("Count 3", 2, countingContentHandler::generateCount);
+	}
+
+	void testExactGeneratedSize_ContentsChanged() {
+
+		vmime::shared_ptr <vmime::stringContentHandler> contents =
+			vmime::make_shared <vmime::stringContentHandler>(vmime::string(100, 'a'));
+
+		vmime::bodyPart p;
+		p.getBody()->setContents(
+			contents,
+			vmime::mediaType("application", "octet-stream"),
+			vmime::charset("utf-8"),
+			vmime::encoding("quoted-printable")
+		);
+
+		const vmime::generationContext& ctx = vmime::generationContext::getDefaultContext();
+
+		const vmime::size_t size1 = p.getBody()->getExactGeneratedSize(ctx);
+
+		VASSERT_EQ("Size 1", generatedLength(*p.getBody(), ctx), size1);
+
+		// Same length, but the encoded length depends on the bytes
+		contents->setData(vmime::string(100, '\xfe'));
+
+		const vmime::size_t size2 = p.getBody()->getExactGeneratedSize(ctx);
+
+		VASSERT_EQ("Size 2", generatedLength(*p.getBody(), ctx), size2);
+		VASSERT_NEQ("Size changed", size1, size2);
+	}
+
+	void testIsBuffered() {
+
+		vmime::bodyPart p;
+		vmime::body& b = *p.getBody();
+
+		VASSERT_TRUE("empty", b.isBuffered());
+
+		b.setContents(vmime::make_shared <vmime::stringContentHandler>("contents"));
+
+		VASSERT_TRUE("string", b.isBuffered());
+
+		// One part whose contents can only be read once
+		vmime::shared_ptr <vmime::bodyPart> part1 = vmime::make_shared <vmime::bodyPart>();
+		part1->getBody()->setContents(vmime::make_shared <vmime::stringContentHandler>("part 1"));
+
+		vmime::shared_ptr <vmime::bodyPart> part2 = vmime::make_shared <vmime::bodyPart>();
+		part2->getBody()->setContents(vmime::make_shared <vmime::streamContentHandler>
+			(vmime::make_shared <testUnbufferedInputStream>("part 2"), 6));
+
+		b.appendPart(part1);
+
+		VASSERT_TRUE("multipart", b.isBuffered());
+
+		b.appendPart(part2);
+
+		VASSERT_FALSE("multipart unbuffered", b.isBuffered());
+	}
+
 VMIME_TEST_SUITE_END
@@ -23,6 +23,9 @@
 
 #include "tests/testUtils.hpp"
 
+#include <atomic>
+#include <thread>
+
 
 VMIME_TEST_SUITE_BEGIN(headerFieldTest)
 
@@ -31,6 +34,13 @@ VMIME_TEST_SUITE_BEGIN(headerFieldTest)
 		VMIME_TEST(testValueOnNextLine)
 		VMIME_TEST(testStripSpacesAtEnd)
 		VMIME_TEST(testValueWithEmptyLine)
+		VMIME_TEST(testLazyValueGenerate)
+		VMIME_TEST(testLazyValueModify)
+		VMIME_TEST(testLazyValueBareLF)
+		VMIME_TEST(testLazyValueParsedBounds)
+		VMIME_TEST(testLazyValueCopy)
+		VMIME_TEST(testLazyValueSharedSource)
+		VMIME_TEST(testLazyValueConcurrentAccess)
 	VMIME_TEST_LIST_END
 
 
@@ -109,4 +119,151 @@ VMIME_TEST_SUITE_BEGIN(headerFieldTest)
 		VASSERT_EQ("Field value", "data1 data2 data3", hvalue->getWholeBuffer());
 	}
 
+	void testLazyValueGenerate() {
+
+		vmime::parsingContext ctx;
+
+		const vmime::string buffer = "Subject:   =?us-ascii?Q?a?=    b\r\n\t c\r\n";
+
+		vmime::shared_ptr <vmime::headerField> hfield =
+			vmime::headerField::parseNext(ctx, buffer, 0, buffer.size());
+
+		// Unmodified value is generated as it was parsed
+		VASSERT_EQ("1", "Subject: =?us-ascii?Q?a?=    b\r\n\t c", hfield->generate());
+
+		vmime::shared_ptr <const vmime::headerField> chfield = hfield;
+
+		VASSERT_EQ("2", "a    b c", chfield->getValue <vmime::text>()->getWholeBuffer());
+		VASSERT_EQ("3", "Subject: =?us-ascii?Q?a?=    b\r\n\t c", chfield->generate());
+	}
+
+	void testLazyValueModify() {
+
+		vmime::parsingContext ctx;
+
+		const vmime::string buffer = "From:   Name   <name@vmime.org>";
+
+		vmime::shared_ptr <vmime::headerField> hfield =
+			vmime::headerField::parseNext(ctx, buffer, 0, buffer.size());
+
+		hfield->getValue <vmime::mailbox>()->setEmail(vmime::emailAddress("other@vmime.org"));
+
+		VASSERT_EQ("1", "From: \"Name\" <other@vmime.org>", hfield->generate());
+
+		hfield = vmime::headerField::parseNext(ctx, buffer, 0, buffer.size());
+		hfield->setValue(vmime::mailbox(vmime::emailAddress("other@vmime.org")));
+
+		VASSERT_EQ("2", "From: other@vmime.org", hfield->generate());
+	}
+
+	void testLazyValueBareLF() {
+
+		vmime::parsingContext ctx;
+
+		const vmime::string buffer = "Subject: a\n b";
+
+		vmime::shared_ptr <vmime::headerField> hfield =
+			vmime::headerField::parseNext(ctx, buffer, 0, buffer.size());
+
+		// Bare LF in value must not be generated as-is
+		VASSERT_EQ("1", "Subject: a b", hfield->generate());
+	}
+
+	void testLazyValueParsedBounds() {
+
+		vmime::header hdr;
+		hdr.parse("X-Pad: x\r\nFrom: name@vmime.org\r\n\r\n");
+
+		vmime::shared_ptr <const vmime::headerField> hfield = hdr.findField("From");
+
+		VASSERT_EQ("1", 10, hfield->getParsedOffset());
+		VASSERT_EQ("2", 16, hfield->getValue()->getParsedOffset());
+		VASSERT_EQ("3", 14, hfield->getValue()->getParsedLength());
+	}
+
+	void testLazyValueCopy() {
+
+		vmime::parsingContext ctx;
+
+		const vmime::string buffer = "To: a@vmime.org,   b@vmime.org";
+
+		vmime::shared_ptr <vmime::headerField> hfield =
+			vmime::headerField::parseNext(ctx, buffer, 0, buffer.size());
+
+		vmime::shared_ptr <vmime::headerField> copy =
+			vmime::dynamicCast <vmime::headerField>(hfield->clone());
+
+		VASSERT_EQ("1", "To: a@vmime.org,   b@vmime.org", copy->generate());
+		VASSERT_EQ("2", 2, copy->getValue <vmime::addressList>()->getAddressCount());
+	}
+
+	void testLazyValueSharedSource() {
+
+		// Header block does not start at the beginning of the buffer
+		const vmime::string buffer = "xxxxxSubject: a\r\n b\r\nTo: c@vmime.org\r\n\r\nBody";
+
+		vmime::header hdr;
+		hdr.parse(buffer, 5, buffer.length());
+
+		VASSERT_EQ("1", "Subject: a\r\n b", hdr.findField("Subject")->generate());
+
+		vmime::shared_ptr <const vmime::headerField> hfield = hdr.findField("To");
+
+		VASSERT_EQ("2", "To: c@vmime.org", hfield->generate());
+		VASSERT_EQ("3", 21, hfield->getParsedOffset());
+		VASSERT_EQ("4", 25, hfield->getValue()->getParsedOffset());
+		VASSERT_EQ("5", 11, hfield->getValue()->getParsedLength());
+	}
+
+	void testLazyValueConcurrentAccess() {
+
+		// Bare LF: generation also needs the parsed value
+		const vmime::string buffer =
+			"Subject: =?us-ascii?Q?a?=\n b\r\nTo: a@vmime.org, b@vmime.org\r\n\r\n";
+
+		for (int n = 0 ; n < 20 ; ++n) {
+
+			vmime::shared_ptr <vmime::header> hdr = vmime::make_shared <vmime::header>();
+			hdr->parse(buffer);
+
+			const vmime::shared_ptr <const vmime::header> constHdr = hdr;
+
+			std::atomic <int> errors(0);
+			std::vector <std::thread> threads;
+
+			for (int i = 0 ; i < 4 ; ++i) {
+
+				threads.push_back(std::thread([&constHdr, &errors, i]() {
+
+					vmime::shared_ptr <const vmime::headerField> subject = constHdr->findField("Subject");
+					vmime::shared_ptr <const vmime::headerField> to = constHdr->findField("To");
+
+					if (i % 2 == 0 && subject->generate() != "Subject: a b") {
+						++errors;
+					}
+
+					if (subject->getValue <vmime::text>()->getWholeBuffer() != "a b") {
+						++errors;
+					}
+
+					// Copies of a field whose value is being parsed
+					vmime::shared_ptr <vmime::headerField> copy =
+						vmime::dynamicCast <vmime::headerField>(to->clone());
+
+					if (copy->getValue <vmime::addressList>()->getAddressCount() != 2 ||
+					    to->getValue <vmime::addressList>()->getAddressCount() != 2) {
+
+						++errors;
+					}
+				}));
+			}
+
+			for (size_t i = 0 ; i < threads.size() ; ++i) {
+				threads[i].join();
+			}
+
+			VASSERT_EQ("errors", 0, errors.load());
+		}
+	}
+
 VMIME_TEST_SUITE_END
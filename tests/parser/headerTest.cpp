@@ -61,6 +61,18 @@ VMIME_TEST_SUITE_BEGIN(headerTest)
 		VMIME_TEST(testFindAllFields1)
 		VMIME_TEST(testFindAllFields2)
 		VMIME_TEST(testFindAllFields3)
+		VMIME_TEST(testFindCaseInsensitive)
+		VMIME_TEST(testFindRenamedField)
+		VMIME_TEST(testFindAfterInsertRemove)
+		VMIME_TEST(testFindById)
+		VMIME_TEST(testFindByIdAfterInsertRemove)
+		VMIME_TEST(testFindByIdRenamedField)
+		VMIME_TEST(testFieldIndexCopy)
+		VMIME_TEST(testFieldIndexSharedField)
+		VMIME_TEST(testFindByUnknownId)
+		VMIME_TEST(testRemoveAllFieldsByName)
+
+		VMIME_TEST(testParseFromStream)
 	VMIME_TEST_LIST_END
 
 
@@ -372,4 +384,291 @@ VMIME_TEST_SUITE_BEGIN(headerTest)
 		VASSERT_EQ("Second value", "C: c2", headerTest::getFieldValue(*res[2]));
 	}
 
+	void testFindCaseInsensitive() {
+
+		vmime::header hdr;
+		hdr.parse("content-transfer-encoding: base64\r\nX-Mailer: a\r\n");
+
+		VASSERT_EQ("1", true, hdr.hasField(vmime::fields::CONTENT_TRANSFER_ENCODING));
+		VASSERT_EQ("2", true, hdr.hasField(vmime::string("CONTENT-Transfer-Encoding")));
+		VASSERT_EQ("3", false, hdr.hasField("Content-Transfer-Encodin"));
+		VASSERT_EQ("4", "X-Mailer: a", headerTest::getFieldValue(*hdr.findField("x-mailer")));
+		VASSERT(
+			"5",
+			hdr.findField(vmime::fields::CONTENT_TRANSFER_ENCODING) ==
+				hdr.findField(vmime::string(vmime::fields::CONTENT_TRANSFER_ENCODING))
+		);
+	}
+
+	void testFindRenamedField() {
+
+		vmime::header hdr;
+		hdr.parse("A: a\r\nB: b\r\n");
+
+		hdr.findField("A")->setName("C");
+
+		VASSERT_EQ("1", false, hdr.hasField("A"));
+		VASSERT_EQ("2", "C: a", headerTest::getFieldValue(*hdr.findField("c")));
+	}
+
+	void testFindAfterInsertRemove() {
+
+		vmime::header hdr;
+
+		for (int i = 0 ; i < 200 ; ++i) {
+			hdr.appendField(vmime::headerFieldFactory::getInstance()->create("Received", "r"));
+		}
+
+		hdr.appendField(vmime::headerFieldFactory::getInstance()->create("B", "b1"));
+
+		vmime::shared_ptr <vmime::headerField> b0 =
+			vmime::headerFieldFactory::getInstance()->create("b", "b0");
+
+		hdr.insertFieldBefore(0, b0);
+
+		VASSERT_EQ("1", 200, hdr.findAllFields(vmime::fields::RECEIVED).size());
+		VASSERT_EQ("2", "b: b0", headerTest::getFieldValue(*hdr.findField("B")));
+
+		hdr.removeField(b0);
+
+		VASSERT_EQ("3", "B: b1", headerTest::getFieldValue(*hdr.findField("B")));
+
+		std::vector <vmime::shared_ptr <vmime::headerField> > res = hdr.findAllFields("B");
+
+		VASSERT_EQ("4", 1, res.size());
+		VASSERT_EQ("5", "B: b1", headerTest::getFieldValue(*res[0]));
+	}
+
+	void testFindById() {
+
+		vmime::header hdr;
+		hdr.parse("received: r1\r\nSubject: s\r\nX-Foo: f\r\nRECEIVED: r2\r\n");
+
+		VASSERT_EQ("1", true, hdr.hasField(vmime::fields::ID_RECEIVED));
+		VASSERT_EQ("2", false, hdr.hasField(vmime::fields::ID_FROM));
+		VASSERT_EQ("3", "Subject: s", headerTest::getFieldValue(*hdr.findField(vmime::fields::ID_SUBJECT)));
+		VASSERT(
+			"4",
+			hdr.findField(vmime::fields::ID_SUBJECT) == hdr.findField(vmime::string("subject"))
+		);
+		VASSERT_EQ("5", vmime::fields::ID_UNKNOWN, hdr.findField("X-Foo")->getNameId());
+
+		std::vector <vmime::shared_ptr <vmime::headerField> > res =
+			hdr.findAllFields(vmime::fields::ID_RECEIVED);
+
+		VASSERT_EQ("6", 2, res.size());
+		VASSERT_EQ("7", "received: r1", headerTest::getFieldValue(*res[0]));
+		VASSERT_EQ("8", "RECEIVED: r2", headerTest::getFieldValue(*res[1]));
+
+		// Field is created with the name matching the identifier
+		vmime::shared_ptr <vmime::headerField> to = hdr.getField(vmime::fields::ID_TO);
+
+		VASSERT_EQ("9", vmime::fields::TO, to->getName());
+		VASSERT_EQ("10", 5, hdr.getFieldCount());
+		VASSERT(
+			"11",
+			to == hdr.getField <vmime::headerField>(vmime::fields::ID_TO)
+		);
+	}
+
+	void testFindByIdAfterInsertRemove() {
+
+		findByIdAfterInsertRemove(/* indexed */ false);
+		findByIdAfterInsertRemove(/* indexed */ true);
+	}
+
+	static void findByIdAfterInsertRemove(const bool indexed) {
+
+		vmime::header hdr;
+		hdr.setFieldIndexEnabled(indexed);
+		hdr.parse("A: a\r\nReceived: r1\r\nB: b\r\nReceived: r2\r\n");
+
+		vmime::shared_ptr <vmime::headerField> r0 =
+			vmime::headerFieldFactory::getInstance()->create("Received", "r0");
+		vmime::shared_ptr <vmime::headerField> r3 =
+			vmime::headerFieldFactory::getInstance()->create("Received", "r3");
+		vmime::shared_ptr <vmime::headerField> r4 =
+			vmime::headerFieldFactory::getInstance()->create("Received", "r4");
+
+		hdr.insertFieldAfter(0, r0);               // A r0 r1 B r2
+		hdr.insertFieldBefore(hdr.findField("B"), r3);  // A r0 r1 r3 B r2
+		hdr.appendField(r4);                       // A r0 r1 r3 B r2 r4
+
+		VASSERT("1", r0 == hdr.findField(vmime::fields::ID_RECEIVED));
+		VASSERT_EQ("2", 5, hdr.findAllFields(vmime::fields::ID_RECEIVED).size());
+
+		hdr.removeField(r0);  // A r1 r3 B r2 r4
+
+		VASSERT_EQ("3", "Received: r1", headerTest::getFieldValue(*hdr.findField(vmime::fields::ID_RECEIVED)));
+
+		hdr.removeField(1);  // A r3 B r2 r4
+
+		VASSERT("4", r3 == hdr.findField(vmime::fields::ID_RECEIVED));
+
+		hdr.replaceField(r3, vmime::headerFieldFactory::getInstance()->create("C", "c"));  // A C B r2 r4
+
+		std::vector <vmime::shared_ptr <vmime::headerField> > res =
+			hdr.findAllFields(vmime::fields::ID_RECEIVED);
+
+		VASSERT_EQ("5", 2, res.size());
+		VASSERT_EQ("6", "Received: r2", headerTest::getFieldValue(*res[0]));
+		VASSERT("7", r4 == res[1]);
+
+		hdr.removeAllFields("received");
+
+		VASSERT_EQ("8", false, hdr.hasField(vmime::fields::ID_RECEIVED));
+		VASSERT_EQ("9", 3, hdr.getFieldCount());
+	}
+
+	void testFindByIdRenamedField() {
+
+		findByIdRenamedField(/* indexed */ false);
+		findByIdRenamedField(/* indexed */ true);
+	}
+
+	static void findByIdRenamedField(const bool indexed) {
+
+		vmime::header hdr;
+		hdr.setFieldIndexEnabled(indexed);
+		hdr.parse("Subject: s\r\nX-Foo: f\r\n");
+
+		hdr.findField(vmime::fields::ID_SUBJECT)->setName("X-Bar");
+		hdr.findField("X-Foo")->setName("subject");
+
+		VASSERT_EQ("1", "subject: f", headerTest::getFieldValue(*hdr.findField(vmime::fields::ID_SUBJECT)));
+		VASSERT_EQ("2", 1, hdr.findAllFields(vmime::fields::ID_SUBJECT).size());
+
+		// A field removed from the header is not indexed anymore
+		vmime::shared_ptr <vmime::headerField> field = hdr.findField(vmime::fields::ID_SUBJECT);
+
+		hdr.removeField(field);
+		field->setName("Subject");
+
+		VASSERT_EQ("3", false, hdr.hasField(vmime::fields::ID_SUBJECT));
+	}
+
+	void testFieldIndexCopy() {
+
+		vmime::header hdr;
+		hdr.setFieldIndexEnabled(true);
+		hdr.parse("Subject: s\r\nX-Foo: f\r\n");
+
+		// Fields are copied and indexed by the copy
+		vmime::header copy(hdr);
+
+		VASSERT_EQ("1", true, copy.isFieldIndexEnabled());
+		VASSERT("2", copy.findField(vmime::fields::ID_SUBJECT) != hdr.findField(vmime::fields::ID_SUBJECT));
+
+		copy.findField("X-Foo")->setName("Subject");
+
+		VASSERT_EQ("3", 2, copy.findAllFields(vmime::fields::ID_SUBJECT).size());
+		VASSERT_EQ("4", 1, hdr.findAllFields(vmime::fields::ID_SUBJECT).size());
+
+		vmime::header assigned;
+		assigned = copy;
+
+		VASSERT_EQ("5", true, assigned.isFieldIndexEnabled());
+
+		assigned.findField(vmime::fields::ID_SUBJECT)->setName("X-Bar");
+
+		VASSERT_EQ("6", 1, assigned.findAllFields(vmime::fields::ID_SUBJECT).size());
+		VASSERT_EQ("7", 2, copy.findAllFields(vmime::fields::ID_SUBJECT).size());
+	}
+
+	void testFieldIndexSharedField() {
+
+		vmime::shared_ptr <vmime::headerField> field =
+			vmime::headerFieldFactory::getInstance()->create("X-Foo", "f");
+
+		vmime::header hdr1;
+		hdr1.setFieldIndexEnabled(true);
+		hdr1.appendField(field);
+
+		{
+			vmime::header hdr2;
+			hdr2.setFieldIndexEnabled(true);
+			hdr2.appendField(field);
+
+			// Both headers index the renamed field
+			field->setName("Subject");
+
+			VASSERT("1", hdr1.findField(vmime::fields::ID_SUBJECT) == field);
+			VASSERT("2", hdr2.findField(vmime::fields::ID_SUBJECT) == field);
+		}
+
+		// The destroyed header is not notified anymore
+		field->setName("X-Bar");
+
+		VASSERT_EQ("3", false, hdr1.hasField(vmime::fields::ID_SUBJECT));
+	}
+
+	void testFindByUnknownId() {
+
+		findByUnknownId(/* indexed */ false);
+		findByUnknownId(/* indexed */ true);
+	}
+
+	static void findByUnknownId(const bool indexed) {
+
+		vmime::header hdr;
+		hdr.setFieldIndexEnabled(indexed);
+		hdr.parse("X-Foo: f\r\n");
+
+		VASSERT_THROW("find", hdr.findField(vmime::fields::ID_UNKNOWN), vmime::exceptions::invalid_argument);
+		VASSERT_THROW("has", hdr.hasField(vmime::fields::ID_UNKNOWN), vmime::exceptions::invalid_argument);
+		VASSERT_THROW("find all", hdr.findAllFields(vmime::fields::ID_UNKNOWN), vmime::exceptions::invalid_argument);
+		VASSERT_THROW("get", hdr.getField(vmime::fields::ID_UNKNOWN), vmime::exceptions::invalid_argument);
+
+		VASSERT_EQ("count", 1, hdr.getFieldCount());
+	}
+
+	void testRemoveAllFieldsByName() {
+
+		vmime::header hdr;
+		hdr.parse("A: a1\r\nB: b1\r\na: a2\r\nC: c1\r\nA: a3\r\n");
+
+		hdr.removeAllFields("A");
+
+		std::vector <vmime::shared_ptr <vmime::headerField> > res = hdr.getFieldList();
+
+		VASSERT_EQ("Count", 2, res.size());
+		VASSERT_EQ("First value", "B: b1", headerTest::getFieldValue(*res[0]));
+		VASSERT_EQ("Second value", "C: c1", headerTest::getFieldValue(*res[1]));
+	}
+
+	// parse from a seekable stream (header block is extracted alone)
+	void testParseFromStream() {
+
+		const char* const tests[][2] = {
+			{ "A: a\r\nB: b\r\n\r\nBODY\r\n\r\nC: c\r\n", "A: a\r\nB: b\r\n\r\n" },
+			{ "A: a\nB: b\n\nBODY\n\nC: c\n", "A: a\nB: b\n\n" },
+			{ "A: a\r\n b\r\n\r\nBODY", "A: a\r\n b\r\n\r\n" },
+			{ "\r\nA: a\r\n", "\r\n" },
+			{ "A: a\r\nB: b", "A: a\r\nB: b" }
+		};
+
+		for (size_t i = 0 ; i < sizeof(tests) / sizeof(tests[0]) ; ++i) {
+
+			const vmime::string data = vmime::string("PREFIX") + tests[i][0];
+			const vmime::string headerBlock = tests[i][1];
+
+			vmime::shared_ptr <vmime::utility::inputStreamStringAdapter> is =
+				vmime::make_shared <vmime::utility::inputStreamStringAdapter>(data);
+
+			vmime::header hdr1, hdr2;
+			size_t newPos1 = 0, newPos2 = 0;
+
+			hdr1.parse(is, 6, data.length(), &newPos1);
+			hdr2.parse(data, 6, data.length(), &newPos2);
+
+			std::ostringstream oss;
+			oss << "Test " << i;
+
+			VASSERT_EQ(oss.str() + ": new position", 6 + headerBlock.length(), newPos1);
+			VASSERT_EQ(oss.str() + ": same position", newPos2, newPos1);
+			VASSERT_EQ(oss.str() + ": count", hdr2.getFieldCount(), hdr1.getFieldCount());
+			VASSERT_EQ(oss.str() + ": generate", hdr2.generate(), hdr1.generate());
+		}
+	}
+
 VMIME_TEST_SUITE_END
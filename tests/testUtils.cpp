@@ -25,9 +25,14 @@
 
 #include "vmime/utility/stringUtils.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
+#if VMIME_HAVE_ZLIB_SUPPORT
+	#include <zlib.h>
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
 
 // Enable to output socket send/receive on standard output
 #define DEBUG_SOCKET_IN_OUT  0
@@ -36,6 +41,14 @@
 
 // testSocket
 
+testSocket::testSocket()
+	: m_port(0),
+	  m_connected(false),
+	  m_inBufferPos(0) {
+
+}
+
+
 void testSocket::connect(const vmime::string& address, const vmime::port_t port) {
 
 	m_address = address;
@@ -115,8 +128,10 @@ bool testSocket::waitForWrite(const int /* msecs */) {
 
 void testSocket::receive(vmime::string& buffer) {
 
-	buffer = m_inBuffer;
+	buffer.assign(m_inBuffer, m_inBufferPos, vmime::string::npos);
+
 	m_inBuffer.clear();
+	m_inBufferPos = 0;
 }
 
 
@@ -136,10 +151,16 @@ void testSocket::send(const char* str) {
 
 vmime::size_t testSocket::receiveRaw(vmime::byte_t* buffer, const size_t count) {
 
-	const size_t n = std::min(count, static_cast <size_t>(m_inBuffer.size()));
+	const size_t n = std::min(count, static_cast <size_t>(m_inBuffer.size() - m_inBufferPos));
+
+	std::copy(m_inBuffer.begin() + m_inBufferPos, m_inBuffer.begin() + m_inBufferPos + n, buffer);
+	m_inBufferPos += n;
 
-	std::copy(m_inBuffer.begin(), m_inBuffer.begin() + n, buffer);
-	m_inBuffer.erase(m_inBuffer.begin(), m_inBuffer.begin() + n);
+	if (m_inBufferPos == m_inBuffer.size()) {
+
+		m_inBuffer.clear();
+		m_inBufferPos = 0;
+	}
 
 	return  n;
 }
@@ -273,6 +294,122 @@ bool lineBasedTestSocket::haveMoreLines() const {
 }
 
 
+// testUnbufferedInputStream
+
+testUnbufferedInputStream::testUnbufferedInputStream(const vmime::string& data)
+	: m_data(data),
+	  m_pos(0) {
+
+}
+
+
+bool testUnbufferedInputStream::eof() const {
+
+	return m_pos >= m_data.length();
+}
+
+
+void testUnbufferedInputStream::reset() {
+
+	// Data cannot be read again
+}
+
+
+size_t testUnbufferedInputStream::read(vmime::byte_t* const data, const size_t count) {
+
+	const size_t n = std::min(count, m_data.length() - m_pos);
+
+	std::copy(m_data.begin() + m_pos, m_data.begin() + m_pos + n, data);
+	m_pos += n;
+
+	return n;
+}
+
+
+size_t testUnbufferedInputStream::skip(const size_t count) {
+
+	const size_t n = std::min(count, m_data.length() - m_pos);
+
+	m_pos += n;
+
+	return n;
+}
+
+
+#if VMIME_HAVE_ZLIB_SUPPORT
+
+// testDeflatePeer
+
+testDeflatePeer::testDeflatePeer()
+	: m_deflate(new z_stream),
+	  m_inflate(new z_stream) {
+
+	std::memset(m_deflate, 0, sizeof(z_stream));
+	std::memset(m_inflate, 0, sizeof(z_stream));
+
+	deflateInit2(m_deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+	inflateInit2(m_inflate, -15);
+}
+
+
+testDeflatePeer::~testDeflatePeer() {
+
+	deflateEnd(m_deflate);
+	inflateEnd(m_inflate);
+
+	delete m_deflate;
+	delete m_inflate;
+}
+
+
+const vmime::string testDeflatePeer::compress(const vmime::string& data) {
+
+	vmime::string out;
+	unsigned char buffer[4096];
+
+	m_deflate->next_in = reinterpret_cast <Bytef*>(const_cast <char*>(data.data()));
+	m_deflate->avail_in = static_cast <uInt>(data.length());
+
+	do {
+
+		m_deflate->next_out = buffer;
+		m_deflate->avail_out = sizeof(buffer);
+
+		deflate(m_deflate, Z_SYNC_FLUSH);
+
+		out.append(reinterpret_cast <char*>(buffer), sizeof(buffer) - m_deflate->avail_out);
+
+	} while (m_deflate->avail_out == 0);
+
+	return out;
+}
+
+
+const vmime::string testDeflatePeer::decompress(const vmime::string& data) {
+
+	vmime::string out;
+	unsigned char buffer[4096];
+
+	m_inflate->next_in = reinterpret_cast <Bytef*>(const_cast <char*>(data.data()));
+	m_inflate->avail_in = static_cast <uInt>(data.length());
+
+	do {
+
+		m_inflate->next_out = buffer;
+		m_inflate->avail_out = sizeof(buffer);
+
+		inflate(m_inflate, Z_SYNC_FLUSH);
+
+		out.append(reinterpret_cast <char*>(buffer), sizeof(buffer) - m_inflate->avail_out);
+
+	} while (m_inflate->avail_out == 0);
+
+	return out;
+}
+
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
+
 // testTimeoutHandler
 
 testTimeoutHandler::testTimeoutHandler(const unsigned long delay)
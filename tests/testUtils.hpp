@@ -261,6 +261,8 @@ class testSocket : public vmime::net::socket {
 
 public:
 
+	testSocket();
+
 	void connect(const vmime::string& address, const vmime::port_t port);
 	void disconnect();
 
@@ -333,6 +335,7 @@ private:
 	bool m_connected;
 
 	vmime::string m_inBuffer;
+	vmime::size_t m_inBufferPos;  // data before this has been received by client
 	vmime::string m_outBuffer;
 };
 
@@ -399,6 +402,86 @@ public:
 };
 
 
+/** Input stream which can only be read once, like data received
+  * from a socket: reset() has no effect.
+  */
+class testUnbufferedInputStream : public vmime::utility::inputStream {
+
+public:
+
+	testUnbufferedInputStream(const vmime::string& data);
+
+	bool eof() const;
+	void reset();
+	size_t read(vmime::byte_t* const data, const size_t count);
+	size_t skip(const size_t count);
+
+private:
+
+	const vmime::string m_data;
+	size_t m_pos;
+};
+
+
+/** Create a store whose connections are made to a test server,
+  * implemented by the socket class SOCKET (see testSocketFactory).
+  *
+  * @param sess session in which to create the store
+  * @param url URL of the store (eg. "imap://localhost")
+  * @return new store, not connected
+  */
+template <typename SOCKET>
+vmime::shared_ptr <vmime::net::store> createTestStore(
+	const vmime::shared_ptr <vmime::net::session>& sess,
+	const vmime::string& url
+) {
+
+	vmime::shared_ptr <vmime::net::store> store = sess->getStore(vmime::utility::url(url));
+
+	store->setSocketFactory(vmime::make_shared <testSocketFactory <SOCKET> >());
+	store->setTimeoutHandlerFactory(vmime::make_shared <testTimeoutHandlerFactory>());
+
+	return store;
+}
+
+
+#if VMIME_HAVE_ZLIB_SUPPORT
+
+struct z_stream_s;
+
+
+/** Peer side of a compressed connection (raw DEFLATE, as in RFC-4978).
+  */
+class testDeflatePeer {
+
+public:
+
+	testDeflatePeer();
+	~testDeflatePeer();
+
+	/** Compress data to be sent to the client. Output is flushed.
+	  *
+	  * @param data data to compress
+	  * @return compressed data
+	  */
+	const vmime::string compress(const vmime::string& data);
+
+	/** Decompress data received from the client.
+	  *
+	  * @param data compressed data
+	  * @return decompressed data
+	  */
+	const vmime::string decompress(const vmime::string& data);
+
+private:
+
+	z_stream_s* m_deflate;
+	z_stream_s* m_inflate;
+};
+
+#endif // VMIME_HAVE_ZLIB_SUPPORT
+
+
 // Exception helper
 std::ostream& operator<<(std::ostream& os, const vmime::exception& e);
 
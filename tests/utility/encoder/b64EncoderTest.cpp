@@ -25,11 +25,21 @@
 
 #include "encoderTestUtils.hpp"
 
+#include "vmime/utility/encoder/b64Kernels.hpp"
+
 
 VMIME_TEST_SUITE_BEGIN(b64EncoderTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testBase64)
+		VMIME_TEST(testBase64_Stream)
+		VMIME_TEST(testBase64_StreamChain)
+		VMIME_TEST(testBase64_LargeData)
+		VMIME_TEST(testBase64_InvalidInput)
+		VMIME_TEST(testBase64_KernelEncode)
+		VMIME_TEST(testBase64_KernelDecode)
+		VMIME_TEST(testBase64_BenchmarkEncode)
+		VMIME_TEST(testBase64_BenchmarkDecode)
 	VMIME_TEST_LIST_END
 
 
@@ -165,4 +175,295 @@ VMIME_TEST_SUITE_BEGIN(b64EncoderTest)
 		}
 	}
 
+	void testBase64_Stream() {
+
+		vmime::string data;
+
+		for (int i = 0 ; i < 1000 ; ++i) {
+			data += static_cast <char>((i * 7) & 0xff);
+		}
+
+		static const size_t blockSizes[] = { 1, 2, 3, 4, 7, 57, 100, 4096 };
+
+		const vmime::string expected = encode("base64", data, 76);
+
+		for (unsigned int i = 0 ; i < sizeof(blockSizes) / sizeof(blockSizes[0]) ; ++i) {
+
+			std::ostringstream oss;
+			oss << "Block size " << blockSizes[i] << ": ";
+
+			VASSERT_EQ(oss.str() + "encoding", expected, encodeStream("base64", data, blockSizes[i], 76));
+			VASSERT_EQ(oss.str() + "decoding", data, decodeStream("base64", expected, blockSizes[i]));
+		}
+
+		VASSERT_EQ("padding.1", "QQ==", encodeStream("base64", "A", 1));
+		VASSERT_EQ("padding.2", "QUI=", encodeStream("base64", "AB", 1));
+		VASSERT_EQ("padding.3", "AB", decodeStream("base64", "QUI=QUJD", 1));
+	}
+
+	void testBase64_StreamChain() {
+
+		// Re-encode quoted-printable data to Base64
+		const vmime::string data = "Caf=C3=A9 cr=C3=A8me=\r\n br=C3=BBl=C3=A9e";
+
+		std::ostringstream out;
+		vmime::utility::outputStreamAdapter vout(out);
+
+		vmime::shared_ptr <vmime::utility::encoder::encoder> enc = getEncoder("base64");
+		vmime::shared_ptr <vmime::utility::encoder::encoder> dec = getEncoder("quoted-printable");
+
+		vmime::shared_ptr <vmime::utility::filteredOutputStream> encStream =
+			enc->getEncodingFilteredOutputStream(vout);
+		vmime::shared_ptr <vmime::utility::filteredOutputStream> decStream =
+			dec->getDecodingFilteredOutputStream(*encStream);
+
+		for (size_t i = 0 ; i < data.length() ; ++i) {
+			decStream->write(data.data() + i, 1);
+		}
+
+		decStream->flush();
+
+		VASSERT_EQ("1", encode("base64", decode("quoted-printable", data)), out.str());
+	}
+
+	void testBase64_LargeData() {
+
+		// Larger than the internal output buffer, so that block kernels
+		// have to flush in the middle of a line
+		vmime::string data;
+
+		for (int i = 0 ; i < 100000 ; ++i) {
+			data += static_cast <char>((i * 31 + (i >> 8)) & 0xff);
+		}
+
+		static const int lineLengths[] = { 0, 4, 7, 76, 1000 };
+
+		for (unsigned int i = 0 ; i < sizeof(lineLengths) / sizeof(lineLengths[0]) ; ++i) {
+
+			std::ostringstream oss;
+			oss << "Line length " << lineLengths[i] << ": ";
+
+			const vmime::string encoded = encode("base64", data, lineLengths[i]);
+
+			VASSERT_EQ(oss.str() + "decode", data, decode("base64", encoded));
+			VASSERT_EQ(oss.str() + "stream", encoded, encodeStream("base64", data, 5000, lineLengths[i]));
+
+			if (lineLengths[i] == 0) {
+				continue;
+			}
+
+			// All lines but the last one have the same length, and all
+			// of them fit the limit (CRLF included)
+			size_t lineLength = vmime::string::npos;
+			size_t pos = 0;
+
+			for (size_t end ; (end = encoded.find("\r\n", pos)) != vmime::string::npos ; pos = end + 2) {
+
+				if (lineLength == vmime::string::npos) {
+					lineLength = end - pos;
+				}
+
+				VASSERT_EQ(oss.str() + "length", lineLength, end - pos);
+				VASSERT(oss.str() + "limit", end - pos + 2 <= static_cast <size_t>(std::max(lineLengths[i], 6)));
+			}
+
+			VASSERT(oss.str() + "last", encoded.length() - pos <= lineLength);
+		}
+	}
+
+	void testBase64_InvalidInput() {
+
+		// Whitespace is skipped
+		VASSERT_EQ("1", "ABCDEF", decode("base64", "QU JD\r\nRE\tVG"));
+
+		// Characters outside the alphabet decode as in previous releases
+		VASSERT_EQ("2", "\x41\x42\x43\xfc\x45\x46", decode("base64", "QUJD!EVG"));
+		VASSERT_EQ("3", "\x41\x4f\xc3\x44\x45\x46", decode("base64", "QU*DREVG"));
+		VASSERT_EQ("4", "\xff\xf4\x14", decode("base64", "\xc3\xa9QUJD"));
+
+		// Padding ends the data
+		VASSERT_EQ("5", "ABC", decode("base64", "QUJDR=VGSElK"));
+		VASSERT_EQ("6", "ABCDEFH", decode("base64", "QUJDREVGSE=K"));
+		VASSERT_EQ("7", "ABCDEF", decode("base64", "QUJDREVG=QUJD"));
+
+		// Incomplete trailing group is dropped
+		VASSERT_EQ("8", "ABC", decode("base64", "QUJDRE"));
+	}
+
+	// SIMD kernels must give the same results as the scalar kernel
+
+	typedef vmime::utility::encoder::b64Kernels b64Kernels;
+
+	static const std::vector <b64Kernels::Kernel> getSupportedKernels() {
+
+		std::vector <b64Kernels::Kernel> kernels;
+
+		if (b64Kernels::isKernelSupported(b64Kernels::KERNEL_SSSE3)) {
+			kernels.push_back(b64Kernels::KERNEL_SSSE3);
+		}
+
+		if (b64Kernels::isKernelSupported(b64Kernels::KERNEL_AVX2)) {
+			kernels.push_back(b64Kernels::KERNEL_AVX2);
+		}
+
+		return kernels;
+	}
+
+	void testBase64_KernelEncode() {
+
+		VASSERT_TRUE("default", b64Kernels::isKernelSupported(b64Kernels::getDefaultKernel()));
+
+		const std::vector <b64Kernels::Kernel> kernels = getSupportedKernels();
+
+		std::vector <vmime::byte_t> data(3 * 100);
+
+		for (size_t i = 0 ; i < data.size() ; ++i) {
+			data[i] = static_cast <vmime::byte_t>((i * 167 + (i >> 3)) & 0xff);
+		}
+
+		for (size_t count = 0 ; count <= 100 ; ++count) {
+
+			std::vector <vmime::byte_t> expected(count * 4 + 1, 0xaa);
+			b64Kernels::encode(b64Kernels::KERNEL_SCALAR, &data[0], count, &expected[0]);
+
+			for (size_t k = 0 ; k < kernels.size() ; ++k) {
+
+				std::ostringstream oss;
+				oss << "Kernel " << kernels[k] << ", " << count << " groups";
+
+				// The byte after the output must not be touched
+				std::vector <vmime::byte_t> out(count * 4 + 1, 0xaa);
+				b64Kernels::encode(kernels[k], &data[0], count, &out[0]);
+
+				VASSERT_TRUE(oss.str(), out == expected);
+			}
+		}
+
+		// All 6-bit values, at every position in a group
+		std::vector <vmime::byte_t> values(3 * 64);
+
+		for (size_t i = 0 ; i < 64 ; ++i) {
+			values[i * 3] = static_cast <vmime::byte_t>(i << 2);
+			values[i * 3 + 1] = static_cast <vmime::byte_t>((i << 4) | (i >> 2));
+			values[i * 3 + 2] = static_cast <vmime::byte_t>((i << 6) | i);
+		}
+
+		std::vector <vmime::byte_t> expected(64 * 4);
+		b64Kernels::encode(b64Kernels::KERNEL_SCALAR, &values[0], 64, &expected[0]);
+
+		for (size_t k = 0 ; k < kernels.size() ; ++k) {
+
+			std::vector <vmime::byte_t> out(64 * 4);
+			b64Kernels::encode(kernels[k], &values[0], 64, &out[0]);
+
+			VASSERT_TRUE("alphabet", out == expected);
+		}
+	}
+
+	void testBase64_KernelDecode() {
+
+		const std::vector <b64Kernels::Kernel> kernels = getSupportedKernels();
+
+		// Every character of the alphabet, in various positions
+		static const char alphabet[] =
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		std::vector <vmime::byte_t> data(4 * 100);
+
+		for (size_t i = 0 ; i < data.size() ; ++i) {
+			data[i] = alphabet[(i * 7 + (i >> 6)) % 64];
+		}
+
+		// Characters which must stop decoding
+		static const char invalid[] = { ' ', '\r', '\n', '=', '-', '@', '[', '`', '{', ':', '\x80', '\xff' };
+
+		for (size_t count = 0 ; count <= 100 ; count += (count < 40 ? 1 : 7)) {
+
+			// -1 means no invalid character
+			for (int invalidPos = -1 ; invalidPos < static_cast <int>(count * 4) ; invalidPos += 5) {
+
+				std::vector <vmime::byte_t> in(data.begin(), data.begin() + count * 4);
+
+				if (invalidPos >= 0) {
+					in[invalidPos] = invalid[invalidPos % sizeof(invalid)];
+				}
+
+				std::vector <vmime::byte_t> expected(count * 3 + 1, 0xaa);
+				const size_t expectedGroups = b64Kernels::decode
+					(b64Kernels::KERNEL_SCALAR, in.empty() ? NULL : &in[0], count, &expected[0]);
+
+				VASSERT_EQ("scalar", invalidPos < 0 ? count : invalidPos / 4, expectedGroups);
+
+				for (size_t k = 0 ; k < kernels.size() ; ++k) {
+
+					std::ostringstream oss;
+					oss << "Kernel " << kernels[k] << ", " << count << " groups, invalid at " << invalidPos;
+
+					std::vector <vmime::byte_t> out(count * 3 + 1, 0xaa);
+					const size_t groups = b64Kernels::decode
+						(kernels[k], in.empty() ? NULL : &in[0], count, &out[0]);
+
+					VASSERT_EQ(oss.str() + ": groups", expectedGroups, groups);
+					VASSERT_TRUE(oss.str() + ": data", std::equal(out.begin(), out.begin() + groups * 3, expected.begin()));
+					VASSERT_EQ(oss.str() + ": end", 0xaa, out[count * 3]);
+				}
+			}
+		}
+	}
+
+	// Throughput benchmarks: the test runner reports the duration of
+	// each test, for BENCHMARK_SIZE bytes of binary data
+
+	static const size_t BENCHMARK_SIZE = 8 * 1024 * 1024;
+
+	static const vmime::string buildBenchmarkData() {
+
+		vmime::string data;
+		data.reserve(BENCHMARK_SIZE);
+
+		for (size_t i = 0 ; i < BENCHMARK_SIZE ; ++i) {
+			data += static_cast <char>((i * 31 + (i >> 8)) & 0xff);
+		}
+
+		return data;
+	}
+
+	void testBase64_BenchmarkEncode() {
+
+		const vmime::string data = buildBenchmarkData();
+
+		vmime::shared_ptr <vmime::utility::encoder::encoder> enc = getEncoder("base64", 76);
+
+		vmime::utility::inputStreamStringAdapter vin(data);
+
+		vmime::string encoded;
+		encoded.reserve(data.length() * 4 / 3 + data.length() / 38 + 4);
+
+		vmime::utility::outputStreamStringAdapter vout(encoded);
+
+		enc->encode(vin, vout);
+
+		// Lines of 72 characters (54 bytes), separated by CRLF
+		VASSERT_EQ("length", (BENCHMARK_SIZE + 2) / 3 * 4 + ((BENCHMARK_SIZE + 53) / 54 - 1) * 2, encoded.length());
+	}
+
+	void testBase64_BenchmarkDecode() {
+
+		const vmime::string data = buildBenchmarkData();
+		const vmime::string encoded = encode("base64", data, 76);
+
+		vmime::shared_ptr <vmime::utility::encoder::encoder> enc = getEncoder("base64", 76);
+
+		vmime::utility::inputStreamStringAdapter vin(encoded);
+
+		vmime::string decoded;
+		decoded.reserve(data.length());
+
+		vmime::utility::outputStreamStringAdapter vout(decoded);
+
+		enc->decode(vin, vout);
+
+		VASSERT_TRUE("decode", decoded == data);
+	}
+
 VMIME_TEST_SUITE_END
@@ -80,3 +80,57 @@ static const vmime::string decode(
 
 	return (out.str());
 }
+
+
+// Encoding helper function, using a filtered output stream and
+// writing data in blocks of the specified size
+static const vmime::string encodeStream(
+	const vmime::string& name,
+	const vmime::string& in,
+	const size_t blockSize,
+	int maxLineLength = 0,
+	const vmime::propertySet props = vmime::propertySet()
+) {
+
+	vmime::shared_ptr <vmime::utility::encoder::encoder> enc = getEncoder(name, maxLineLength, props);
+
+	std::ostringstream out;
+	vmime::utility::outputStreamAdapter vout(out);
+
+	vmime::shared_ptr <vmime::utility::filteredOutputStream> fout =
+		enc->getEncodingFilteredOutputStream(vout);
+
+	for (size_t pos = 0 ; pos < in.length() ; pos += blockSize) {
+		fout->write(in.data() + pos, std::min(blockSize, in.length() - pos));
+	}
+
+	fout->flush();
+
+	return (out.str());
+}
+
+
+// Decoding helper function, using a filtered output stream and
+// writing data in blocks of the specified size
+static const vmime::string decodeStream(
+	const vmime::string& name,
+	const vmime::string& in,
+	const size_t blockSize
+) {
+
+	vmime::shared_ptr <vmime::utility::encoder::encoder> enc = getEncoder(name);
+
+	std::ostringstream out;
+	vmime::utility::outputStreamAdapter vout(out);
+
+	vmime::shared_ptr <vmime::utility::filteredOutputStream> fout =
+		enc->getDecodingFilteredOutputStream(vout);
+
+	for (size_t pos = 0 ; pos < in.length() ; pos += blockSize) {
+		fout->write(in.data() + pos, std::min(blockSize, in.length() - pos));
+	}
+
+	fout->flush();
+
+	return (out.str());
+}
@@ -35,6 +35,8 @@ VMIME_TEST_SUITE_BEGIN(qpEncoderTest)
 		VMIME_TEST(testQuotedPrintable_HardLineBreakDecode)
 		VMIME_TEST(testQuotedPrintable_CRLF)
 		VMIME_TEST(testQuotedPrintable_RFC2047)
+		VMIME_TEST(testQuotedPrintable_Stream)
+		VMIME_TEST(testQuotedPrintable_LiteralRuns)
 	VMIME_TEST_LIST_END
 
 
@@ -272,4 +274,106 @@ VMIME_TEST_SUITE_BEGIN(qpEncoderTest)
 		VASSERT_EQ("especials.12", "=22", encode("quoted-printable", "\"", 10, encProps));
 	}
 
+	void testQuotedPrintable_Stream() {
+
+		vmime::string data =
+			"Now's the time for all folk  \r\n"
+			".to come to the aid of their country. \r\n"
+			"\tCaf\xc3\xa9 = 1 + 2 ? \n \x01\xff ";
+
+		for (int i = 0 ; i < 3 ; ++i) {
+			data += data;
+		}
+
+		static const size_t blockSizes[] = { 1, 2, 3, 5, 29, 100, 4096 };
+
+		vmime::propertySet textProps;
+		textProps["text"] = true;
+
+		vmime::propertySet rfc2047Props;
+		rfc2047Props["rfc2047"] = true;
+
+		const vmime::string expectedBinary = encode("quoted-printable", data, 76);
+		const vmime::string expectedText = encode("quoted-printable", data, 76, textProps);
+		const vmime::string expectedRFC2047 = encode("quoted-printable", data, 0, rfc2047Props);
+
+		for (unsigned int i = 0 ; i < sizeof(blockSizes) / sizeof(blockSizes[0]) ; ++i) {
+
+			std::ostringstream oss;
+			oss << "Block size " << blockSizes[i] << ": ";
+
+			VASSERT_EQ(
+				oss.str() + "binary",
+				expectedBinary,
+				encodeStream("quoted-printable", data, blockSizes[i], 76)
+			);
+
+			VASSERT_EQ(
+				oss.str() + "text",
+				expectedText,
+				encodeStream("quoted-printable", data, blockSizes[i], 76, textProps)
+			);
+
+			VASSERT_EQ(
+				oss.str() + "rfc2047",
+				expectedRFC2047,
+				encodeStream("quoted-printable", data, blockSizes[i], 0, rfc2047Props)
+			);
+
+			VASSERT_EQ(
+				oss.str() + "decoding",
+				data,
+				decodeStream("quoted-printable", expectedBinary, blockSizes[i])
+			);
+
+			VASSERT_EQ(
+				oss.str() + "decoding text",
+				decode("quoted-printable", expectedText),
+				decodeStream("quoted-printable", expectedText, blockSizes[i])
+			);
+		}
+	}
+
+	void testQuotedPrintable_LiteralRuns() {
+
+		vmime::propertySet rfc2047Props;
+		rfc2047Props["rfc2047"] = true;
+
+		// Runs of literal characters are cut by soft line breaks
+		VASSERT_EQ(
+			"1",
+			"=2E.=\r\nabcd=\r\nefgh=\r\nij.k=\r\nlm",
+			encode("quoted-printable", "..abcdefghij.klm", 5)
+		);
+
+		// No soft line breaks in RFC-2047 mode
+		VASSERT_EQ(
+			"2",
+			"abcdefghijkl_mnop=3Dqrst",
+			encode("quoted-printable", "abcdefghijkl mnop=qrst", 10, rfc2047Props)
+		);
+
+		VASSERT_EQ(
+			"3",
+			"abc=2Edef_ghi=5Fjkl",
+			encode("quoted-printable", "abc.def ghi_jkl", 5, rfc2047Props)
+		);
+
+		// Encoded sequences between runs of literal characters
+		VASSERT_EQ("4", "ab", decode("quoted-printable", "ab=4"));
+		VASSERT_EQ("5", "abcdefA", decode("quoted-printable", "ab=\rXcd=\nef=41="));
+
+		vmime::shared_ptr <vmime::utility::encoder::encoder> dec =
+			getEncoder("quoted-printable", 0, rfc2047Props);
+
+		vmime::utility::inputStreamStringAdapter in("a_b=5F_c");
+
+		vmime::string out;
+		vmime::utility::outputStreamStringAdapter os(out);
+
+		dec->decode(in, os);
+
+		VASSERT_EQ("6", "a b_ c", out);
+	}
+
 VMIME_TEST_SUITE_END
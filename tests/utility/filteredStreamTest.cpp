@@ -38,6 +38,11 @@ VMIME_TEST_SUITE_BEGIN(filteredStreamTest)
 		VMIME_TEST(testStopSequenceFilteredInputStreamN_3)
 		VMIME_TEST(testLFToCRLFFilteredOutputStream_Global)
 		VMIME_TEST(testLFToCRLFFilteredOutputStream_Edge)
+		VMIME_TEST(testSMTPDataFilteredOutputStream)
+		VMIME_TEST(testSMTPDataFilteredOutputStream_LongLines)
+		VMIME_TEST(testSMTPDataFilteredOutputStream_NoNormalization)
+		VMIME_TEST(testSMTPDataFilteredOutputStream_Benchmark)
+		VMIME_TEST(testDotLFToCRLFFilteredOutputStreamChain_Benchmark)
 	VMIME_TEST_LIST_END
 
 
@@ -164,6 +169,8 @@ VMIME_TEST_SUITE_BEGIN(filteredStreamTest)
 		if (!c3.empty()) fos.write(c3.data(), c3.length());
 		if (!c4.empty()) fos.write(c4.data(), c4.length());
 
+		fos.flush();
+
 		VASSERT_EQ(number, expected, oss.str());
 	}
 
@@ -338,4 +345,169 @@ VMIME_TEST_SUITE_BEGIN(filteredStreamTest)
 		testFilteredOutputStreamHelper<FILTER>("11", "\r\nA\r\nB\r\nC\r\nD\r\n", "\nA\rB", "\nC\r\nD\r");
 	}
 
+	void testSMTPDataFilteredOutputStream() {
+
+		typedef vmime::utility::SMTPDataFilteredOutputStream FILTER;
+
+		// Dot-stuffing
+		testFilteredOutputStreamHelper<FILTER>("1",  "foo\r\n..bar", "foo\r\n.bar");
+		testFilteredOutputStreamHelper<FILTER>("2",  "foo\r\n..bar", "foo\r\n", ".bar");
+		testFilteredOutputStreamHelper<FILTER>("3",  "foo\r\n..bar", "foo\r", "\n.bar");
+		testFilteredOutputStreamHelper<FILTER>("4",  "foo\r\n..bar", "foo", "\r\n", ".", "bar");
+		testFilteredOutputStreamHelper<FILTER>("5",  "..foobar", ".foobar");
+		testFilteredOutputStreamHelper<FILTER>("6",  "..\r\n", ".", "\r\n");
+		testFilteredOutputStreamHelper<FILTER>("7",  "foo.\r\nbar.", "foo.", "\r\n", "bar.");
+		testFilteredOutputStreamHelper<FILTER>("8",  "a\r\n...\r\n", "a\r\n..\r\n");
+
+		// Line endings
+		testFilteredOutputStreamHelper<FILTER>("9",  "foo\r\n..bar", "foo\n.bar");
+		testFilteredOutputStreamHelper<FILTER>("10", "foo\r\n..bar", "foo\r.bar");
+		testFilteredOutputStreamHelper<FILTER>("11", "\r\n\r\n", "\r", "\r");
+		testFilteredOutputStreamHelper<FILTER>("12", "\r\n\r\n", "\n", "\n");
+		testFilteredOutputStreamHelper<FILTER>("13", "\r\n\r\n", "\r\n\r", "\n");
+		testFilteredOutputStreamHelper<FILTER>("14", "A\r\nB\r\nC\r\nD", "A\rB", "\nC\r\nD");
+		testFilteredOutputStreamHelper<FILTER>("15", "\r\n..\r\n..", "\n.\n.");
+	}
+
+	void testSMTPDataFilteredOutputStream_LongLines() {
+
+		// Lines longer than the vector width and the internal buffer
+		const std::string line1(40, 'x');
+		const std::string line2(20000, 'y');
+
+		std::ostringstream oss;
+		vmime::utility::outputStreamAdapter os(oss);
+
+		vmime::utility::SMTPDataFilteredOutputStream fos(os);
+
+		const std::string input = line1 + "\n." + line2 + "\n" + line1 + "\r\n";
+		fos.write(input.data(), input.length());
+		fos.flush();
+
+		VASSERT_EQ("Long lines", line1 + "\r\n.." + line2 + "\r\n" + line1 + "\r\n", oss.str());
+	}
+
+	// SMTP DATA filter for data with line breaks already formatted
+	class SMTPDataNoNormalizationFilteredOutputStream
+		: public vmime::utility::SMTPDataFilteredOutputStream {
+
+	public:
+
+		SMTPDataNoNormalizationFilteredOutputStream(vmime::utility::outputStream& os)
+			: vmime::utility::SMTPDataFilteredOutputStream(os, /* normalizeLineBreaks */ false) {
+
+		}
+	};
+
+	void testSMTPDataFilteredOutputStream_NoNormalization() {
+
+		typedef SMTPDataNoNormalizationFilteredOutputStream FILTER;
+
+		testFilteredOutputStreamHelper<FILTER>("1", "foo\n..bar", "foo\n.bar");
+		testFilteredOutputStreamHelper<FILTER>("2", "foo\r\n..bar", "foo\r", "\n", ".bar");
+		testFilteredOutputStreamHelper<FILTER>("3", "..foo\rbar\r.", ".foo\rbar\r.");
+		testFilteredOutputStreamHelper<FILTER>("4", "\n\n..\n", "\n", "\n.", "\n");
+		testFilteredOutputStreamHelper<FILTER>("5", "a\n..\r\n\n..", "a\n.\r\n", "\n.");
+	}
+
+	// Throughput benchmarks: the test runner reports the duration of each
+	// test, for BENCHMARK_SIZE bytes of text written in BENCHMARK_CHUNK_SIZE
+	// chunks through the fused filter and through the chain of filters
+
+	static const size_t BENCHMARK_SIZE = 16 * 1024 * 1024;
+	static const size_t BENCHMARK_CHUNK_SIZE = 8192;
+
+	static const std::string buildBenchmarkData() {
+
+		std::string data;
+		data.reserve(BENCHMARK_SIZE);
+
+		for (size_t i = 0 ; data.length() < BENCHMARK_SIZE ; ++i) {
+
+			// Lines of varying length with LF line endings, some of
+			// which start with a dot
+			if (i % 16 == 1) {
+				data += '.';
+			}
+
+			data.append(20 + (i * 7) % 57, static_cast <char>('a' + i % 26));
+			data += '\n';
+		}
+
+		data.resize(BENCHMARK_SIZE);
+
+		return data;
+	}
+
+	static void writeBenchmarkData(const std::string& data, vmime::utility::outputStream& os) {
+
+		for (size_t pos = 0 ; pos < data.length() ; pos += BENCHMARK_CHUNK_SIZE) {
+			os.write(data.data() + pos, std::min(BENCHMARK_CHUNK_SIZE, data.length() - pos));
+		}
+	}
+
+	void testSMTPDataFilteredOutputStream_Benchmark() {
+
+		const std::string data = buildBenchmarkData();
+
+		vmime::string out;
+		out.reserve(BENCHMARK_SIZE * 2);
+
+		vmime::utility::outputStreamStringAdapter os(out);
+		vmime::utility::SMTPDataFilteredOutputStream fos(os);
+
+		writeBenchmarkData(data, fos);
+		fos.flush();
+
+		VASSERT_EQ("Output", referenceFilter(data), out);
+	}
+
+	void testDotLFToCRLFFilteredOutputStreamChain_Benchmark() {
+
+		const std::string data = buildBenchmarkData();
+
+		vmime::string out;
+		out.reserve(BENCHMARK_SIZE * 2);
+
+		vmime::utility::outputStreamStringAdapter os(out);
+		vmime::utility::dotFilteredOutputStream dos(os);
+		vmime::utility::LFToCRLFFilteredOutputStream fos(dos);
+
+		writeBenchmarkData(data, fos);
+		fos.flush();
+		dos.flush();
+
+		VASSERT_EQ("Output", referenceFilter(data), out);
+	}
+
+	// Expected output for the benchmark data: LF becomes CRLF, and a dot
+	// is doubled at the start of each line
+	static const std::string referenceFilter(const std::string& data) {
+
+		std::string res;
+		res.reserve(data.length() * 2);
+
+		bool startOfLine = true;
+
+		for (size_t i = 0 ; i < data.length() ; ++i) {
+
+			if (data[i] == '\n') {
+
+				res += "\r\n";
+				startOfLine = true;
+
+			} else {
+
+				if (startOfLine && data[i] == '.') {
+					res += '.';
+				}
+
+				res += data[i];
+				startOfLine = false;
+			}
+		}
+
+		return res;
+	}
+
 VMIME_TEST_SUITE_END
@@ -0,0 +1,190 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/utility/mappedFileInputStream.hpp"
+#include "vmime/utility/stringUtils.hpp"
+
+
+VMIME_TEST_SUITE_BEGIN(mappedFileInputStreamTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testRead)
+		VMIME_TEST(testSeekAndSkip)
+		VMIME_TEST(testGetDirectBuffer)
+		VMIME_TEST(testEmptyFile)
+		VMIME_TEST(testFileNotFound)
+		VMIME_TEST(testParseMessage)
+	VMIME_TEST_LIST_END
+
+
+	vmime::shared_ptr <vmime::utility::file> testFile;
+	vmime::string testFilePath;
+
+
+	void setUp() {
+
+		std::ostringstream oss;
+		oss << "/tmp/vmime_test_" << (rand() % 999999999);
+
+		testFilePath = oss.str();
+
+		vmime::shared_ptr <vmime::utility::fileSystemFactory> fsf =
+			vmime::platform::getHandler()->getFileSystemFactory();
+
+		testFile = fsf->create(fsf->stringToPath(testFilePath));
+		testFile->createFile();
+	}
+
+	void tearDown() {
+
+		testFile->remove();
+		testFile = vmime::null;
+	}
+
+	void writeTestFile(const vmime::string& data) {
+
+		vmime::shared_ptr <vmime::utility::outputStream> os =
+			testFile->getFileWriter()->getOutputStream();
+
+		os->write(data.data(), data.length());
+		os->flush();
+	}
+
+
+	void testRead() {
+
+		writeTestFile("THIS IS A TEST BUFFER");
+
+		vmime::utility::mappedFileInputStream stream(testFilePath);
+
+		VASSERT_EQ("Pos", 0, stream.getPosition());
+		VASSERT_FALSE("EOF", stream.eof());
+
+		vmime::byte_t buffer[100];
+
+		VASSERT_EQ("Read 1", 4, stream.read(buffer, 4));
+		VASSERT_EQ("Data 1", "THIS", vmime::utility::stringUtils::makeStringFromBytes(buffer, 4));
+		VASSERT_EQ("Read 2", 17, stream.read(buffer, 100));
+		VASSERT_EQ("Data 2", " IS A TEST BUFFER", vmime::utility::stringUtils::makeStringFromBytes(buffer, 17));
+		VASSERT_TRUE("EOF 2", stream.eof());
+		VASSERT_EQ("Read 3", 0, stream.read(buffer, 100));
+
+		stream.reset();
+
+		VASSERT_EQ("Pos 2", 0, stream.getPosition());
+		VASSERT_FALSE("EOF 3", stream.eof());
+	}
+
+	void testSeekAndSkip() {
+
+		writeTestFile("THIS IS A TEST BUFFER");
+
+		vmime::utility::mappedFileInputStream stream(testFilePath);
+
+		stream.seek(10);
+
+		VASSERT_EQ("Pos 1", 10, stream.getPosition());
+		VASSERT_EQ("Skip 1", 5, stream.skip(5));
+		VASSERT_EQ("Pos 2", 15, stream.getPosition());
+		VASSERT_EQ("Skip 2", 6, stream.skip(100));
+		VASSERT_EQ("Pos 3", 21, stream.getPosition());
+		VASSERT_TRUE("EOF", stream.eof());
+	}
+
+	void testGetDirectBuffer() {
+
+		writeTestFile("THIS IS A TEST BUFFER");
+
+		vmime::utility::mappedFileInputStream stream(testFilePath);
+
+		size_t length = 0;
+		const vmime::byte_t* buffer = stream.getDirectBuffer(&length);
+
+		VASSERT_NOT_NULL("Buffer", buffer);
+		VASSERT_EQ("Length", 21, length);
+		VASSERT_EQ("Data", "THIS IS A TEST BUFFER", vmime::utility::stringUtils::makeStringFromBytes(buffer, length));
+	}
+
+	void testEmptyFile() {
+
+		vmime::utility::mappedFileInputStream stream(testFilePath);
+
+		vmime::byte_t buffer[10];
+
+		VASSERT_TRUE("EOF", stream.eof());
+		VASSERT_EQ("Read", 0, stream.read(buffer, 10));
+	}
+
+	void testFileNotFound() {
+
+		VASSERT_THROW(
+			"Not found",
+			vmime::utility::mappedFileInputStream(testFilePath + "-not-found"),
+			vmime::exceptions::filesystem_exception
+		);
+	}
+
+	void testParseMessage() {
+
+		writeTestFile(
+			"From: me@vmime.org\r\n"
+			"Subject: Test\r\n"
+			"Content-Type: multipart/mixed; boundary=\"BOUNDARY\"\r\n"
+			"\r\n"
+			"--BOUNDARY\r\n"
+			"Content-Type: text/plain\r\n"
+			"\r\n"
+			"BODY1\r\n"
+			"--BOUNDARY\r\n"
+			"\r\n"
+			"BODY2\r\n"
+			"--BOUNDARY--\r\n"
+		);
+
+		vmime::shared_ptr <vmime::utility::mappedFileInputStream> stream =
+			vmime::make_shared <vmime::utility::mappedFileInputStream>(testFilePath);
+
+		size_t length = 0;
+		stream->getDirectBuffer(&length);
+
+		vmime::message msg;
+		msg.parse(stream, length);
+
+		VASSERT_EQ("Subject", "Test", msg.getHeader()->Subject()->getValue <vmime::text>()->getWholeBuffer());
+		VASSERT_EQ("Count", 2, msg.getBody()->getPartCount());
+
+		vmime::shared_ptr <const vmime::contentHandler> cts =
+			msg.getBody()->getPartAt(1)->getBody()->getContents();
+
+		VASSERT("Stream", vmime::dynamicCast <const vmime::streamContentHandler>(cts) != NULL);
+		vmime::string body;
+		vmime::utility::outputStreamStringAdapter os(body);
+		cts->extract(os);
+
+		VASSERT_EQ("Body", "BODY2", body);
+	}
+
+VMIME_TEST_SUITE_END
@@ -0,0 +1,77 @@
+//
+// VMime library (http://www.vmime.org)
+// Copyright (C) 2002 Vincent Richard <vincent@vmime.org>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 3 of
+// the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+// Linking this library statically or dynamically with other modules is making
+// a combined work based on this library.  Thus, the terms and conditions of
+// the GNU General Public License cover the whole combination.
+//
+
+#include "tests/testUtils.hpp"
+
+#include "vmime/utility/nullOutputStream.hpp"
+
+
+VMIME_TEST_SUITE_BEGIN(nullOutputStreamTest)
+
+	VMIME_TEST_LIST_BEGIN
+		VMIME_TEST(testWrite)
+		VMIME_TEST(testGeneratedSize)
+	VMIME_TEST_LIST_END
+
+
+	void testWrite() {
+
+		vmime::utility::nullOutputStream stream;
+
+		VASSERT_EQ("Initial", 0, stream.getByteCount());
+
+		stream << "some data";
+		stream.flush();
+
+		VASSERT_EQ("Write 1", 9, stream.getByteCount());
+
+		stream.write("\r\nmore data");
+
+		VASSERT_EQ("Write 2", 20, stream.getByteCount());
+
+		stream.advance(5);
+
+		VASSERT_EQ("Advance", 25, stream.getByteCount());
+	}
+
+	void testGeneratedSize() {
+
+		vmime::messageBuilder mb;
+		mb.setSubject(vmime::text("Test message"));
+		mb.setExpeditor(vmime::mailbox("me@vmime.org"));
+		mb.getRecipients().appendAddress(vmime::make_shared <vmime::mailbox>("you@vmime.org"));
+		mb.getTextPart()->setText(vmime::make_shared <vmime::stringContentHandler>("Message body"));
+
+		vmime::shared_ptr <vmime::message> msg = mb.construct();
+
+		vmime::string str;
+		vmime::utility::outputStreamStringAdapter strStream(str);
+		msg->generate(strStream);
+
+		vmime::utility::nullOutputStream nullStream;
+		msg->generate(nullStream);
+
+		VASSERT_EQ("Size", str.length(), nullStream.getByteCount());
+	}
+
+VMIME_TEST_SUITE_END
@@ -30,9 +30,53 @@ VMIME_TEST_SUITE_BEGIN(parserInputStreamAdapterTest)
 
 	VMIME_TEST_LIST_BEGIN
 		VMIME_TEST(testEndlessLoopBufferSize)
+		VMIME_TEST(testFindNext)
+		VMIME_TEST(testFindNextDirect)
+		VMIME_TEST(testExtract)
+		VMIME_TEST(testMatchBytes)
 	VMIME_TEST_LIST_END
 
 
+	// Hides the direct buffer, to test the stream-based code path
+	class indirectStringStream : public vmime::utility::inputStreamStringAdapter {
+
+	public:
+
+		indirectStringStream(const vmime::string& buffer)
+			: vmime::utility::inputStreamStringAdapter(buffer) {
+
+		}
+
+		const vmime::byte_t* getDirectBuffer(size_t* length) const {
+
+			*length = 0;
+			return NULL;
+		}
+	};
+
+
+	static const vmime::string createFindBuffer() {
+
+		vmime::string str(10000, 'X');
+		str.replace(4095, 5, "token");
+		str.replace(9995, 5, "token");
+
+		return str;
+	}
+
+	static void testFindNextImpl(
+		const vmime::shared_ptr <vmime::utility::parserInputStreamAdapter>& parser
+	) {
+
+		VASSERT_EQ("1", 4095, parser->findNext("token"));
+		VASSERT_EQ("2", 4095, parser->findNext("token", 4095));
+		VASSERT_EQ("3", 9995, parser->findNext("token", 4096));
+		VASSERT_EQ("4", vmime::string::npos, parser->findNext("token", 9996));
+		VASSERT_EQ("5", vmime::string::npos, parser->findNext("tokenY"));
+		VASSERT_EQ("Pos", 0, parser->getPosition());
+	}
+
+
 	void testEndlessLoopBufferSize() {
 
 		static const unsigned int BUFFER_SIZE = 4096;  // same as in parserInputStreamAdapter::findNext()
@@ -48,4 +92,83 @@ VMIME_TEST_SUITE_BEGIN(parserInputStreamAdapterTest)
 		VASSERT_EQ("Not found", vmime::string::npos, parser->findNext("token"));
 	}
 
+	void testFindNext() {
+
+		testFindNextImpl(
+			vmime::make_shared <vmime::utility::parserInputStreamAdapter>(
+				vmime::make_shared <indirectStringStream>(createFindBuffer())
+			)
+		);
+	}
+
+	void testFindNextDirect() {
+
+		vmime::shared_ptr <vmime::utility::parserInputStreamAdapter> parser =
+			vmime::make_shared <vmime::utility::parserInputStreamAdapter>(
+				vmime::make_shared <vmime::utility::inputStreamStringAdapter>(createFindBuffer())
+			);
+
+		size_t length = 0;
+		VASSERT_NOT_NULL("Direct", parser->getDirectBuffer(&length));
+		VASSERT_EQ("Length", 10000, length);
+
+		testFindNextImpl(parser);
+	}
+
+	void testExtract() {
+
+		const vmime::string str("THIS IS A TEST BUFFER");
+
+		vmime::shared_ptr <vmime::utility::parserInputStreamAdapter> parsers[] = {
+			vmime::make_shared <vmime::utility::parserInputStreamAdapter>(
+				vmime::make_shared <indirectStringStream>(str)
+			),
+			vmime::make_shared <vmime::utility::parserInputStreamAdapter>(
+				vmime::make_shared <vmime::utility::inputStreamStringAdapter>(str)
+			)
+		};
+
+		for (size_t i = 0 ; i < 2 ; ++i) {
+
+			parsers[i]->seek(3);
+
+			VASSERT_EQ("1", "TEST", parsers[i]->extract(10, 14));
+			VASSERT_EQ("2", "BUFFER", parsers[i]->extract(15, 100));
+			VASSERT_EQ("3", "", parsers[i]->extract(5, 5));
+			VASSERT_EQ("Pos", 3, parsers[i]->getPosition());
+		}
+	}
+
+	void testMatchBytes() {
+
+		const vmime::string str("THIS IS A TEST BUFFER");
+
+		vmime::shared_ptr <vmime::utility::parserInputStreamAdapter> parsers[] = {
+			vmime::make_shared <vmime::utility::parserInputStreamAdapter>(
+				vmime::make_shared <indirectStringStream>(str)
+			),
+			vmime::make_shared <vmime::utility::parserInputStreamAdapter>(
+				vmime::make_shared <vmime::utility::inputStreamStringAdapter>(str)
+			)
+		};
+
+		for (size_t i = 0 ; i < 2 ; ++i) {
+
+			parsers[i]->seek(10);
+
+			VASSERT_TRUE("1", parsers[i]->matchBytes("TEST", 4));
+			VASSERT_FALSE("2", parsers[i]->matchBytes("TESTX", 5));
+			VASSERT_EQ("3", 'T', parsers[i]->peekByte());
+			VASSERT_EQ("Pos", 10, parsers[i]->getPosition());
+
+			parsers[i]->seek(18);
+
+			VASSERT_FALSE("4", parsers[i]->matchBytes("FER ", 4));
+
+			parsers[i]->seek(21);
+
+			VASSERT_EQ("5", 0, parsers[i]->peekByte());
+		}
+	}
+
 VMIME_TEST_SUITE_END
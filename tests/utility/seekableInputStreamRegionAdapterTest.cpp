@@ -40,6 +40,7 @@ VMIME_TEST_SUITE_BEGIN(seekableInputStreamRegionAdapterTest)
 		VMIME_TEST(testSkip)
 		VMIME_TEST(testReset)
 		VMIME_TEST(testOwnPosition)
+		VMIME_TEST(testGetDirectBuffer)
 	VMIME_TEST_LIST_END
 
 
@@ -173,4 +174,26 @@ VMIME_TEST_SUITE_BEGIN(seekableInputStreamRegionAdapterTest)
 		VASSERT_EQ("Pos", 21, ustream->getPosition());
 	}
 
+	void testGetDirectBuffer() {
+
+		vmime::shared_ptr <seekableInputStream> ustream;
+		vmime::shared_ptr <seekableInputStreamRegionAdapter> stream = createStream(&ustream);
+
+		size_t length = 0;
+		const vmime::byte_t* buffer = stream->getDirectBuffer(&length);
+
+		VASSERT_NOT_NULL("Buffer", buffer);
+		VASSERT_EQ("Length", 11, length);
+		VASSERT_EQ("Data", "TEST BUFFER", vmime::utility::stringUtils::makeStringFromBytes(buffer, length));
+
+		// Region is truncated to the underlying stream
+		seekableInputStreamRegionAdapter stream2(ustream, 15, 100);
+
+		buffer = stream2.getDirectBuffer(&length);
+
+		VASSERT_NOT_NULL("Buffer 2", buffer);
+		VASSERT_EQ("Length 2", 6, length);
+		VASSERT_EQ("Data 2", "BUFFER", vmime::utility::stringUtils::makeStringFromBytes(buffer, length));
+	}
+
 VMIME_TEST_SUITE_END
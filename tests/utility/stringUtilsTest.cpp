@@ -42,6 +42,9 @@ VMIME_TEST_SUITE_BEGIN(stringUtilsTest)
 
 		VMIME_TEST(testCountASCIIChars)
 
+		VMIME_TEST(testFindFirstOf)
+		VMIME_TEST(testFindFirstOutsideRange)
+
 		VMIME_TEST(testUnquote)
 
 		VMIME_TEST(testIsValidHostname)
@@ -186,6 +189,45 @@ VMIME_TEST_SUITE_BEGIN(stringUtilsTest)
 		VASSERT_EQ("4", "quoted with \"escape\"", stringUtils::unquote("\"quoted with \\\"escape\\\"\""));  // "quoted with \"escape\""
 	}
 
+	void testFindFirstOf() {
+
+		// Long enough to be scanned by blocks, with matches in
+		// the first block, in a later block and in the tail
+		const vmime::string str =
+			"0123456789abcd_f0123456789abcdef0123456789abcdef=123";
+
+		const vmime::byte_t* begin = stringUtils::bytesFromString(str);
+		const vmime::byte_t* end = begin + str.length();
+
+		VASSERT_EQ("1", 14, stringUtils::findFirstOf(begin, end, '=', '_') - begin);
+		VASSERT_EQ("2", 48, stringUtils::findFirstOf(begin, end, '=', '=') - begin);
+		VASSERT_EQ("3", 48, stringUtils::findFirstOf(begin + 15, end, '_', '=') - begin);
+		VASSERT_EQ("4", 50, stringUtils::findFirstOf(begin + 49, end, '2', '3') - begin);
+		VASSERT_TRUE("5", stringUtils::findFirstOf(begin, end, '\r', '\n') == end);
+		VASSERT_TRUE("6", stringUtils::findFirstOf(begin, begin, '0', '1') == begin);
+	}
+
+	void testFindFirstOutsideRange() {
+
+		// Bytes below and above the range (including bytes with
+		// the high bit set), in blocks and in the tail
+		const vmime::string str =
+			"0123456789abcdef0123456789ab\x01" "def0123456789abcdef\xe9" "123";
+
+		const vmime::byte_t* begin = stringUtils::bytesFromString(str);
+		const vmime::byte_t* end = begin + str.length();
+
+		VASSERT_EQ("1", 28, stringUtils::findFirstOutsideRange(begin, end, '!', '~', '=', '?') - begin);
+		VASSERT_EQ("2", 48, stringUtils::findFirstOutsideRange(begin + 29, end, '!', '~', '=', '?') - begin);
+		VASSERT_EQ("3", 10, stringUtils::findFirstOutsideRange(begin, end, '!', '~', 'a', 'a') - begin);
+		VASSERT_EQ("4", 50, stringUtils::findFirstOutsideRange(begin + 49, end, '!', '~', '2', '2') - begin);
+		VASSERT_EQ("5", 28, stringUtils::findFirstOutsideRange(begin, end, '0', 'f', '=', '?') - begin);
+		VASSERT_EQ("6", 10, stringUtils::findFirstOutsideRange(begin, end, '0', '9', '=', '?') - begin);
+		VASSERT_TRUE("7", stringUtils::findFirstOutsideRange(begin + 49, end, '0', '9', '=', '?') == end);
+		VASSERT_TRUE("8", stringUtils::findFirstOutsideRange(begin, end, 0x00, 0xff, '=', '?') == end);
+		VASSERT_TRUE("9", stringUtils::findFirstOutsideRange(begin, begin, '0', '1', '=', '?') == begin);
+	}
+
 	void testIsValidHostname() {
 
 		VASSERT_TRUE ("1", stringUtils::isValidHostname("localhost"));